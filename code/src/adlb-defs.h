@@ -263,6 +263,8 @@ typedef struct
   bool permanent : 1;
   bool release_write_refs : 1;
   adlb_dsym symbol;
+  // Containers only: keep ordered index of keys for filtered enumerate
+  bool sorted_index : 1;
 } adlb_create_props;
 
 // Default settings for new variables
@@ -272,6 +274,7 @@ static const adlb_create_props DEFAULT_CREATE_PROPS = {
   false, /* permanent */
   false, /* release_write_refs */
   ADLB_DSYM_NULL, /* symbol */
+  false, /* sorted_index */
 };
 
 // Information for new variable creation
@@ -284,6 +287,31 @@ typedef struct {
 
 #pragma pack(pop) // Undo pragma change
 
+/**
+   Binary close notifications, sent as task payloads if
+   ADLB_BINARY_NOTIFS is set, or if the notification carries a value.
+   A batch is a header followed by count records, each an
+   adlb_notif_record followed by subscript_len bytes of subscript and
+   value_len bytes of packed value.  Records are not aligned: use
+   ADLB_Notif_next() to decode them.
+ */
+#define ADLB_NOTIF_BATCH_MAGIC 0x4e424c58 // "XLBN"
+
+#pragma pack(push, 1)
+typedef struct
+{
+  uint32_t magic;
+  int32_t count;
+} adlb_notif_batch_hdr;
+
+typedef struct
+{
+  adlb_datum_id id;
+  int32_t subscript_len;
+  int32_t value_len; // -1 if no value
+} adlb_notif_record;
+#pragma pack(pop)
+
 /* 
    Describe how refcounts should be changed
  */
@@ -312,6 +340,110 @@ static const adlb_retrieve_refc ADLB_RETRIEVE_ACQUIRE_REFC = {
       { 1, 0 }, /* incr_reference read and write refcounts */
 };
 
+/*
+   Resume position for enumerating a container in chunks.  Start from
+   ADLB_ENUM_CURSOR_START and pass back the cursor returned by the
+   previous call unmodified: the other fields are private to the server.
+ */
+typedef struct
+{
+  // Members already enumerated
+  int position;
+  // Container size when cursor was returned, to detect inserts
+  int stamp;
+  // Position in member storage
+  int chunk;
+  int slot;
+  int bucket;
+  int entry;
+} adlb_enum_cursor;
+
+static const adlb_enum_cursor ADLB_ENUM_CURSOR_START = {
+  0, /* position */
+  -1, /* stamp */
+  0, 0, 0, -1, /* storage position */
+};
+
+/*
+   Selection of container members for ADLB_Enumerate_filter
+ */
+typedef enum
+{
+  ADLB_ENUM_ALL,
+  ADLB_ENUM_RANGE, // Integer keys from lo to hi inclusive
+  ADLB_ENUM_PREFIX, // Keys starting with prefix
+} adlb_enum_filter_type;
+
+typedef struct
+{
+  adlb_enum_filter_type type;
+  int64_t lo;
+  int64_t hi;
+  // Prefix bytes: for string keys, without the null terminator
+  const void *prefix;
+  size_t prefix_len;
+  // Return members in key order: numeric for integer keys, otherwise
+  // bytewise
+  bool sorted;
+} adlb_enum_filter;
+
+/*
+   Atomic operations on integer and float data, executed by the server
+ */
+typedef enum
+{
+  ADLB_ATOMIC_ADD, // Fetch and add
+  ADLB_ATOMIC_CAS, // Compare and swap
+  ADLB_ATOMIC_MIN,
+  ADLB_ATOMIC_MAX,
+} adlb_atomic_op;
+
+// Operand or result of atomic operation, selected by data type
+typedef union
+{
+  int64_t INTEGER;
+  double FLOAT;
+} adlb_atomic_value;
+
+/*
+   Reductions over the values of a container or multiset, executed by
+   the server
+ */
+typedef enum
+{
+  ADLB_REDUCE_COUNT, // Number of values, for any value type
+  ADLB_REDUCE_SUM,
+  ADLB_REDUCE_MIN,
+  ADLB_REDUCE_MAX,
+  ADLB_REDUCE_HISTOGRAM,
+} adlb_reduce_op;
+
+#define ADLB_REDUCE_HIST_BINS_MAX 64
+
+typedef struct
+{
+  adlb_reduce_op op;
+  // Histogram only: equal width bins over [hist_lo, hist_hi)
+  double hist_lo;
+  double hist_hi;
+  int hist_bins;
+} adlb_reduce_spec;
+
+typedef struct
+{
+  // Number of values reduced: reserved members without values are
+  // not counted
+  int64_t count;
+  // Type of value: ADLB_DATA_TYPE_INTEGER or ADLB_DATA_TYPE_FLOAT
+  adlb_data_type type;
+  // Sum, min or max.  0 if there were no values
+  adlb_atomic_value value;
+  // Histogram counts, plus values outside range
+  int64_t hist[ADLB_REDUCE_HIST_BINS_MAX];
+  int64_t hist_under;
+  int64_t hist_over;
+} adlb_reduce_result;
+
 
 /**
    Common return codes
@@ -117,6 +117,13 @@ static adlb_code xlb_get_req_release(adlb_get_req* req,
 
 static adlb_code xlb_parallel_comm_setup(int parallelism, MPI_Comm* comm);
 
+static adlb_code xlb_enumerate(adlb_datum_id container_id,
+          int count, int offset, adlb_enum_cursor *cursor,
+          const adlb_enum_filter *filter, adlb_refc decr,
+          bool include_keys, bool include_vals,
+          void** data, size_t* length, int* records,
+          adlb_type_extra *kv_type);
+
 static void
 check_versions()
 {
@@ -132,6 +139,34 @@ check_versions()
 
 static inline int get_next_server();
 
+/**
+   Reference count changes held by a worker, cf. ADLB_REFC_BATCH.
+   One batch per server, indexed by server number.
+ */
+typedef struct {
+  struct packed_incr *changes;
+  int count;
+  int size;
+} refc_batch;
+
+static refc_batch *refc_batches = NULL;
+
+/** Total changes held in refc_batches */
+static int refc_pending = 0;
+
+static adlb_code refc_batch_add(adlb_datum_id id, adlb_refc change);
+static inline adlb_code refc_flush_pending(void);
+static void refc_batches_free(void);
+
+/**
+   Send held reference count changes before an operation that could
+   depend on them.  Note: ADLB_CHECK returns from the caller on error.
+ */
+#define REFC_FLUSH_PENDING() do {                      \
+    adlb_code __flush_rc = refc_flush_pending();       \
+    ADLB_CHECK(__flush_rc);                            \
+  } while (0)
+
 adlb_code
 ADLBP_Init(int nservers, int ntypes, int type_vect[],
            int *am_server, MPI_Comm comm, MPI_Comm *worker_comm)
@@ -169,6 +204,26 @@ ADLBP_Init(int nservers, int ntypes, int type_vect[],
   getenv_boolean("ADLB_PERF_COUNTERS", xlb_s.perfc_enabled,
                  &xlb_s.perfc_enabled);
 
+  xlb_s.binary_notifs = false;
+  getenv_boolean("ADLB_BINARY_NOTIFS", xlb_s.binary_notifs,
+                 &xlb_s.binary_notifs);
+
+  long notif_fanout = 16;
+  code = xlb_env_long("ADLB_NOTIF_FANOUT", &notif_fanout);
+  CHECK_MSG(code != ADLB_ERROR && notif_fanout >= 0 &&
+            notif_fanout <= INT_MAX, "Invalid ADLB_NOTIF_FANOUT");
+  xlb_s.notif_fanout = (int)notif_fanout;
+
+  long refc_batch = 0;
+  code = xlb_env_long("ADLB_REFC_BATCH", &refc_batch);
+  CHECK_MSG(code != ADLB_ERROR && refc_batch >= 0 &&
+            refc_batch <= INT_MAX, "Invalid ADLB_REFC_BATCH");
+  xlb_s.refc_batch = (int)refc_batch;
+
+  xlb_s.dput_placement = false;
+  getenv_boolean("ADLB_DPUT_PLACEMENT", xlb_s.dput_placement,
+                 &xlb_s.dput_placement);
+
   next_server = xlb_s.layout.my_server;
 
   code = xlb_dsyms_init();
@@ -334,6 +389,8 @@ ADLBP_Put(const void* payload, int length, int target, int answer,
   adlb_code rc;
   int response;
 
+  REFC_FLUSH_PENDING();
+
   DEBUG("ADLB_Put: type=%i target=%i priority=%i strictness=%i "
         "accuracy=%i x%i %.*s", type, target, opts.priority,
         opts.strictness, opts.accuracy, opts.parallelism, length,
@@ -404,6 +461,62 @@ ADLBP_Put(const void* payload, int length, int target, int answer,
   return ADLB_SUCCESS;
 }
 
+static inline adlb_datum_id
+dput_input_id(const adlb_datum_id *wait_ids, int wait_id_count,
+              const adlb_datum_id_sub *wait_id_subs, int i)
+{
+  return (i < wait_id_count) ? wait_ids[i] :
+                               wait_id_subs[i - wait_id_count].id;
+}
+
+/*
+  Find server owning a majority of inputs of a data-dependent task,
+  so that the engine there can subscribe to them locally.
+  return: the server, or default_server if no server has a majority
+ */
+static int
+dput_majority_server(const adlb_datum_id *wait_ids, int wait_id_count,
+        const adlb_datum_id_sub *wait_id_subs, int wait_id_sub_count,
+        int default_server)
+{
+  int total = wait_id_count + wait_id_sub_count;
+
+  // Boyer-Moore majority vote: finds majority if there is one
+  int candidate = default_server;
+  int votes = 0;
+  for (int i = 0; i < total; i++)
+  {
+    int server = ADLB_Locate(dput_input_id(wait_ids, wait_id_count,
+                                           wait_id_subs, i));
+    if (votes == 0)
+    {
+      candidate = server;
+      votes = 1;
+    }
+    else if (server == candidate)
+    {
+      votes++;
+    }
+    else
+    {
+      votes--;
+    }
+  }
+
+  if (candidate == default_server)
+    return default_server;
+
+  // Check candidate actually has majority
+  int owned = 0;
+  for (int i = 0; i < total; i++)
+  {
+    if (ADLB_Locate(dput_input_id(wait_ids, wait_id_count,
+                                  wait_id_subs, i)) == candidate)
+      owned++;
+  }
+  return (owned * 2 > total) ? candidate : default_server;
+}
+
 adlb_code ADLBP_Dput(const void* payload, int length, int target,
         int answer, int type, adlb_put_opts opts, const char *name,
         const adlb_datum_id *wait_ids, int wait_id_count,
@@ -414,6 +527,8 @@ adlb_code ADLBP_Dput(const void* payload, int length, int target,
   int response;
   adlb_code rc;
 
+  REFC_FLUSH_PENDING();
+
   DEBUG("ADLB_Dput: target=%i x%i %.*s",
         target, opts.parallelism, length, (char*) payload);
 
@@ -425,6 +540,13 @@ adlb_code ADLBP_Dput(const void* payload, int length, int target,
   rc = adlb_put_target_server(target, &to_server);
   ADLB_CHECK(rc);
 
+  if (xlb_s.dput_placement && target == ADLB_RANK_ANY)
+  {
+    // Task is released from server where it waits
+    to_server = dput_majority_server(wait_ids, wait_id_count,
+                    wait_id_subs, wait_id_sub_count, to_server);
+  }
+
   int inline_data_len;
   if (length <= PUT_INLINE_DATA_MAX)
   {
@@ -522,6 +644,8 @@ ADLBP_Get(int type_requested, void* payload, int* length,
 
   TRACE_START;
 
+  REFC_FLUSH_PENDING();
+
   CHECK_MSG(type_requested >= 0 && type_requested < xlb_s.types_size,
                 "ADLB_Get(): Bad work type: %i\n", type_requested);
 
@@ -596,6 +720,8 @@ ADLBP_Iget(int type_requested, void* payload, int* length,
   MPI_Status status;
   MPI_Request request;
 
+  REFC_FLUSH_PENDING();
+
   CHECK_MSG(type_requested >= 0 && type_requested < xlb_s.types_size,
             "ADLB_Iget(): Bad work type: %i\n", type_requested);
 
@@ -784,6 +910,8 @@ adlb_code ADLBP_Amget(int type_requested, int nreqs, bool wait,
     return ADLB_SUCCESS;
   }
 
+  REFC_FLUSH_PENDING();
+
   CHECK_MSG(type_requested >= 0 && type_requested < xlb_s.types_size,
                 "ADLB_Amget(): Bad work type: %i\n", type_requested);
 
@@ -1261,6 +1389,8 @@ ADLBP_Exists(adlb_datum_id id, adlb_subscript subscript, bool* result,
 {
   int to_server_rank = ADLB_Locate(id);
 
+  REFC_FLUSH_PENDING();
+
   MPI_Status status;
   MPI_Request request;
 
@@ -1291,6 +1421,8 @@ ADLBP_Refcount_get(adlb_datum_id id, adlb_refc *result,
 {
   int to_server_rank = ADLB_Locate(id);
 
+  REFC_FLUSH_PENDING();
+
   MPI_Status status;
   MPI_Request request;
 
@@ -1343,6 +1475,8 @@ xlb_store(adlb_datum_id id, adlb_subscript subscript,
   MPI_Status status;
   MPI_Request request;
 
+  REFC_FLUSH_PENDING();
+
   CHECK_MSG(length < ADLB_DATA_MAX,
             "ADLB_Store(): value too long: %llu max: %llu\n",
             (long long unsigned) length, ADLB_DATA_MAX);
@@ -1450,6 +1584,13 @@ ADLBP_Refcount_incr(adlb_datum_id id, adlb_refc change)
 {
   adlb_code rc;
 
+  if (xlb_s.refc_batch > 0 && !xlb_s.layout.am_server)
+  {
+    rc = refc_batch_add(id, change);
+    ADLB_CHECK(rc);
+    return ADLB_SUCCESS;
+  }
+
   adlb_notif_t notifs = ADLB_NO_NOTIFS;
   rc = xlb_refcount_incr(id, change, &notifs);
   ADLB_CHECK(rc);
@@ -1503,6 +1644,165 @@ xlb_refcount_incr(adlb_datum_id id, adlb_refc change,
   return ADLB_SUCCESS;
 }
 
+/*
+  Merge change into held changes for id, sending all held changes if
+  there are too many
+ */
+static adlb_code
+refc_batch_add(adlb_datum_id id, adlb_refc change)
+{
+  if (!xlb_s.read_refc_enabled)
+    change.read_refcount = 0;
+
+  if (ADLB_REFC_IS_NULL(change))
+    return ADLB_SUCCESS;
+
+  if (refc_batches == NULL)
+  {
+    refc_batches = calloc((size_t)xlb_s.layout.servers,
+                          sizeof(refc_batches[0]));
+    ADLB_MALLOC_CHECK(refc_batches);
+  }
+
+  int server = ADLB_Locate(id);
+  refc_batch *batch =
+      &refc_batches[server - xlb_s.layout.master_server_rank];
+
+  // Ids tend to be reused soon, so search most recent first
+  for (int i = batch->count - 1; i >= 0; i--)
+  {
+    struct packed_incr *incr = &batch->changes[i];
+    if (incr->id == id)
+    {
+      incr->change.read_refcount += change.read_refcount;
+      incr->change.write_refcount += change.write_refcount;
+      if (ADLB_REFC_IS_NULL(incr->change))
+      {
+        // Cancelled out: drop it
+        *incr = batch->changes[--batch->count];
+        refc_pending--;
+      }
+      return ADLB_SUCCESS;
+    }
+  }
+
+  if (batch->count == batch->size)
+  {
+    int new_size = (batch->size == 0) ? 16 : batch->size * 2;
+    struct packed_incr *tmp = realloc(batch->changes,
+                                      sizeof(tmp[0]) * (size_t)new_size);
+    ADLB_MALLOC_CHECK(tmp);
+    batch->changes = tmp;
+    batch->size = new_size;
+  }
+
+  batch->changes[batch->count].id = id;
+  batch->changes[batch->count].change = change;
+  batch->count++;
+  refc_pending++;
+
+  DEBUG("ADLB_Refcount_incr: held "ADLB_PRID" READ %i WRITE %i",
+        ADLB_PRID_ARGS(id, ADLB_DSYM_NULL),
+        change.read_refcount, change.write_refcount);
+
+  if (refc_pending >= xlb_s.refc_batch)
+  {
+    adlb_code rc = ADLBP_Refcount_flush();
+    ADLB_CHECK(rc);
+  }
+  return ADLB_SUCCESS;
+}
+
+/*
+  Send batch of held changes to server.  Notifications resulting
+  from the changes are added to notifs.
+ */
+static adlb_code
+refc_batch_send(int server, const refc_batch *batch, adlb_notif_t *notifs)
+{
+  MPI_Status status;
+  MPI_Request request;
+
+  DEBUG("ADLB_Refcount_flush: %i changes to %i", batch->count, server);
+
+  struct packed_incr_batch hdr = { .count = batch->count };
+  struct packed_incr_resp resp;
+  IRECV(&resp, sizeof(resp), MPI_BYTE, server, ADLB_TAG_RESPONSE);
+  SEND(&hdr, sizeof(hdr), MPI_BYTE, server, ADLB_TAG_REFCOUNT_INCR_BATCH);
+  SEND(batch->changes, (int)sizeof(batch->changes[0]) * batch->count,
+       MPI_BYTE, server, ADLB_TAG_WORK);
+  WAIT(&request, &status);
+
+  if (!resp.success)
+    return ADLB_ERROR;
+
+  adlb_code ac = xlb_recv_notif_work(&resp.notifs, server, notifs);
+  ADLB_CHECK(ac);
+
+  return ADLB_SUCCESS;
+}
+
+adlb_code
+ADLBP_Refcount_flush(void)
+{
+  if (refc_pending == 0)
+    return ADLB_SUCCESS;
+
+  adlb_code rc;
+  adlb_notif_t notifs = ADLB_NO_NOTIFS;
+
+  for (int i = 0; i < xlb_s.layout.servers; i++)
+  {
+    refc_batch *batch = &refc_batches[i];
+    if (batch->count > 0)
+    {
+      rc = refc_batch_send(xlb_s.layout.master_server_rank + i, batch,
+                           &notifs);
+      // Drop batch even if send failed, so counts stay consistent
+      refc_pending -= batch->count;
+      batch->count = 0;
+      if (rc == ADLB_ERROR)
+      {
+        xlb_free_notif(&notifs);
+        ADLB_CHECK(rc);
+      }
+    }
+  }
+  assert(refc_pending == 0);
+
+  // Notifications may call back into ADLB, so only once all are sent
+  rc = xlb_notify_all(&notifs);
+  ADLB_CHECK(rc);
+
+  xlb_free_notif(&notifs);
+
+  return ADLB_SUCCESS;
+}
+
+static inline adlb_code
+refc_flush_pending(void)
+{
+  if (refc_pending == 0)
+    return ADLB_SUCCESS;
+
+  return ADLBP_Refcount_flush();
+}
+
+static void
+refc_batches_free(void)
+{
+  if (refc_batches == NULL)
+    return;
+
+  for (int i = 0; i < xlb_s.layout.servers; i++)
+  {
+    free(refc_batches[i].changes);
+  }
+  free(refc_batches);
+  refc_batches = NULL;
+  refc_pending = 0;
+}
+
 adlb_code
 ADLBP_Insert_atomic(adlb_datum_id id, adlb_subscript subscript,
                        adlb_retrieve_refc refcounts,
@@ -1514,6 +1814,8 @@ ADLBP_Insert_atomic(adlb_datum_id id, adlb_subscript subscript,
   MPI_Request request;
   struct packed_insert_atomic_resp resp;
 
+  REFC_FLUSH_PENDING();
+
   DEBUG("ADLB_Insert_atomic: "ADLB_PRIDSUB,
         ADLB_PRIDSUB_ARGS(id, ADLB_DSYM_NULL, subscript));
   char *xfer_pos = xlb_xfer;
@@ -1561,6 +1863,131 @@ ADLBP_Insert_atomic(adlb_datum_id id, adlb_subscript subscript,
   return ADLB_SUCCESS;
 }
 
+adlb_code
+ADLBP_Atomic(adlb_datum_id id, adlb_atomic_op op, adlb_data_type type,
+             const adlb_atomic_value *operand,
+             const adlb_atomic_value *compare,
+             adlb_refc refcount_decr,
+             adlb_atomic_value *old_value, bool *old_set,
+             bool *updated)
+{
+  int rc;
+  adlb_code ac;
+  MPI_Status status;
+  MPI_Request request;
+
+  REFC_FLUSH_PENDING();
+
+  DEBUG("ADLB_Atomic: "ADLB_PRID" op %i",
+        ADLB_PRID_ARGS(id, ADLB_DSYM_NULL), op);
+
+  struct packed_atomic msg;
+  memset(&msg, 0, sizeof(msg));
+  msg.id = id;
+  msg.op = op;
+  msg.type = type;
+  msg.operand = *operand;
+  if (compare != NULL)
+    msg.compare = *compare;
+  msg.refcount_decr = refcount_decr;
+
+  int to_server_rank = ADLB_Locate(id);
+
+  struct packed_atomic_resp resp;
+  rc = MPI_Irecv(&resp, sizeof(resp), MPI_BYTE, to_server_rank,
+                 ADLB_TAG_RESPONSE, xlb_s.comm, &request);
+  MPI_CHECK(rc);
+  rc = MPI_Send(&msg, sizeof(msg), MPI_BYTE, to_server_rank,
+                ADLB_TAG_ATOMIC, xlb_s.comm);
+  MPI_CHECK(rc);
+  rc = MPI_Wait(&request, &status);
+  MPI_CHECK(rc);
+
+  if (resp.dc != ADLB_DATA_SUCCESS)
+  {
+    if (resp.dc == ADLB_DATA_ERROR_DOUBLE_WRITE)
+      return ADLB_REJECTED;
+    return ADLB_ERROR;
+  }
+
+  ac = xlb_handle_client_notif_work(&resp.notifs, to_server_rank);
+  ADLB_CHECK(ac);
+
+  if (old_value != NULL)
+    *old_value = resp.old_value;
+  if (old_set != NULL)
+    *old_set = resp.old_set;
+  if (updated != NULL)
+    *updated = resp.updated;
+  return ADLB_SUCCESS;
+}
+
+static adlb_code
+xlb_reduce_request(const struct packed_reduce *msg,
+                   adlb_reduce_result *result)
+{
+  int rc;
+  MPI_Status status;
+  MPI_Request request;
+
+  REFC_FLUSH_PENDING();
+
+  int to_server_rank = ADLB_Locate(msg->id);
+
+  struct packed_reduce_resp resp;
+  rc = MPI_Irecv(&resp, sizeof(resp), MPI_BYTE, to_server_rank,
+                 ADLB_TAG_RESPONSE, xlb_s.comm, &request);
+  MPI_CHECK(rc);
+  rc = MPI_Send(msg, sizeof(*msg), MPI_BYTE, to_server_rank,
+                ADLB_TAG_REDUCE, xlb_s.comm);
+  MPI_CHECK(rc);
+  rc = MPI_Wait(&request, &status);
+  MPI_CHECK(rc);
+
+  if (resp.dc != ADLB_DATA_SUCCESS)
+    return ADLB_ERROR;
+
+  if (result != NULL)
+    *result = resp.result;
+  return ADLB_SUCCESS;
+}
+
+adlb_code
+ADLBP_Reduce(adlb_datum_id id, const adlb_reduce_spec *spec,
+             adlb_refc decr, adlb_reduce_result *result)
+{
+  DEBUG("ADLB_Reduce: "ADLB_PRID" op %i",
+        ADLB_PRID_ARGS(id, ADLB_DSYM_NULL), spec->op);
+
+  struct packed_reduce msg;
+  memset(&msg, 0, sizeof(msg));
+  msg.id = id;
+  msg.spec = *spec;
+  msg.decr = decr;
+  msg.on_close = false;
+  msg.result_id = ADLB_DATA_ID_NULL;
+  return xlb_reduce_request(&msg, result);
+}
+
+adlb_code
+ADLBP_Reduce_on_close(adlb_datum_id id, const adlb_reduce_spec *spec,
+                      adlb_datum_id result_id, int write_decr)
+{
+  DEBUG("ADLB_Reduce_on_close: "ADLB_PRID" op %i => "ADLB_PRID,
+        ADLB_PRID_ARGS(id, ADLB_DSYM_NULL), spec->op,
+        ADLB_PRID_ARGS(result_id, ADLB_DSYM_NULL));
+
+  struct packed_reduce msg;
+  memset(&msg, 0, sizeof(msg));
+  msg.id = id;
+  msg.spec = *spec;
+  msg.decr = ADLB_NO_REFC;
+  msg.on_close = true;
+  msg.result_id = result_id;
+  msg.write_decr = write_decr;
+  return xlb_reduce_request(&msg, NULL);
+}
+
 adlb_code
 ADLBP_Retrieve(adlb_datum_id id, adlb_subscript subscript,
                adlb_retrieve_refc refcounts, adlb_data_type* type,
@@ -1569,6 +1996,8 @@ ADLBP_Retrieve(adlb_datum_id id, adlb_subscript subscript,
   MPI_Status status;
   MPI_Request request;
 
+  REFC_FLUSH_PENDING();
+
   int to_server_rank = ADLB_Locate(id);
 
   size_t subscript_len = adlb_has_sub(subscript) ?
@@ -1629,25 +2058,90 @@ ADLBP_Enumerate(adlb_datum_id container_id,
                 bool include_keys, bool include_vals,
                 void** data, size_t* length, int* records,
                 adlb_type_extra *kv_type)
+{
+  return xlb_enumerate(container_id, count, offset, NULL, NULL, decr,
+                       include_keys, include_vals, data, length, records,
+                       kv_type);
+}
+
+adlb_code
+ADLBP_Enumerate_cursor(adlb_datum_id container_id,
+                int count, adlb_enum_cursor *cursor, adlb_refc decr,
+                bool include_keys, bool include_vals,
+                void** data, size_t* length, int* records,
+                adlb_type_extra *kv_type)
+{
+  assert(cursor != NULL);
+  return xlb_enumerate(container_id, count, 0, cursor, NULL, decr,
+                       include_keys, include_vals, data, length, records,
+                       kv_type);
+}
+
+adlb_code
+ADLBP_Enumerate_filter(adlb_datum_id container_id,
+                int count, int offset, const adlb_enum_filter *filter,
+                adlb_refc decr, bool include_keys, bool include_vals,
+                void** data, size_t* length, int* records,
+                adlb_type_extra *kv_type)
+{
+  assert(filter != NULL);
+  return xlb_enumerate(container_id, count, offset, NULL, filter, decr,
+                       include_keys, include_vals, data, length, records,
+                       kv_type);
+}
+
+/**
+   cursor: if not NULL, ignore offset and start at cursor, then
+           update cursor to continue from next call
+   filter: if not NULL, only return members that pass filter
+ */
+static adlb_code
+xlb_enumerate(adlb_datum_id container_id,
+              int count, int offset, adlb_enum_cursor *cursor,
+              const adlb_enum_filter *filter, adlb_refc decr,
+              bool include_keys, bool include_vals,
+              void** data, size_t* length, int* records,
+              adlb_type_extra *kv_type)
 {
   MPI_Status status;
   MPI_Request request;
 
+  REFC_FLUSH_PENDING();
+
   int to_server_rank = ADLB_Locate(container_id);
 
-  struct packed_enumerate opts;
-  opts.id = container_id;
+  size_t prefix_len = 0;
+  if (filter != NULL && filter->type == ADLB_ENUM_PREFIX)
+  {
+    prefix_len = filter->prefix_len;
+    CHECK_MSG(prefix_len <= ADLB_DATA_SUBSCRIPT_MAX,
+              "Enumeration prefix too long: %zu", prefix_len);
+  }
+
+  size_t req_length = sizeof(struct packed_enumerate) + prefix_len;
+  assert(req_length <= ADLB_XFER_SIZE);
+  struct packed_enumerate *opts = (struct packed_enumerate*)xlb_xfer;
+  opts->id = container_id;
   // Are we requesting subscripts?
-  opts.request_subscripts = include_keys;
+  opts->request_subscripts = include_keys;
   // Are we requesting members?
-  opts.request_members = include_vals;
-  opts.count = count;
-  opts.offset = offset;
-  opts.decr = decr;
+  opts->request_members = include_vals;
+  opts->count = count;
+  opts->offset = offset;
+  opts->use_cursor = (cursor != NULL);
+  opts->cursor = (cursor != NULL) ? *cursor : ADLB_ENUM_CURSOR_START;
+  opts->decr = decr;
+  opts->filter_type = (filter != NULL) ? filter->type : ADLB_ENUM_ALL;
+  opts->sorted = (filter != NULL) && filter->sorted;
+  opts->lo = (filter != NULL) ? filter->lo : 0;
+  opts->hi = (filter != NULL) ? filter->hi : 0;
+  opts->prefix_len = (int)prefix_len;
+  if (prefix_len > 0)
+    memcpy(opts->prefix, filter->prefix, prefix_len);
 
   struct packed_enumerate_result res;
   IRECV(&res, sizeof(res), MPI_BYTE, to_server_rank, ADLB_TAG_RESPONSE);
-  SEND(&opts, sizeof(struct packed_enumerate), MPI_BYTE,
+  SEND(xlb_xfer, (int)req_length, MPI_BYTE,
        to_server_rank, ADLB_TAG_ENUMERATE);
   WAIT(&request,&status);
 
@@ -1667,6 +2161,8 @@ ADLBP_Enumerate(adlb_datum_id container_id,
     kv_type->valid = true;
     kv_type->CONTAINER.key_type = res.key_type;
     kv_type->CONTAINER.val_type = res.val_type;
+    if (cursor != NULL)
+      *cursor = res.cursor;
     return ADLB_SUCCESS;
   }
   else
@@ -1750,6 +2246,8 @@ ADLBP_Typeof(adlb_datum_id id, adlb_data_type* type)
   MPI_Status status;
   MPI_Request request;
 
+  REFC_FLUSH_PENDING();
+
   int to_server_rank = ADLB_Locate(id);
   IRECV(type, 1, MPI_INT, to_server_rank, ADLB_TAG_RESPONSE);
   SEND(&id, 1, MPI_ADLB_ID, to_server_rank, ADLB_TAG_TYPEOF);
@@ -1771,6 +2269,8 @@ ADLBP_Container_typeof(adlb_datum_id id, adlb_data_type* key_type,
   MPI_Request request;
   // DEBUG("ADLB_Container_typeof: %li", id);
 
+  REFC_FLUSH_PENDING();
+
   int to_server_rank = ADLB_Locate(id);
   adlb_data_type types[2];
   IRECV(types, 2, MPI_INT, to_server_rank, ADLB_TAG_RESPONSE);
@@ -1790,21 +2290,25 @@ ADLBP_Container_typeof(adlb_datum_id id, adlb_data_type* key_type,
 
 /**
    @param work_type work type to receive notification as
+   @param with_value ask for value to be sent with notification
    @param subscribed output: false if data is already closed
                              or ADLB_ERROR on error
  */
-adlb_code
-ADLBP_Subscribe(adlb_datum_id id, adlb_subscript subscript,
-                int work_type, int* subscribed)
+static adlb_code
+xlb_subscribe(adlb_datum_id id, adlb_subscript subscript,
+              int work_type, bool with_value, int* subscribed)
 {
   int to_server_rank;
   MPI_Status status;
   MPI_Request request;
 
+  REFC_FLUSH_PENDING();
+
   to_server_rank = ADLB_Locate(id);
 
   char *xfer_pos = xlb_xfer;
   MSG_PACK_BIN(xfer_pos, work_type);
+  MSG_PACK_BIN(xfer_pos, with_value);
   xfer_pos += xlb_pack_id_sub(xfer_pos, id, subscript);
 
   int req_length = (int)(xfer_pos - xlb_xfer);
@@ -1854,6 +2358,20 @@ ADLBP_Subscribe(adlb_datum_id id, adlb_subscript subscript,
   }
 }
 
+adlb_code
+ADLBP_Subscribe(adlb_datum_id id, adlb_subscript subscript,
+                int work_type, int* subscribed)
+{
+  return xlb_subscribe(id, subscript, work_type, false, subscribed);
+}
+
+adlb_code
+ADLBP_Subscribe_value(adlb_datum_id id, adlb_subscript subscript,
+                      int work_type, int* subscribed)
+{
+  return xlb_subscribe(id, subscript, work_type, true, subscribed);
+}
+
 /**
    This consumes a read reference count to the container
    @return false in subscribed if data is already closed
@@ -1867,6 +2385,8 @@ ADLBP_Container_reference(adlb_datum_id id, adlb_subscript subscript,
   MPI_Status status;
   MPI_Request request;
 
+  REFC_FLUSH_PENDING();
+
   char *xfer_pos = xlb_xfer;
 
   MSG_PACK_BIN(xfer_pos, ref_type);
@@ -1911,6 +2431,8 @@ ADLBP_Container_size(adlb_datum_id container_id, int* size,
   MPI_Status status;
   MPI_Request request;
 
+  REFC_FLUSH_PENDING();
+
   int to_server_rank = ADLB_Locate(container_id);
 
   struct packed_size_req req = { .id = container_id, .decr = decr };
@@ -1930,18 +2452,26 @@ ADLBP_Container_size(adlb_datum_id container_id, int* size,
 /**
    @return result 0->try again, 1->locked
  */
-adlb_code
-ADLBP_Lock(adlb_datum_id id, bool* result)
+static adlb_code
+xlb_lock(adlb_datum_id id, bool wait, double timeout, bool* result)
 {
   MPI_Status status;
   MPI_Request request;
 
+  REFC_FLUSH_PENDING();
+
   int to_server_rank = ADLB_Locate(id);
 
+  struct packed_lock msg;
+  memset(&msg, 0, sizeof(msg));
+  msg.id = id;
+  msg.wait = wait;
+  msg.timeout = timeout;
+
   // c 0->try again, 1->locked, x->failed
   char c;
   IRECV(&c, 1, MPI_CHAR, to_server_rank, ADLB_TAG_RESPONSE);
-  SEND(&id, 1, MPI_ADLB_ID, to_server_rank, ADLB_TAG_LOCK);
+  SEND(&msg, sizeof(msg), MPI_BYTE, to_server_rank, ADLB_TAG_LOCK);
   WAIT(&request, &status);
 
   if (c == 'x')
@@ -1957,6 +2487,18 @@ ADLBP_Lock(adlb_datum_id id, bool* result)
   return ADLB_SUCCESS;
 }
 
+adlb_code
+ADLBP_Lock(adlb_datum_id id, bool* result)
+{
+  return xlb_lock(id, false, 0.0, result);
+}
+
+adlb_code
+ADLBP_Lock_wait(adlb_datum_id id, double timeout, bool* result)
+{
+  return xlb_lock(id, true, timeout, result);
+}
+
 /**
    @return result 0->try again, 1->locked
  */
@@ -1966,6 +2508,8 @@ ADLBP_Unlock(adlb_datum_id id)
   MPI_Status status;
   MPI_Request request;
 
+  REFC_FLUSH_PENDING();
+
   int to_server_rank = ADLB_Locate(id);
 
   // c: 1->success, x->failed
@@ -2055,6 +2599,8 @@ ADLBP_Finalize()
     // Worker:
     if (!got_shutdown)
     {
+      REFC_FLUSH_PENDING();
+
       rc = ADLB_Shutdown();
       ADLB_CHECK(rc);
     }
@@ -2077,6 +2623,8 @@ ADLBP_Finalize()
   rc = xlb_get_reqs_finalize();
   ADLB_CHECK(rc);
 
+  refc_batches_free();
+
   // Get messaging module to clean up state
   xlb_msg_finalize();
 
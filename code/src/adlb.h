@@ -333,13 +333,65 @@ adlb_code ADLB_Enumerate(adlb_datum_id container_id,
                    void** data, size_t* length, int* records,
                    adlb_type_extra *kv_type);
 
+/*
+   List contents of container in chunks, continuing where the previous
+   call left off.  Each call costs time proportional to count rather
+   than to the position in the container.  If members were added since
+   the previous call, the server falls back to counting from the start.
+
+   cursor: in/out.  Initialize to ADLB_ENUM_CURSOR_START, and pass back
+           unmodified for the next chunk.
+   Other arguments as for ADLB_Enumerate().
+ */
+adlb_code ADLBP_Enumerate_cursor(adlb_datum_id container_id,
+                   int count, adlb_enum_cursor *cursor, adlb_refc decr,
+                   bool include_keys, bool include_vals,
+                   void** data, size_t* length, int* records,
+                   adlb_type_extra *kv_type);
+adlb_code ADLB_Enumerate_cursor(adlb_datum_id container_id,
+                   int count, adlb_enum_cursor *cursor, adlb_refc decr,
+                   bool include_keys, bool include_vals,
+                   void** data, size_t* length, int* records,
+                   adlb_type_extra *kv_type);
+
+/*
+   List container members that pass a filter: integer keys in the
+   range [lo, hi], or keys starting with prefix.  If filter->sorted,
+   members are returned in key order.  offset and count select from
+   the matching members.  Containers created with the sorted_index
+   property answer these from an ordered index; otherwise the server
+   scans all members.
+   Other arguments as for ADLB_Enumerate().
+ */
+adlb_code ADLBP_Enumerate_filter(adlb_datum_id container_id,
+                   int count, int offset, const adlb_enum_filter *filter,
+                   adlb_refc decr, bool include_keys, bool include_vals,
+                   void** data, size_t* length, int* records,
+                   adlb_type_extra *kv_type);
+adlb_code ADLB_Enumerate_filter(adlb_datum_id container_id,
+                   int count, int offset, const adlb_enum_filter *filter,
+                   adlb_refc decr, bool include_keys, bool include_vals,
+                   void** data, size_t* length, int* records,
+                   adlb_type_extra *kv_type);
+
 // Switch on read refcounting and memory management, which is off by default
 adlb_code ADLBP_Read_refcount_enable(void);
 adlb_code ADLB_Read_refcount_enable(void);
 
+/*
+  Change reference counts.  If ADLB_REFC_BATCH is set, workers hold
+  changes and send them in one message per server at the next
+  ADLB_Get, other data or task operation, or ADLB_Refcount_flush.
+  Changes for the same id are merged.
+ */
 adlb_code ADLBP_Refcount_incr(adlb_datum_id id, adlb_refc change);
 adlb_code ADLB_Refcount_incr(adlb_datum_id id, adlb_refc change);
 
+// Send any reference count changes held by this client.  On error,
+// changes that could not be sent are dropped.
+adlb_code ADLBP_Refcount_flush(void);
+adlb_code ADLB_Refcount_flush(void);
+
 /*
   Try to reserve an insert position in container
   result: true if could be created, false if already present/reserved
@@ -362,6 +414,68 @@ adlb_code ADLB_Insert_atomic(adlb_datum_id id, adlb_subscript subscript,
                         bool *result, bool *value_present,
                         void *data, size_t *length, adlb_data_type *type);
 
+/*
+  Atomically update an integer or float datum on its server, in one
+  round trip.  The datum must still have a write reference.
+  op: ADLB_ATOMIC_ADD adds operand.  Integer overflow is an error
+      and leaves the value unchanged.
+      ADLB_ATOMIC_CAS stores operand if the value equals compare.
+      ADLB_ATOMIC_MIN/MAX store operand if less/greater than the value.
+      If the datum is not yet set, ADD, MIN and MAX store operand and
+      CAS does nothing.
+  type: ADLB_DATA_TYPE_INTEGER or ADLB_DATA_TYPE_FLOAT, must match datum
+  compare: only used by CAS, may be NULL otherwise
+  refcount_decr: refcounts to release after the update, e.g. to close
+        the datum with its final value.  Notifications are sent as
+        for a store.
+  old_value: if not NULL, set to the value before the operation
+  old_set: if not NULL, set to whether the datum was set before
+  updated: if not NULL, set to whether the value was changed
+  returns: ADLB_REJECTED if datum has no write references left
+ */
+adlb_code ADLBP_Atomic(adlb_datum_id id, adlb_atomic_op op,
+                       adlb_data_type type,
+                       const adlb_atomic_value *operand,
+                       const adlb_atomic_value *compare,
+                       adlb_refc refcount_decr,
+                       adlb_atomic_value *old_value, bool *old_set,
+                       bool *updated);
+adlb_code ADLB_Atomic(adlb_datum_id id, adlb_atomic_op op,
+                      adlb_data_type type,
+                      const adlb_atomic_value *operand,
+                      const adlb_atomic_value *compare,
+                      adlb_refc refcount_decr,
+                      adlb_atomic_value *old_value, bool *old_set,
+                      bool *updated);
+
+/*
+  Reduce the values of a container or multiset on its server, without
+  transferring the members.  Reserved members with no value are
+  skipped.  Does not wait for the container to be closed.
+  spec: operation.  COUNT works for all value types; SUM, MIN, MAX and
+        HISTOGRAM require integer or float values.
+  decr: refcounts to release after reducing
+ */
+adlb_code ADLBP_Reduce(adlb_datum_id id, const adlb_reduce_spec *spec,
+                       adlb_refc decr, adlb_reduce_result *result);
+adlb_code ADLB_Reduce(adlb_datum_id id, const adlb_reduce_spec *spec,
+                      adlb_refc decr, adlb_reduce_result *result);
+
+/*
+  Have the server reduce a container or multiset once it is closed, and
+  store the result into result_id, which must be an integer datum for
+  COUNT, or otherwise of the value type.  HISTOGRAM is not supported.
+  If already closed, the result is stored immediately.  MIN and MAX of
+  no values are stored as 0.
+  write_decr: write refcount to release on result_id after storing
+ */
+adlb_code ADLBP_Reduce_on_close(adlb_datum_id id,
+        const adlb_reduce_spec *spec, adlb_datum_id result_id,
+        int write_decr);
+adlb_code ADLB_Reduce_on_close(adlb_datum_id id,
+        const adlb_reduce_spec *spec, adlb_datum_id result_id,
+        int write_decr);
+
 /*
   returns: ADLB_SUCCESS if datum found
        ADLB_NOTHING if datum not found (can indicate it was gced)
@@ -371,6 +485,39 @@ adlb_code ADLBP_Subscribe(adlb_datum_id id, adlb_subscript subscript,
 adlb_code ADLB_Subscribe(adlb_datum_id id, adlb_subscript subscript,
                           int work_type, int* subscribed);
 
+/*
+  As ADLB_Subscribe(), but ask for the value to be sent with the
+  notification, if it is no larger than ADLB_NOTIF_VALUE_MAX bytes
+  and not a container or multiset.  Otherwise the notification comes
+  without a value and the caller must retrieve it.
+ */
+adlb_code ADLBP_Subscribe_value(adlb_datum_id id, adlb_subscript subscript,
+                          int work_type, int* subscribed);
+adlb_code ADLB_Subscribe_value(adlb_datum_id id, adlb_subscript subscript,
+                          int work_type, int* subscribed);
+
+/**
+  Decode the next close notification from a task payload received
+  for a subscription.  Accepts both binary batches and the text
+  format "close <id> [<subscript>]".  Start with *pos = 0.
+  Subscripts and values point into the payload; text subscripts
+  include the null terminator in their length.
+  value: set to packed value of data, as from ADLB_Retrieve(),
+         if sent with notification
+  value_len: set to length of value, or -1 if no value sent
+  returns: ADLB_SUCCESS with id and subscript set,
+           ADLB_NOTHING if no notifications remain,
+           ADLB_ERROR if payload is malformed
+ */
+adlb_code ADLB_Notif_next(const void *payload, int length, int *pos,
+                          adlb_datum_id *id, adlb_subscript *subscript,
+                          const void **value, int *value_len);
+
+/**
+  Number of close notifications in a task payload
+ */
+adlb_code ADLB_Notif_count(const void *payload, int length, int *count);
+
 adlb_code ADLBP_Container_reference(adlb_datum_id id, adlb_subscript subscript,
                 adlb_datum_id ref_id, adlb_subscript ref_subscript,
                 adlb_data_type ref_type, adlb_refc transfer_refs,
@@ -418,9 +565,25 @@ adlb_code ADLBP_Container_size(adlb_datum_id container_id, int* size,
 adlb_code ADLB_Container_size(adlb_datum_id container_id, int* size,
                               adlb_refc decr);
 
+/*
+  Try to lock datum.
+  result: true if locked, false if already locked
+ */
 adlb_code ADLBP_Lock(adlb_datum_id id, bool* result);
 adlb_code ADLB_Lock(adlb_datum_id id, bool* result);
 
+/*
+  Lock datum, waiting on the server if it is already locked.  Waiting
+  ranks are granted the lock in the order they asked for it, with no
+  further messages.
+  Locks are not re-entrant: returns an error if the caller already
+  holds the lock.
+  timeout: give up after this many seconds, or wait forever if negative
+  result: true if locked, false if timed out
+ */
+adlb_code ADLBP_Lock_wait(adlb_datum_id id, double timeout, bool* result);
+adlb_code ADLB_Lock_wait(adlb_datum_id id, double timeout, bool* result);
+
 adlb_code ADLBP_Unlock(adlb_datum_id id);
 adlb_code ADLB_Unlock(adlb_datum_id id);
 
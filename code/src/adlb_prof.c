@@ -321,6 +321,30 @@ ADLB_Enumerate(adlb_datum_id container_id,
                          data, length, records, kv_type);
 }
 
+adlb_code
+ADLB_Enumerate_cursor(adlb_datum_id container_id,
+               int count, adlb_enum_cursor *cursor, adlb_refc decr,
+               bool include_keys, bool include_vals,
+               void** data, size_t* length, int* records,
+               adlb_type_extra *kv_type)
+{
+  return ADLBP_Enumerate_cursor(container_id, count, cursor, decr,
+                                include_keys, include_vals,
+                                data, length, records, kv_type);
+}
+
+adlb_code
+ADLB_Enumerate_filter(adlb_datum_id container_id,
+               int count, int offset, const adlb_enum_filter *filter,
+               adlb_refc decr, bool include_keys, bool include_vals,
+               void** data, size_t* length, int* records,
+               adlb_type_extra *kv_type)
+{
+  return ADLBP_Enumerate_filter(container_id, count, offset, filter, decr,
+                                include_keys, include_vals,
+                                data, length, records, kv_type);
+}
+
 adlb_code
 ADLB_Read_refcount_enable(void)
 {
@@ -333,6 +357,12 @@ ADLB_Refcount_incr(adlb_datum_id id, adlb_refc change)
   return ADLBP_Refcount_incr(id, change);
 }
 
+adlb_code
+ADLB_Refcount_flush(void)
+{
+  return ADLBP_Refcount_flush();
+}
+
 adlb_code ADLB_Insert_atomic(adlb_datum_id id, adlb_subscript subscript,
                        adlb_retrieve_refc refcounts,
                        bool *result, bool *value_present,
@@ -343,6 +373,31 @@ adlb_code ADLB_Insert_atomic(adlb_datum_id id, adlb_subscript subscript,
   return rc;
 }
 
+adlb_code ADLB_Atomic(adlb_datum_id id, adlb_atomic_op op,
+                      adlb_data_type type,
+                      const adlb_atomic_value *operand,
+                      const adlb_atomic_value *compare,
+                      adlb_refc refcount_decr,
+                      adlb_atomic_value *old_value, bool *old_set,
+                      bool *updated)
+{
+  return ADLBP_Atomic(id, op, type, operand, compare, refcount_decr,
+                      old_value, old_set, updated);
+}
+
+adlb_code ADLB_Reduce(adlb_datum_id id, const adlb_reduce_spec *spec,
+                      adlb_refc decr, adlb_reduce_result *result)
+{
+  return ADLBP_Reduce(id, spec, decr, result);
+}
+
+adlb_code ADLB_Reduce_on_close(adlb_datum_id id,
+        const adlb_reduce_spec *spec, adlb_datum_id result_id,
+        int write_decr)
+{
+  return ADLBP_Reduce_on_close(id, spec, result_id, write_decr);
+}
+
 adlb_code ADLB_Unique(adlb_datum_id *result)
 {
   return ADLBP_Unique(result);
@@ -374,6 +429,17 @@ ADLB_Subscribe(adlb_datum_id id, adlb_subscript subscript,
   return rc;
 }
 
+adlb_code
+ADLB_Subscribe_value(adlb_datum_id id, adlb_subscript subscript,
+               int work_type, int* subscribed)
+{
+  MPE_LOG(xlb_mpe_wkr_subscribe_start);
+  adlb_code rc = ADLBP_Subscribe_value(id, subscript, work_type,
+                                       subscribed);
+  MPE_LOG(xlb_mpe_wkr_subscribe_end);
+  return rc;
+}
+
 adlb_code ADLB_Container_reference(adlb_datum_id id, adlb_subscript subscript,
                adlb_datum_id ref_id, adlb_subscript ref_subscript,
                adlb_data_type ref_type, adlb_refc transfer_refs,
@@ -397,6 +463,12 @@ ADLB_Lock(adlb_datum_id id, bool* result)
   return ADLBP_Lock(id, result);
 }
 
+adlb_code
+ADLB_Lock_wait(adlb_datum_id id, double timeout, bool* result)
+{
+  return ADLBP_Lock_wait(id, timeout, result);
+}
+
 adlb_code
 ADLB_Unlock(adlb_datum_id id)
 {
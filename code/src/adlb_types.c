@@ -12,6 +12,7 @@
 
 #include "adlb.h"
 #include "checks.h"
+#include "container.h"
 #include "data_cleanup.h"
 #include "data_internal.h"
 #include "data_structs.h"
@@ -31,6 +32,9 @@
 
 static char *data_repr_container(const adlb_container *c);
 
+// Set by server's data module
+bool xlb_inline_values = false;
+
 struct type_entry
 {
   adlb_data_type code;
@@ -192,10 +196,10 @@ ADLB_Init_compound(adlb_datum_storage *d, adlb_data_type type,
   {
     case ADLB_DATA_TYPE_CONTAINER:
       assert(type_extra.valid);
-      d->CONTAINER.members = table_bp_create(CONTAINER_INIT_CAPACITY);
-      DATA_CHECK_MALLOC(d->CONTAINER.members);
       d->CONTAINER.key_type = type_extra.CONTAINER.key_type;
       d->CONTAINER.val_type = type_extra.CONTAINER.val_type;
+      dc = xlb_members_init(&d->CONTAINER, false);
+      DATA_CHECK(dc);
       break;
     case ADLB_DATA_TYPE_MULTISET:
       assert(type_extra.valid);
@@ -249,9 +253,9 @@ ADLB_Pack(const adlb_datum_storage *d, adlb_data_type type,
     case ADLB_DATA_TYPE_FLOAT:
       return ADLB_Pack_float(&d->FLOAT, result);
     case ADLB_DATA_TYPE_STRING:
-      return ADLB_Pack_string(&d->STRING, result);
+      return xlb_pack_string(&d->STRING, result);
     case ADLB_DATA_TYPE_BLOB:
-      return ADLB_Pack_blob(&d->BLOB, result);
+      return xlb_pack_blob(&d->BLOB, result);
     case ADLB_DATA_TYPE_STRUCT:
       return ADLB_Pack_struct(d->STRUCT, caller_buffer, result);
     case ADLB_DATA_TYPE_CONTAINER:
@@ -390,8 +394,8 @@ ADLB_Pack_container(const adlb_container *container,
 {
   adlb_data_code dc;
 
-  const table_bp *members = container->members;
-  dc = ADLB_Pack_container_hdr(members->size,
+  int size = xlb_members_size(container);
+  dc = ADLB_Pack_container_hdr(size,
       (adlb_data_type)container->key_type,
       (adlb_data_type)container->val_type,
       output, output_caller_buffer, output_pos);
@@ -399,21 +403,23 @@ ADLB_Pack_container(const adlb_container *container,
 
   int appended = 0;
 
-  TABLE_BP_FOREACH(members, item)
+  xlb_members_iter it;
+  xlb_members_iter_init(&it);
+  while (xlb_members_iter_next(container, &it))
   {
-    assert(item->key_len <= INT_MAX);
-    size_t key_len = item->key_len;
+    assert(it.key_len <= INT_MAX);
+    size_t key_len = it.key_len;
     // append key; append val
     size_t required = *output_pos + VINT_MAX_BYTES + key_len;
     dc = ADLB_Resize_buf(output, output_caller_buffer, required);
     DATA_CHECK(dc);
 
     dc = ADLB_Append_buffer(ADLB_DATA_TYPE_NULL,
-          table_bp_get_key(item), key_len,
+          it.key, key_len,
           true, output, output_caller_buffer, output_pos);
     DATA_CHECK(dc);
 
-    dc = ADLB_Pack_buffer(item->data, (adlb_data_type)container->val_type,
+    dc = ADLB_Pack_buffer(it.val, (adlb_data_type)container->val_type,
             true, tmp_buf, output, output_caller_buffer, output_pos);
     DATA_CHECK(dc);
 
@@ -421,11 +427,11 @@ ADLB_Pack_container(const adlb_container *container,
   }
 
   DEBUG("Packed container:  entries: %i, key: %s, val: %s, bytes: %zu",
-        members->size, ADLB_Data_type_tostring(container->key_type),
+        size, ADLB_Data_type_tostring(container->key_type),
         ADLB_Data_type_tostring(container->val_type), *output_pos);
 
   // Check that the number we appended matches
-  assert(appended == members->size);
+  assert(appended == size);
   return ADLB_DATA_SUCCESS;
 }
 
@@ -580,11 +586,11 @@ adlb_data_code ADLB_Unpack2(adlb_datum_storage *d, adlb_data_type type,
       dc = ADLB_Unpack_float(&d->FLOAT, buffer, length);
       break;
     case ADLB_DATA_TYPE_STRING:
-      dc = ADLB_Unpack_string(&d->STRING, buffer, length, copy_buffer);
+      dc = xlb_unpack_string(&d->STRING, buffer, length, copy_buffer);
       can_take_ownership = true;
       break;
     case ADLB_DATA_TYPE_BLOB:
-      dc = ADLB_Unpack_blob(&d->BLOB, buffer, length, copy_buffer);
+      dc = xlb_unpack_blob(&d->BLOB, buffer, length, copy_buffer);
       can_take_ownership = true;
       break;
     case ADLB_DATA_TYPE_STRUCT:
@@ -633,11 +639,12 @@ ADLB_Unpack_container(adlb_container *container,
   {
     container->key_type = key_type;
     container->val_type = val_type;
-    container->members = table_bp_create(CONTAINER_INIT_CAPACITY);
+    dc = xlb_members_init(container, false);
+    DATA_CHECK(dc);
   }
   else
   {
-    assert(container->members != NULL);
+    assert(container->dense || container->members != NULL);
     check_verbose(key_type == (adlb_data_type)container->key_type &&
          val_type == (adlb_data_type)container->val_type, ADLB_DATA_ERROR_TYPE,
         "Unpacked container type does not match: expected %s[%s] vs. %s[%s]",
@@ -655,15 +662,15 @@ ADLB_Unpack_container(adlb_container *container,
                                 &pos, &key, &key_len, &val, &val_len);
     DATA_CHECK(dc);
 
-    adlb_datum_storage *d = malloc(sizeof(adlb_datum_storage));
+    adlb_datum_storage *d = xlb_pool_alloc(sizeof(adlb_datum_storage));
     check_verbose(d != NULL, ADLB_DATA_ERROR_OOM,
                   "error allocating memory");
     dc = ADLB_Unpack(d, val_type, val, val_len, refcounts);
     DATA_CHECK(dc);
 
     // TODO: handle case where key already exists
-    bool ok = table_bp_add(container->members, key, key_len, d);
-    check_verbose(ok, ADLB_DATA_ERROR_OOM, "Error adding to container");
+    dc = xlb_members_add(container, key, key_len, d, NULL);
+    check_verbose(dc == ADLB_DATA_SUCCESS, dc, "Error adding to container");
   }
 
   return ADLB_DATA_SUCCESS;
@@ -821,10 +828,12 @@ adlb_data_code ADLB_Free_storage(adlb_datum_storage *d, adlb_data_type type)
   switch (type)
   {
     case ADLB_DATA_TYPE_STRING:
-      free(d->STRING.value);
+      if (!xlb_value_is_inline(&d->STRING))
+        xlb_pool_free(d->STRING.value);
       break;
     case ADLB_DATA_TYPE_BLOB:
-      free(d->BLOB.value);
+      if (!xlb_value_is_inline(&d->BLOB))
+        xlb_pool_free(d->BLOB.value);
       break;
     case ADLB_DATA_TYPE_CONTAINER:
     {
@@ -864,8 +873,8 @@ char *ADLB_Data_repr(const adlb_datum_storage *d, adlb_data_type type)
     case ADLB_DATA_TYPE_STRING:
     {
       // Allocate with enough room for trailing ...
-      tmp = malloc(d->STRING.length + 5);
-      strcpy(tmp, d->STRING.value);
+      tmp = malloc(xlb_value_length(&d->STRING) + 5);
+      strcpy(tmp, xlb_string_value(&d->STRING));
       int pos = 0;
       // Don't return multiple lines of multi-line string
       while (tmp[pos] != '\0')
@@ -897,7 +906,7 @@ char *ADLB_Data_repr(const adlb_datum_storage *d, adlb_data_type type)
       return tmp;
       break;
     case ADLB_DATA_TYPE_BLOB:
-      rc = asprintf(&tmp, "blob (%zu bytes)", d->BLOB.length);
+      rc = asprintf(&tmp, "blob (%zu bytes)", xlb_value_length(&d->BLOB));
       assert(rc >= 0);
       return tmp;
     case ADLB_DATA_TYPE_CONTAINER:
@@ -920,7 +929,6 @@ char *ADLB_Data_repr(const adlb_datum_storage *d, adlb_data_type type)
 static char *data_repr_container(const adlb_container *c)
 {
   adlb_data_code dc;
-  table_bp* members = c->members;
   size_t cont_str_len = 1024;
   char *cont_str = malloc(cont_str_len);
   int cont_str_pos = 0;
@@ -932,26 +940,28 @@ static char *data_repr_container(const adlb_container *c)
   assert(dc == ADLB_DATA_SUCCESS);
   cont_str_pos += sprintf(&cont_str[cont_str_pos], "%s=>%s: ", kts, vts);
 
-  TABLE_BP_FOREACH(members, item)
+  xlb_members_iter it;
+  xlb_members_iter_init(&it);
+  while (xlb_members_iter_next(c, &it))
   {
     const char *null_str = "(null)";
-    adlb_container_val v = item->data;
+    adlb_container_val v = it.val;
     char *value_s = (v == NULL) ? NULL :
           ADLB_Data_repr(v, (adlb_data_type)c->val_type);
     size_t value_strlen = (value_s == NULL) ? sizeof(null_str) :
                                               strlen(value_s);
     dc = xlb_resize_str(&cont_str, &cont_str_len, cont_str_pos,
-                   (item->key_len - 1) + value_strlen + 7);
+                   (it.key_len - 1) + value_strlen + 7);
     assert(dc == ADLB_DATA_SUCCESS);
     if (c->key_type == ADLB_DATA_TYPE_STRING)
     {
       cont_str_pos += sprintf(&cont_str[cont_str_pos], "\"%s\"=",
-                        (char*)table_bp_get_key(item));
+                        (const char*)it.key);
     }
     else
     {
       cont_str_pos += sprintf(&cont_str[cont_str_pos], "\"%s\"=",
-                              (char*)table_bp_get_key(item));
+                              (const char*)it.key);
     }
 
     if (value_s != NULL)
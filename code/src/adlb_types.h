@@ -65,18 +65,34 @@ typedef struct {
   int write_refs;
 } adlb_ref;
 
+// Forward declaration of incomplete dense member storage type
+struct xlb_dense_members;
+
 typedef struct {
-  /**
-    Map from subscript to member.  Use binary subscripts as keys.
-    Therefore binary representations of keys must be comparable.
-   */
-  struct table_bp* members;
+  union
+  {
+    /**
+      Map from subscript to member.  Use binary subscripts as keys.
+      Therefore binary representations of keys must be comparable.
+      Valid if dense is not set.
+     */
+    struct table_bp* members;
+
+    /**
+      Dense storage for integer keys, only used in the server's data
+      store.  Valid if dense is set.
+     */
+    struct xlb_dense_members* dense_members;
+  };
 
   /** Type of container keys */
   adlb_data_type key_type : ADLB_DATA_TYPE_BITS;
 
   /** type of container values */
   adlb_data_type val_type : ADLB_DATA_TYPE_BITS;
+
+  /** Which member storage is used */
+  bool dense : 1;
 } adlb_container;
 
 // Forward declaration of incomplete struct type
@@ -34,6 +34,10 @@
        double xlb_steal_rate_limit  = 8;
        double xlb_steal_backoff     = 8;
        double xlb_steal_concurrency_limit = 1;
+       double xlb_steal_host_concurrency_limit   = 1;
+       double xlb_steal_nearby_concurrency_limit = 1;
+       double xlb_steal_random_concurrency_limit = 1;
+       double xlb_load_info_max_age = 8;
 static double backoff_server_max    = 2;
 static int    backoff_server_no_delay_attempts  = 0;
 static int    backoff_server_min_delay_attempts = 1;
@@ -48,6 +52,10 @@ static double backoff_sync          = 1;
        double xlb_steal_rate_limit  = 0.5;
        double xlb_steal_backoff     = 0.5;
        double xlb_steal_concurrency_limit = 1;
+       double xlb_steal_host_concurrency_limit   = 1;
+       double xlb_steal_nearby_concurrency_limit = 1;
+       double xlb_steal_random_concurrency_limit = 1;
+       double xlb_load_info_max_age = 0.5;
 static double backoff_server_max    = 0.001;
 static int    backoff_server_no_delay_attempts  = 0;
 static int    backoff_server_min_delay_attempts = 1;
@@ -66,6 +74,10 @@ static double backoff_sync          = 0.01;
        double xlb_steal_rate_limit  = 0.0005;
        double xlb_steal_backoff     = 0.02;
        double xlb_steal_concurrency_limit = 16;
+       double xlb_steal_host_concurrency_limit   = 8;
+       double xlb_steal_nearby_concurrency_limit = 4;
+       double xlb_steal_random_concurrency_limit = 4;
+       double xlb_load_info_max_age = 0.02;
 static double backoff_server_max    = 0.000001;
 static int    backoff_server_no_delay_attempts  = 1024;
 static int    backoff_server_min_delay_attempts = 4;
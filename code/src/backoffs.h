@@ -61,6 +61,22 @@ extern double xlb_steal_backoff;
  */
 extern double xlb_steal_concurrency_limit;
 
+/**
+  Per-level limits on outstanding steal probes for hierarchical
+  victim selection: servers on the same host, servers on nearby
+  hosts, and randomly chosen servers.  All levels together are
+  still bounded by xlb_steal_concurrency_limit.
+ */
+extern double xlb_steal_host_concurrency_limit;
+extern double xlb_steal_nearby_concurrency_limit;
+extern double xlb_steal_random_concurrency_limit;
+
+/**
+  How long, in seconds, load information piggybacked from other
+  servers is trusted when choosing steal victims.
+ */
+extern double xlb_load_info_max_age;
+
 /**
   Smallest gap between successive steal attempts.
  */
@@ -0,0 +1,280 @@
+/*
+ * Copyright 2014 University of Chicago and Argonne National Laboratory
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License
+ */
+
+
+/*
+ * closed_set.c
+ */
+
+#include <assert.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "closed_set.h"
+
+static bool
+common_init(xlb_closed_set_common *c, int capacity)
+{
+  int nbuckets = 0;
+  if (capacity > 0)
+  {
+    nbuckets = 1;
+    while (nbuckets * XLB_CLOSED_SET_WAYS < capacity)
+      nbuckets *= 2;
+  }
+
+  c->nbuckets = nbuckets;
+  c->size = 0;
+  c->lookups = 0;
+  c->hits = 0;
+  c->evictions = 0;
+  c->refs = NULL;
+  c->hands = NULL;
+  if (nbuckets == 0)
+    return true;
+
+  c->refs = calloc((size_t)nbuckets, sizeof(c->refs[0]));
+  c->hands = calloc((size_t)nbuckets, sizeof(c->hands[0]));
+  return c->refs != NULL && c->hands != NULL;
+}
+
+static void
+common_free(xlb_closed_set_common *c)
+{
+  free(c->refs);
+  free(c->hands);
+  c->refs = c->hands = NULL;
+  c->nbuckets = 0;
+  c->size = 0;
+}
+
+/**
+   Choose slot to replace in full bucket, advancing clock hand
+ */
+static inline int
+clock_victim(xlb_closed_set_common *c, int b)
+{
+  int way = c->hands[b];
+  while (c->refs[b] & (1 << way))
+  {
+    // Second chance
+    c->refs[b] &= (unsigned char)~(1 << way);
+    way = (way + 1) % XLB_CLOSED_SET_WAYS;
+  }
+  c->hands[b] = (unsigned char)((way + 1) % XLB_CLOSED_SET_WAYS);
+  c->evictions++;
+  return way;
+}
+
+static inline uint64_t
+hash_id(adlb_datum_id id)
+{
+  // splitmix64 finalizer
+  uint64_t x = (uint64_t)id;
+  x ^= x >> 30;
+  x *= 0xbf58476d1ce4e5b9ULL;
+  x ^= x >> 27;
+  x *= 0x94d049bb133111ebULL;
+  x ^= x >> 31;
+  return x;
+}
+
+static inline uint64_t
+hash_key(const void *key, size_t key_len)
+{
+  // FNV-1a
+  const unsigned char *p = key;
+  uint64_t h = 0xcbf29ce484222325ULL;
+  for (size_t i = 0; i < key_len; i++)
+  {
+    h ^= p[i];
+    h *= 0x100000001b3ULL;
+  }
+  // Mix so that high and low bits both depend on all input
+  return hash_id((adlb_datum_id)h);
+}
+
+bool
+xlb_id_set_init(xlb_id_set *s, int capacity)
+{
+  s->buckets = NULL;
+  if (!common_init(&s->c, capacity))
+    return false;
+  if (s->c.nbuckets == 0)
+    return true;
+
+  s->buckets = calloc((size_t)s->c.nbuckets, sizeof(s->buckets[0]));
+  return s->buckets != NULL;
+}
+
+void
+xlb_id_set_free(xlb_id_set *s)
+{
+  free(s->buckets);
+  s->buckets = NULL;
+  common_free(&s->c);
+}
+
+bool
+xlb_id_set_contains(xlb_id_set *s, adlb_datum_id id)
+{
+  if (s->c.nbuckets == 0)
+    return false;
+
+  s->c.lookups++;
+  int b = (int)(hash_id(id) & (uint64_t)(s->c.nbuckets - 1));
+  xlb_id_bucket *bucket = &s->buckets[b];
+  for (int way = 0; way < XLB_CLOSED_SET_WAYS; way++)
+  {
+    if (bucket->ids[way] == id)
+    {
+      s->c.refs[b] |= (unsigned char)(1 << way);
+      s->c.hits++;
+      return true;
+    }
+  }
+  return false;
+}
+
+void
+xlb_id_set_add(xlb_id_set *s, adlb_datum_id id)
+{
+  assert(id != ADLB_DATA_ID_NULL);
+  if (s->c.nbuckets == 0)
+    return;
+
+  int b = (int)(hash_id(id) & (uint64_t)(s->c.nbuckets - 1));
+  xlb_id_bucket *bucket = &s->buckets[b];
+  int empty = -1;
+  for (int way = 0; way < XLB_CLOSED_SET_WAYS; way++)
+  {
+    if (bucket->ids[way] == id)
+      return;
+    if (empty < 0 && bucket->ids[way] == ADLB_DATA_ID_NULL)
+      empty = way;
+  }
+
+  if (empty < 0)
+  {
+    empty = clock_victim(&s->c, b);
+  }
+  else
+  {
+    s->c.size++;
+  }
+  bucket->ids[empty] = id;
+  s->c.refs[b] &= (unsigned char)~(1 << empty);
+}
+
+bool
+xlb_key_set_init(xlb_key_set *s, int capacity)
+{
+  s->buckets = NULL;
+  if (!common_init(&s->c, capacity))
+    return false;
+  if (s->c.nbuckets == 0)
+    return true;
+
+  s->buckets = calloc((size_t)s->c.nbuckets, sizeof(s->buckets[0]));
+  return s->buckets != NULL;
+}
+
+void
+xlb_key_set_free(xlb_key_set *s)
+{
+  for (int b = 0; b < s->c.nbuckets; b++)
+  {
+    for (int way = 0; way < XLB_CLOSED_SET_WAYS; way++)
+    {
+      free(s->buckets[b].keys[way]);
+    }
+  }
+  free(s->buckets);
+  s->buckets = NULL;
+  common_free(&s->c);
+}
+
+static inline bool
+key_match(const xlb_key_bucket *bucket, int way, uint32_t tag,
+          const void *key, size_t key_len)
+{
+  const xlb_closed_key *k = bucket->keys[way];
+  return k != NULL && bucket->tags[way] == tag && k->len == key_len &&
+         memcmp(k->data, key, key_len) == 0;
+}
+
+bool
+xlb_key_set_contains(xlb_key_set *s, const void *key, size_t key_len)
+{
+  if (s->c.nbuckets == 0)
+    return false;
+
+  s->c.lookups++;
+  uint64_t h = hash_key(key, key_len);
+  int b = (int)(h & (uint64_t)(s->c.nbuckets - 1));
+  uint32_t tag = (uint32_t)(h >> 32);
+  xlb_key_bucket *bucket = &s->buckets[b];
+  for (int way = 0; way < XLB_CLOSED_SET_WAYS; way++)
+  {
+    if (key_match(bucket, way, tag, key, key_len))
+    {
+      s->c.refs[b] |= (unsigned char)(1 << way);
+      s->c.hits++;
+      return true;
+    }
+  }
+  return false;
+}
+
+bool
+xlb_key_set_add(xlb_key_set *s, const void *key, size_t key_len)
+{
+  if (s->c.nbuckets == 0)
+    return true;
+
+  uint64_t h = hash_key(key, key_len);
+  int b = (int)(h & (uint64_t)(s->c.nbuckets - 1));
+  uint32_t tag = (uint32_t)(h >> 32);
+  xlb_key_bucket *bucket = &s->buckets[b];
+  int empty = -1;
+  for (int way = 0; way < XLB_CLOSED_SET_WAYS; way++)
+  {
+    if (key_match(bucket, way, tag, key, key_len))
+      return true;
+    if (empty < 0 && bucket->keys[way] == NULL)
+      empty = way;
+  }
+
+  xlb_closed_key *k = malloc(sizeof(*k) + key_len);
+  if (k == NULL)
+    return false;
+  k->len = key_len;
+  memcpy(k->data, key, key_len);
+
+  if (empty < 0)
+  {
+    empty = clock_victim(&s->c, b);
+    free(bucket->keys[empty]);
+  }
+  else
+  {
+    s->c.size++;
+  }
+  bucket->keys[empty] = k;
+  bucket->tags[empty] = tag;
+  s->c.refs[b] &= (unsigned char)~(1 << empty);
+  return true;
+}
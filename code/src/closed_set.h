@@ -0,0 +1,105 @@
+/*
+ * Copyright 2014 University of Chicago and Argonne National Laboratory
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License
+ */
+
+
+/*
+ * closed_set.h
+ *
+ * Fixed-capacity sets of data IDs and ID/subscript keys, used by the
+ * engine to remember remote data known to be closed.
+ *
+ * Sets are exact: a false positive would release a task before its
+ * input was closed.  Entries are kept in buckets of
+ * XLB_CLOSED_SET_WAYS slots, selected by hash, so that a lookup reads
+ * one or two cache lines.  When a bucket is full, an entry is evicted
+ * with the CLOCK algorithm: each slot has a reference bit that is set
+ * on lookup hits and cleared as the bucket's hand passes over it.
+ * ID entries take 8 bytes, plus 2 bits per entry of clock state.
+ */
+
+#ifndef CLOSED_SET_H
+#define CLOSED_SET_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "adlb-defs.h"
+
+/** Slots per bucket: one reference bit each in an unsigned char */
+#define XLB_CLOSED_SET_WAYS 8
+
+typedef struct
+{
+  // Zero for empty slot: ADLB_DATA_ID_NULL is never added
+  adlb_datum_id ids[XLB_CLOSED_SET_WAYS];
+} xlb_id_bucket;
+
+typedef struct
+{
+  size_t len;
+  char data[];
+} xlb_closed_key;
+
+typedef struct
+{
+  uint32_t tags[XLB_CLOSED_SET_WAYS]; // Upper hash bits, to skip compares
+  xlb_closed_key *keys[XLB_CLOSED_SET_WAYS]; // NULL for empty slot
+} xlb_key_bucket;
+
+/** State common to both kinds of set */
+typedef struct
+{
+  int nbuckets; // Power of two
+  unsigned char *refs; // Reference bits, per bucket
+  unsigned char *hands; // Clock hand, per bucket
+  int size; // Entries in set
+
+  // Perf counters
+  int64_t lookups;
+  int64_t hits;
+  int64_t evictions;
+} xlb_closed_set_common;
+
+typedef struct
+{
+  xlb_closed_set_common c;
+  xlb_id_bucket *buckets;
+} xlb_id_set;
+
+typedef struct
+{
+  xlb_closed_set_common c;
+  xlb_key_bucket *buckets;
+} xlb_key_set;
+
+/**
+   capacity: maximum entries, rounded up to a power of two buckets.
+             May be 0 to disable set.
+ */
+bool xlb_id_set_init(xlb_id_set *s, int capacity);
+void xlb_id_set_free(xlb_id_set *s);
+bool xlb_id_set_contains(xlb_id_set *s, adlb_datum_id id);
+/** Add id, evicting another entry if needed */
+void xlb_id_set_add(xlb_id_set *s, adlb_datum_id id);
+
+bool xlb_key_set_init(xlb_key_set *s, int capacity);
+void xlb_key_set_free(xlb_key_set *s);
+bool xlb_key_set_contains(xlb_key_set *s, const void *key, size_t key_len);
+/** Add copy of key, evicting another entry if needed */
+bool xlb_key_set_add(xlb_key_set *s, const void *key, size_t key_len);
+
+#endif // CLOSED_SET_H
@@ -75,6 +75,21 @@ struct xlb_state {
   /** Whether to maintain performance counters */
   bool perfc_enabled;
 
+  /** Whether to send close notifications as binary batches */
+  bool binary_notifs;
+
+  /** Forward notifications for workers of another server through that
+      server if there are at least this many, 0 to disable */
+  int notif_fanout;
+
+  /** Max reference count changes a client holds before sending them
+      to servers in batches, 0 to send each immediately */
+  int refc_batch;
+
+  /** Send untargeted data-dependent tasks to the server owning a
+      majority of their inputs */
+  bool dput_placement;
+
   double max_malloc;
 };
 
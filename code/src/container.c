@@ -0,0 +1,609 @@
+/*
+ * Copyright 2014 University of Chicago and Argonne National Laboratory
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License
+ */
+
+#include <assert.h>
+#include <inttypes.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "checks.h"
+#include "container.h"
+#include "data_internal.h"
+
+/**
+  Chunks that the span of dense keys may cover beyond twice those in
+  use before keys are considered too sparse for dense storage.
+ */
+#define XLB_DENSE_SLACK_CHUNKS 4
+
+/** Max digits in dense key: keeps keys well within int64 range */
+#define XLB_DENSE_KEY_DIGITS 15
+
+typedef struct {
+  /** Bit set if key is a member */
+  uint64_t present;
+  /** Bit set if member has a value, i.e. is not only reserved */
+  uint64_t set;
+  adlb_datum_storage vals[XLB_DENSE_CHUNK_SIZE];
+} dense_chunk;
+
+struct xlb_dense_members
+{
+  /**
+    Chunks indexed by key / XLB_DENSE_CHUNK_SIZE - base, NULL if empty.
+    Keys need not start near zero, and may arrive in any order.
+   */
+  dense_chunk **chunks;
+  int64_t base; // Chunk number of chunks[0]
+  int chunks_size; // Allocated size of chunks array
+  int chunks_used; // Non-NULL chunks
+  int64_t first, last; // Lowest and highest non-NULL chunk numbers
+  int count; // Members in chunks
+
+  /** Members not stored densely, NULL until needed */
+  struct table_bp *sparse;
+};
+
+/**
+  Parse canonical decimal key: no sign, no leading zeroes and a
+  null terminator, so that the key can be regenerated exactly.
+ */
+static inline bool dense_key(const void *key, size_t key_len,
+                             int64_t *result)
+{
+  const char *s = key;
+  if (key_len < 2 || key_len > XLB_DENSE_KEY_DIGITS + 1 ||
+      s[key_len - 1] != '\0' || (s[0] == '0' && key_len > 2))
+  {
+    return false;
+  }
+
+  int64_t k = 0;
+  for (size_t i = 0; i < key_len - 1; i++)
+  {
+    if (s[i] < '0' || s[i] > '9')
+    {
+      return false;
+    }
+    k = k * 10 + (s[i] - '0');
+  }
+  *result = k;
+  return true;
+}
+
+static inline const struct table_bp *
+members_table(const adlb_container *c)
+{
+  return c->dense ? c->dense_members->sparse : c->members;
+}
+
+adlb_data_code
+xlb_members_init(adlb_container *c, bool dense)
+{
+  if (dense && c->key_type == ADLB_DATA_TYPE_INTEGER)
+  {
+    struct xlb_dense_members *dm = malloc(sizeof(*dm));
+    DATA_CHECK_MALLOC(dm);
+    dm->chunks = NULL;
+    dm->base = 0;
+    dm->chunks_size = 0;
+    dm->chunks_used = 0;
+    dm->first = dm->last = 0;
+    dm->count = 0;
+    dm->sparse = NULL;
+    c->dense_members = dm;
+    c->dense = true;
+  }
+  else
+  {
+    c->members = table_bp_create(CONTAINER_INIT_CAPACITY);
+    DATA_CHECK_MALLOC(c->members);
+    c->dense = false;
+  }
+  return ADLB_DATA_SUCCESS;
+}
+
+static void table_members_free(struct table_bp *members)
+{
+  for (int i = 0; i < members->capacity; i++)
+  {
+    table_bp_entry* head = &members->array[i];
+    if (!table_bp_entry_valid(head))
+    {
+      // Empty bucket
+      continue;
+    }
+
+    // Keep next pointer to allow freeing of item
+    table_bp_entry* item, *next;
+    for (item = head, next = head->next; item != NULL;
+         item = next)
+    {
+      next = item->next; // Store next pointer immediately
+      if (!table_bp_inline_key(item->key_len))
+      {
+        assert(item->__key != NULL);
+        free(item->__key);
+      }
+
+      // Free list node and move to next
+      if (item != head) // Head is part of array
+        free(item);
+    }
+
+    // Mark bucket empty
+    table_bp_clear_entry(head);
+  }
+  table_bp_free(members);
+}
+
+void
+xlb_members_free(adlb_container *c)
+{
+  if (!c->dense)
+  {
+    table_members_free(c->members);
+    c->members = NULL;
+    return;
+  }
+
+  struct xlb_dense_members *dm = c->dense_members;
+  for (int i = 0; i < dm->chunks_size; i++)
+  {
+    free(dm->chunks[i]);
+  }
+  free(dm->chunks);
+  if (dm->sparse != NULL)
+  {
+    table_members_free(dm->sparse);
+  }
+  free(dm);
+  c->dense_members = NULL;
+}
+
+int
+xlb_members_size(const adlb_container *c)
+{
+  if (!c->dense)
+  {
+    return c->members->size;
+  }
+
+  const struct xlb_dense_members *dm = c->dense_members;
+  return dm->count + (dm->sparse != NULL ? dm->sparse->size : 0);
+}
+
+/**
+  Locate dense member slot.
+  return: chunk containing member, or NULL if not stored densely
+ */
+static inline dense_chunk *
+dense_lookup(const struct xlb_dense_members *dm, const void *key,
+             size_t key_len, int *slot)
+{
+  int64_t k;
+  if (!dense_key(key, key_len, &k))
+  {
+    return NULL;
+  }
+
+  int64_t chunk_ix = k / XLB_DENSE_CHUNK_SIZE - dm->base;
+  if (chunk_ix < 0 || chunk_ix >= dm->chunks_size)
+  {
+    return NULL;
+  }
+
+  dense_chunk *chunk = dm->chunks[chunk_ix];
+  int s = (int)(k % XLB_DENSE_CHUNK_SIZE);
+  if (chunk == NULL || (chunk->present & ((uint64_t)1 << s)) == 0)
+  {
+    return NULL;
+  }
+
+  *slot = s;
+  return chunk;
+}
+
+bool
+xlb_members_lookup(const adlb_container *c, const void *key,
+                   size_t key_len, adlb_container_val *val)
+{
+  if (c->dense)
+  {
+    int slot;
+    dense_chunk *chunk = dense_lookup(c->dense_members, key, key_len,
+                                      &slot);
+    if (chunk != NULL)
+    {
+      *val = (chunk->set & ((uint64_t)1 << slot)) ?
+             &chunk->vals[slot] : NULL;
+      return true;
+    }
+  }
+
+  const struct table_bp *table = members_table(c);
+  if (table == NULL)
+  {
+    return false;
+  }
+  return table_bp_search(table, key, key_len, (void**)val);
+}
+
+/**
+  Grow chunks array to cover chunk number n, leaving room to grow
+  further in the same direction.
+  return: false if out of memory
+ */
+static bool
+dense_grow(struct xlb_dense_members *dm, int64_t n)
+{
+  int64_t lo = dm->base, hi = dm->base + dm->chunks_size; // [lo, hi)
+  int64_t needed = (n < lo ? hi - n : n + 1 - lo);
+  int64_t new_size = (int64_t)dm->chunks_size * 2;
+  if (new_size < needed)
+  {
+    new_size = needed;
+  }
+
+  int64_t new_base = lo;
+  if (dm->chunks_size == 0)
+  {
+    new_base = n;
+  }
+  else if (n < lo)
+  {
+    // Keys going down, e.g. filled by reverse loop: room below
+    new_base = hi - new_size;
+    if (new_base < 0)
+    {
+      new_base = 0;
+    }
+  }
+
+  dense_chunk **tmp = malloc(sizeof(tmp[0]) * (size_t)new_size);
+  if (tmp == NULL)
+  {
+    return false;
+  }
+  for (int64_t i = 0; i < new_size; i++)
+  {
+    tmp[i] = NULL;
+  }
+  for (int i = 0; i < dm->chunks_size; i++)
+  {
+    tmp[lo - new_base + i] = dm->chunks[i];
+  }
+  free(dm->chunks);
+  dm->chunks = tmp;
+  dm->base = new_base;
+  dm->chunks_size = (int)new_size;
+  return true;
+}
+
+/**
+  Get chunk to store new key densely, allocating if needed.  Keys are
+  stored densely while the span of chunk numbers covered stays within
+  twice the chunks in use, plus some slack.
+  return: NULL if key should not be stored densely
+ */
+static dense_chunk *
+dense_slot(struct xlb_dense_members *dm, const void *key,
+           size_t key_len, int *slot)
+{
+  int64_t k;
+  if (!dense_key(key, key_len, &k))
+  {
+    return NULL;
+  }
+
+  int64_t n = k / XLB_DENSE_CHUNK_SIZE;
+  if (n < dm->base || n >= dm->base + dm->chunks_size)
+  {
+    if (dm->chunks_used > 0)
+    {
+      // Span of chunk numbers in use if we add this one
+      int64_t span = (n < dm->first ? dm->last - n : n - dm->first) + 1;
+      if (span > 2 * (int64_t)dm->chunks_used + XLB_DENSE_SLACK_CHUNKS)
+      {
+        // Too far from keys in use
+        return NULL;
+      }
+    }
+
+    if (!dense_grow(dm, n))
+    {
+      return NULL;
+    }
+  }
+
+  int64_t chunk_ix = n - dm->base;
+  dense_chunk *chunk = dm->chunks[chunk_ix];
+  if (chunk == NULL)
+  {
+    chunk = malloc(sizeof(*chunk));
+    if (chunk == NULL)
+    {
+      return NULL;
+    }
+    chunk->present = 0;
+    chunk->set = 0;
+    dm->chunks[chunk_ix] = chunk;
+    if (dm->chunks_used == 0 || n < dm->first)
+    {
+      dm->first = n;
+    }
+    if (dm->chunks_used == 0 || n > dm->last)
+    {
+      dm->last = n;
+    }
+    dm->chunks_used++;
+  }
+
+  *slot = (int)(k % XLB_DENSE_CHUNK_SIZE);
+  return chunk;
+}
+
+adlb_data_code
+xlb_members_add(adlb_container *c, const void *key, size_t key_len,
+                adlb_container_val val, adlb_container_val *stored)
+{
+  struct table_bp *table;
+  if (c->dense)
+  {
+    struct xlb_dense_members *dm = c->dense_members;
+    int slot;
+    dense_chunk *chunk = dense_slot(dm, key, key_len, &slot);
+    if (chunk != NULL)
+    {
+      uint64_t bit = (uint64_t)1 << slot;
+      assert((chunk->present & bit) == 0);
+      chunk->present |= bit;
+      if (val != NULL)
+      {
+        chunk->vals[slot] = *val;
+        chunk->set |= bit;
+        xlb_pool_free(val);
+        val = &chunk->vals[slot];
+      }
+      dm->count++;
+      if (stored != NULL)
+        *stored = val;
+      return ADLB_DATA_SUCCESS;
+    }
+
+    if (dm->sparse == NULL)
+    {
+      dm->sparse = table_bp_create(CONTAINER_INIT_CAPACITY);
+      DATA_CHECK_MALLOC(dm->sparse);
+    }
+    table = dm->sparse;
+  }
+  else
+  {
+    table = c->members;
+  }
+
+  bool ok = table_bp_add(table, key, key_len, val);
+  if (stored != NULL)
+    *stored = val;
+  return ok ? ADLB_DATA_SUCCESS : ADLB_DATA_ERROR_OOM;
+}
+
+bool
+xlb_members_set(adlb_container *c, const void *key, size_t key_len,
+          adlb_container_val val, adlb_container_val *prev,
+          adlb_container_val *stored)
+{
+  if (c->dense)
+  {
+    int slot;
+    dense_chunk *chunk = dense_lookup(c->dense_members, key, key_len,
+                                      &slot);
+    if (chunk != NULL)
+    {
+      uint64_t bit = (uint64_t)1 << slot;
+      *prev = NULL;
+      if (chunk->set & bit)
+      {
+        // Caller takes ownership of previous value
+        *prev = xlb_pool_alloc(sizeof(**prev));
+        if (*prev == NULL)
+        {
+          return false;
+        }
+        **prev = chunk->vals[slot];
+      }
+
+      if (val != NULL)
+      {
+        chunk->vals[slot] = *val;
+        chunk->set |= bit;
+        xlb_pool_free(val);
+        val = &chunk->vals[slot];
+      }
+      else
+      {
+        chunk->set &= ~bit;
+      }
+      if (stored != NULL)
+        *stored = val;
+      return true;
+    }
+  }
+
+  struct table_bp *table = (struct table_bp *)members_table(c);
+  if (table == NULL)
+  {
+    return false;
+  }
+
+  if (stored != NULL)
+    *stored = val;
+  return table_bp_set(table, key, key_len, val, (void**)prev);
+}
+
+void
+xlb_members_iter_init(xlb_members_iter *it)
+{
+  it->chunk = 0;
+  it->slot = 0;
+  it->bucket = 0;
+  it->entry = NULL;
+  it->entry_pos = -1;
+}
+
+/**
+  Find next dense member at or after current position
+ */
+static bool dense_iter_next(const struct xlb_dense_members *dm,
+                            xlb_members_iter *it)
+{
+  while (it->chunk < dm->chunks_size)
+  {
+    const dense_chunk *chunk = dm->chunks[it->chunk];
+    if (chunk != NULL && it->slot < XLB_DENSE_CHUNK_SIZE)
+    {
+      // Bits for remaining slots in chunk
+      uint64_t remaining = chunk->present >> it->slot;
+      if (remaining != 0)
+      {
+        int slot = it->slot + __builtin_ctzll(remaining);
+        uint64_t bit = (uint64_t)1 << slot;
+        int64_t k = (dm->base + it->chunk) * XLB_DENSE_CHUNK_SIZE + slot;
+        int n = sprintf(it->key_buf, "%"PRId64, k);
+        it->key = it->key_buf;
+        it->key_len = (size_t)n + 1;
+        it->val = (chunk->set & bit) ?
+                  (adlb_container_val)&chunk->vals[slot] : NULL;
+        it->inline_val = true;
+
+        it->slot = slot + 1;
+        return true;
+      }
+    }
+    it->chunk++;
+    it->slot = 0;
+  }
+  return false;
+}
+
+/**
+  Find next hashed member after current entry
+ */
+static bool table_iter_next(const struct table_bp *table,
+                            xlb_members_iter *it)
+{
+  const table_bp_entry *e = (it->entry != NULL) ? it->entry->next : NULL;
+  it->entry_pos++;
+  while (e == NULL)
+  {
+    if (it->bucket >= table->capacity)
+    {
+      return false;
+    }
+    const table_bp_entry *head = &table->array[it->bucket++];
+    if (table_bp_entry_valid(head))
+    {
+      e = head;
+      it->entry_pos = 0;
+    }
+  }
+
+  it->entry = e;
+  it->key = table_bp_get_key(e);
+  it->key_len = e->key_len;
+  it->val = e->data;
+  it->inline_val = false;
+  return true;
+}
+
+bool
+xlb_members_iter_next(const adlb_container *c, xlb_members_iter *it)
+{
+  if (c->dense && dense_iter_next(c->dense_members, it))
+  {
+    return true;
+  }
+
+  const struct table_bp *table = members_table(c);
+  if (table == NULL)
+  {
+    return false;
+  }
+  return table_iter_next(table, it);
+}
+
+void
+xlb_members_iter_save(const xlb_members_iter *it, adlb_enum_cursor *cursor)
+{
+  cursor->chunk = it->chunk;
+  cursor->slot = it->slot;
+  cursor->bucket = it->bucket;
+  cursor->entry = (it->entry != NULL) ? it->entry_pos : -1;
+}
+
+bool
+xlb_members_iter_restore(const adlb_container *c,
+                         const adlb_enum_cursor *cursor,
+                         xlb_members_iter *it)
+{
+  xlb_members_iter_init(it);
+
+  int chunks_size = c->dense ? c->dense_members->chunks_size : 0;
+  if (cursor->chunk < 0 || cursor->chunk > chunks_size ||
+      cursor->slot < 0 || cursor->slot > XLB_DENSE_CHUNK_SIZE)
+  {
+    return false;
+  }
+  it->chunk = cursor->chunk;
+  it->slot = cursor->slot;
+
+  if (cursor->bucket == 0 && cursor->entry < 0)
+  {
+    // Not yet in hash table
+    return true;
+  }
+
+  // Hashed members are only visited after all dense members
+  const struct table_bp *table = members_table(c);
+  if (it->chunk != chunks_size || table == NULL ||
+      cursor->bucket <= 0 || cursor->bucket > table->capacity ||
+      cursor->entry < 0)
+  {
+    return false;
+  }
+
+  // Entry is in bucket before the one to be scanned next
+  const table_bp_entry *e = &table->array[cursor->bucket - 1];
+  if (!table_bp_entry_valid(e))
+  {
+    return false;
+  }
+  for (int i = 0; i < cursor->entry; i++)
+  {
+    e = e->next;
+    if (e == NULL)
+    {
+      return false;
+    }
+  }
+
+  it->bucket = cursor->bucket;
+  it->entry = e;
+  it->entry_pos = cursor->entry;
+  return true;
+}
@@ -0,0 +1,141 @@
+/*
+ * Copyright 2014 University of Chicago and Argonne National Laboratory
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License
+ */
+
+/*
+  Storage for container members.
+
+  By default members are stored in a table_bp hash table, with each
+  value separately allocated.  Containers with integer keys in the
+  server's data store may instead use dense storage: chunks of
+  XLB_DENSE_CHUNK_SIZE values stored inline, with presence bitmaps,
+  indexed by key.  Keys must be in canonical decimal form ("123", with
+  null terminator) and close to the range already in use to be stored
+  densely, but may start anywhere and arrive in any order; other keys
+  go in a hash table alongside.
+
+  Values stored inline have a stable address, but must not be freed
+  separately: check inline_val when iterating.
+ */
+
+#ifndef __XLB_CONTAINER_H
+#define __XLB_CONTAINER_H
+
+#include <table_bp.h>
+
+#include "adlb-defs.h"
+#include "adlb_types.h"
+
+/** Values per dense chunk: one bitmap word */
+#define XLB_DENSE_CHUNK_SIZE 64
+
+/** Max bytes in decimal key, including sign and null terminator */
+#define XLB_DENSE_KEY_MAX 21
+
+/**
+  Initialize empty members of container.  key_type and val_type must
+  already be set.
+  dense: if true, integer keys may be stored densely
+ */
+adlb_data_code xlb_members_init(adlb_container *c, bool dense);
+
+/**
+  Free storage for members.  Does not free values.
+ */
+void xlb_members_free(adlb_container *c);
+
+/** Number of members, including reserved members without values */
+int xlb_members_size(const adlb_container *c);
+
+/**
+  Look up member.
+  val: set to value if found, NULL if reserved but not set
+  return: true if found
+ */
+bool xlb_members_lookup(const adlb_container *c, const void *key,
+                        size_t key_len, adlb_container_val *val);
+
+/**
+  Add a member that does not already exist.  Takes ownership of val,
+  which is freed if copied to inline storage.
+  val: value, or NULL to reserve the key
+  stored: if not NULL, set to location of stored value
+ */
+adlb_data_code xlb_members_add(adlb_container *c, const void *key,
+          size_t key_len, adlb_container_val val,
+          adlb_container_val *stored);
+
+/**
+  Replace the value of an existing member.  Takes ownership of val.
+  prev: set to previous value, owned by caller
+  stored: if not NULL, set to location of stored value
+  return: true if member existed
+ */
+bool xlb_members_set(adlb_container *c, const void *key, size_t key_len,
+          adlb_container_val val, adlb_container_val *prev,
+          adlb_container_val *stored);
+
+/**
+  Iterator over container members.  Dense members are visited in key
+  order first, then any hashed members.  The container must not be
+  modified during iteration.
+ */
+typedef struct {
+  // Position in dense storage
+  int chunk;
+  int slot;
+
+  // Position in hash table
+  int bucket;
+  const table_bp_entry *entry;
+  int entry_pos; // Position of entry in bucket chain
+
+  // Storage for key of dense member
+  char key_buf[XLB_DENSE_KEY_MAX];
+
+  // Current member.  For dense members, key points to key_buf, so is
+  // only valid until the next call to xlb_members_iter_next(): copy
+  // it to keep it.
+  const void *key;
+  size_t key_len;
+  adlb_container_val val;
+  /** If true, val is stored inline and must not be freed */
+  bool inline_val;
+} xlb_members_iter;
+
+void xlb_members_iter_init(xlb_members_iter *it);
+
+/**
+  Move to next member.
+  return: false if no members left
+ */
+bool xlb_members_iter_next(const adlb_container *c, xlb_members_iter *it);
+
+/**
+  Save iterator position in cursor fields other than position/stamp
+ */
+void xlb_members_iter_save(const xlb_members_iter *it,
+                           adlb_enum_cursor *cursor);
+
+/**
+  Resume iteration from a saved position.  Only valid if the
+  container has not had members added since the position was saved.
+  return: false if cursor does not refer to a position in container
+ */
+bool xlb_members_iter_restore(const adlb_container *c,
+                              const adlb_enum_cursor *cursor,
+                              xlb_members_iter *it);
+
+#endif // __XLB_CONTAINER_H
@@ -0,0 +1,217 @@
+/*
+ * Copyright 2014 University of Chicago and Argonne National Laboratory
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License
+ */
+
+
+/*
+ * container_index.c
+ */
+
+#include <assert.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "adlb_types.h"
+#include "checks.h"
+#include "container_index.h"
+#include "data_internal.h"
+
+#define CINDEX_INIT_SIZE 64
+
+xlb_cindex *
+xlb_cindex_create(adlb_data_type key_type)
+{
+  xlb_cindex *ix = malloc(sizeof(*ix));
+  if (ix == NULL)
+    return NULL;
+  ix->key_type = key_type;
+  ix->keys = NULL;
+  ix->count = 0;
+  ix->size = 0;
+  ix->sorted = 0;
+  return ix;
+}
+
+/**
+   Parse integer key: optional minus sign, digits and null terminator
+ */
+static inline bool
+parse_int_key(const char *s, size_t len, int64_t *result)
+{
+  if (len < 2 || s[len - 1] != '\0')
+    return false;
+
+  size_t i = 0;
+  bool neg = (s[0] == '-');
+  if (neg)
+    i++;
+  if (i == len - 1 || len - 1 - i > 18)
+    return false;
+
+  int64_t k = 0;
+  for (; i < len - 1; i++)
+  {
+    if (s[i] < '0' || s[i] > '9')
+      return false;
+    k = k * 10 + (s[i] - '0');
+  }
+  *result = neg ? -k : k;
+  return true;
+}
+
+void
+xlb_cindex_key_init(adlb_data_type key_type, const void *key,
+                    size_t key_len, xlb_cindex_key *k)
+{
+  k->len = key_len;
+  k->ikey = 0;
+  k->is_int = (key_type == ADLB_DATA_TYPE_INTEGER) &&
+              parse_int_key(key, key_len, &k->ikey);
+}
+
+adlb_data_code
+xlb_cindex_add(xlb_cindex *ix, const void *key, size_t key_len)
+{
+  if (ix->count == ix->size)
+  {
+    int new_size = (ix->size == 0) ? CINDEX_INIT_SIZE : ix->size * 2;
+    xlb_cindex_key **tmp = realloc(ix->keys,
+                                   sizeof(ix->keys[0]) * (size_t)new_size);
+    DATA_CHECK_MALLOC(tmp);
+    ix->keys = tmp;
+    ix->size = new_size;
+  }
+
+  xlb_cindex_key *k = xlb_pool_alloc(sizeof(*k) + key_len);
+  DATA_CHECK_MALLOC(k);
+  xlb_cindex_key_init(ix->key_type, key, key_len, k);
+  memcpy(k->data, key, key_len);
+
+  if (ix->sorted == ix->count && (ix->count == 0 ||
+      xlb_cindex_key_cmp(ix->keys[ix->count - 1],
+                         ix->keys[ix->count - 1]->data, k, k->data) <= 0))
+  {
+    // Still in order, e.g. ascending integer keys
+    ix->sorted++;
+  }
+  ix->keys[ix->count++] = k;
+  return ADLB_DATA_SUCCESS;
+}
+
+void
+xlb_cindex_clear(xlb_cindex *ix)
+{
+  for (int i = 0; i < ix->count; i++)
+  {
+    xlb_pool_free(ix->keys[i]);
+  }
+  ix->count = 0;
+  ix->sorted = 0;
+}
+
+void
+xlb_cindex_free(xlb_cindex *ix)
+{
+  xlb_cindex_clear(ix);
+  free(ix->keys);
+  free(ix);
+}
+
+int
+xlb_cindex_key_cmp(const xlb_cindex_key *a, const void *a_data,
+                   const xlb_cindex_key *b, const void *b_data)
+{
+  if (a->is_int != b->is_int)
+  {
+    // Integers first
+    return a->is_int ? -1 : 1;
+  }
+
+  if (a->is_int && a->ikey != b->ikey)
+  {
+    return (a->ikey < b->ikey) ? -1 : 1;
+  }
+
+  size_t min_len = (a->len < b->len) ? a->len : b->len;
+  int c = memcmp(a_data, b_data, min_len);
+  if (c != 0)
+    return c;
+  if (a->len != b->len)
+    return (a->len < b->len) ? -1 : 1;
+  return 0;
+}
+
+static int
+cindex_key_ptr_cmp(const void *a, const void *b)
+{
+  const xlb_cindex_key *ka = *(xlb_cindex_key * const *)a;
+  const xlb_cindex_key *kb = *(xlb_cindex_key * const *)b;
+  return xlb_cindex_key_cmp(ka, ka->data, kb, kb->data);
+}
+
+adlb_data_code
+xlb_cindex_sort(xlb_cindex *ix)
+{
+  if (ix->sorted == ix->count)
+    return ADLB_DATA_SUCCESS;
+
+  int head = ix->sorted;
+  int tail = ix->count - head;
+  qsort(&ix->keys[head], (size_t)tail, sizeof(ix->keys[0]),
+        cindex_key_ptr_cmp);
+
+  if (head > 0)
+  {
+    // Merge sorted runs
+    xlb_cindex_key **merged = malloc(sizeof(merged[0]) * (size_t)ix->size);
+    DATA_CHECK_MALLOC(merged);
+    int i = 0, j = head, out = 0;
+    while (i < head && j < ix->count)
+    {
+      if (cindex_key_ptr_cmp(&ix->keys[j], &ix->keys[i]) < 0)
+        merged[out++] = ix->keys[j++];
+      else
+        merged[out++] = ix->keys[i++];
+    }
+    while (i < head)
+      merged[out++] = ix->keys[i++];
+    while (j < ix->count)
+      merged[out++] = ix->keys[j++];
+    assert(out == ix->count);
+    free(ix->keys);
+    ix->keys = merged;
+  }
+
+  ix->sorted = ix->count;
+  return ADLB_DATA_SUCCESS;
+}
+
+int
+xlb_cindex_lower_bound(const xlb_cindex *ix, const xlb_cindex_key *key,
+                       const void *key_data)
+{
+  assert(ix->sorted == ix->count);
+  int lo = 0, hi = ix->count;
+  while (lo < hi)
+  {
+    int mid = lo + (hi - lo) / 2;
+    const xlb_cindex_key *k = ix->keys[mid];
+    if (xlb_cindex_key_cmp(k, k->data, key, key_data) < 0)
+      lo = mid + 1;
+    else
+      hi = mid;
+  }
+  return lo;
+}
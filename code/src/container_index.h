@@ -0,0 +1,94 @@
+/*
+ * Copyright 2014 University of Chicago and Argonne National Laboratory
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License
+ */
+
+
+/*
+ * container_index.h
+ *
+ * Ordered secondary index over the keys of a container, for
+ * containers created with the sorted_index property.  Container
+ * members are hashed, or stored densely by integer key, so neither
+ * gives an order to answer range and prefix queries from.
+ *
+ * Keys of containers with integer keys are ordered numerically, and
+ * other keys bytewise.  Members are never removed from containers, so
+ * keys are only added.  New keys are appended unsorted and merged in
+ * by xlb_cindex_sort() when the index is next queried, so filling a
+ * container costs no more than a copy of each key.
+ */
+
+#ifndef CONTAINER_INDEX_H
+#define CONTAINER_INDEX_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "adlb-defs.h"
+
+typedef struct
+{
+  bool is_int; // Integer key, ordered by ikey
+  int64_t ikey;
+  size_t len;
+  char data[];
+} xlb_cindex_key;
+
+typedef struct
+{
+  adlb_data_type key_type;
+  xlb_cindex_key **keys;
+  int count;
+  int size; // Allocated size of keys
+  int sorted; // Number of keys at start that are in order
+} xlb_cindex;
+
+xlb_cindex *xlb_cindex_create(adlb_data_type key_type);
+
+adlb_data_code xlb_cindex_add(xlb_cindex *ix, const void *key,
+                              size_t key_len);
+
+/**
+   Remove all keys
+ */
+void xlb_cindex_clear(xlb_cindex *ix);
+
+void xlb_cindex_free(xlb_cindex *ix);
+
+/**
+   Put all keys in order
+ */
+adlb_data_code xlb_cindex_sort(xlb_cindex *ix);
+
+/**
+   Fill in key as it would be stored in index
+ */
+void xlb_cindex_key_init(adlb_data_type key_type, const void *key,
+                         size_t key_len, xlb_cindex_key *k);
+
+/**
+   Compare keys in index order.  Keys need not be in an index.
+ */
+int xlb_cindex_key_cmp(const xlb_cindex_key *a, const void *a_data,
+                       const xlb_cindex_key *b, const void *b_data);
+
+/**
+   Position of first key that is not less than key.  Index must be
+   sorted.
+ */
+int xlb_cindex_lower_bound(const xlb_cindex *ix, const xlb_cindex_key *key,
+                           const void *key_data);
+
+#endif // CONTAINER_INDEX_H
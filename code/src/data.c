@@ -18,6 +18,7 @@
 #include <assert.h>
 #include <inttypes.h>
 #include <limits.h>
+#include <math.h>
 #include <stdbool.h>
 #include <stdio.h>
 #include <stdlib.h>
@@ -32,20 +33,27 @@
 
 #include "adlb.h"
 #include "adlb_types.h"
+#include "common.h"
+#include "container.h"
+#include "container_index.h"
 #include "data.h"
 #include "data_cleanup.h"
 #include "data_internal.h"
 #include "data_structs.h"
+#include "datum_table.h"
 #include "debug.h"
+#include "incr_table.h"
 #include "multiset.h"
 #include "notifications.h"
+#include "pool.h"
+#include "reduce.h"
 #include "refcount.h"
 #include "sync.h"
 
 /**
    Map from adlb_datum_id to adlb_datum
 */
-static struct table_lp tds;
+static xlb_datum_table tds;
 
 typedef struct {
   adlb_datum_id id;
@@ -58,18 +66,70 @@ typedef struct {
 /**
    Map from "container,subscript" specifier to list of listening references.
  */
-static struct table_bp container_references;
+static xlb_incr_bp container_references;
 
 /**
    Map from "container,subscript" specifier to list of xlb_listeners
  */
-static struct table_bp container_ix_listeners;
+static xlb_incr_bp container_ix_listeners;
 
 /**
-   Map from adlb_datum_id to int rank if locked
+   Rank waiting for a lock.  Waiters with a deadline are also linked
+   into timed_waiters so that expired waits can be found.
+ */
+typedef struct lock_waiter
+{
+  int rank;
+  double deadline; // Negative if none
+  struct lock_lock *lock;
+  struct lock_waiter *prev, *next; // In FIFO of lock
+  struct lock_waiter *timed_prev, *timed_next;
+} lock_waiter;
+
+typedef struct lock_lock
+{
+  adlb_datum_id id;
+  int owner;
+  lock_waiter *head, *tail; // FIFO of waiting ranks
+} lock_lock;
+
+/**
+   Map from adlb_datum_id to lock_lock if locked
 */
 static struct table_lp locked;
 
+/**
+   Reduction to compute when a container closes
+ */
+typedef struct close_reduction
+{
+  adlb_reduce_spec spec;
+  adlb_datum_id result_id;
+  int write_decr;
+  struct close_reduction *next;
+} close_reduction;
+
+/**
+   Map from adlb_datum_id to list of close_reduction
+ */
+static struct table_lp close_reductions;
+
+/**
+   Map from adlb_datum_id to xlb_cindex, for containers with
+   status.sorted_index
+ */
+static struct table_lp container_indexes;
+
+/** Waiters with a deadline, unordered */
+static lock_waiter *timed_waiters = NULL;
+
+/** No waiter expires before this time */
+static double next_lock_deadline = INFINITY;
+
+// Lock perf counters
+static int64_t lock_waits = 0;
+static int64_t lock_timeouts = 0;
+
 /**
    Number of ADLB servers
 */
@@ -91,6 +151,37 @@ static adlb_datum_id last_id;
  */
 static adlb_datum_id xlb_min_alloced_system_id;
 
+/**
+   If true, containers with integer keys may store members densely.
+   Set by ADLB_DENSE_CONTAINERS
+ */
+static bool dense_containers = true;
+
+/**
+   Largest packed value sent with a close notification.
+   Set by ADLB_NOTIF_VALUE_MAX
+ */
+static long notif_value_max = 1024;
+
+/**
+   Containers with at least this many members have their members
+   freed incrementally by the server loop after garbage collection.
+   0 disables.  Set by ADLB_GC_DEFER_MIN
+ */
+static long gc_defer_min = 65536;
+
+/**
+   Value of closed data for listeners that asked for it.  Only packed
+   if some listener wants it.
+ */
+typedef struct
+{
+  const adlb_datum_storage *storage; // Unpacked value, or NULL
+  adlb_data_type type;
+  const void *packed; // Packed value, or NULL
+  size_t packed_len;
+} notif_value;
+
 static adlb_data_code
 datum_init_props(adlb_datum_id id, adlb_datum *d,
                  const adlb_create_props *props);
@@ -99,6 +190,11 @@ static adlb_data_code
 add_close_notifs(adlb_datum_id id, adlb_datum *d,
                     adlb_notif_t *notifs);
 
+static adlb_data_code
+add_reduce_ref(adlb_datum_id id, adlb_datum *d,
+               const adlb_reduce_spec *spec, adlb_datum_id result_id,
+               int write_decr, adlb_notif_t *notifs);
+
 static adlb_data_code
 lookup_subscript(adlb_datum_id id, adlb_dsym dsym,
     const adlb_datum_storage *d,
@@ -168,7 +264,8 @@ check_subscript_notifications(adlb_datum_id container_id,
 static adlb_data_code
 insert_notifications2(adlb_datum *d,
       adlb_datum_id id, adlb_subscript subscript,
-      bool copy_sub, adlb_data_type value_type,
+      bool copy_sub, const adlb_datum_storage *value,
+      adlb_data_type value_type,
       const void *value_buffer, size_t value_len,
       struct list *ref_list, struct list_b *listener_list,
       adlb_notif_t *notifs, bool *garbage_collected);
@@ -181,7 +278,8 @@ adlb_data_code process_ref_list(struct list *subscribers,
 
 static
 adlb_data_code append_notifs(struct list_b *listeners, bool free_list_root,
-  adlb_datum_id id, adlb_dsym dsym, adlb_subscript sub, adlb_notif_ranks *notify);
+  adlb_datum_id id, adlb_dsym dsym, adlb_subscript sub,
+  const notif_value *value, adlb_notif_t *notifs);
 
 
 static bool container_value_exists(const adlb_container *c,
@@ -190,9 +288,11 @@ static bool container_lookup(const adlb_container *c, adlb_subscript sub,
                              adlb_container_val *val);
 static bool container_set(adlb_container *c, adlb_subscript sub,
                               adlb_container_val val,
-                              adlb_container_val *prev);
+                              adlb_container_val *prev,
+                              adlb_container_val *stored);
 static adlb_data_code container_add(adlb_container *c, adlb_subscript sub,
-                              adlb_container_val val);
+                              adlb_container_val val,
+                              adlb_container_val *stored);
 
 static void report_leaks(void);
 
@@ -209,14 +309,27 @@ xlb_data_init(int s, int server_num)
   unique = server_num;
   if (unique == 0) unique += s;
 
+  // Tables start small and grow incrementally, cf. incr_table.h
+  int table_size = XLB_DATA_TABLE_INIT_SIZE;
+  long tmp;
+  adlb_code rc = xlb_env_long("ADLB_DATA_TABLE_SIZE", &tmp);
+  check_verbose(rc != ADLB_ERROR, ADLB_DATA_ERROR_INVALID,
+                "Invalid ADLB_DATA_TABLE_SIZE");
+  if (rc == ADLB_SUCCESS)
+  {
+    check_verbose(tmp > 0 && tmp <= INT_MAX / 2, ADLB_DATA_ERROR_INVALID,
+                  "Invalid ADLB_DATA_TABLE_SIZE %li", tmp);
+    table_size = (int)tmp;
+  }
+
   bool result;
-  result = table_lp_init(&tds, 1024*1024);
+  result = xlb_datum_table_init(&tds, s, server_num, table_size);
   if (!result)
     return ADLB_DATA_ERROR_OOM;
-  result = table_bp_init(&container_references, 1024*1024);
+  result = xlb_incr_bp_init(&container_references, table_size);
   if (!result)
     return ADLB_DATA_ERROR_OOM;
-  result = table_bp_init(&container_ix_listeners, 1024*1024);
+  result = xlb_incr_bp_init(&container_ix_listeners, table_size);
   if (!result)
     return ADLB_DATA_ERROR_OOM;
 
@@ -224,6 +337,32 @@ xlb_data_init(int s, int server_num)
   if (!result)
     return ADLB_DATA_ERROR_OOM;
 
+  result = table_lp_init(&close_reductions, 16);
+  if (!result)
+    return ADLB_DATA_ERROR_OOM;
+
+  result = table_lp_init(&container_indexes, 16);
+  if (!result)
+    return ADLB_DATA_ERROR_OOM;
+
+  rc = xlb_pool_init();
+  check_verbose(rc == ADLB_SUCCESS, ADLB_DATA_ERROR_OOM,
+                "Could not initialize data pools");
+
+  // Store short strings and blobs inline, cf. adlb_types.h
+  getenv_boolean("ADLB_INLINE_VALUES", true, &xlb_inline_values);
+
+  getenv_boolean("ADLB_DENSE_CONTAINERS", true, &dense_containers);
+
+  rc = xlb_env_long("ADLB_NOTIF_VALUE_MAX", &notif_value_max);
+  check_verbose(rc != ADLB_ERROR && notif_value_max >= 0 &&
+                notif_value_max <= INT_MAX, ADLB_DATA_ERROR_INVALID,
+                "Invalid ADLB_NOTIF_VALUE_MAX");
+
+  rc = xlb_env_long("ADLB_GC_DEFER_MIN", &gc_defer_min);
+  check_verbose(rc != ADLB_ERROR && gc_defer_min >= 0,
+                ADLB_DATA_ERROR_INVALID, "Invalid ADLB_GC_DEFER_MIN");
+
   last_id = LONG_MAX - servers - 1;
 
   xlb_min_alloced_system_id = 0;
@@ -251,7 +390,9 @@ xlb_data_create(adlb_datum_id id, adlb_data_type type,
           ADLB_Data_type_tostring(type_extra->CONTAINER.val_type));
 
 #ifndef NDEBUG
-  check_verbose(!table_lp_contains(&tds, id), ADLB_DATA_ERROR_DOUBLE_DECLARE,
+  void *existing;
+  check_verbose(!xlb_datum_table_search(&tds, id, &existing),
+                ADLB_DATA_ERROR_DOUBLE_DECLARE,
                 ADLB_PRID" already exists",
                 ADLB_PRID_ARGS(id, props->symbol));
 #endif
@@ -263,24 +404,73 @@ xlb_data_create(adlb_datum_id id, adlb_data_type type,
     return ADLB_DATA_SUCCESS;
   }
 
-  adlb_datum* d = malloc(sizeof(adlb_datum));
+  adlb_datum* d = xlb_pool_alloc(sizeof(adlb_datum));
   check_verbose(d != NULL, ADLB_DATA_ERROR_OOM,
                 "Out of memory while allocating datum");
   d->type = type;
   d->symbol = props->symbol;
   list_b_init(&d->listeners);
 
-  table_lp_add(&tds, id, d);
+  xlb_datum_table_add(&tds, id, d);
 
   adlb_data_code dc = datum_init_props(id, d, props);
   DATA_CHECK(dc);
 
-  if (ADLB_Data_is_compound(type))
+  if (type == ADLB_DATA_TYPE_CONTAINER && dense_containers)
+  {
+    // Integer keys may be stored densely, cf. container.h
+    assert(type_extra->valid);
+    d->data.CONTAINER.key_type = type_extra->CONTAINER.key_type;
+    d->data.CONTAINER.val_type = type_extra->CONTAINER.val_type;
+    dc = xlb_members_init(&d->data.CONTAINER, true);
+    DATA_CHECK(dc);
+    d->status.set = true;
+  }
+  else if (ADLB_Data_is_compound(type))
   {
     dc = ADLB_Init_compound(&d->data, type, *type_extra, false);
     DATA_CHECK(dc);
     d->status.set = true;
   }
+
+  if (type == ADLB_DATA_TYPE_CONTAINER && props->sorted_index)
+  {
+    xlb_cindex *ix = xlb_cindex_create(
+              (adlb_data_type)d->data.CONTAINER.key_type);
+    DATA_CHECK_MALLOC(ix);
+    bool ok = table_lp_add(&container_indexes, id, ix);
+    check_verbose(ok, ADLB_DATA_ERROR_OOM, "Could not add index");
+    d->status.sorted_index = true;
+  }
+  return ADLB_DATA_SUCCESS;
+}
+
+static inline xlb_cindex *
+container_index(adlb_datum_id id)
+{
+  xlb_cindex *ix;
+  bool found = table_lp_search(&container_indexes, id, (void**)&ix);
+  assert(found);
+  return found ? ix : NULL;
+}
+
+/**
+   Rebuild index from all members, e.g. after storing whole container
+ */
+static adlb_data_code
+container_index_rebuild(adlb_datum_id id, adlb_datum *d)
+{
+  adlb_data_code dc;
+  xlb_cindex *ix = container_index(id);
+  xlb_cindex_clear(ix);
+
+  xlb_members_iter it;
+  xlb_members_iter_init(&it);
+  while (xlb_members_iter_next(&d->data.CONTAINER, &it))
+  {
+    dc = xlb_cindex_add(ix, it.key, it.key_len);
+    DATA_CHECK(dc);
+  }
   return ADLB_DATA_SUCCESS;
 }
 
@@ -333,7 +523,7 @@ xlb_data_exists(adlb_datum_id id, adlb_subscript subscript, bool* result)
 {
   adlb_data_code dc;
   adlb_datum* d;
-  table_lp_search(&tds, id, (void**)&d);
+  xlb_datum_table_search(&tds, id, (void**)&d);
 
   // if subscript provided, check that subscript exists
   if (!adlb_has_sub(subscript))
@@ -417,7 +607,7 @@ adlb_data_code xlb_data_permanent(adlb_datum_id id)
 adlb_data_code
 xlb_datum_lookup(adlb_datum_id id, adlb_datum **d)
 {
-  bool found = table_lp_search(&tds, id, (void**)d);
+  bool found = xlb_datum_table_search(&tds, id, (void**)d);
   check_verbose(found, ADLB_DATA_ERROR_NOT_FOUND,
                 "not found: "ADLB_PRID,
                 ADLB_PRID_ARGS(id, ADLB_DSYM_NULL));
@@ -543,11 +733,25 @@ xlb_refc_incr(adlb_datum *d, adlb_datum_id id,
 }
 
 static adlb_data_code
-extract_members(adlb_container *c, int count, int offset,
+extract_members(adlb_container *c, xlb_members_iter *it,
+                int count, int skip,
                 bool include_keys, bool include_vals,
                 const adlb_buffer *caller_buffer,
                 adlb_buffer *output);
 
+/*
+  Whether to leave freeing members of garbage collected datum to the
+  server loop.  Only large containers are deferred.  Acquired
+  references must be applied immediately, so can't defer those.
+ */
+static inline bool
+defer_members_cleanup(const adlb_datum *d, xlb_refc_acquire to_acquire)
+{
+  return gc_defer_min > 0 && d->type == ADLB_DATA_TYPE_CONTAINER &&
+         ADLB_REFC_IS_NULL(to_acquire.refcounts) &&
+         xlb_members_size(&d->data.CONTAINER) >= gc_defer_min;
+}
+
 static adlb_data_code
 datum_gc(adlb_datum_id id, adlb_datum* d,
            xlb_refc_acquire to_acquire, xlb_refc_changes *refcs)
@@ -560,8 +764,16 @@ datum_gc(adlb_datum_id id, adlb_datum* d,
   if (d->status.set)
   {
     // Cleanup the storage if initialized
-    adlb_data_code dc = xlb_datum_cleanup(&d->data, d->type, true,
-                                true, true, to_acquire, refcs);
+    adlb_data_code dc;
+    if (defer_members_cleanup(d, to_acquire))
+    {
+      dc = xlb_members_cleanup_defer(&d->data.CONTAINER);
+    }
+    else
+    {
+      dc = xlb_datum_cleanup(&d->data, d->type, true,
+                             true, true, to_acquire, refcs);
+    }
     DATA_CHECK(dc);
   }
 
@@ -571,59 +783,177 @@ datum_gc(adlb_datum_id id, adlb_datum* d,
         d->listeners.size, ADLB_PRID_ARGS(id, d->symbol));
 
   void *tmp;
-  table_lp_remove(&tds, id, &tmp);
+  xlb_datum_table_remove(&tds, id, &tmp);
   assert(tmp == d);
 
-  free(d);
+  if (d->status.sorted_index)
+  {
+    bool found = table_lp_remove(&container_indexes, id, &tmp);
+    assert(found);
+    xlb_cindex_free(tmp);
+  }
+
+  xlb_pool_free(d);
   return ADLB_DATA_SUCCESS;
 }
 
 adlb_data_code
-xlb_data_lock(adlb_datum_id id, int rank, bool* result)
+xlb_data_lock(adlb_datum_id id, int rank, bool wait, double deadline,
+              bool* result)
 {
   adlb_datum* d;
   adlb_data_code dc = xlb_datum_lookup(id, &d);
   DATA_CHECK(dc);
 
-  if (table_lp_contains(&locked, id))
+  lock_lock *lock;
+  if (!table_lp_search(&locked, id, (void**)&lock))
   {
-    *result = false;
+    lock = malloc(sizeof(*lock));
+    DATA_CHECK_MALLOC(lock);
+    lock->id = id;
+    lock->owner = rank;
+    lock->head = lock->tail = NULL;
+    bool ok = table_lp_add(&locked, id, lock);
+    check_verbose(ok, ADLB_DATA_ERROR_OOM, "Could not add lock");
+    *result = true;
     return ADLB_DATA_SUCCESS;
   }
+
+  *result = false;
+  if (!wait)
+  {
+    return ADLB_DATA_SUCCESS;
+  }
+
+  // The owner would wait for itself forever
+  check_verbose(lock->owner != rank, ADLB_DATA_ERROR_INVALID,
+                "rank %i waiting for lock it holds: "ADLB_PRID, rank,
+                ADLB_PRID_ARGS(id, d->symbol));
+
+  // Queue rank behind current owner and any earlier waiters
+  lock_waiter *w = malloc(sizeof(*w));
+  DATA_CHECK_MALLOC(w);
+  w->rank = rank;
+  w->deadline = deadline;
+  w->lock = lock;
+  w->prev = lock->tail;
+  w->next = NULL;
+  if (lock->tail != NULL)
+    lock->tail->next = w;
   else
+    lock->head = w;
+  lock->tail = w;
+
+  w->timed_prev = w->timed_next = NULL;
+  if (deadline >= 0)
   {
-    int* r = malloc(sizeof(int));
-    *r = rank;
-    *result = true;
-    table_lp_add(&locked, id, (void*)r);
+    w->timed_next = timed_waiters;
+    if (timed_waiters != NULL)
+      timed_waiters->timed_prev = w;
+    timed_waiters = w;
+    if (deadline < next_lock_deadline)
+      next_lock_deadline = deadline;
   }
 
+  lock_waits++;
+  DEBUG("Lock: "ADLB_PRID" rank %i waiting for rank %i",
+        ADLB_PRID_ARGS(id, d->symbol), rank, lock->owner);
   return ADLB_DATA_SUCCESS;
 }
 
+/**
+   Unlink and free waiter, leaving lock in place
+ */
+static void
+lock_waiter_remove(lock_waiter *w)
+{
+  lock_lock *lock = w->lock;
+  if (w->prev != NULL)
+    w->prev->next = w->next;
+  else
+    lock->head = w->next;
+  if (w->next != NULL)
+    w->next->prev = w->prev;
+  else
+    lock->tail = w->prev;
+
+  if (w->deadline >= 0)
+  {
+    if (w->timed_prev != NULL)
+      w->timed_prev->timed_next = w->timed_next;
+    else
+      timed_waiters = w->timed_next;
+    if (w->timed_next != NULL)
+      w->timed_next->timed_prev = w->timed_prev;
+  }
+  free(w);
+}
+
 adlb_data_code
-xlb_data_unlock(adlb_datum_id id)
+xlb_data_unlock(adlb_datum_id id, int *granted)
 {
-  int* r;
-  bool found = table_lp_remove(&locked, id, (void**)&r);
+  lock_lock *lock;
+  bool found = table_lp_search(&locked, id, (void**)&lock);
   check_verbose(found, ADLB_DATA_ERROR_NOT_FOUND,
                 "not found: "ADLB_PRID,
                 ADLB_PRID_ARGS(id, ADLB_DSYM_NULL));
-  free(r);
+
+  if (lock->head != NULL)
+  {
+    // Hand over to first waiter
+    lock_waiter *w = lock->head;
+    lock->owner = w->rank;
+    *granted = w->rank;
+    lock_waiter_remove(w);
+    return ADLB_DATA_SUCCESS;
+  }
+
+  *granted = -1;
+  table_lp_remove(&locked, id, (void**)&lock);
+  free(lock);
   return ADLB_DATA_SUCCESS;
 }
 
+bool
+xlb_data_lock_expire(double now, adlb_datum_id *id, int *rank)
+{
+  if (now < next_lock_deadline)
+  {
+    return false;
+  }
+
+  double next = INFINITY;
+  for (lock_waiter *w = timed_waiters; w != NULL; w = w->timed_next)
+  {
+    if (w->deadline <= now)
+    {
+      *id = w->lock->id;
+      *rank = w->rank;
+      lock_waiter_remove(w);
+      lock_timeouts++;
+      // Rescan on next call in case more have expired
+      return true;
+    }
+    if (w->deadline < next)
+      next = w->deadline;
+  }
+
+  next_lock_deadline = next;
+  return false;
+}
+
 /**
    @param subscript if not null and data type is container, subscribe
           to this subscript
    @param work_type send notification to worker with this work type.
                 If server, this has no effect
+   @param with_value send value with notification, cf. append_notifs()
    @param result set to true iff subscribed, else false (td closed)
    @return ADLB_SUCCESS or ADLB_ERROR
  */
 adlb_data_code
 xlb_data_subscribe(adlb_datum_id id, adlb_subscript subscript,
-              int rank, int work_type, bool* subscribed)
+              int rank, int work_type, bool with_value, bool* subscribed)
 {
   adlb_datum* d;
   adlb_data_code dc = xlb_datum_lookup(id, &d);
@@ -679,18 +1009,19 @@ xlb_data_subscribe(adlb_datum_id id, adlb_subscript subscript,
         ADLB_PRIDSUB_ARGS(id, d->symbol, subscript));
 
       struct list_b* listeners = NULL;
-      found = table_bp_search(&container_ix_listeners, key, key_len,
+      found = xlb_incr_bp_search(&container_ix_listeners, key, key_len,
                                 (void*)&listeners);
       if (!found)
       {
         // Nobody else has subscribed to this pair yet
         listeners = list_b_create();
-        table_bp_add(&container_ix_listeners, key, key_len, listeners);
+        xlb_incr_bp_add(&container_ix_listeners, key, key_len, listeners);
       }
       TRACE("Added %i to listeners for "ADLB_PRIDSUB, rank,
           ADLB_PRIDSUB_ARGS(id, d->symbol, subscript));
 
-      xlb_listener listener = { .rank = rank, .work_type = work_type };
+      xlb_listener listener = { .rank = rank, .work_type = work_type,
+                                .with_value = with_value };
       list_b_add(listeners, &listener, sizeof(listener));
       *subscribed = true;
     }
@@ -713,7 +1044,8 @@ xlb_data_subscribe(adlb_datum_id id, adlb_subscript subscript,
     }
     else
     {
-      xlb_listener listener = { .rank = rank, .work_type = work_type };
+      xlb_listener listener = { .rank = rank, .work_type = work_type,
+                                .with_value = with_value };
       list_b_add(&d->listeners, &listener, sizeof(listener));
       *subscribed = true;
     }
@@ -827,7 +1159,7 @@ adlb_data_code xlb_data_container_reference(adlb_datum_id id,
   size_t key_len = xlb_write_id_sub(key, id, subscript);
 
   struct list* listeners = NULL;
-  bool found = table_bp_search(&container_references, key, key_len,
+  bool found = xlb_incr_bp_search(&container_references, key, key_len,
                             (void*)&listeners);
   TRACE("search container_ref "ADLB_PRIDSUB": %i",
           ADLB_PRIDSUB_ARGS(id, d->symbol, subscript), (int)found);
@@ -837,7 +1169,7 @@ adlb_data_code xlb_data_container_reference(adlb_datum_id id,
     listeners = list_create();
     TRACE("add container_ref "ADLB_PRIDSUB,
         ADLB_PRIDSUB_ARGS(id, d->symbol, subscript));
-    table_bp_add(&container_references, key, key_len, listeners);
+    xlb_incr_bp_add(&container_references, key, key_len, listeners);
     d->status.subscript_notifs = true;
   }
   else
@@ -966,6 +1298,12 @@ data_store_root(adlb_datum_id id, adlb_datum *d,
   DATA_CHECK(dc);
   d->status.set = true;
 
+  if (d->status.sorted_index)
+  {
+    dc = container_index_rebuild(id, d);
+    DATA_CHECK(dc);
+  }
+
   if (ENABLE_LOG_DEBUG && xlb_debug_enabled)
   {
     char *val_s = ADLB_Data_repr(&d->data, d->type);
@@ -1071,7 +1409,8 @@ data_store_subscript(adlb_datum_id id, adlb_datum *d,
                     ADLB_Data_type_tostring(c->val_type));
 
         // Now we are guaranteed to succeed
-        adlb_datum_storage *entry = malloc(sizeof(adlb_datum_storage));
+        adlb_datum_storage *entry =
+                      xlb_pool_alloc(sizeof(adlb_datum_storage));
         dc = ADLB_Unpack2(entry, (adlb_data_type)c->val_type, value,
                   length, copy, store_refcounts, true, took_ownership);
         DATA_CHECK(dc);
@@ -1082,15 +1421,22 @@ data_store_subscript(adlb_datum_id id, adlb_datum *d,
           // Ok- somebody did an Insert_atomic
           adlb_container_val v;
           // Reset entry
-          bool b = container_set(c, curr_sub, entry, &v);
+          bool b = container_set(c, curr_sub, entry, &v, &entry);
           ASSERT(b);
           ASSERT(v == NULL); // Should have been NULL for unlinked
         }
         else
         {
           DEBUG("Creating new container entry");
-          dc = container_add(c, curr_sub, entry);
+          dc = container_add(c, curr_sub, entry, &entry);
           DATA_CHECK(dc);
+
+          if (d->status.sorted_index && data == &d->data)
+          {
+            dc = xlb_cindex_add(container_index(id), curr_sub.key,
+                                curr_sub.length);
+            DATA_CHECK(dc);
+          }
         }
 
         if (ENABLE_LOG_DEBUG && xlb_debug_enabled)
@@ -1113,8 +1459,15 @@ data_store_subscript(adlb_datum_id id, adlb_datum *d,
       else
       {
         // Use NULL pointer value to represent reserved but not set
-        dc = container_add(c, curr_sub, NULL);
+        dc = container_add(c, curr_sub, NULL, NULL);
         DATA_CHECK(dc);
+
+        if (d->status.sorted_index && data == &d->data)
+        {
+          dc = xlb_cindex_add(container_index(id), curr_sub.key,
+                              curr_sub.length);
+          DATA_CHECK(dc);
+        }
       }
       return ADLB_DATA_SUCCESS;
     }
@@ -1230,10 +1583,118 @@ add_close_notifs(adlb_datum_id id, adlb_datum *d, adlb_notif_t *notifs)
   assert(d != NULL);
   DEBUG("data_close: "ADLB_PRID" listeners: %i",
         ADLB_PRID_ARGS(id, d->symbol), d->listeners.size);
+  notif_value value = { .storage = d->status.set ? &d->data : NULL,
+                        .type = d->type, .packed = NULL };
   adlb_data_code dc = append_notifs(&d->listeners, false, id, d->symbol,
-                                    ADLB_NO_SUB, &notifs->notify);
+                                    ADLB_NO_SUB, &value, notifs);
   DATA_CHECK(dc);
 
+  close_reduction *reds;
+  if (close_reductions.size > 0 &&
+      table_lp_remove(&close_reductions, id, (void**)&reds))
+  {
+    while (reds != NULL)
+    {
+      close_reduction *next = reds->next;
+      dc = add_reduce_ref(id, d, &reds->spec, reds->result_id,
+                          reds->write_decr, notifs);
+      free(reds);
+      DATA_CHECK(dc);
+      reds = next;
+    }
+  }
+
+  return ADLB_DATA_SUCCESS;
+}
+
+/**
+   Compute reduction and add notification to store result
+ */
+static adlb_data_code
+add_reduce_ref(adlb_datum_id id, adlb_datum *d,
+               const adlb_reduce_spec *spec, adlb_datum_id result_id,
+               int write_decr, adlb_notif_t *notifs)
+{
+  adlb_reduce_result result;
+  adlb_data_code dc = xlb_reduce(&d->data, d->type, spec, &result);
+  DATA_CHECK(dc);
+
+  void *value = malloc(sizeof(adlb_atomic_value));
+  DATA_CHECK_MALLOC(value);
+  adlb_data_type type;
+  size_t length;
+  xlb_reduce_result_pack(spec, &result, &type, value, &length);
+
+  DEBUG("Reduction of "ADLB_PRID" => "ADLB_PRID,
+        ADLB_PRID_ARGS(id, d->symbol),
+        ADLB_PRID_ARGS(result_id, ADLB_DSYM_NULL));
+
+  adlb_code ac = xlb_to_free_add(notifs, value);
+  check_verbose(ac == ADLB_SUCCESS, ADLB_DATA_ERROR_OOM,
+                "Could not add to notifications");
+  ac = xlb_refs_add(&notifs->references, result_id, ADLB_NO_SUB, type,
+                    value, length, ADLB_NO_REFC, write_decr);
+  check_verbose(ac == ADLB_SUCCESS, ADLB_DATA_ERROR_OOM,
+                "Could not add to notifications");
+  return ADLB_DATA_SUCCESS;
+}
+
+adlb_data_code
+xlb_data_reduce(adlb_datum_id id, const adlb_reduce_spec *spec,
+                adlb_reduce_result *result)
+{
+  adlb_datum *d;
+  adlb_data_code dc = xlb_datum_lookup(id, &d);
+  DATA_CHECK(dc);
+
+  return xlb_reduce(&d->data, d->type, spec, result);
+}
+
+adlb_data_code
+xlb_data_reduce_on_close(adlb_datum_id id, const adlb_reduce_spec *spec,
+                         adlb_datum_id result_id, int write_decr,
+                         adlb_notif_t *notifs)
+{
+  adlb_datum *d;
+  adlb_data_code dc = xlb_datum_lookup(id, &d);
+  DATA_CHECK(dc);
+
+  check_verbose(d->type == ADLB_DATA_TYPE_CONTAINER ||
+                d->type == ADLB_DATA_TYPE_MULTISET, ADLB_DATA_ERROR_TYPE,
+                "Cannot reduce "ADLB_PRID" of type %s",
+                ADLB_PRID_ARGS(id, d->symbol),
+                ADLB_Data_type_tostring(d->type));
+  check_verbose(spec->op != ADLB_REDUCE_HISTOGRAM, ADLB_DATA_ERROR_INVALID,
+                "Histogram cannot be stored to datum");
+  adlb_data_type val_type = (d->type == ADLB_DATA_TYPE_CONTAINER) ?
+          (adlb_data_type)d->data.CONTAINER.val_type :
+          (adlb_data_type)d->data.MULTISET->elem_type;
+  dc = xlb_reduce_check(spec, val_type);
+  DATA_CHECK(dc);
+
+  if (d->write_refcount == 0)
+  {
+    // Already closed
+    return add_reduce_ref(id, d, spec, result_id, write_decr, notifs);
+  }
+
+  close_reduction *red = malloc(sizeof(*red));
+  DATA_CHECK_MALLOC(red);
+  red->spec = *spec;
+  red->result_id = result_id;
+  red->write_decr = write_decr;
+
+  close_reduction *head;
+  if (table_lp_remove(&close_reductions, id, (void**)&head))
+  {
+    red->next = head;
+  }
+  else
+  {
+    red->next = NULL;
+  }
+  bool ok = table_lp_add(&close_reductions, id, red);
+  check_verbose(ok, ADLB_DATA_ERROR_OOM, "Could not add reduction");
   return ADLB_DATA_SUCCESS;
 }
 
@@ -1400,12 +1861,11 @@ lookup_subscript(adlb_datum_id id, adlb_dsym dsym,
    Helper function to add to container
  */
 static adlb_data_code container_add(adlb_container *c, adlb_subscript sub,
-                              adlb_container_val val)
+                              adlb_container_val val,
+                              adlb_container_val *stored)
 {
   TRACE("Adding %p to %p", val, c);
-  bool ok = table_bp_add(c->members, sub.key, sub.length, val);
-
-  return ok ? ADLB_DATA_SUCCESS : ADLB_DATA_ERROR_OOM;
+  return xlb_members_add(c, sub.key, sub.length, val, stored);
 }
 
 /**
@@ -1413,9 +1873,10 @@ static adlb_data_code container_add(adlb_container *c, adlb_subscript sub,
  */
 static bool container_set(adlb_container *c, adlb_subscript sub,
                               adlb_container_val val,
-                              adlb_container_val *prev)
+                              adlb_container_val *prev,
+                              adlb_container_val *stored)
 {
-  return table_bp_set(c->members, sub.key, sub.length, val, (void**)prev);
+  return xlb_members_set(c, sub.key, sub.length, val, prev, stored);
 }
 
 /**
@@ -1424,7 +1885,7 @@ static bool container_set(adlb_container *c, adlb_subscript sub,
 static bool container_lookup(const adlb_container *c, adlb_subscript sub,
                              adlb_container_val *val)
 {
-  return table_bp_search(c->members, sub.key, sub.length, (void**)val);
+  return xlb_members_lookup(c, sub.key, sub.length, val);
 }
 
 /**
@@ -1444,25 +1905,28 @@ static bool container_value_exists(const adlb_container *c,
 }
 
 static adlb_data_code
-pack_member(adlb_container *cont, table_bp_entry *item,
-            bool include_keys, bool include_vals,
+pack_member(adlb_container *cont, const void *key, size_t key_len,
+            adlb_container_val val, bool include_keys, bool include_vals,
             const adlb_buffer *tmp_buf, adlb_buffer *result,
             bool *result_caller_buffer, size_t* result_pos);
 
 /**
    Extract the table members into a buffer.
-   count: -1 for all past offset, or the exact expected count based
-        on the array size.
+   it: iterator to continue from.  On return, positioned at last
+        member extracted.
+   count: number of members to extract, as computed by
+        enumerate_slice_size()
+   skip: number of members to skip before extracting
  */
 static adlb_data_code
-extract_members(adlb_container *cont, int count, int offset,
+extract_members(adlb_container *cont, xlb_members_iter *it,
+                int count, int skip,
                 bool include_keys, bool include_vals,
                 const adlb_buffer *caller_buffer,
                 adlb_buffer *output)
 {
-  int c = 0; // Count of members seen
+  int c = 0; // Count of members extracted
   adlb_data_code dc;
-  struct table_bp* members = cont->members;
   bool use_caller_buf;
 
   dc = ADLB_Init_buf(caller_buffer, output, &use_caller_buf, 65536);
@@ -1476,33 +1940,38 @@ extract_members(adlb_container *cont, int count, int offset,
 
   size_t output_pos = 0; // Amount of output used
 
-  TABLE_BP_FOREACH(members, item)
+  for (int i = 0; i < skip; i++)
   {
-    if (c >= offset)
+    if (!xlb_members_iter_next(cont, it))
     {
-      if (c >= count+offset && count != -1)
-      {
-        TRACE("Got %i/%i items, done\n", c+1, count);
-        goto extract_members_done;
-      }
-      dc = pack_member(cont, item, include_keys, include_vals, &tmp_buf,
+      break;
+    }
+  }
+
+  // Stop without advancing past the last member, so that the
+  // iterator can be saved in a cursor
+  while (c < count && xlb_members_iter_next(cont, it))
+  {
+    if (include_keys || include_vals)
+    {
+      dc = pack_member(cont, it->key, it->key_len, it->val,
+                       include_keys, include_vals, &tmp_buf,
                        output, &use_caller_buf, &output_pos);
       DATA_CHECK(dc);
     }
     c++;
   }
 
-  TRACE("Got %i/%i entries at offset %i table size %i\n", c-offset, count,
-                offset, members->size);
+  TRACE("Got %i/%i entries after skipping %i table size %i\n", c, count,
+                skip, xlb_members_size(cont));
   // Should have found requested number
-  if (count != -1 && c - offset != count)
+  if (c != count)
   {
     DEBUG("Warning: did not get expected count when enumerating array. "
-          "Got %i/%i entries at offset %i table size %i\n",
-          c-offset, count, offset, members->size);
+          "Got %i/%i entries after skipping %i table size %i\n",
+          c, count, skip, xlb_members_size(cont));
   }
 
-extract_members_done:
   // Mark actual length of output
   output->length = output_pos;
   TRACE("extract_members: output_length: %zu\n", output->length);
@@ -1510,25 +1979,22 @@ extract_members_done:
 }
 
 static adlb_data_code
-pack_member(adlb_container *cont, table_bp_entry *item,
-            bool include_keys, bool include_vals,
+pack_member(adlb_container *cont, const void *key, size_t key_len,
+            adlb_container_val val, bool include_keys, bool include_vals,
             const adlb_buffer *tmp_buf, adlb_buffer *result,
             bool *result_caller_buffer, size_t* result_pos)
 {
-  assert(table_bp_entry_valid(item));
-
   adlb_data_code dc;
   if (include_keys)
   {
-    assert(item->key_len <= INT_MAX);
-    dc = ADLB_Append_buffer(ADLB_DATA_TYPE_NULL,
-            table_bp_get_key(item), item->key_len,
+    assert(key_len <= INT_MAX);
+    dc = ADLB_Append_buffer(ADLB_DATA_TYPE_NULL, key, key_len,
             true, result, result_caller_buffer, result_pos);
     DATA_CHECK(dc);
   }
   if (include_vals)
   {
-    dc = ADLB_Pack_buffer(item->data, (adlb_data_type)cont->val_type,
+    dc = ADLB_Pack_buffer(val, (adlb_data_type)cont->val_type,
           true, tmp_buf, result, result_caller_buffer, result_pos);
     DATA_CHECK(dc);
   }
@@ -1536,6 +2002,181 @@ pack_member(adlb_container *cont, table_bp_entry *item,
   return ADLB_DATA_SUCCESS;
 }
 
+/**
+   Check if key passes filter
+ */
+static inline bool
+filter_match(const adlb_enum_filter *filter, const xlb_cindex_key *k,
+             const void *key_data)
+{
+  switch (filter->type)
+  {
+    case ADLB_ENUM_RANGE:
+      return k->is_int && k->ikey >= filter->lo && k->ikey <= filter->hi;
+    case ADLB_ENUM_PREFIX:
+      return k->len >= filter->prefix_len &&
+             memcmp(key_data, filter->prefix, filter->prefix_len) == 0;
+    default:
+      return true;
+  }
+}
+
+/**
+   Pack members with keys ix->keys[start..end) that match filter,
+   after skipping offset matches
+   count: maximum number of members to pack, negative for unlimited
+   actual: set to number of members packed
+ */
+static adlb_data_code
+extract_index_members(adlb_container *cont, const xlb_cindex *ix,
+                int start, int end, const adlb_enum_filter *filter,
+                int count, int offset,
+                bool include_keys, bool include_vals,
+                const adlb_buffer *caller_buffer,
+                adlb_buffer *output, int *actual)
+{
+  adlb_data_code dc;
+  bool use_caller_buf;
+
+  dc = ADLB_Init_buf(caller_buffer, output, &use_caller_buf, 65536);
+  DATA_CHECK(dc);
+
+  adlb_buffer tmp_buf;
+  tmp_buf.length = XLB_STACK_BUFFER_LEN;
+  char tmp_storage[XLB_STACK_BUFFER_LEN];
+  tmp_buf.data = tmp_storage;
+
+  size_t output_pos = 0;
+  int matches = 0, c = 0;
+  for (int i = start; i < end && (count < 0 || c < count); i++)
+  {
+    const xlb_cindex_key *k = ix->keys[i];
+    if (!filter_match(filter, k, k->data))
+      continue;
+
+    if (matches++ < offset)
+      continue;
+
+    if (include_keys || include_vals)
+    {
+      adlb_container_val val;
+      bool found = xlb_members_lookup(cont, k->data, k->len, &val);
+      assert(found);
+
+      dc = pack_member(cont, k->data, k->len, val,
+                       include_keys, include_vals, &tmp_buf,
+                       output, &use_caller_buf, &output_pos);
+      DATA_CHECK(dc);
+    }
+    c++;
+  }
+
+  output->length = output_pos;
+  *actual = c;
+  return ADLB_DATA_SUCCESS;
+}
+
+/**
+   Enumerate container members that pass filter.  Uses the container's
+   index if it has one, otherwise scans all members.
+ */
+static adlb_data_code
+enumerate_filtered(adlb_datum_id id, adlb_datum *d,
+               const adlb_enum_filter *filter, int count, int offset,
+               bool include_keys, bool include_vals,
+               const adlb_buffer *caller_buffer,
+               adlb_buffer *data, int *actual)
+{
+  adlb_data_code dc;
+  adlb_container *c = &d->data.CONTAINER;
+  adlb_data_type key_type = (adlb_data_type)c->key_type;
+
+  check_verbose(filter->type != ADLB_ENUM_RANGE ||
+                key_type == ADLB_DATA_TYPE_INTEGER,
+      ADLB_DATA_ERROR_TYPE, "range enumeration of "ADLB_PRID" with key "
+      "type %s", ADLB_PRID_ARGS(id, d->symbol),
+      ADLB_Data_type_tostring(key_type));
+  check_verbose(filter->type != ADLB_ENUM_PREFIX ||
+                filter->prefix_len <= ADLB_DATA_SUBSCRIPT_MAX,
+      ADLB_DATA_ERROR_INVALID, "enumeration prefix too long: %zu",
+      filter->prefix_len);
+
+  if (d->status.sorted_index)
+  {
+    xlb_cindex *ix = container_index(id);
+    dc = xlb_cindex_sort(ix);
+    DATA_CHECK(dc);
+
+    // Narrow down to keys that could match
+    int start = 0, end = ix->count;
+    if (filter->type == ADLB_ENUM_RANGE)
+    {
+      xlb_cindex_key probe = { .is_int = true, .ikey = filter->lo,
+                               .len = 0 };
+      start = xlb_cindex_lower_bound(ix, &probe, NULL);
+      end = start;
+      while (end < ix->count && ix->keys[end]->is_int &&
+             ix->keys[end]->ikey <= filter->hi)
+      {
+        end++;
+      }
+    }
+    else if (filter->type == ADLB_ENUM_PREFIX &&
+             key_type != ADLB_DATA_TYPE_INTEGER)
+    {
+      // Keys with prefix are contiguous in bytewise order
+      xlb_cindex_key probe = { .is_int = false, .ikey = 0,
+                               .len = filter->prefix_len };
+      start = xlb_cindex_lower_bound(ix, &probe, filter->prefix);
+      end = start;
+      while (end < ix->count &&
+             filter_match(filter, ix->keys[end], ix->keys[end]->data))
+      {
+        end++;
+      }
+    }
+
+    return extract_index_members(c, ix, start, end, filter, count, offset,
+              include_keys, include_vals, caller_buffer, data, actual);
+  }
+
+  // No index: collect matching keys in a temporary index
+  xlb_cindex *tmp = xlb_cindex_create(key_type);
+  DATA_CHECK_MALLOC(tmp);
+
+  xlb_members_iter it;
+  xlb_members_iter_init(&it);
+  while (xlb_members_iter_next(c, &it))
+  {
+    xlb_cindex_key k;
+    xlb_cindex_key_init(key_type, it.key, it.key_len, &k);
+    if (filter_match(filter, &k, it.key))
+    {
+      dc = xlb_cindex_add(tmp, it.key, it.key_len);
+      if (dc != ADLB_DATA_SUCCESS)
+      {
+        xlb_cindex_free(tmp);
+        return dc;
+      }
+    }
+  }
+
+  dc = ADLB_DATA_SUCCESS;
+  if (filter->sorted)
+  {
+    dc = xlb_cindex_sort(tmp);
+  }
+
+  if (dc == ADLB_DATA_SUCCESS)
+  {
+    dc = extract_index_members(c, tmp, 0, tmp->count, filter, count,
+              offset, include_keys, include_vals, caller_buffer, data,
+              actual);
+  }
+  xlb_cindex_free(tmp);
+  return dc;
+}
+
 static int
 enumerate_slice_size(int offset, int count, int actual_size)
 {
@@ -1568,11 +2209,18 @@ enumerate_slice_size(int offset, int count, int actual_size)
    @param length Length of data in data
    @param include_keys whether to include keys in result
    @param include_vals whether to include values in result
+   @param cursor if not NULL, start at cursor position instead of offset,
+                 and update cursor to position after returned entries
+   @param filter if not NULL, only return container members that pass
+                 filter, with offset and count applied to the matches.
+                 Cannot be combined with cursor.
    @param actual Returns the number of entries in the container
  */
 adlb_data_code
 xlb_data_enumerate(adlb_datum_id id, int count, int offset,
                bool include_keys, bool include_vals,
+               adlb_enum_cursor *cursor,
+               const adlb_enum_filter *filter,
                const adlb_buffer *caller_buffer,
                adlb_buffer *data, int* actual,
                adlb_data_type *key_type, adlb_data_type *val_type)
@@ -1582,19 +2230,75 @@ xlb_data_enumerate(adlb_datum_id id, int count, int offset,
   adlb_data_code dc = xlb_datum_lookup(id, &d);
   DATA_CHECK(dc);
 
+  if (filter != NULL &&
+      (filter->type != ADLB_ENUM_ALL || filter->sorted))
+  {
+    check_verbose(cursor == NULL, ADLB_DATA_ERROR_INVALID,
+        "enumeration of "ADLB_PRID": cursor cannot be used with filter",
+        ADLB_PRID_ARGS(id, d->symbol));
+    check_verbose(d->type == ADLB_DATA_TYPE_CONTAINER,
+        ADLB_DATA_ERROR_TYPE, "filtered enumeration of "ADLB_PRID
+        " with type %s not supported", ADLB_PRID_ARGS(id, d->symbol),
+        ADLB_Data_type_tostring(d->type));
+
+    dc = enumerate_filtered(id, d, filter, count, offset,
+              include_keys, include_vals, caller_buffer, data, actual);
+    DATA_CHECK(dc);
+
+    *key_type = (adlb_data_type)d->data.CONTAINER.key_type;
+    *val_type = (adlb_data_type)d->data.CONTAINER.val_type;
+    TRACE("Enumerate container with filter: %i elems %zu bytes\n",
+          *actual, data->length);
+    return ADLB_DATA_SUCCESS;
+  }
+
+  if (cursor != NULL)
+  {
+    check_verbose(cursor->position >= 0, ADLB_DATA_ERROR_INVALID,
+        "invalid enumeration cursor for "ADLB_PRID,
+        ADLB_PRID_ARGS(id, d->symbol));
+    offset = cursor->position;
+  }
+
   if (d->type == ADLB_DATA_TYPE_CONTAINER)
   {
-    int slice_size = enumerate_slice_size(offset, count,
-                        d->data.CONTAINER.members->size);
+    adlb_container *c = &d->data.CONTAINER;
+    int size = xlb_members_size(c);
+    int slice_size = enumerate_slice_size(offset, count, size);
+
+    xlb_members_iter it;
+    int skip = offset;
+    if (cursor != NULL && offset > 0 && cursor->stamp == size &&
+        xlb_members_iter_restore(c, cursor, &it))
+    {
+      // Members are never removed, so same size means no inserts
+      skip = 0;
+    }
+    else
+    {
+      if (cursor != NULL && offset > 0)
+      {
+        DEBUG("Enumerate "ADLB_PRID": cursor invalidated, skipping %i",
+              ADLB_PRID_ARGS(id, d->symbol), offset);
+      }
+      xlb_members_iter_init(&it);
+    }
 
-    if (include_keys || include_vals)
+    if (include_keys || include_vals || cursor != NULL)
     {
-      dc = extract_members(&d->data.CONTAINER, count, offset,
-                                  include_keys, include_vals,
-                                  caller_buffer, data);
+      dc = extract_members(c, &it, slice_size, skip,
+                           include_keys, include_vals,
+                           caller_buffer, data);
       DATA_CHECK(dc);
     }
 
+    if (cursor != NULL)
+    {
+      xlb_members_iter_save(&it, cursor);
+      cursor->position = offset + slice_size;
+      cursor->stamp = size;
+    }
+
     *actual = slice_size;
     *key_type = (adlb_data_type)d->data.CONTAINER.key_type;
     *val_type = (adlb_data_type)d->data.CONTAINER.val_type;
@@ -1617,6 +2321,11 @@ xlb_data_enumerate(adlb_datum_id id, int count, int offset,
       DATA_CHECK(dc);
     }
 
+    if (cursor != NULL)
+    {
+      cursor->position = offset + slice_size;
+    }
+
     *actual = slice_size;
     *key_type = ADLB_DATA_TYPE_NULL;
     *val_type = (adlb_data_type)d->data.MULTISET->elem_type;
@@ -1644,7 +2353,7 @@ xlb_data_container_size(adlb_datum_id container_id, int* size)
   switch (d->type)
   {
     case ADLB_DATA_TYPE_CONTAINER:
-      *size = d->data.CONTAINER.members->size;
+      *size = xlb_members_size(&d->data.CONTAINER);
       return ADLB_DATA_SUCCESS;
     case ADLB_DATA_TYPE_MULTISET:
       *size = (int)xlb_multiset_size(d->data.MULTISET);
@@ -1693,7 +2402,7 @@ insert_notifications(adlb_datum *d, adlb_datum_id id,
   *garbage_collected = false;
 
   dc = insert_notifications2(d, id, subscript, false,
-      value_type, value_buffer, value_len,
+      value, value_type, value_buffer, value_len,
       ref_list, listener_list, notifs, garbage_collected);
   DATA_CHECK(dc);
 
@@ -1718,14 +2427,14 @@ check_subscript_notifications(adlb_datum_id id,
   char s[xlb_id_sub_buflen(subscript)];
   size_t s_len = xlb_write_id_sub(s, id, subscript);
   void *data;
-  bool result = table_bp_remove(&container_references, s, s_len, &data);
+  bool result = xlb_incr_bp_remove(&container_references, s, s_len, &data);
 
   if (result)
   {
     *ref_list = (struct list*) data;
   }
 
-  result = table_bp_remove(&container_ix_listeners, s, s_len, &data);
+  result = xlb_incr_bp_remove(&container_ix_listeners, s, s_len, &data);
 
   if (result)
   {
@@ -1747,7 +2456,8 @@ check_subscript_notifications(adlb_datum_id id,
 static adlb_data_code
 insert_notifications2(adlb_datum *d,
       adlb_datum_id id, adlb_subscript subscript,
-      bool copy_sub, adlb_data_type value_type,
+      bool copy_sub, const adlb_datum_storage *value,
+      adlb_data_type value_type,
       const void *value_buffer, size_t value_len,
       struct list *ref_list, struct list_b *listener_list,
       adlb_notif_t *notifs, bool *garbage_collected)
@@ -1793,8 +2503,13 @@ insert_notifications2(adlb_datum *d,
       adlb_code ac = xlb_to_free_add(notifs, subscript_ptr);
       DATA_CHECK_ADLB(ac, ADLB_DATA_ERROR_OOM);
     }
+    // Use packed value if we have it: data may have been freed
+    notif_value listener_value = {
+      .storage = value_buffer == NULL ? value : NULL,
+      .type = value_type, .packed = value_buffer,
+      .packed_len = value_len };
     dc = append_notifs(listener_list, true, id, d->symbol, subscript,
-                       &notifs->notify);
+                       &listener_value, notifs);
     DATA_CHECK(dc);
   }
   return ADLB_DATA_SUCCESS;
@@ -1827,7 +2542,8 @@ all_notifs_step(adlb_datum *d, adlb_datum_id id, adlb_subscript sub,
 
   if (ref_list != NULL || listener_list != NULL)
   {
-    adlb_binary_data val_data;
+    adlb_binary_data val_data = { .data = NULL, .caller_data = NULL,
+                                  .length = 0 };
     if (ref_list != NULL)
     {
       // Pack container value to binary value if needed
@@ -1841,7 +2557,7 @@ all_notifs_step(adlb_datum *d, adlb_datum_id id, adlb_subscript sub,
       adlb_code ac = xlb_to_free_add(notifs, val_data.caller_data);
       DATA_CHECK_ADLB(ac, ADLB_DATA_ERROR_OOM);
     }
-    dc = insert_notifications2(d, id, sub, copy_sub, val_type,
+    dc = insert_notifications2(d, id, sub, copy_sub, val, val_type,
                 val_data.data, val_data.length, ref_list, listener_list,
                 notifs, garbage_collected);
     DATA_CHECK(dc);
@@ -1953,10 +2669,12 @@ container_notifs_rec(adlb_datum *d, adlb_datum_id id,
    * we need to keep the subscript pointer pointed to it
    */
   bool subscript_uses_buf = (subscript.key == sub_buf->data);
-  TABLE_BP_FOREACH(c->members, item)
+  xlb_members_iter item;
+  xlb_members_iter_init(&item);
+  while (xlb_members_iter_next(c, &item))
   {
-    adlb_subscript component = { .key = table_bp_get_key(item),
-                                 .length = item->key_len };
+    adlb_subscript component = { .key = item.key,
+                                 .length = item.key_len };
 
     // Ensure subscript valid in event of reallocation
     if (subscript_uses_buf)
@@ -1976,7 +2694,7 @@ container_notifs_rec(adlb_datum *d, adlb_datum_id id,
     DATA_CHECK(dc);
 
     // Check for subscriptions on this subscript
-    dc = all_notifs_step(d, id, child_sub, true, item->data,
+    dc = all_notifs_step(d, id, child_sub, true, item.val,
             (adlb_data_type)c->val_type, notifs, garbage_collected);
     DATA_CHECK(dc);
 
@@ -1987,7 +2705,7 @@ container_notifs_rec(adlb_datum *d, adlb_datum_id id,
       return ADLB_DATA_SUCCESS;
     }
 
-    dc = subscript_notifs_rec(d, id, item->data,
+    dc = subscript_notifs_rec(d, id, item.val,
         (adlb_data_type)c->val_type, sub_buf, sub_caller_buf, child_sub,
         notifs, garbage_collected);
     DATA_CHECK(dc);
@@ -2140,15 +2858,66 @@ adlb_data_code process_ref_list(struct list *subscribers,
   return ADLB_DATA_SUCCESS;
 }
 
+/*
+  Pack value for notifications and copy it into memory owned by
+  notifications.
+  value_len: set to -1 if value is missing, too large or a
+             container or multiset
+ */
+static adlb_data_code
+pack_notif_value(const notif_value *value, adlb_notif_t *notifs,
+                 const void **result, int *value_len)
+{
+  *result = NULL;
+  *value_len = -1;
+
+  if (value->type == ADLB_DATA_TYPE_CONTAINER ||
+      value->type == ADLB_DATA_TYPE_MULTISET)
+  {
+    return ADLB_DATA_SUCCESS;
+  }
+
+  adlb_binary_data packed = { .data = value->packed,
+        .caller_data = NULL, .length = value->packed_len };
+  if (value->packed == NULL)
+  {
+    if (value->storage == NULL)
+      return ADLB_DATA_SUCCESS;
+
+    adlb_data_code dc = ADLB_Pack(value->storage, value->type, NULL,
+                                  &packed);
+    DATA_CHECK(dc);
+  }
+
+  if (packed.length <= (size_t)notif_value_max)
+  {
+    void *copy = malloc(packed.length > 0 ? packed.length : 1);
+    DATA_CHECK_MALLOC(copy);
+    memcpy(copy, packed.data, packed.length);
+
+    adlb_code ac = xlb_to_free_add(notifs, copy);
+    DATA_CHECK_ADLB(ac, ADLB_DATA_ERROR_OOM);
+
+    *result = copy;
+    *value_len = (int)packed.length;
+  }
+
+  ADLB_Free_binary_data(&packed);
+  return ADLB_DATA_SUCCESS;
+}
+
 /*
  * listeners: list items are freed, list root is freed
               if free_list_root is true
+ * value: value of closed data, sent to listeners that asked for it.
+          May be NULL
  */
 static
 adlb_data_code append_notifs(struct list_b *listeners,
   bool free_list_root, adlb_datum_id id, adlb_dsym dsym,
-  adlb_subscript sub, adlb_notif_ranks *notify)
+  adlb_subscript sub, const notif_value *value, adlb_notif_t *notifs)
 {
+  adlb_notif_ranks *notify = &notifs->notify;
   assert(listeners != NULL);
   assert(notify->count >= 0);
   int nlisteners = listeners->size;
@@ -2159,6 +2928,11 @@ adlb_data_code append_notifs(struct list_b *listeners,
   adlb_code ac = xlb_notifs_expand(notify, nlisteners);
   DATA_CHECK_ADLB(ac, ADLB_DATA_ERROR_OOM);
 
+  // Packed value, filled in when first listener asks for it
+  bool value_packed = false;
+  const void *packed = NULL;
+  int packed_len = -1;
+
   struct list_b_item *node = listeners->head;
   for (int i = 0; i < nlisteners; i++)
   {
@@ -2170,6 +2944,19 @@ adlb_data_code append_notifs(struct list_b *listeners,
     adlb_notif_rank *nrank = &notify->notifs[i + notify->count];
     xlb_notif_init(nrank, listener->rank, id, sub, listener->work_type);
 
+    if (listener->with_value && value != NULL)
+    {
+      if (!value_packed)
+      {
+        adlb_data_code dc = pack_notif_value(value, notifs, &packed,
+                                             &packed_len);
+        DATA_CHECK(dc);
+        value_packed = true;
+      }
+      nrank->value = packed;
+      nrank->value_len = packed_len;
+    }
+
     // #define ADLB_PRIDSUB "<%"PRId64">:%s[%.*s] (%s)"
     TRACE("Add notif "ADLB_PRIDSUB" to rank %i",
           ADLB_PRIDSUB_ARGS(id, dsym, sub), nrank->rank);
@@ -2229,6 +3016,131 @@ xlb_data_insert_atomic(adlb_datum_id id, adlb_subscript subscript,
   return ADLB_DATA_SUCCESS;
 }
 
+/**
+   Apply atomic operation to set value
+   return: true if value was changed
+ */
+#define ATOMIC_APPLY_FN(name, T)                                  \
+static inline bool                                                \
+name(adlb_atomic_op op, T *val, T operand, T compare)             \
+{                                                                 \
+  switch (op)                                                     \
+  {                                                               \
+    case ADLB_ATOMIC_ADD:                                         \
+      *val += operand;                                            \
+      return true;                                                \
+    case ADLB_ATOMIC_CAS:                                         \
+      if (*val != compare)                                        \
+        return false;                                             \
+      break;                                                      \
+    case ADLB_ATOMIC_MIN:                                         \
+      if (!(operand < *val))                                      \
+        return false;                                             \
+      break;                                                      \
+    case ADLB_ATOMIC_MAX:                                         \
+      if (!(operand > *val))                                      \
+        return false;                                             \
+      break;                                                      \
+  }                                                               \
+  *val = operand;                                                 \
+  return true;                                                    \
+}
+
+ATOMIC_APPLY_FN(atomic_apply_int, adlb_int_t)
+ATOMIC_APPLY_FN(atomic_apply_float, adlb_float_t)
+
+adlb_data_code
+xlb_data_atomic(adlb_datum_id id, adlb_atomic_op op,
+        adlb_data_type type, const adlb_atomic_value *operand,
+        const adlb_atomic_value *compare, adlb_refc refcount_decr,
+        adlb_atomic_value *old_value, bool *old_set, bool *updated,
+        adlb_notif_t *notifs)
+{
+  adlb_datum *d;
+  adlb_data_code dc = xlb_datum_lookup(id, &d);
+  DATA_CHECK(dc);
+
+  check_verbose(type == ADLB_DATA_TYPE_INTEGER ||
+                type == ADLB_DATA_TYPE_FLOAT, ADLB_DATA_ERROR_TYPE,
+                "Atomic operations not supported for type %s",
+                ADLB_Data_type_tostring(type));
+  check_verbose(type == d->type, ADLB_DATA_ERROR_TYPE,
+          "Type mismatch: expected %s actual %s\n",
+          ADLB_Data_type_tostring(type), ADLB_Data_type_tostring(d->type));
+  check_verbose(op >= ADLB_ATOMIC_ADD && op <= ADLB_ATOMIC_MAX,
+                ADLB_DATA_ERROR_INVALID, "Invalid atomic op: %i", op);
+
+  if (d->write_refcount <= 0)
+  {
+    DEBUG("attempt to update closed var: "ADLB_PRID,
+          ADLB_PRID_ARGS(id, d->symbol));
+    return ADLB_DATA_ERROR_DOUBLE_WRITE;
+  }
+
+  *old_set = d->status.set;
+  memset(old_value, 0, sizeof(*old_value));
+  if (!d->status.set)
+  {
+    // Unset value acts as identity for ADD, MIN and MAX
+    *updated = (op != ADLB_ATOMIC_CAS);
+    if (*updated)
+    {
+      if (type == ADLB_DATA_TYPE_INTEGER)
+        d->data.INTEGER = operand->INTEGER;
+      else
+        d->data.FLOAT = operand->FLOAT;
+      d->status.set = true;
+    }
+  }
+  else if (type == ADLB_DATA_TYPE_INTEGER)
+  {
+    if (op == ADLB_ATOMIC_ADD)
+    {
+      // Signed overflow is undefined: reject it and leave value as is
+      adlb_int_t sum;
+      check_verbose(!__builtin_add_overflow(d->data.INTEGER,
+                                  operand->INTEGER, &sum),
+                    ADLB_DATA_ERROR_INVALID,
+                    "Integer overflow in atomic add to "ADLB_PRID,
+                    ADLB_PRID_ARGS(id, d->symbol));
+    }
+    old_value->INTEGER = d->data.INTEGER;
+    *updated = atomic_apply_int(op, &d->data.INTEGER, operand->INTEGER,
+                                compare->INTEGER);
+  }
+  else
+  {
+    old_value->FLOAT = d->data.FLOAT;
+    *updated = atomic_apply_float(op, &d->data.FLOAT, operand->FLOAT,
+                                  compare->FLOAT);
+  }
+
+  if (ENABLE_LOG_DEBUG && xlb_debug_enabled && d->status.set)
+  {
+    char *val_s = ADLB_Data_repr(&d->data, d->type);
+    DEBUG("data_atomic "ADLB_PRID" op %i => %s",
+          ADLB_PRID_ARGS(id, d->symbol), op, val_s);
+    free(val_s);
+  }
+
+  // Handle reference count decrease as for store
+  check_verbose(refcount_decr.write_refcount >= 0 &&
+                refcount_decr.read_refcount >= 0,
+                ADLB_DATA_ERROR_REFCOUNT_NEGATIVE,
+                "Negative refcount decrement for atomic op on "ADLB_PRID,
+                ADLB_PRID_ARGS(id, d->symbol));
+  if (refcount_decr.write_refcount > 0 || refcount_decr.read_refcount > 0)
+  {
+    adlb_refc incr = { .read_refcount = xlb_s.read_refc_enabled ?
+                                            -refcount_decr.read_refcount : 0,
+                            .write_refcount = -refcount_decr.write_refcount };
+    dc = xlb_refc_incr(d, id, incr, XLB_NO_ACQUIRE, NULL, notifs);
+    DATA_CHECK(dc);
+  }
+
+  return ADLB_DATA_SUCCESS;
+}
+
 adlb_data_code
 xlb_data_system_reserve(int count, adlb_datum_id *start)
 {
@@ -2281,7 +3193,7 @@ xlb_data_refc_type_tostring(adlb_refcount_type refc_type)
 adlb_dsym xlb_get_dsym(adlb_datum_id id)
 {
   adlb_datum* d;
-  bool found = table_lp_search(&tds, id, (void**)&d);
+  bool found = xlb_datum_table_search(&tds, id, (void**)&d);
   if (found)
   {
     assert(d != NULL);
@@ -2306,7 +3218,7 @@ static void free_td_entry(adlb_datum_id id, void *val)
 
     list_b_clear(&d->listeners);
 
-    free(d);
+    xlb_pool_free(d);
   }
 }
 
@@ -2372,58 +3284,116 @@ static void free_ix_l_entry(const void *key, size_t key_len, void *val)
   list_b_free(listeners);
 }
 
+static void free_container_index(int64_t key, void *val)
+{
+  xlb_cindex_free(val);
+}
+
+static void free_close_reductions(int64_t key, void *val)
+{
+  close_reduction *red = val;
+  while (red != NULL)
+  {
+    close_reduction *next = red->next;
+    free(red);
+    red = next;
+  }
+}
+
 static void free_locked_entry(int64_t key, void *val)
 {
   assert(val != NULL);
-  free(val);
+  lock_lock *lock = val;
+  while (lock->head != NULL)
+  {
+    lock_waiter_remove(lock->head);
+  }
+  free(lock);
 }
 
 adlb_data_code
 xlb_data_finalize()
 {
+  // Reclaim members of any containers not yet cleaned up
+  adlb_data_code cleanup_dc = xlb_deferred_cleanup_finalize();
+
   // First report any leaks or other problems
   report_leaks();
 
   // Second free and report problems with subscriptions.
   // This step may lookup tds table, so free that later.
-  table_bp_free_callback(&container_references, false, free_cref_entry);
-  table_bp_free_callback(&container_ix_listeners, false, free_ix_l_entry);
+  xlb_incr_bp_free_callback(&container_references, free_cref_entry);
+  xlb_incr_bp_free_callback(&container_ix_listeners, free_ix_l_entry);
 
   table_lp_free_callback(&locked, false, free_locked_entry);
+  table_lp_free_callback(&close_reductions, false, free_close_reductions);
+  table_lp_free_callback(&container_indexes, false, free_container_index);
 
   // Finally free up memory allocated in this module
-  table_lp_free_callback(&tds, false, free_td_entry);
+  xlb_datum_table_free_callback(&tds, free_td_entry);
+
+  xlb_print_pool_stats();
+  xlb_pool_finalize();
 
   adlb_data_code dc = xlb_struct_finalize();
   DATA_CHECK(dc);
 
   xlb_data_types_finalize();
+  DATA_CHECK(cleanup_dc);
   if (failed_during_finalize)
     return ADLB_DATA_ERROR_UNRESOLVED;
   return ADLB_DATA_SUCCESS;
 }
 
+void
+xlb_print_data_counters(void)
+{
+  if (!xlb_s.perfc_enabled)
+  {
+    return;
+  }
+
+  PRINT_COUNTER("DATA_PAGED_CREATES=%"PRId64, tds.paged_adds);
+  PRINT_COUNTER("DATA_HASHED_CREATES=%"PRId64, tds.sparse_adds);
+  PRINT_COUNTER("DATA_TABLE_RESIZES=%"PRId64, tds.sparse.resizes);
+  PRINT_COUNTER("DATA_TABLE_MIGRATED=%"PRId64, tds.sparse.migrated);
+  PRINT_COUNTER("DATA_REFERENCES_TABLE_RESIZES=%"PRId64,
+                container_references.resizes);
+  PRINT_COUNTER("DATA_REFERENCES_TABLE_MIGRATED=%"PRId64,
+                container_references.migrated);
+  PRINT_COUNTER("DATA_LISTENERS_TABLE_RESIZES=%"PRId64,
+                container_ix_listeners.resizes);
+  PRINT_COUNTER("DATA_LISTENERS_TABLE_MIGRATED=%"PRId64,
+                container_ix_listeners.migrated);
+  PRINT_COUNTER("DATA_LOCK_WAITS=%"PRId64, lock_waits);
+  PRINT_COUNTER("DATA_LOCK_TIMEOUTS=%"PRId64, lock_timeouts);
+
+  xlb_print_cleanup_counters();
+}
+
 static void
 report_leaks()
 {
   bool report_leaks_setting;
   getenv_boolean("ADLB_REPORT_LEAKS", false, &report_leaks_setting);
 
-  TABLE_LP_FOREACH(&tds, item)
+  xlb_datum_iter item;
+  xlb_datum_iter_init(&tds, &item);
+  while (xlb_datum_iter_next(&tds, &item))
   {
-    adlb_datum *d = item->data;
+    adlb_datum *d = item.datum;
     if (d == NULL || !d->status.permanent)
     {
       // Distinguish between leaked data, and unassigned data
       if (d->write_refcount == 0)
       {
-        DEBUG("LEAK: "ADLB_PRID, ADLB_PRID_ARGS(item->key,
+        DEBUG("LEAK: "ADLB_PRID, ADLB_PRID_ARGS(item.id,
                                                         d->symbol));
         if (report_leaks_setting)
         {
           char *repr = ADLB_Data_repr(&d->data, d->type);
           printf("LEAK DETECTED: "ADLB_PRID" t:%s r:%i w:%i v:%s\n",
-                ADLB_PRID_ARGS(item->key, d->symbol),
+                ADLB_PRID_ARGS(item.id, d->symbol),
                 ADLB_Data_type_tostring(d->type),
                 d->read_refcount, d->write_refcount,
                 repr);
@@ -2433,11 +3403,11 @@ report_leaks()
       else
       {
         DEBUG("UNSET VARIABLE: "ADLB_PRID, ADLB_PRID_ARGS(
-                                              item->key, d->symbol));
+                                              item.id, d->symbol));
         if (report_leaks_setting)
         {
           printf("UNSET VARIABLE DETECTED: "ADLB_PRID"\n",
-              ADLB_PRID_ARGS(item->key, d->symbol));
+              ADLB_PRID_ARGS(item.id, d->symbol));
         }
       }
     }
@@ -57,12 +57,37 @@ adlb_data_code xlb_data_multicreate(const ADLB_create_spec *specs,
 adlb_data_code xlb_data_exists(adlb_datum_id id, adlb_subscript subscript,
                            bool* result);
 
-adlb_data_code xlb_data_lock(adlb_datum_id id, int rank, bool* result);
+/*
+  Lock datum for rank.
+  wait: if locked by another rank, queue rank to be granted the lock
+        when it is unlocked.  Waiters are granted the lock in FIFO
+        order.  It is an error for the owner to wait.
+  deadline: if >= 0, time at which a queued rank stops waiting,
+        cf. xlb_data_lock_expire()
+  result: true if locked now, false if queued or not waiting
+ */
+adlb_data_code xlb_data_lock(adlb_datum_id id, int rank, bool wait,
+                             double deadline, bool* result);
+
+/*
+  Unlock datum.
+  granted: set to the waiting rank that now holds the lock, or -1
+ */
+adlb_data_code xlb_data_unlock(adlb_datum_id id, int *granted);
 
-adlb_data_code xlb_data_unlock(adlb_datum_id id);
+/*
+  Remove a waiter whose deadline has passed.  Call repeatedly until
+  false is returned.  Cheap if no deadline has passed.
+  id, rank: set to the datum and rank that gave up waiting
+ */
+bool xlb_data_lock_expire(double now, adlb_datum_id *id, int *rank);
 
+/*
+  with_value: send value with notification if small enough
+ */
 adlb_data_code xlb_data_subscribe(adlb_datum_id id, adlb_subscript subscript,
-                              int rank, int work_type, bool* subscribed);
+                              int rank, int work_type, bool with_value,
+                              bool* subscribed);
 
 /**
  * If data at id[subscript] is already set:
@@ -120,6 +145,8 @@ xlb_data_retrieve(adlb_datum_id id, adlb_subscript subscript,
 adlb_data_code
 xlb_data_enumerate(adlb_datum_id id, int count, int offset,
                bool include_keys, bool include_vals,
+               adlb_enum_cursor *cursor,
+               const adlb_enum_filter *filter,
                const adlb_buffer *caller_buffer,
                adlb_buffer *data, int* actual,
                adlb_data_type *key_type, adlb_data_type *val_type);
@@ -173,6 +200,31 @@ adlb_data_code xlb_data_insert_atomic(adlb_datum_id id,
                                   adlb_subscript subscript,
                                   bool *created, bool *value_present);
 
+/*
+  Apply atomic operation to integer or float datum.  See ADLB_Atomic.
+  notifs: notifications from decrementing refcounts, must be initialized
+ */
+adlb_data_code xlb_data_atomic(adlb_datum_id id, adlb_atomic_op op,
+        adlb_data_type type, const adlb_atomic_value *operand,
+        const adlb_atomic_value *compare, adlb_refc refcount_decr,
+        adlb_atomic_value *old_value, bool *old_set, bool *updated,
+        adlb_notif_t *notifs);
+
+/*
+  Reduce values of container or multiset, cf. ADLB_Reduce
+ */
+adlb_data_code xlb_data_reduce(adlb_datum_id id,
+        const adlb_reduce_spec *spec, adlb_reduce_result *result);
+
+/*
+  Store result of reduction to result_id when container or multiset
+  closes, or now if already closed.  Cf. ADLB_Reduce_on_close.
+  notifs: receives notification to store result if already closed
+ */
+adlb_data_code xlb_data_reduce_on_close(adlb_datum_id id,
+        const adlb_reduce_spec *spec, adlb_datum_id result_id,
+        int write_decr, adlb_notif_t *notifs);
+
 adlb_data_code xlb_data_unique(adlb_datum_id* result);
 
 /*
@@ -189,4 +241,6 @@ adlb_dsym xlb_get_dsym(adlb_datum_id id);
 
 adlb_data_code xlb_data_finalize(void);
 
+void xlb_print_data_counters(void);
+
 #endif
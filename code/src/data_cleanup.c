@@ -1,13 +1,19 @@
 #include "data_cleanup.h"
 
+#include "checks.h"
+#include "common.h"
+#include "container.h"
 #include "data_structs.h"
 #include "debug.h"
 #include "multiset.h"
+#include "pool.h"
 #include "refcount.h"
 #include "table_bp.h"
 
 #include <assert.h>
+#include <inttypes.h>
 #include <stdio.h>
+#include <stdlib.h>
 #include <string.h>
 
 adlb_data_code
@@ -74,84 +80,251 @@ xlb_members_cleanup(adlb_container *container, bool free_mem,
   xlb_refc_changes *refcs)
 {
   adlb_data_code dc;
-  struct table_bp* members = container->members;
 
   // Whether we are making any refcount changes
   bool refcount_change = release_read || release_write ||
                           !ADLB_REFC_IS_NULL(to_acquire.refcounts);
 
   TRACE("Freeing container %p", container);
-  for (int i = 0; i < members->capacity; i++)
+  xlb_members_iter it;
+  xlb_members_iter_init(&it);
+  while (xlb_members_iter_next(container, &it))
   {
-    table_bp_entry* head = &members->array[i];
-    if (!table_bp_entry_valid(head))
-    {
-      // Empty bucket
-      continue;
-    }
+    adlb_datum_storage *d = it.val;
 
-    // Keep next pointer to allow freeing of item
-    table_bp_entry* item, *next;
-    for (item = head, next = head->next; item != NULL;
-         item = next)
+    TRACE("Freeing %p in %p", d, container);
+    // Value may be null when insert_atomic occurred, but nothing inserted
+    if (refcount_change && d != NULL)
     {
-      next = item->next; // Store next pointer immediately
+      adlb_subscript *sub = &to_acquire.subscript;
+      bool acquire_field = (!adlb_has_sub(*sub) ||
+           (sub->length == it.key_len &&
+            memcmp(sub->key, it.key, it.key_len) == 0));
 
-      adlb_datum_storage *d = (adlb_datum_storage*)item->data;
-      
-      TRACE("Freeing %p in %p", d, container);
-      // Value may be null when insert_atomic occurred, but nothing inserted
-      if (refcount_change && d != NULL)
+      // create new acquire to remove subscript
+      xlb_refc_acquire field_acquire;
+      field_acquire.subscript = ADLB_NO_SUB;
+      if (acquire_field)
       {
-        adlb_subscript *sub = &to_acquire.subscript;
-        bool acquire_field = (!adlb_has_sub(*sub) ||
-             table_bp_key_match(sub->key, sub->length, item));
-
-        // create new acquire to remove subscript
-        xlb_refc_acquire field_acquire;
-        field_acquire.subscript = ADLB_NO_SUB;
-        if (acquire_field)
-        {
-          field_acquire.refcounts = to_acquire.refcounts;
-        }
-        else
-        {
-          field_acquire.refcounts = ADLB_NO_REFC;
-        }
-
-        dc = xlb_incr_referand(d, (adlb_data_type)container->val_type,
-                release_read, release_write, field_acquire, refcs);
-        DATA_CHECK(dc);
+        field_acquire.refcounts = to_acquire.refcounts;
       }
-      // Free the memory for value and key
-      if (free_mem)
+      else
       {
-        if (d != NULL)
-        {
-          dc = ADLB_Free_storage(d, (adlb_data_type)container->val_type);
-          DATA_CHECK(dc);
-          free(d);
-        }
-        if (!table_bp_inline_key(item->key_len))
-        {
-          assert(item->__key != NULL);
-          free(item->__key);
-        }
+        field_acquire.refcounts = ADLB_NO_REFC;
       }
-     
-      // Free list node and move to next
-      if (free_mem && item != head) // Head is part of array
-        free(item);
+
+      dc = xlb_incr_referand(d, (adlb_data_type)container->val_type,
+              release_read, release_write, field_acquire, refcs);
+      DATA_CHECK(dc);
+    }
+    // Free the memory for value
+    if (free_mem && d != NULL)
+    {
+      dc = ADLB_Free_storage(d, (adlb_data_type)container->val_type);
+      DATA_CHECK(dc);
+      if (!it.inline_val)
+        xlb_pool_free(d);
     }
+  }
 
+  // Free keys and member storage
+  if (free_mem)
+    xlb_members_free(container);
+  return ADLB_DATA_SUCCESS;
+}
 
-    // Mark bucket empty
-    if (free_mem)
-      table_bp_clear_entry(head);
+/*
+  Container awaiting deferred cleanup.  Members are cleaned up in
+  iteration order, so we can resume where the last step finished.
+ */
+typedef struct deferred_cleanup
+{
+  adlb_container container;
+  xlb_members_iter it;
+  int remaining;
+  struct deferred_cleanup *next;
+} deferred_cleanup;
+
+// FIFO queue of containers awaiting cleanup
+static deferred_cleanup *deferred_head = NULL;
+static deferred_cleanup *deferred_tail = NULL;
+
+// Total members in queue
+static int64_t deferred_backlog = 0;
+
+// Perf counters
+static int64_t deferred_containers = 0;
+static int64_t deferred_members = 0;
+static int64_t deferred_backlog_max = 0;
+
+adlb_data_code
+xlb_members_cleanup_defer(adlb_container *container)
+{
+  deferred_cleanup *entry = malloc(sizeof(*entry));
+  DATA_CHECK_MALLOC(entry);
+
+  entry->container = *container;
+  xlb_members_iter_init(&entry->it);
+  entry->remaining = xlb_members_size(container);
+  entry->next = NULL;
+
+  // Caller no longer owns members
+  container->members = NULL;
+  container->dense = false;
+
+  if (deferred_tail == NULL)
+  {
+    deferred_head = entry;
   }
-  if (free_mem)
-    table_bp_free(members);
+  else
+  {
+    deferred_tail->next = entry;
+  }
+  deferred_tail = entry;
+
+  deferred_backlog += entry->remaining;
+  deferred_containers++;
+  deferred_members += entry->remaining;
+  if (deferred_backlog > deferred_backlog_max)
+  {
+    deferred_backlog_max = deferred_backlog;
+  }
+
+  DEBUG("Deferred cleanup of container with %i members, backlog %"PRId64,
+        entry->remaining, deferred_backlog);
   return ADLB_DATA_SUCCESS;
 }
 
+/*
+  Clean up next member of container.
+  release: if true, release referand reference counts
+  more: set to false if no members were left
+ */
+static adlb_data_code
+deferred_cleanup_member(deferred_cleanup *entry, xlb_refc_changes *refcs,
+                        bool release, bool *more)
+{
+  adlb_container *c = &entry->container;
+  *more = xlb_members_iter_next(c, &entry->it);
+  if (!*more)
+  {
+    return ADLB_DATA_SUCCESS;
+  }
 
+  adlb_datum_storage *d = entry->it.val;
+  adlb_data_type val_type = (adlb_data_type)c->val_type;
+  entry->remaining--;
+  deferred_backlog--;
+
+  // Value may be null when insert_atomic occurred, but nothing inserted
+  if (d == NULL)
+  {
+    return ADLB_DATA_SUCCESS;
+  }
+
+  adlb_data_code dc;
+  if (release)
+  {
+    dc = xlb_incr_referand(d, val_type, true, true, XLB_NO_ACQUIRE, refcs);
+    DATA_CHECK(dc);
+  }
+
+  dc = ADLB_Free_storage(d, val_type);
+  DATA_CHECK(dc);
+  if (!entry->it.inline_val)
+    xlb_pool_free(d);
+
+  return ADLB_DATA_SUCCESS;
+}
+
+static void
+deferred_cleanup_pop(void)
+{
+  deferred_cleanup *entry = deferred_head;
+  deferred_head = entry->next;
+  if (deferred_head == NULL)
+  {
+    deferred_tail = NULL;
+  }
+
+  // Size may include reserved members that the iterator skipped
+  deferred_backlog -= entry->remaining;
+
+  xlb_members_free(&entry->container);
+  free(entry);
+}
+
+adlb_data_code
+xlb_deferred_cleanup_step(int budget, xlb_refc_changes *refcs)
+{
+  int done = 0;
+  while (deferred_head != NULL && done < budget)
+  {
+    bool more;
+    adlb_data_code dc = deferred_cleanup_member(deferred_head, refcs,
+                                                true, &more);
+    DATA_CHECK(dc);
+
+    if (more)
+    {
+      done++;
+    }
+    else
+    {
+      deferred_cleanup_pop();
+    }
+  }
+
+  TRACE("Deferred cleanup step: %i members, backlog %"PRId64,
+        done, deferred_backlog);
+  return ADLB_DATA_SUCCESS;
+}
+
+int64_t
+xlb_deferred_cleanup_backlog(void)
+{
+  return deferred_backlog;
+}
+
+adlb_data_code
+xlb_deferred_cleanup_finalize(void)
+{
+  adlb_data_code result = ADLB_DATA_SUCCESS;
+  while (deferred_head != NULL)
+  {
+    bool more;
+    adlb_data_code dc = deferred_cleanup_member(deferred_head, NULL,
+                                                false, &more);
+    if (dc != ADLB_DATA_SUCCESS)
+    {
+      // Free the rest anyway, and report first error
+      ERR_PRINTF("Error freeing deferred container members: %i\n",
+                 (int)dc);
+      if (result == ADLB_DATA_SUCCESS)
+      {
+        result = dc;
+      }
+      more = false;
+    }
+
+    if (!more)
+    {
+      deferred_cleanup_pop();
+    }
+  }
+  return result;
+}
+
+void
+xlb_print_cleanup_counters(void)
+{
+  if (!xlb_s.perfc_enabled)
+  {
+    return;
+  }
+
+  PRINT_COUNTER("DATA_GC_DEFERRED_CONTAINERS=%"PRId64, deferred_containers);
+  PRINT_COUNTER("DATA_GC_DEFERRED_MEMBERS=%"PRId64, deferred_members);
+  PRINT_COUNTER("DATA_GC_BACKLOG_MAX=%"PRId64, deferred_backlog_max);
+  PRINT_COUNTER("DATA_GC_BACKLOG=%"PRId64, deferred_backlog);
+}
@@ -23,5 +23,40 @@ adlb_data_code xlb_members_cleanup(adlb_container *container, bool free_mem,
   bool release_read, bool release_write, xlb_refc_acquire to_acquire,
   xlb_refc_changes *refcs);
 
+/*
+  Deferred cleanup of large containers.  Members are freed and
+  referand reference counts released a few at a time by
+  xlb_deferred_cleanup_step(), so that garbage collecting a large
+  container does not stall the server.
+ */
+
+/*
+  Take over members of a garbage collected container.  The read and
+  write reference counts held by members are released later.
+  container: left without members
+ */
+adlb_data_code xlb_members_cleanup_defer(adlb_container *container);
+
+/*
+  Clean up at most budget members from the deferred queue.
+  refcs: changes resulting from released references
+ */
+adlb_data_code xlb_deferred_cleanup_step(int budget,
+                                         xlb_refc_changes *refcs);
+
+/*
+  Number of members awaiting deferred cleanup
+ */
+int64_t xlb_deferred_cleanup_backlog(void);
+
+/*
+  Free memory for remaining deferred containers without releasing
+  reference counts.  Only for use at shutdown.
+  return: first error, after freeing all containers
+ */
+adlb_data_code xlb_deferred_cleanup_finalize(void);
+
+void xlb_print_cleanup_counters(void);
+
 #endif // __XLB_DATA_CLEANUP_H
 
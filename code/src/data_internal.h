@@ -24,6 +24,7 @@
 #include "adlb-defs.h"
 #include "adlb_types.h"
 #include "data.h"
+#include "pool.h"
 #include <list_b.h>
 
 /**
@@ -32,6 +33,12 @@
  */
 #define CONTAINER_INIT_CAPACITY 32
 
+/**
+ * Initial capacity of the server's data tables, which grow
+ * incrementally.  Override with ADLB_DATA_TABLE_SIZE.
+ */
+#define XLB_DATA_TABLE_INIT_SIZE 1024
+
 /**
  * Size for temporary stack buffers.  Assume no recursive calls.
  * Should be small enough to avoid stack overflows
@@ -52,6 +59,9 @@ typedef struct {
   /** SUBSCRIPT_NOTIFS: If true, at least one subscript subscription or
       reference for this datum. */
   bool subscript_notifs : 1;
+  /** SORTED_INDEX: If true, container has an ordered index of keys,
+      cf. container_index.h */
+  bool sorted_index : 1;
 } adlb_data_status;
 
 
@@ -68,6 +78,7 @@ static inline void xlb_data_init_status(adlb_data_status *s)
 typedef struct {
   int rank;
   int work_type;
+  bool with_value; // Attach closed value to notification if small
 } xlb_listener;
 
 typedef struct
@@ -147,6 +158,160 @@ typedef struct
   DATA_CHECK_MALLOC(array);                                            \
 }
 
+/*
+  Short string and blob values may be stored inline in the server's
+  data store: the bytes go in place of the value pointer and length,
+  and the last byte holds the length with XLB_INLINE_FLAG set.  Since
+  real lengths are far below 2^56, that byte is otherwise zero on
+  little-endian systems.  Inline values are only created by unpacking
+  with copy by xlb_unpack_string() or xlb_unpack_blob() while
+  xlb_inline_values is set, which is only on servers, so values
+  unpacked by clients always use value and length.  Use the accessors
+  below for values in the server's data store.
+ */
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+#define XLB_INLINE_VALUE_MAX (sizeof(adlb_string_t) - 1)
+#else
+#define XLB_INLINE_VALUE_MAX 0
+#endif
+
+#define XLB_INLINE_FLAG 0x80
+
+extern bool xlb_inline_values;
+
+/* v: adlb_string_t or adlb_blob_t, which have the same layout */
+static inline bool xlb_value_is_inline(const void *v)
+{
+  return XLB_INLINE_VALUE_MAX > 0 &&
+    (((const unsigned char*)v)[sizeof(adlb_string_t) - 1] &
+      XLB_INLINE_FLAG) != 0;
+}
+
+static inline const void *xlb_value_data(const void *v)
+{
+  if (xlb_value_is_inline(v))
+    return v;
+  return ((const adlb_blob_t*)v)->value;
+}
+
+static inline size_t xlb_value_length(const void *v)
+{
+  if (xlb_value_is_inline(v))
+    return ((const unsigned char*)v)[sizeof(adlb_string_t) - 1] &
+           (unsigned char)~XLB_INLINE_FLAG;
+  return ((const adlb_blob_t*)v)->length;
+}
+
+/*
+  Store copy of data inline if enabled and short enough.
+  return: true if stored
+ */
+static inline bool xlb_value_set_inline(void *v, const void *data,
+                                        size_t length)
+{
+  if (!xlb_inline_values || length > XLB_INLINE_VALUE_MAX)
+    return false;
+
+  unsigned char *bytes = (unsigned char*)v;
+  memset(bytes, 0, sizeof(adlb_string_t));
+  memcpy(bytes, data, length);
+  bytes[sizeof(adlb_string_t) - 1] =
+        (unsigned char)(XLB_INLINE_FLAG | length);
+  return true;
+}
+
+static inline const char *xlb_string_value(const adlb_string_t *s)
+{
+  return (const char*)xlb_value_data(s);
+}
+
+static inline adlb_data_code
+xlb_pack_string(const adlb_string_t *s, adlb_binary_data *result)
+{
+  const char *value = xlb_string_value(s);
+  size_t length = xlb_value_length(s);
+
+  // Check for malformed string
+  assert(length >= 1);
+  assert(value != NULL);
+  assert(value[length-1] == '\0');
+
+  result->caller_data = NULL;
+  result->data = value;
+  result->length = length;
+
+  return ADLB_DATA_SUCCESS;
+}
+
+/*
+  Unpack a packed string, as ADLB_Unpack_string(), but storing copies
+  inline or in the pools where possible.
+  copy: if true, allocate new memory and copy, otherwise s takes ownership
+        of data pointer.
+ */
+static inline adlb_data_code
+xlb_unpack_string(adlb_string_t *s, void *data, size_t length, bool copy)
+{
+  // Must be null-terminated
+  if (length < 1 || ((char*)data)[length-1] != '\0')
+    return ADLB_DATA_ERROR_INVALID;
+
+  if (copy)
+  {
+    if (xlb_value_set_inline(s, data, length))
+      return ADLB_DATA_SUCCESS;
+
+    s->value = xlb_pool_alloc(length);
+    memcpy(s->value, data, length);
+  }
+  else
+  {
+    s->value = data;
+  }
+  s->length = length;
+  return ADLB_DATA_SUCCESS;
+}
+
+static inline adlb_data_code
+xlb_pack_blob(const adlb_blob_t *b, adlb_binary_data *result)
+{
+  const void *value = xlb_value_data(b);
+
+  // Check for malformed blob
+  assert(value != NULL);
+
+  result->caller_data = NULL;
+  result->data = value;
+  result->length = xlb_value_length(b);
+
+  return ADLB_DATA_SUCCESS;
+}
+
+/*
+  Unpack a packed blob, as ADLB_Unpack_blob(), but storing copies
+  inline or in the pools where possible.
+  copy: if true, allocate new memory and copy, otherwise s takes ownership
+        of data pointer.
+ */
+static inline adlb_data_code
+xlb_unpack_blob(adlb_blob_t *b, void *data, size_t length, bool copy)
+{
+  if (copy)
+  {
+    if (xlb_value_set_inline(b, data, length))
+      return ADLB_DATA_SUCCESS;
+
+    b->value = xlb_pool_alloc(length);
+    memcpy(b->value, data, length);
+  }
+  else
+  {
+    b->value = data;
+  }
+  b->length = length;
+  return ADLB_DATA_SUCCESS;
+}
+
 adlb_data_code
 xlb_datum_lookup(adlb_datum_id id, adlb_datum **d);
 
@@ -0,0 +1,316 @@
+/*
+ * Copyright 2014 University of Chicago and Argonne National Laboratory
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License
+ */
+
+/*
+ * datum_table.c
+ *
+ * Implementation notes:
+ * An id may be in the hash table even though its page exists now,
+ * e.g. if it was added before ids caught up with it, so a miss in the
+ * pages falls back to the hash table.  Misses are rare in practice.
+ */
+
+#include <assert.h>
+#include <limits.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "datum_table.h"
+
+#define DIR_POS 0
+#define DIR_NEG 1
+#define DIRS 2
+
+#define XLB_DATUM_PAGE_MASK (XLB_DATUM_PAGE_SIZE - 1)
+
+struct xlb_datum_page
+{
+  int count; // Non-NULL slots
+  void *slots[XLB_DATUM_PAGE_SIZE];
+};
+
+/**
+   Find position for id in pages.
+   return: false if id cannot be stored in pages
+ */
+static inline bool
+paged_index(const xlb_datum_table *t, adlb_datum_id id,
+            int *dir, int64_t *page, int *slot)
+{
+  int64_t abs_id;
+  if (id > 0)
+  {
+    *dir = DIR_POS;
+    abs_id = id;
+  }
+  else if (id < 0 && id != INT64_MIN)
+  {
+    *dir = DIR_NEG;
+    abs_id = -id;
+  }
+  else
+  {
+    return false;
+  }
+
+  int64_t ix;
+  if (*dir == DIR_NEG)
+  {
+    // System ids are reserved in a contiguous range below zero
+    ix = abs_id;
+  }
+  else
+  {
+    if (abs_id % t->servers != t->server_num)
+    {
+      return false;
+    }
+    ix = abs_id / t->servers;
+  }
+
+  *page = ix >> XLB_DATUM_PAGE_BITS;
+  *slot = (int)(ix & XLB_DATUM_PAGE_MASK);
+  return true;
+}
+
+static inline adlb_datum_id
+paged_id(const xlb_datum_table *t, int dir, int page, int slot)
+{
+  int64_t ix = ((int64_t)page << XLB_DATUM_PAGE_BITS) + slot;
+  if (dir == DIR_NEG)
+  {
+    return -ix;
+  }
+  return ix * t->servers + t->server_num;
+}
+
+bool
+xlb_datum_table_init(xlb_datum_table *t, int servers, int server_num,
+                     int sparse_size)
+{
+  assert(servers > 0 && server_num >= 0 && server_num < servers);
+  t->servers = servers;
+  t->server_num = server_num;
+  for (int i = 0; i < DIRS; i++)
+  {
+    t->dirs[i].pages = NULL;
+    t->dirs[i].size = 0;
+    t->dirs[i].high = 0;
+  }
+  t->paged_adds = 0;
+  t->sparse_adds = 0;
+  return xlb_incr_lp_init(&t->sparse, sparse_size);
+}
+
+/**
+   Make sure page exists if id is dense enough
+   return: page, or NULL if id should be stored sparsely or on OOM
+ */
+static xlb_datum_page *
+dir_page(xlb_datum_dir *dir, int64_t page)
+{
+  if (page >= (int64_t)dir->high + XLB_DATUM_PAGE_SLACK ||
+      page >= INT_MAX / 2)
+  {
+    return NULL;
+  }
+  int p = (int)page;
+
+  if (p >= dir->size)
+  {
+    int new_size = (dir->size == 0) ? XLB_DATUM_PAGE_SLACK : dir->size * 2;
+    while (new_size <= p)
+      new_size *= 2;
+
+    xlb_datum_page **tmp = realloc(dir->pages,
+                                sizeof(dir->pages[0]) * (size_t)new_size);
+    if (tmp == NULL)
+      return NULL;
+    memset(&tmp[dir->size], 0,
+           sizeof(tmp[0]) * (size_t)(new_size - dir->size));
+    dir->pages = tmp;
+    dir->size = new_size;
+  }
+
+  if (dir->pages[p] == NULL)
+  {
+    dir->pages[p] = calloc(1, sizeof(xlb_datum_page));
+    if (dir->pages[p] == NULL)
+      return NULL;
+  }
+
+  if (p >= dir->high)
+    dir->high = p + 1;
+  return dir->pages[p];
+}
+
+bool
+xlb_datum_table_add(xlb_datum_table *t, adlb_datum_id id, void *datum)
+{
+  assert(datum != NULL);
+  int dir, slot;
+  int64_t page;
+  if (paged_index(t, id, &dir, &page, &slot))
+  {
+    xlb_datum_page *pg = dir_page(&t->dirs[dir], page);
+    if (pg != NULL)
+    {
+      assert(pg->slots[slot] == NULL);
+      pg->slots[slot] = datum;
+      pg->count++;
+      t->paged_adds++;
+      return true;
+    }
+  }
+
+  t->sparse_adds++;
+  return xlb_incr_lp_add(&t->sparse, id, datum);
+}
+
+bool
+xlb_datum_table_search(const xlb_datum_table *t, adlb_datum_id id,
+                       void **datum)
+{
+  int dir, slot;
+  int64_t page;
+  if (paged_index(t, id, &dir, &page, &slot))
+  {
+    const xlb_datum_dir *d = &t->dirs[dir];
+    if (page < d->size && d->pages[page] != NULL &&
+        d->pages[page]->slots[slot] != NULL)
+    {
+      *datum = d->pages[page]->slots[slot];
+      return true;
+    }
+  }
+
+  return xlb_incr_lp_size(&t->sparse) > 0 &&
+         xlb_incr_lp_search(&t->sparse, id, datum);
+}
+
+bool
+xlb_datum_table_remove(xlb_datum_table *t, adlb_datum_id id,
+                       void **datum)
+{
+  int dir, slot;
+  int64_t page;
+  if (paged_index(t, id, &dir, &page, &slot))
+  {
+    xlb_datum_dir *d = &t->dirs[dir];
+    if (page < d->size && d->pages[page] != NULL &&
+        d->pages[page]->slots[slot] != NULL)
+    {
+      xlb_datum_page *pg = d->pages[page];
+      *datum = pg->slots[slot];
+      pg->slots[slot] = NULL;
+      pg->count--;
+      if (pg->count == 0)
+      {
+        // Ids are not reused, so most empty pages stay empty
+        free(pg);
+        d->pages[page] = NULL;
+      }
+      return true;
+    }
+  }
+
+  return xlb_incr_lp_remove(&t->sparse, id, datum);
+}
+
+void
+xlb_datum_table_free_callback(xlb_datum_table *t,
+                              void (*callback)(int64_t, void*))
+{
+  for (int dir = 0; dir < DIRS; dir++)
+  {
+    xlb_datum_dir *d = &t->dirs[dir];
+    for (int p = 0; p < d->size; p++)
+    {
+      xlb_datum_page *pg = d->pages[p];
+      if (pg == NULL)
+        continue;
+
+      for (int slot = 0; callback != NULL && slot < XLB_DATUM_PAGE_SIZE;
+           slot++)
+      {
+        if (pg->slots[slot] != NULL)
+          callback(paged_id(t, dir, p, slot), pg->slots[slot]);
+      }
+      free(pg);
+    }
+    free(d->pages);
+    d->pages = NULL;
+    d->size = d->high = 0;
+  }
+
+  xlb_incr_lp_free_callback(&t->sparse, callback);
+}
+
+void
+xlb_datum_iter_init(xlb_datum_table *t, xlb_datum_iter *it)
+{
+  // Iterate over one hash table
+  xlb_incr_lp_finish(&t->sparse);
+
+  it->dir = 0;
+  it->page = 0;
+  it->slot = 0;
+  it->bucket = 0;
+  it->entry = NULL;
+}
+
+bool
+xlb_datum_iter_next(const xlb_datum_table *t, xlb_datum_iter *it)
+{
+  for (; it->dir < DIRS; it->dir++, it->page = 0)
+  {
+    const xlb_datum_dir *d = &t->dirs[it->dir];
+    for (; it->page < d->size; it->page++, it->slot = 0)
+    {
+      const xlb_datum_page *pg = d->pages[it->page];
+      for (; pg != NULL && it->slot < XLB_DATUM_PAGE_SIZE; it->slot++)
+      {
+        if (pg->slots[it->slot] != NULL)
+        {
+          it->id = paged_id(t, it->dir, it->page, it->slot);
+          it->datum = pg->slots[it->slot];
+          it->slot++;
+          return true;
+        }
+      }
+    }
+  }
+
+  const struct table_lp *sparse = &t->sparse.cur;
+  const table_lp_entry *e = (it->entry != NULL) ? it->entry->next : NULL;
+  while (e == NULL)
+  {
+    if (it->bucket >= sparse->capacity)
+    {
+      return false;
+    }
+    const table_lp_entry *head = &sparse->array[it->bucket++];
+    if (table_lp_entry_valid(head))
+    {
+      e = head;
+    }
+  }
+
+  it->entry = e;
+  it->id = e->key;
+  it->datum = e->data;
+  return true;
+}
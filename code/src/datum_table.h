@@ -0,0 +1,126 @@
+/*
+ * Copyright 2014 University of Chicago and Argonne National Laboratory
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License
+ */
+
+/*
+ * datum_table.h
+ *
+ * Map from adlb_datum_id to adlb_datum for the data stored on this
+ * server.
+ *
+ * The ids on a server are mostly dense: xlb_data_unique() hands out
+ * every servers'th positive id, and xlb_data_system_reserve() hands
+ * out a contiguous range of negative ids counting down from 0.
+ * Positive ids are stored in a paged array indexed by id / servers,
+ * negative ids in one indexed by |id|, for lookups without hashing.
+ * Ids far beyond the highest page in use, or positive ids located on
+ * another server, go in a hash table instead.  Pages are freed when
+ * they become empty, so memory use follows the live data as ids
+ * advance.
+ */
+
+#ifndef DATUM_TABLE_H
+#define DATUM_TABLE_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "adlb-defs.h"
+#include "incr_table.h"
+
+/** Bits of index within page */
+#define XLB_DATUM_PAGE_BITS 10
+#define XLB_DATUM_PAGE_SIZE (1 << XLB_DATUM_PAGE_BITS)
+
+/**
+   Pages that may be added beyond the highest page used so far before
+   ids are considered sparse
+ */
+#define XLB_DATUM_PAGE_SLACK 64
+
+typedef struct xlb_datum_page xlb_datum_page;
+
+/** Paged array for ids of one sign */
+typedef struct
+{
+  xlb_datum_page **pages;
+  int size; // Allocated size of pages array
+  int high; // One past highest page allocated so far
+} xlb_datum_dir;
+
+typedef struct
+{
+  int servers;
+  /** |id| % servers for ids on this server */
+  int server_num;
+
+  /** Positive and negative ids */
+  xlb_datum_dir dirs[2];
+
+  /** Ids that are not stored in pages */
+  xlb_incr_lp sparse;
+
+  // Perf counters
+  int64_t paged_adds;
+  int64_t sparse_adds;
+} xlb_datum_table;
+
+bool xlb_datum_table_init(xlb_datum_table *t, int servers,
+                          int server_num, int sparse_size);
+
+/**
+   Add datum.  Id must not be present.
+   return: false if out of memory
+ */
+bool xlb_datum_table_add(xlb_datum_table *t, adlb_datum_id id,
+                         void *datum);
+
+bool xlb_datum_table_search(const xlb_datum_table *t, adlb_datum_id id,
+                            void **datum);
+
+bool xlb_datum_table_remove(xlb_datum_table *t, adlb_datum_id id,
+                            void **datum);
+
+/**
+   Free table, calling callback on each datum if not NULL
+ */
+void xlb_datum_table_free_callback(xlb_datum_table *t,
+                                   void (*callback)(int64_t, void*));
+
+/**
+   Iterator over all data in table.  Table must not be modified during
+   iteration.
+ */
+typedef struct
+{
+  int dir;
+  int page;
+  int slot;
+  int bucket;
+  const table_lp_entry *entry;
+
+  // Current datum
+  adlb_datum_id id;
+  void *datum;
+} xlb_datum_iter;
+
+void xlb_datum_iter_init(xlb_datum_table *t, xlb_datum_iter *it);
+
+/**
+   return: false if no data left
+ */
+bool xlb_datum_iter_next(const xlb_datum_table *t, xlb_datum_iter *it);
+
+#endif // DATUM_TABLE_H
@@ -38,15 +38,13 @@
 #include <adlb.h>
 
 #include <c-utils.h>
-#include <list.h>
-#include <list2.h>
-#include <list2_b.h>
 #include <log.h>
 #include <table.h>
 #include <table_bp.h>
 #include <table_lp.h>
 #include <tools.h>
 
+#include "closed_set.h"
 #include "data_internal.h"
 #include "debug.h"
 #include "sync.h"
@@ -68,6 +66,8 @@ static struct {
   int64_t id_sub_subscribe_remote; /* Subscribe to remote data */
   int64_t id_sub_subscribe_cached; /* Cached subscribe to remote data */
   int64_t id_sub_ready; /* Already closed upon subscribe */
+
+  int64_t subscribe_batches; /* Batched remote subscribe messages */
 } xlb_engine_counters;
 
 #define INCR_COUNTER(name) \
@@ -94,10 +94,31 @@ typedef enum
   TRANSFORM_READY,
 } transform_status;
 
+typedef struct transform transform;
+
+typedef struct blocker_ref blocker_ref;
+
+/**
+   Entry in blocker lists: one input of a transform.  Inputs that
+   appear multiple times have an entry for each position.
+   Lists are linked through the entries, which are stored in the
+   transform, so adding a blocker allocates nothing.
+ */
+struct blocker_ref
+{
+  transform *T;
+  /** Position in inputs (input_id_list, then input_id_sub_list) */
+  int input;
+  /** Next entry blocked on same data */
+  blocker_ref *next;
+};
+
 /**
-   In-memory structure for data-dependent task
+   In-memory structure for data-dependent task.
+   The transform and all its arrays and strings are one allocation
+   from the server's slab pools, cf. transform_create().
  */
-typedef struct
+struct transform
 {
   /** Name for human debugging */
   char* name;
@@ -105,8 +126,8 @@ typedef struct
   /** Task to release when inputs are ready */
   xlb_work_unit *work;
 
-  /** Entry in transforms_waiting */
-  struct list2_item *list_entry;
+  /** Links in transforms_waiting */
+  transform *prev, *next;
 
   /** Number of input tds */
   int input_tds;
@@ -120,11 +141,12 @@ typedef struct
 
   /** Closed inputs - bit vector for both tds and td/sub pairs */
   unsigned char *closed_inputs;
-  /** Index of next subscribed input (starts at 0 in input_td list,
-      continues into input_id_sub_list) */
-  int blocker; // Next input we're waiting for
+  /** Blocker list entries, indexed by input position */
+  blocker_ref *blocker_refs;
+  /** Number of inputs not yet closed: ready when this reaches 0 */
+  int blocked_inputs;
   transform_status status;
-} transform;
+};
 
 static size_t bitfield_size(int inputs);
 
@@ -136,7 +158,7 @@ static inline void mark_input_id_sub_closed(transform *T, int i);
 
 // Update transforms after close
 static xlb_engine_code
-xlb_engine_close_update(struct list *blocked, adlb_datum_id id,
+xlb_engine_close_update(blocker_ref *blocked, adlb_datum_id id,
      adlb_subscript sub, xlb_engine_work_array *ready);
 
 static inline xlb_engine_code
@@ -151,6 +173,12 @@ subscribe_id_sub(adlb_datum_id id, engine_sub subscript,
 static xlb_engine_code init_closed_caches(void);
 static void finalize_closed_caches(void);
 
+static xlb_engine_code init_subscribe_batches(void);
+static void finalize_subscribe_batches(void);
+static xlb_engine_code subscribe_remote(int server, adlb_datum_id id,
+                              adlb_subscript sub, bool *subscribed);
+static xlb_engine_code flush_subscribe_batches(void);
+
 static xlb_engine_code id_closed_cache_add(adlb_datum_id id);
 static bool id_closed_cache_check(adlb_datum_id id);
 
@@ -165,27 +193,28 @@ bool xlb_engine_initialized = false;
 
 /**
    Waiting transforms.
-   List of transforms
+   List of transforms linked through prev and next
  */
-static struct list2 transforms_waiting;
+static struct {
+  transform *head;
+  int size;
+} transforms_waiting;
 
 /**
    TD inputs blocking their transforms
-   Map from TD ID to list of pointers to transforms.
+   Map from TD ID to first blocker_ref in list.
 
-   There may be duplicate entries of the same transform for an ID
-   in id_blockers: this must be handled when the notification is
-   received.
+   There may be multiple entries of the same transform for an ID
+   in id_blockers, one for each position of the input.
  */
 static struct table_lp id_blockers;
 
 /**
    ID/subscript pairs blocking transforms
-   Map from ID/subscript pair to list of pointers to transforms
-   
-   There may be duplicate entries of the same transform for an ID
-   in id_sub_blockers: this must be handled when the notification is
-   received.
+   Map from ID/subscript pair to first blocker_ref in list
+
+   There may be multiple entries of the same transform for an ID
+   in id_sub_blockers, one for each position of the input.
  */
 static struct table_bp id_sub_blockers;
 
@@ -202,35 +231,42 @@ static struct table_lp id_subscribed;
 static struct table_bp id_sub_subscribed;
 
 /**
-  LRU caches for TDs or TD/sub pairs known to be closed implemented with
-  doubly-linked list and hash table.  Hash table entries point to linked
-  list node.  Linked list node contains subscribe cache entry.  The head
-  of the LRU is next in line for eviction.  We only cache remote
+  Caches for TDs or TD/sub pairs known to be closed, implemented with
+  fixed-size sets with clock eviction, cf. closed_set.h.  Keys of TD/sub
+  pairs are created with xlb_write_id_sub.  We only cache remote
   subscribes, not local ones.
  */
-typedef struct {
-  adlb_datum_id id;
-} id_closed_cache_entry;
+#define DEFAULT_CLOSED_CACHE_SIZE (256 * 1024)
 
-// Key created with xlb_write_id_sub
+/**
+  Remote subscribes of transform being added, batched by server and
+  sent at the end of init_inputs(), so that adding a transform costs
+  one message per server instead of one per input.
+  Disable with ADLB_SUBSCRIBE_BATCH=0.
+ */
 typedef struct {
-  size_t key_len;
-  char key[];
-} id_sub_closed_cache_entry;
-
-#define DEFAULT_CLOSED_CACHE_SIZE 4096
+  char *buf; // Entries packed with xlb_pack_id_sub()
+  int length;
+  int size;
+  int count;
+  bool listed; // In subscribe_batch_servers
+} subscribe_batch;
 
-static int id_closed_cache_size; // Number of entries
+/** Send batch early if it reaches this size */
+#define SUBSCRIBE_BATCH_MAX_BYTES (64 * 1024)
 
-static int id_sub_closed_cache_size; // Number of entries
+static bool subscribe_batching;
 
-static struct table_lp id_closed_cache;
+/** Batches indexed by server number */
+static subscribe_batch *subscribe_batches = NULL;
 
-static struct table_bp id_sub_closed_cache;
+/** Server numbers of batches with entries */
+static int *subscribe_batch_servers = NULL;
+static int subscribe_batch_server_count = 0;
 
-static struct list2_b id_closed_cache_lru;
+static xlb_id_set id_closed_cache;
 
-static struct list2_b id_sub_closed_cache_lru;
+static xlb_key_set id_sub_closed_cache;
 
 // Maximum length of buffer required for key
 #define ID_SUB_KEY_MAX (ADLB_DATA_SUBSCRIPT_MAX + 30)
@@ -346,7 +382,8 @@ xlb_engine_init(int rank)
 
   bool result;
 
-  list2_init(&transforms_waiting); 
+  transforms_waiting.head = NULL;
+  transforms_waiting.size = 0;
 
   result = table_lp_init(&id_blockers, table_init_capacity); 
   if (!result)
@@ -377,16 +414,35 @@ xlb_engine_init(int rank)
     xlb_engine_counters.id_sub_subscribe_remote = 0;
     xlb_engine_counters.id_sub_subscribe_cached = 0;
     xlb_engine_counters.id_sub_ready = 0;
+
+    xlb_engine_counters.subscribe_batches = 0;
   }
 
   xlb_engine_code tc = init_closed_caches();
   if (tc != XLB_ENGINE_SUCCESS)
     return tc;
+
+  tc = init_subscribe_batches();
+  if (tc != XLB_ENGINE_SUCCESS)
+    return tc;
   
   xlb_engine_initialized = true;
   return XLB_ENGINE_SUCCESS;
 }
 
+static void
+print_closed_cache_counters(const char *name,
+                            const xlb_closed_set_common *c)
+{
+  double hit_rate = c->lookups > 0 ?
+                    (double)c->hits / (double)c->lookups : 0.0;
+  PRINT_COUNTER("%s_lookups=%"PRId64, name, c->lookups);
+  PRINT_COUNTER("%s_hits=%"PRId64, name, c->hits);
+  PRINT_COUNTER("%s_hit_rate=%.4f", name, hit_rate);
+  PRINT_COUNTER("%s_evictions=%"PRId64, name, c->evictions);
+  PRINT_COUNTER("%s_size=%i", name, c->size);
+}
+
 void
 xlb_engine_print_counters(void)
 {
@@ -428,8 +484,30 @@ xlb_engine_print_counters(void)
         xlb_engine_counters.id_sub_subscribe_cached);
   PRINT_COUNTER("engine_id_sub_ready=%"PRId64,
         xlb_engine_counters.id_sub_ready);
+
+  PRINT_COUNTER("engine_subscribe_batches=%"PRId64,
+        xlb_engine_counters.subscribe_batches);
+
+  print_closed_cache_counters("engine_id_closed_cache", &id_closed_cache.c);
+  print_closed_cache_counters("engine_id_sub_closed_cache",
+                              &id_sub_closed_cache.c);
+}
+
+/*
+  Round up offset in transform allocation for alignment of next array
+ */
+static inline size_t
+transform_align(size_t offset)
+{
+  const size_t align = sizeof(void*);
+  return (offset + align - 1) & ~(align - 1);
 }
 
+/*
+  Create transform in one allocation, laid out as:
+  struct transform, input_id_list, input_id_sub_list, blocker_refs,
+  subscript keys, name, closed_inputs.
+ */
 static inline xlb_engine_code
 transform_create(const char* name, int name_strlen,
            int input_tds, const adlb_datum_id* input_id_list,
@@ -442,13 +520,35 @@ transform_create(const char* name, int name_strlen,
   assert(input_id_subs >= 0);
   assert(input_id_subs == 0 || input_id_sub_list != NULL);
 
-  transform* T = malloc(sizeof(transform));
-  if (! T)
+  int total_inputs = input_tds + input_id_subs;
+
+  size_t ids_off = transform_align(sizeof(transform));
+  size_t id_subs_off = transform_align(ids_off +
+                    (size_t)input_tds * sizeof(adlb_datum_id));
+  size_t refs_off = transform_align(id_subs_off +
+                    (size_t)input_id_subs * sizeof(id_sub_pair));
+  size_t keys_off = refs_off + (size_t)total_inputs * sizeof(blocker_ref);
+  size_t name_off = keys_off;
+  for (int i = 0; i < input_id_subs; i++)
+  {
+    name_off += input_id_sub_list[i].subscript.length;
+  }
+  size_t closed_off = name_off;
+  if (name != NULL)
+  {
+    closed_off += (size_t)name_strlen + 1;
+  }
+  size_t size = closed_off + bitfield_size(total_inputs);
+
+  char *mem = xlb_pool_alloc(size);
+  if (! mem)
     return XLB_ENGINE_ERROR_OOM;
 
+  transform* T = (transform*)mem;
+
   if (name != NULL)
   {
-    T->name = malloc((size_t) name_strlen + 1);
+    T->name = mem + name_off;
     memcpy(T->name, name, (size_t)name_strlen);
     T->name[name_strlen] = '\0';
   }
@@ -458,19 +558,16 @@ transform_create(const char* name, int name_strlen,
   }
 
   T->work = work;
-  T->blocker = 0;
+  T->prev = T->next = NULL;
+  T->blocked_inputs = 0;
   T->input_tds = input_tds;
   T->input_id_subs = input_id_subs;
 
   if (input_tds > 0)
   {
-    size_t sz = (size_t)input_tds*sizeof(adlb_datum_id);
-    T->input_id_list = malloc(sz);
-
-    if (! T->input_id_list)
-      return XLB_ENGINE_ERROR_OOM;
-
-    memcpy(T->input_id_list, input_id_list, sz);
+    T->input_id_list = (adlb_datum_id*)(mem + ids_off);
+    memcpy(T->input_id_list, input_id_list,
+           (size_t)input_tds * sizeof(adlb_datum_id));
   }
   else
   {
@@ -479,12 +576,10 @@ transform_create(const char* name, int name_strlen,
 
   if (input_id_subs > 0)
   {
-    size_t sz = (size_t)input_id_subs* sizeof(id_sub_pair);
-    T->input_id_sub_list = malloc(sz);
+    T->input_id_sub_list = (id_sub_pair*)(mem + id_subs_off);
 
-    if (! T->input_id_sub_list)
-      return XLB_ENGINE_ERROR_OOM;
     // Copy across all subscripts
+    char *key = mem + keys_off;
     for (int i = 0; i < input_id_subs; i++)
     {
       const adlb_datum_id_sub *src;
@@ -493,11 +588,9 @@ transform_create(const char* name, int name_strlen,
       dst = &T->input_id_sub_list[i];
       dst->td = src->id;
       dst->subscript.length = src->subscript.length;
-      dst->subscript.key = malloc(src->subscript.length);
-      if (!dst->subscript.key)
-        return XLB_ENGINE_ERROR_OOM;
-      memcpy(dst->subscript.key, src->subscript.key,
-             src->subscript.length);
+      dst->subscript.key = key;
+      memcpy(key, src->subscript.key, src->subscript.length);
+      key += src->subscript.length;
     }
   }
   else
@@ -505,20 +598,17 @@ transform_create(const char* name, int name_strlen,
     T->input_id_sub_list = NULL;
   }
 
-  int total_inputs = input_tds + input_id_subs;
   if (total_inputs > 0)
   {
-    size_t sz = bitfield_size(total_inputs)* sizeof(unsigned char);
-    T->closed_inputs = malloc(sz);
-
-    if (! T->closed_inputs)
-      return XLB_ENGINE_ERROR_OOM;
+    T->closed_inputs = (unsigned char*)(mem + closed_off);
+    memset(T->closed_inputs, 0, bitfield_size(total_inputs));
 
-    memset(T->closed_inputs, 0, sz);
+    T->blocker_refs = (blocker_ref*)(mem + refs_off);
   }
   else
   {
     T->closed_inputs = NULL;
+    T->blocker_refs = NULL;
   }
 
 
@@ -531,24 +621,9 @@ transform_create(const char* name, int name_strlen,
 static inline void
 transform_free(transform* T)
 {
-  if (T->name != NULL)
-    free(T->name);
   if (T->work)
     xlb_work_unit_free(T->work);
-  if (T->input_id_list)
-    free(T->input_id_list);
-  if (T->input_id_sub_list)
-  {
-    for (int i = 0; i < T->input_id_subs; i++)
-    {
-      // free subscript strings
-      free(T->input_id_sub_list[i].subscript.key);
-    }
-    free(T->input_id_sub_list);
-  }
-  if (T->closed_inputs)
-    free(T->closed_inputs);
-  free(T);
+  xlb_pool_free(T);
 }
 
 /**
@@ -573,7 +648,7 @@ subscribe_td(adlb_datum_id id, bool *subscribed)
     if (server == xlb_s.layout.rank)
     {
       adlb_data_code dc = xlb_data_subscribe(id, ADLB_NO_SUB,
-                               xlb_s.layout.rank, 0, subscribed);
+                               xlb_s.layout.rank, 0, false, subscribed);
       TRACE("xlb_data_subscribe => %i %i", (int)dc, (int)*subscribed);
       if (dc == ADLB_DATA_ERROR_NOT_FOUND)
       {
@@ -594,9 +669,9 @@ subscribe_td(adlb_datum_id id, bool *subscribed)
       }
       else
       {
-        adlb_code ac = xlb_sync_subscribe(server, id, ADLB_NO_SUB,
-                                          subscribed);
-        ENGINE_CHECK_ADLB(ac,  XLB_ENGINE_ERROR_UNKNOWN);
+        xlb_engine_code tc = subscribe_remote(server, id, ADLB_NO_SUB,
+                                              subscribed);
+        ENGINE_CHECK(tc);
         INCR_COUNTER(id_subscribe_remote);
       }
     }
@@ -651,7 +726,7 @@ subscribe_id_sub(adlb_datum_id id, engine_sub subscript,
     if (server == xlb_s.layout.rank)
     {
       adlb_data_code dc = xlb_data_subscribe(id, sub_convert(subscript),
-                                            xlb_s.layout.rank, 0, subscribed);
+                              xlb_s.layout.rank, 0, false, subscribed);
       TRACE("xlb_data_subscribe => %i %i", (int)dc, (int)*subscribed);
       if (dc == ADLB_DATA_ERROR_NOT_FOUND)
       {
@@ -673,9 +748,9 @@ subscribe_id_sub(adlb_datum_id id, engine_sub subscript,
       }
       else
       {
-        adlb_code ac = xlb_sync_subscribe(server, id,
+        xlb_engine_code tc = subscribe_remote(server, id,
                             sub_convert(subscript), subscribed);
-        ENGINE_CHECK_ADLB(ac,  XLB_ENGINE_ERROR_UNKNOWN);
+        ENGINE_CHECK(tc);
         
         INCR_COUNTER(id_sub_subscribe_remote);
       }
@@ -715,6 +790,30 @@ static int transform_tostring(char* output,
 static xlb_engine_code progress(transform* T, bool* subscribed);
 static xlb_engine_code init_inputs(transform* T);
 
+static inline void
+waiting_add(transform *T)
+{
+  T->prev = NULL;
+  T->next = transforms_waiting.head;
+  if (T->next != NULL)
+    T->next->prev = T;
+  transforms_waiting.head = T;
+  transforms_waiting.size++;
+}
+
+static inline void
+waiting_remove(transform *T)
+{
+  if (T->prev != NULL)
+    T->prev->next = T->next;
+  else
+    transforms_waiting.head = T->next;
+  if (T->next != NULL)
+    T->next->prev = T->prev;
+  T->prev = T->next = NULL;
+  transforms_waiting.size--;
+}
+
 xlb_engine_code
 xlb_engine_put(const char* name, int name_strlen,
               int input_tds,
@@ -751,10 +850,7 @@ xlb_engine_put(const char* name, int name_strlen,
   {
     DEBUG_ENGINE("waiting: {%"PRId64"}", work->id);
     assert(T != NULL);
-    struct list2_item *list_entry = list2_add(&transforms_waiting, T);
-    if (list_entry == NULL)
-      return XLB_ENGINE_ERROR_OOM;
-    T->list_entry = list_entry;
+    waiting_add(T);
     *ready = false;
   }
   else
@@ -771,24 +867,37 @@ xlb_engine_put(const char* name, int name_strlen,
 }
 
 static inline xlb_engine_code add_blocker(adlb_datum_id id,
-                                      transform *T);
+                                      blocker_ref *ref);
 
 static inline xlb_engine_code add_blocker_sub(void *id_sub_key,
-        size_t id_sub_keylen, transform *T);
+        size_t id_sub_keylen, blocker_ref *ref);
+
+static inline blocker_ref *
+init_blocker_ref(transform *T, int input)
+{
+  blocker_ref *ref = &T->blocker_refs[input];
+  ref->T = T;
+  ref->input = input;
+  ref->next = NULL;
+  T->blocked_inputs++;
+  return ref;
+}
+
 /**
   Do initial setup of subscribes so that notifications will update
   the inputs of this transform
 
   Currently this is implemented by subscribing to all inputs,
   marking those that are already closed, and adding the remainder
-  to the blockers table.
+  to the blockers table, with the count of the remainder in
+  blocked_inputs.
 */
 static xlb_engine_code
 init_inputs(transform* T)
 {
   /*
-    We might add duplicate list entries if input appears multiple
-    times. This is currently handled upon removal from list.
+    Inputs that appear multiple times get a blocker list entry for
+    each position, so each is counted once when closed.
    */
   xlb_engine_code tc;
 
@@ -801,9 +910,7 @@ init_inputs(transform* T)
 
     if (subscribed)
     {
-      // We might add duplicate list entries if id appears multiple
-      //      times. This is currently handled upon removal from list
-      tc = add_blocker(id, T);
+      tc = add_blocker(id, init_blocker_ref(T, i));
       ENGINE_CHECK(tc);
     }
     else
@@ -827,9 +934,8 @@ init_inputs(transform* T)
 
     if (subscribed)
     {
-      // We might add duplicate list entries if id appears multiple
-      //      times. This is currently handled upon removal from list
-      tc = add_blocker_sub(id_sub_key, id_sub_keylen, T);
+      tc = add_blocker_sub(id_sub_key, id_sub_keylen,
+                           init_blocker_ref(T, T->input_tds + i));
       ENGINE_CHECK(tc);
     }
     else
@@ -837,6 +943,142 @@ init_inputs(transform* T)
       mark_input_id_sub_closed(T, i);
     }
   }
+
+  // Send remote subscribes for all inputs together
+  tc = flush_subscribe_batches();
+  ENGINE_CHECK(tc);
+
+  return XLB_ENGINE_SUCCESS;
+}
+
+static xlb_engine_code init_subscribe_batches(void)
+{
+  getenv_boolean("ADLB_SUBSCRIBE_BATCH", true, &subscribe_batching);
+  if (!subscribe_batching)
+    return XLB_ENGINE_SUCCESS;
+
+  int servers = xlb_s.layout.servers;
+  subscribe_batches = calloc((size_t)servers, sizeof(subscribe_batches[0]));
+  subscribe_batch_servers = malloc(sizeof(subscribe_batch_servers[0]) *
+                                   (size_t)servers);
+  if (subscribe_batches == NULL || subscribe_batch_servers == NULL)
+    return XLB_ENGINE_ERROR_OOM;
+  subscribe_batch_server_count = 0;
+  return XLB_ENGINE_SUCCESS;
+}
+
+static void finalize_subscribe_batches(void)
+{
+  if (subscribe_batches != NULL)
+  {
+    for (int i = 0; i < xlb_s.layout.servers; i++)
+    {
+      assert(subscribe_batches[i].count == 0);
+      free(subscribe_batches[i].buf);
+    }
+    free(subscribe_batches);
+    subscribe_batches = NULL;
+  }
+  free(subscribe_batch_servers);
+  subscribe_batch_servers = NULL;
+}
+
+/*
+  Send any batched subscribes to server
+  server_num: server number, not rank
+ */
+static xlb_engine_code flush_subscribe_batch(int server_num)
+{
+  subscribe_batch *b = &subscribe_batches[server_num];
+  int server = server_num + xlb_s.layout.workers;
+  adlb_code ac;
+
+  if (b->count == 1)
+  {
+    // Send as regular subscribe
+    adlb_datum_id id;
+    adlb_subscript sub;
+    xlb_unpack_id_sub(b->buf, &id, &sub);
+    bool subscribed;
+    ac = xlb_sync_subscribe(server, id, sub, &subscribed);
+    ENGINE_CHECK_ADLB(ac, XLB_ENGINE_ERROR_UNKNOWN);
+  }
+  else if (b->count > 1)
+  {
+    DEBUG_ENGINE("Batch of %i subscribes to server %i", b->count, server);
+    ac = xlb_sync_subscribe_batch(server, b->buf, b->length, b->count);
+    ENGINE_CHECK_ADLB(ac, XLB_ENGINE_ERROR_UNKNOWN);
+    INCR_COUNTER(subscribe_batches);
+  }
+
+  b->count = 0;
+  b->length = 0;
+  return XLB_ENGINE_SUCCESS;
+}
+
+/*
+  Subscribe to data on another server.  Subscribes are added to a
+  batch if enabled.
+ */
+static xlb_engine_code subscribe_remote(int server, adlb_datum_id id,
+                              adlb_subscript sub, bool *subscribed)
+{
+  if (!subscribe_batching)
+  {
+    adlb_code ac = xlb_sync_subscribe(server, id, sub, subscribed);
+    ENGINE_CHECK_ADLB(ac, XLB_ENGINE_ERROR_UNKNOWN);
+    return XLB_ENGINE_SUCCESS;
+  }
+
+  int server_num = server - xlb_s.layout.workers;
+  assert(server_num >= 0 && server_num < xlb_s.layout.servers);
+  subscribe_batch *b = &subscribe_batches[server_num];
+
+  if (b->size - b->length < (int)PACKED_SUBSCRIPT_MAX)
+  {
+    int new_size = b->size * 2;
+    if (new_size < b->length + (int)PACKED_SUBSCRIPT_MAX)
+      new_size = b->length + (int)PACKED_SUBSCRIPT_MAX;
+    char *tmp = realloc(b->buf, (size_t)new_size);
+    if (tmp == NULL)
+      return XLB_ENGINE_ERROR_OOM;
+    b->buf = tmp;
+    b->size = new_size;
+  }
+
+  if (!b->listed)
+  {
+    subscribe_batch_servers[subscribe_batch_server_count++] = server_num;
+    b->listed = true;
+  }
+
+  b->length += xlb_pack_id_sub(b->buf + b->length, id, sub);
+  b->count++;
+
+  if (b->length >= SUBSCRIBE_BATCH_MAX_BYTES)
+  {
+    xlb_engine_code tc = flush_subscribe_batch(server_num);
+    ENGINE_CHECK(tc);
+  }
+
+  // We will get notification later
+  *subscribed = true;
+  return XLB_ENGINE_SUCCESS;
+}
+
+/*
+  Send all batched subscribes
+ */
+static xlb_engine_code flush_subscribe_batches(void)
+{
+  for (int i = 0; i < subscribe_batch_server_count; i++)
+  {
+    int server_num = subscribe_batch_servers[i];
+    xlb_engine_code tc = flush_subscribe_batch(server_num);
+    ENGINE_CHECK(tc);
+    subscribe_batches[server_num].listed = false;
+  }
+  subscribe_batch_server_count = 0;
   return XLB_ENGINE_SUCCESS;
 }
 
@@ -846,21 +1088,22 @@ init_inputs(transform* T)
    @param result return the new blocked list here
  */
 static inline xlb_engine_code
-add_blocker(adlb_datum_id id, transform *T)
+add_blocker(adlb_datum_id id, blocker_ref *ref)
 {
   assert(xlb_engine_initialized);
   DEBUG_ENGINE("add_blocker for {%"PRId64"}: <%"PRId64">",
-                T->work->id, id);
-  struct list* blocked;
-  table_lp_search(&id_blockers, id, (void**)&blocked);
-  if (blocked == NULL)
+                ref->T->work->id, id);
+  // Push on front of list
+  void *old;
+  bool ok = table_lp_set(&id_blockers, id, ref, &old);
+  if (ok)
   {
-    blocked = list_create();
-    bool ok = table_lp_add(&id_blockers, id, blocked);
-    if (!ok)
-      return XLB_ENGINE_ERROR_OOM;
+    ref->next = old;
+    return XLB_ENGINE_SUCCESS;
   }
-  list_add(blocked, T);
+  ok = table_lp_add(&id_blockers, id, ref);
+  if (!ok)
+    return XLB_ENGINE_ERROR_OOM;
   return XLB_ENGINE_SUCCESS;
 }
 
@@ -868,22 +1111,22 @@ add_blocker(adlb_datum_id id, transform *T)
   Same as add_blocker, but with subscript.
  */
 static inline xlb_engine_code add_blocker_sub(void *id_sub_key,
-        size_t id_sub_keylen, transform *T)
+        size_t id_sub_keylen, blocker_ref *ref)
 {
   assert(xlb_engine_initialized);
-  DEBUG_ENGINE("add_blocker_sub for {%"PRId64"}", T->work->id);
-  struct list* blocked;
-  bool found = table_bp_search(&id_sub_blockers, id_sub_key,
-                         id_sub_keylen, (void**)&blocked);
-  if (!found)
+  DEBUG_ENGINE("add_blocker_sub for {%"PRId64"}", ref->T->work->id);
+  // Push on front of list
+  void *old;
+  bool ok = table_bp_set(&id_sub_blockers, id_sub_key, id_sub_keylen,
+                         ref, &old);
+  if (ok)
   {
-    blocked = list_create();
-    bool ok = table_bp_add(&id_sub_blockers, id_sub_key, id_sub_keylen,
-                           blocked);
-    if (!ok)
-      return XLB_ENGINE_ERROR_OOM;
+    ref->next = old;
+    return XLB_ENGINE_SUCCESS;
   }
-  list_add(blocked, T);
+  ok = table_bp_add(&id_sub_blockers, id_sub_key, id_sub_keylen, ref);
+  if (!ok)
+    return XLB_ENGINE_ERROR_OOM;
   return XLB_ENGINE_SUCCESS;
 }
 
@@ -905,15 +1148,13 @@ xlb_engine_close(adlb_datum_id id, bool remote,
   }
 
   // Remove from table transforms that this td was blocking
-  // Will need to free list later
-  struct list* L;
-  bool found = table_lp_remove(&id_blockers, id, (void**)&L);
+  void *blocked;
+  bool found = table_lp_remove(&id_blockers, id, &blocked);
   if (!found)
     // We don't have any transforms that block on this td
     return XLB_ENGINE_SUCCESS;
 
-  DEBUG_ENGINE("%i blocked", L->size);
-  return xlb_engine_close_update(L, id, ADLB_NO_SUB, ready);
+  return xlb_engine_close_update(blocked, id, ADLB_NO_SUB, ready);
 }
 
 xlb_engine_code xlb_engine_sub_close(adlb_datum_id id, adlb_subscript sub,
@@ -938,93 +1179,69 @@ xlb_engine_code xlb_engine_sub_close(adlb_datum_id id, adlb_subscript sub,
     ENGINE_CHECK(tc);
   }
 
-  struct list* L;
-  
-  bool found = table_bp_remove(&id_sub_blockers, key, key_len, (void**)&L);
+  void *blocked;
+  bool found = table_bp_remove(&id_sub_blockers, key, key_len, &blocked);
   if (!found)
     // We don't have any transforms that block on this td
     return XLB_ENGINE_SUCCESS;
 
-  return xlb_engine_close_update(L, id, sub, ready);
+  return xlb_engine_close_update(blocked, id, sub, ready);
 }
 
 /*
   Update transforms after having one of blockers removed.
-  blocked: list of transforms with blocker remoed
+  blocked: list of blocker_ref for inputs that were closed
   id: id of data
   sub: optional subscript
   ready/ready_count: list of any work units made ready by this change,
       with ownership passed to caller
  */
 static xlb_engine_code
-xlb_engine_close_update(struct list *blocked, adlb_datum_id id,
+xlb_engine_close_update(blocker_ref *blocked, adlb_datum_id id,
          adlb_subscript sub, xlb_engine_work_array *ready)
 {
-  transform* T_prev = NULL;
-  
-  // Try to make progress on those transforms
-  for (struct list_item* item = blocked->head; item; item = item->next)
+  // Entries were pushed on front: reverse to release in order added
+  blocker_ref *ref = NULL;
+  while (blocked != NULL)
   {
-    transform* T = item->data;
-
-    /*
-     * Avoid processing transform multiple times if the input appeared
-     * multiple times in the transform inputs.  We can assume that the
-     * duplicates of a transform will appear consecutively in the list
-     * because they would have been added at the same time.
-     */
-    if (T == T_prev)
-      continue;
+    blocker_ref *next = blocked->next;
+    blocked->next = ref;
+    ref = blocked;
+    blocked = next;
+  }
 
-    // update closed vector
-    if (!adlb_has_sub(sub))
-    {
-      DEBUG_ENGINE("Update {%"PRId64"} for close: <%"PRId64">", T->work->id, id);
-      for (int i = T->blocker; i < T->input_tds; i++) {
-        if (T->input_id_list[i] == id) {
-          mark_input_id_closed(T, i);
-        }
-      }
-    }
-    else
-    {
-      DEBUG_ENGINE("Update {%"PRId64"} for subscript close: <%"PRId64">",
-                    T->work->id, id);
-      // Check to see which ones remain to be checked
-      int first_id_sub;
-      if (T->blocker >= T->input_tds)
-        first_id_sub = T->blocker - T->input_tds;
-      else
-        first_id_sub = 0;
+  // Each entry is one input position of a waiting transform
+  while (ref != NULL)
+  {
+    transform* T = ref->T;
+    // Entry is freed with T
+    blocker_ref *next = ref->next;
 
-      for (int i = first_id_sub; i < T->input_id_subs; i++)
-      {
-        id_sub_pair *input_tdsub = &T->input_id_sub_list[i];
-        engine_sub *input_sub = &input_tdsub->subscript;
-        if (input_tdsub->td == id && input_sub->length == sub.length 
-            && memcmp(input_sub->key, sub.key, sub.length) == 0)
-        {
-          mark_input_id_sub_closed(T, i);
-        }
-      }
-    }
+    DEBUG_ENGINE("Update {%"PRId64"} for close: <%"PRId64"> input %i",
+                  T->work->id, id, ref->input);
+    assert(!input_id_closed(T, ref->input));
+    mark_input_id_closed(T, ref->input);
+    T->blocked_inputs--;
 
+    /*
+     * T can only become ready on its last entry in the list, since
+     * all of its entries count towards blocked_inputs, so it is safe
+     * to free it here.
+     */
     bool subscribed;
     xlb_engine_code tc = progress(T, &subscribed);
     if (tc != XLB_ENGINE_SUCCESS)
       return tc;
 
-    T_prev = T;
     if (!subscribed)
     {
       DEBUG_ENGINE("Ready {%"PRId64"}", T->work->id);
       tc = move_to_ready(ready, T);
       ENGINE_CHECK(tc);
     }
+    ref = next;
   }
 
-  list_free(blocked); // No longer need list
-
   return XLB_ENGINE_SUCCESS;
 }
 
@@ -1050,10 +1267,8 @@ move_to_ready(xlb_engine_work_array *ready, transform *T)
   }
   ready->work[ready->count++] = T->work;
 
-  list2_remove_item(&transforms_waiting, T->list_entry);
-  free(T->list_entry);
-  T->list_entry = NULL;
-  
+  waiting_remove(T);
+
   T->work = NULL; // Don't free work
   transform_free(T);
 
@@ -1071,29 +1286,12 @@ move_to_ready(xlb_engine_work_array *ready, transform *T)
 static xlb_engine_code
 progress(transform* T, bool* subscribed)
 {
-  // first check TDs to see if all are ready
-  for (; T->blocker < T->input_tds; T->blocker++)
-  {
-    if (!input_id_closed(T, T->blocker))
-    {
-      // TRACE("{%"PRId64"} blocked on <%"PRId64">", T->work->id, T->blocker);
-      // Not yet done
-      *subscribed = true;
-      return XLB_ENGINE_SUCCESS;
-    }
-  }
-
-  // now, make progress on any ID/subscript pairs
-  int total_inputs = T->input_tds  + T->input_id_subs;
-  for (; T->blocker < total_inputs; T->blocker++)
+  assert(T->blocked_inputs >= 0);
+  if (T->blocked_inputs > 0)
   {
-    int id_sub_ix = T->blocker - T->input_tds;
-    if (!input_id_sub_closed(T, id_sub_ix))
-    {
-      // Not yet done
-      *subscribed = true;
-      return XLB_ENGINE_SUCCESS;
-    }
+    // Not yet done
+    *subscribed = true;
+    return XLB_ENGINE_SUCCESS;
   }
 
   // Ready to run
@@ -1226,7 +1424,7 @@ bitfield_size(int inputs) {
 
 static xlb_engine_code init_closed_caches(void)
 {
-  id_closed_cache_size = DEFAULT_CLOSED_CACHE_SIZE;
+  int size = DEFAULT_CLOSED_CACHE_SIZE;
 
   long tmp;
   adlb_code rc = xlb_env_long("ADLB_CLOSED_CACHE_SIZE", &tmp);
@@ -1236,146 +1434,50 @@ static xlb_engine_code init_closed_caches(void)
     ENGINE_CONDITION(tmp >= 0 && tmp < INT_MAX,
                               XLB_ENGINE_ERROR_INVALID,
           "Invalid ADLB_CLOSED_CACHE_SIZE %li", tmp);
-    id_closed_cache_size = (int)tmp;
+    size = (int)tmp;
   }
 
   // Same cache sizes for now
-  id_sub_closed_cache_size = id_closed_cache_size;
+  bool ok = xlb_id_set_init(&id_closed_cache, size);
+  if (!ok)
+    return XLB_ENGINE_ERROR_OOM;
+
+  ok = xlb_key_set_init(&id_sub_closed_cache, size);
+  if (!ok)
+    return XLB_ENGINE_ERROR_OOM;
 
-  // Initialize to size large enough for all entries
-  table_lp_init_custom(&id_closed_cache, id_closed_cache_size, 1.0);
-  table_bp_init_custom(&id_sub_closed_cache, id_sub_closed_cache_size,
-                       1.0);
-  
-  list2_b_init(&id_closed_cache_lru);
-  list2_b_init(&id_sub_closed_cache_lru);
   return XLB_ENGINE_SUCCESS;
 }
 
 static void finalize_closed_caches(void)
 {
-  // Free tables.  Values are pointers to list nodes, which we free next
-  table_lp_free_callback(&id_closed_cache, false, NULL);
-  table_bp_free_callback(&id_sub_closed_cache, false, NULL);
-
-  // Free LRU list
-  list2_b_clear(&id_closed_cache_lru);
-  list2_b_clear(&id_sub_closed_cache_lru);
-}
-
-// Move to top of lru list
-static void id_closed_update_lru(struct list2_b_item *entry)
-{
-  if (id_closed_cache_lru.tail != entry)
-  {
-    // Remove and add back at tail
-    list2_b_remove_item(&id_closed_cache_lru, entry);
-    list2_b_add_item(&id_closed_cache_lru, entry);
-  }
-}
-
-static void id_sub_closed_update_lru(struct list2_b_item *entry)
-{
-  if (id_sub_closed_cache_lru.tail != entry)
-  {
-    // Remove and add back at tail
-    list2_b_remove_item(&id_sub_closed_cache_lru, entry);
-    list2_b_add_item(&id_sub_closed_cache_lru, entry);
-  }
+  xlb_id_set_free(&id_closed_cache);
+  xlb_key_set_free(&id_sub_closed_cache);
 }
 
 // Return true if closed
 static bool id_closed_cache_check(adlb_datum_id id)
 {
-
-  struct list2_b_item *entry;
-  if (table_lp_search(&id_closed_cache, id, (void**)&entry))
-  {
-    // Was closed, just need to update LRU
-    id_closed_update_lru(entry);
-    return true;
-  }
-  else
-  {
-    return false;
-  }
+  return xlb_id_set_contains(&id_closed_cache, id);
 }
 
 // Return true if closed
 static bool id_sub_closed_cache_check(const void *key, size_t key_len)
 {
-  struct list2_b_item *entry;
-
-  if (table_bp_search(&id_sub_closed_cache, key, key_len, (void**)&entry))
-  {
-    // Was closed, just need to update LRU
-    id_sub_closed_update_lru(entry);
-    return true;
-  }
-  else
-  {
-    return false;
-  }
+  return xlb_key_set_contains(&id_sub_closed_cache, key, key_len);
 }
 
 // Add that it was closed to cache
 static xlb_engine_code id_closed_cache_add(adlb_datum_id id)
 {
-  if (id_closed_cache.size >= id_closed_cache_size)
-  {
-    // Evict an entry
-    struct list2_b_item *victim = list2_b_pop_item(&id_closed_cache_lru);
-    id_closed_cache_entry *victim_entry = (id_closed_cache_entry*)
-                                          victim->data;
-    void *tmp;
-    bool removed = table_lp_remove(&id_closed_cache, victim_entry->id,
-                                   &tmp);
-    assert(removed && tmp == victim); // Should have had entry
-    free(victim);
-  }
-
-  id_closed_cache_entry *entry;
-  struct list2_b_item *node = list2_b_item_alloc(sizeof(*entry));
-  entry = (id_closed_cache_entry*)&node->data;
-  entry->id = id;
-  
-  list2_b_add_item(&id_closed_cache_lru, node);
-
-  bool ok = table_lp_add(&id_closed_cache, id, node);
-  if (!ok)
-    return XLB_ENGINE_ERROR_OOM;
-
+  xlb_id_set_add(&id_closed_cache, id);
   return XLB_ENGINE_SUCCESS;
 }
 
 static xlb_engine_code
 id_sub_closed_cache_add(const void *key, size_t key_len)
 {
-  if (id_sub_closed_cache.size >= id_sub_closed_cache_size)
-  {
-    // Evict an entry
-    struct list2_b_item *victim =
-                      list2_b_pop_item(&id_sub_closed_cache_lru);
-    id_sub_closed_cache_entry *victim_entry =
-                        (id_sub_closed_cache_entry*)victim->data;
-
-    void *tmp;
-    bool removed = table_bp_remove(&id_sub_closed_cache,
-        victim_entry->key, victim_entry->key_len, &tmp);
-    assert(removed && tmp == victim); // Should have had entry
-    free(victim);
-  }
-
-  id_sub_closed_cache_entry *entry;
-  size_t entry_size = sizeof(*entry) + key_len;
-  struct list2_b_item *node = list2_b_item_alloc(entry_size);
-  entry = (id_sub_closed_cache_entry*)&node->data;
-  memcpy(entry->key, key, key_len);
-  entry->key_len = key_len;
-  
-  list2_b_add_item(&id_sub_closed_cache_lru, node);
-
-  bool ok = table_bp_add(&id_sub_closed_cache, key, key_len, node);
+  bool ok = xlb_key_set_add(&id_sub_closed_cache, key, key_len);
   if (!ok)
     return XLB_ENGINE_ERROR_OOM;
 
@@ -1388,11 +1490,8 @@ info_waiting()
   // TODO: pass waiting tasks to higher-level handling code
   printf("WAITING WORK: %i\n", transforms_waiting.size);
   char buffer[1024];
-  struct list2_item *item = transforms_waiting.head;
-  while (item != NULL)
+  for (transform *t = transforms_waiting.head; t != NULL; t = t->next)
   {
-    transform* t = item->data;
-    assert(t != NULL);
     char id_string[24];
     assert(t->work != NULL);
     sprintf(id_string, "{%"PRId64"}", t->work->id);
@@ -1400,15 +1499,10 @@ info_waiting()
     transform_tostring(buffer+c, t);
     printf("\t%s\n", buffer);
     DEBUG("Payload: %.*s", t->work->length, t->work->payload);
-
-    item = item->next;
   }
 }
 
-// Callbacks to free data
 static void free_transforms_waiting(void);
-static void tbl_free_blockers_cb(adlb_datum_id key, void *L);
-static void tbl_free_sub_blockers_cb(const void *key, size_t key_len, void *L);
 
 void xlb_engine_finalize(void)
 {
@@ -1421,8 +1515,9 @@ void xlb_engine_finalize(void)
 
   // Now we're done reporting, free everything
   free_transforms_waiting();
-  table_lp_free_callback(&id_blockers, false, tbl_free_blockers_cb);
-  table_bp_free_callback(&id_sub_blockers, false, tbl_free_sub_blockers_cb);
+  // Blocker list entries were freed with their transforms
+  table_lp_free_callback(&id_blockers, false, NULL);
+  table_bp_free_callback(&id_sub_blockers, false, NULL);
 
   // Entries in id_subscribed and id_sub_subscribed are not pointers and don't
   // need to be freed
@@ -1430,28 +1525,18 @@ void xlb_engine_finalize(void)
   table_bp_free_callback(&id_sub_subscribed, false, NULL);
 
   finalize_closed_caches();
+  finalize_subscribe_batches();
 }
 
 static void free_transforms_waiting(void)
 {
-  struct list2_item *item = transforms_waiting.head;
-  struct list2_item *next;
-  while (item != NULL)
+  transform *T = transforms_waiting.head;
+  while (T != NULL)
   {
-    transform *T = item->data; 
-    next = item->next;
+    transform *next = T->next;
     transform_free(T);
-    free(item);
-    item = next;
+    T = next;
   }
-}
-
-static void tbl_free_blockers_cb(adlb_datum_id key, void *L)
-{
-  list_free((struct list*)L);
-}
-
-static void tbl_free_sub_blockers_cb(const void *key, size_t key_len, void *L)
-{
-  list_free((struct list*)L);
+  transforms_waiting.head = NULL;
+  transforms_waiting.size = 0;
 }
@@ -90,9 +90,15 @@ static adlb_code handle_retrieve(int caller);
 static adlb_code handle_enumerate(int caller);
 static adlb_code handle_subscribe(int caller);
 static adlb_code handle_notify(int caller);
+static adlb_code handle_notify_forward(int caller);
 static adlb_code handle_get_refcounts(int caller);
 static adlb_code handle_refcount_incr(int caller);
+static adlb_code handle_refcount_incr_batch(int caller);
+static adlb_code send_incr_resp(int caller, adlb_data_code dc,
+                                adlb_notif_t *notifs);
 static adlb_code handle_insert_atomic(int caller);
+static adlb_code handle_atomic(int caller);
+static adlb_code handle_reduce(int caller);
 static adlb_code handle_unique(int caller);
 static adlb_code handle_typeof(int caller);
 static adlb_code handle_container_typeof(int caller);
@@ -185,9 +191,14 @@ xlb_handlers_init(void)
   register_handler(ADLB_TAG_ENUMERATE, handle_enumerate);
   register_handler(ADLB_TAG_SUBSCRIBE, handle_subscribe);
   register_handler(ADLB_TAG_NOTIFY, handle_notify);
+  register_handler(ADLB_TAG_NOTIFY_FORWARD, handle_notify_forward);
   register_handler(ADLB_TAG_GET_REFCOUNTS, handle_get_refcounts);
   register_handler(ADLB_TAG_REFCOUNT_INCR, handle_refcount_incr);
+  register_handler(ADLB_TAG_REFCOUNT_INCR_BATCH,
+                   handle_refcount_incr_batch);
   register_handler(ADLB_TAG_INSERT_ATOMIC, handle_insert_atomic);
+  register_handler(ADLB_TAG_ATOMIC, handle_atomic);
+  register_handler(ADLB_TAG_REDUCE, handle_reduce);
   register_handler(ADLB_TAG_UNIQUE, handle_unique);
   register_handler(ADLB_TAG_TYPEOF, handle_typeof);
   register_handler(ADLB_TAG_CONTAINER_TYPEOF, handle_container_typeof);
@@ -211,6 +222,10 @@ register_handler(adlb_tag tag, xlb_handler h)
   xlb_handler_counters[tag] = 0;
 }
 
+/** Untargeted data-dependent tasks placed here by workers of other
+    servers */
+static int64_t dputs_placed = 0;
+
 void xlb_print_handler_counters(void)
 {
   if (!xlb_s.perfc_enabled)
@@ -218,6 +233,8 @@ void xlb_print_handler_counters(void)
     return;
   }
 
+  PRINT_COUNTER("DPUT_PLACED=%"PRId64"\n", dputs_placed);
+
   for (int tag = 0; tag < XLB_MAX_HANDLERS; tag++)
   {
     if (xlb_handlers[tag] != NULL)
@@ -398,6 +415,11 @@ handle_dput(int caller)
   // Update performance counters
   xlb_task_data_count(p->type, p->target >= 0, p->opts.parallelism > 1,
                       !ready);
+  if (xlb_s.perfc_enabled && p->target < 0 &&
+      xlb_map_to_server(&xlb_s.layout, caller) != xlb_s.layout.rank)
+  {
+    dputs_placed++;
+  }
 
   MPE_LOG(xlb_mpe_svr_dput_end);
   return ADLB_SUCCESS;
@@ -1296,24 +1318,32 @@ static adlb_code
 handle_enumerate(int caller)
 {
   TRACE("ENUMERATE\n");
-  struct packed_enumerate opts;
+  // Receive into stack buffer: xfer buffer is used for output
+  char req_buf[sizeof(struct packed_enumerate) + ADLB_DATA_SUBSCRIPT_MAX];
+  struct packed_enumerate *opts = (struct packed_enumerate*)req_buf;
   adlb_code rc;
   MPI_Status status;
-  RECV(&opts, sizeof(struct packed_enumerate), MPI_BYTE, caller,
+  RECV(req_buf, (int)sizeof(req_buf), MPI_BYTE, caller,
        ADLB_TAG_ENUMERATE);
 
+  adlb_enum_filter filter = { .type = opts->filter_type,
+      .lo = opts->lo, .hi = opts->hi, .prefix = opts->prefix,
+      .prefix_len = (size_t)opts->prefix_len, .sorted = opts->sorted };
+
   adlb_buffer data = { .data = NULL, .length = 0 };
   struct packed_enumerate_result res;
   adlb_data_code dc;
-  dc = xlb_data_enumerate(opts.id, opts.count, opts.offset,
-                           opts.request_subscripts, opts.request_members,
+  res.cursor = opts->cursor;
+  dc = xlb_data_enumerate(opts->id, opts->count, opts->offset,
+                           opts->request_subscripts, opts->request_members,
+                           opts->use_cursor ? &res.cursor : NULL, &filter,
                            &xlb_xfer_buf, &data, &res.records,
                            &res.key_type, &res.val_type);
   bool free_data = (dc == ADLB_DATA_SUCCESS &&
                     xlb_xfer_buf.data != data.data);
   if (dc == ADLB_DATA_SUCCESS)
   {
-    rc = refcount_decr_helper(opts.id, opts.decr);
+    rc = refcount_decr_helper(opts->id, opts->decr);
     ADLB_CHECK(rc);
   }
 
@@ -1324,7 +1354,7 @@ handle_enumerate(int caller)
   RSEND(&res, sizeof(res), MPI_BYTE, caller, ADLB_TAG_RESPONSE);
   if (dc == ADLB_DATA_SUCCESS)
   {
-    if (opts.request_subscripts || opts.request_members)
+    if (opts->request_subscripts || opts->request_members)
     {
       rc = mpi_send_big(data.data, data.length,
                         caller, ADLB_TAG_RESPONSE);
@@ -1349,8 +1379,10 @@ handle_subscribe(int caller)
   adlb_datum_id id;
   adlb_subscript subscript;
   int work_type;
+  bool with_value;
   const char *xfer_pos = xlb_xfer;
   MSG_UNPACK_BIN(xfer_pos, &work_type);
+  MSG_UNPACK_BIN(xfer_pos, &with_value);
   xlb_unpack_id_sub(xfer_pos, &id, &subscript);
 
 
@@ -1365,7 +1397,7 @@ handle_subscribe(int caller)
   }
   struct pack_sub_resp resp;
   resp.dc = xlb_data_subscribe(id, subscript, caller, work_type,
-                              &resp.subscribed);
+                              with_value, &resp.subscribed);
   if (resp.dc != ADLB_DATA_SUCCESS)
     resp.subscribed = false;
   RSEND(&resp, sizeof(resp), MPI_BYTE, caller, ADLB_TAG_RESPONSE);
@@ -1409,6 +1441,32 @@ handle_notify(int caller)
   return ADLB_SUCCESS;
 }
 
+/*
+  Notifications for workers of this server, forwarded by a worker
+ */
+static adlb_code
+handle_notify_forward(int caller)
+{
+  TRACE("ADLB_TAG_NOTIFY_FORWARD\n");
+
+  MPI_Status status;
+  struct packed_notif_forward hdr;
+  RECV(&hdr, sizeof(hdr), MPI_BYTE, caller, ADLB_TAG_NOTIFY_FORWARD);
+
+  void *records = malloc((size_t)hdr.length);
+  ADLB_MALLOC_CHECK(records);
+  RECV(records, hdr.length, MPI_BYTE, caller, ADLB_TAG_WORK);
+
+  DEBUG("%i notifications forwarded by %i", hdr.count, caller);
+  adlb_code rc = xlb_deliver_forwarded_notifs(records, hdr.length,
+                                              hdr.count);
+  free(records);
+
+  int resp = (rc == ADLB_SUCCESS) ? ADLB_SUCCESS : ADLB_ERROR;
+  RSEND(&resp, 1, MPI_INT, caller, ADLB_TAG_RESPONSE);
+  return ADLB_SUCCESS;
+}
+
 static adlb_code
 handle_get_refcounts(int caller)
 {
@@ -1458,6 +1516,56 @@ handle_refcount_incr(int caller)
 
   DEBUG("data_reference_count => %i", dc);
 
+  rc = send_incr_resp(caller, dc, &notifs);
+  ADLB_CHECK(rc);
+
+  return ADLB_SUCCESS;
+}
+
+/*
+  Apply a batch of reference count changes accumulated by a client
+ */
+static adlb_code
+handle_refcount_incr_batch(int caller)
+{
+  adlb_code rc;
+  MPI_Status status;
+  struct packed_incr_batch hdr;
+  RECV(&hdr, sizeof(hdr), MPI_BYTE, caller, ADLB_TAG_REFCOUNT_INCR_BATCH);
+
+  struct packed_incr *changes = malloc(sizeof(changes[0]) *
+                                       (size_t)hdr.count);
+  ADLB_MALLOC_CHECK(changes);
+  RECV(changes, (int)sizeof(changes[0]) * hdr.count, MPI_BYTE, caller,
+       ADLB_TAG_WORK);
+
+  DEBUG("Refcount_incr batch: %i changes from %i", hdr.count, caller);
+
+  adlb_notif_t notifs = ADLB_NO_NOTIFS;
+  adlb_data_code dc = ADLB_DATA_SUCCESS;
+  for (int i = 0; i < hdr.count && dc == ADLB_DATA_SUCCESS; i++)
+  {
+    dc = xlb_incr_refc_svr(changes[i].id, changes[i].change, &notifs);
+  }
+  free(changes);
+
+  // Shouldn't set any references based on this
+  assert(notifs.references.count == 0);
+
+  rc = send_incr_resp(caller, dc, &notifs);
+  ADLB_CHECK(rc);
+
+  return ADLB_SUCCESS;
+}
+
+/*
+  Send response to reference count change, followed by any
+  notifications for the client to process.  Frees notifs.
+ */
+static adlb_code
+send_incr_resp(int caller, adlb_data_code dc, adlb_notif_t *notifs)
+{
+  adlb_code rc;
   struct packed_incr_resp resp = {
       .success = (dc == ADLB_DATA_SUCCESS)};
 
@@ -1470,7 +1578,7 @@ handle_refcount_incr(int caller)
     xlb_prepared_notifs prep;
     bool send_notifs;
 
-    rc = xlb_prepare_notif_work(&notifs, &xlb_xfer_buf, &resp.notifs,
+    rc = xlb_prepare_notif_work(notifs, &xlb_xfer_buf, &resp.notifs,
                                 &prep, &send_notifs);
     ADLB_CHECK(rc);
 
@@ -1478,12 +1586,12 @@ handle_refcount_incr(int caller)
 
     if (send_notifs)
     {
-      rc = xlb_send_notif_work(caller, &notifs, &resp.notifs, &prep);
+      rc = xlb_send_notif_work(caller, notifs, &resp.notifs, &prep);
       ADLB_CHECK(rc)
     }
   }
 
-  xlb_free_notif(&notifs);
+  xlb_free_notif(notifs);
 
   return ADLB_SUCCESS;
 }
@@ -1587,6 +1695,90 @@ handle_insert_atomic(int caller)
   return ADLB_SUCCESS;
 }
 
+static adlb_code
+handle_atomic(int caller)
+{
+  adlb_code rc;
+  MPI_Status status;
+  struct packed_atomic msg;
+  RECV(&msg, sizeof(msg), MPI_BYTE, caller, ADLB_TAG_ATOMIC);
+
+  adlb_notif_t notifs = ADLB_NO_NOTIFS;
+  struct packed_atomic_resp resp;
+  // Error responses are sent without notification counts or values
+  memset(&resp, 0, sizeof(resp));
+  resp.dc = xlb_data_atomic(msg.id, msg.op, msg.type, &msg.operand,
+                &msg.compare, msg.refcount_decr, &resp.old_value,
+                &resp.old_set, &resp.updated, &notifs);
+
+  DEBUG("Atomic: "ADLB_PRID" op %i => %i",
+        ADLB_PRID_ARGS(msg.id, ADLB_DSYM_NULL), msg.op, resp.dc);
+
+  if (resp.dc != ADLB_DATA_SUCCESS)
+  {
+    RSEND(&resp, sizeof(resp), MPI_BYTE, caller, ADLB_TAG_RESPONSE);
+  }
+  else
+  {
+    xlb_prepared_notifs prep;
+    bool send_notifs;
+
+    rc = xlb_prepare_notif_work(&notifs, &xlb_xfer_buf, &resp.notifs,
+                                &prep, &send_notifs);
+    ADLB_CHECK(rc);
+
+    RSEND(&resp, sizeof(resp), MPI_BYTE, caller, ADLB_TAG_RESPONSE);
+
+    if (send_notifs)
+    {
+      rc = xlb_send_notif_work(caller, &notifs, &resp.notifs, &prep);
+      ADLB_CHECK(rc);
+    }
+  }
+
+  xlb_free_notif(&notifs);
+  return ADLB_SUCCESS;
+}
+
+static adlb_code
+handle_reduce(int caller)
+{
+  adlb_code rc;
+  MPI_Status status;
+  struct packed_reduce msg;
+  RECV(&msg, sizeof(msg), MPI_BYTE, caller, ADLB_TAG_REDUCE);
+
+  DEBUG("Reduce: "ADLB_PRID" op %i",
+        ADLB_PRID_ARGS(msg.id, ADLB_DSYM_NULL), msg.spec.op);
+
+  struct packed_reduce_resp resp;
+  memset(&resp.result, 0, sizeof(resp.result));
+  if (msg.on_close)
+  {
+    adlb_notif_t notifs = ADLB_NO_NOTIFS;
+    resp.dc = xlb_data_reduce_on_close(msg.id, &msg.spec, msg.result_id,
+                                       msg.write_decr, &notifs);
+    if (resp.dc == ADLB_DATA_SUCCESS)
+    {
+      rc = notify_helper(&notifs);
+      ADLB_CHECK(rc);
+    }
+  }
+  else
+  {
+    resp.dc = xlb_data_reduce(msg.id, &msg.spec, &resp.result);
+  }
+
+  if (resp.dc == ADLB_DATA_SUCCESS)
+  {
+    rc = refcount_decr_helper(msg.id, msg.decr);
+    ADLB_CHECK(rc);
+  }
+
+  RSEND(&resp, sizeof(resp), MPI_BYTE, caller, ADLB_TAG_RESPONSE);
+  return ADLB_SUCCESS;
+}
+
 static adlb_code
 handle_unique(int caller)
 {
@@ -1753,20 +1945,29 @@ handle_container_size(int caller)
 static adlb_code
 handle_lock(int caller)
 {
-  adlb_datum_id id;
+  struct packed_lock msg;
   MPI_Status status;
-  RECV(&id, 1, MPI_ADLB_ID, caller, ADLB_TAG_LOCK);
+  RECV(&msg, sizeof(msg), MPI_BYTE, caller, ADLB_TAG_LOCK);
 
   DEBUG("Lock: "ADLB_PRID" by rank: %i",
-        ADLB_PRID_ARGS(id, ADLB_DSYM_NULL), caller);
+        ADLB_PRID_ARGS(msg.id, ADLB_DSYM_NULL), caller);
+
+  // A zero timeout is the same as not waiting
+  bool wait = msg.wait && msg.timeout != 0.0;
+  double deadline = (wait && msg.timeout > 0.0) ?
+                    MPI_Wtime() + msg.timeout : -1.0;
 
   bool result;
-  adlb_data_code dc = xlb_data_lock(id, caller, &result);
+  adlb_data_code dc = xlb_data_lock(msg.id, caller, wait, deadline,
+                                    &result);
   char c;
   if (dc == ADLB_DATA_SUCCESS)
   {
     if (result)
       c = '1';
+    else if (wait)
+      // Reply deferred until lock is granted or wait times out
+      return ADLB_SUCCESS;
     else
       c = '0';
   }
@@ -1786,10 +1987,35 @@ handle_unlock(int caller)
   DEBUG("Unlock: "ADLB_PRID" by rank: %i ",
         ADLB_PRID_ARGS(id, ADLB_DSYM_NULL), caller);
 
-  adlb_data_code dc = xlb_data_unlock(id);
+  int granted;
+  adlb_data_code dc = xlb_data_unlock(id, &granted);
 
   char c = (dc == ADLB_DATA_SUCCESS) ? '1' : 'x';
   RSEND(&c, 1, MPI_CHAR, caller, ADLB_TAG_RESPONSE);
+
+  if (dc == ADLB_DATA_SUCCESS && granted >= 0)
+  {
+    // Reply to waiting lock request
+    DEBUG("Lock: "ADLB_PRID" granted to rank: %i",
+          ADLB_PRID_ARGS(id, ADLB_DSYM_NULL), granted);
+    c = '1';
+    RSEND(&c, 1, MPI_CHAR, granted, ADLB_TAG_RESPONSE);
+  }
+  return ADLB_SUCCESS;
+}
+
+adlb_code
+xlb_check_lock_timeouts(void)
+{
+  adlb_datum_id id;
+  int rank;
+  while (xlb_data_lock_expire(xlb_approx_time(), &id, &rank))
+  {
+    DEBUG("Lock: "ADLB_PRID" wait by rank %i timed out",
+          ADLB_PRID_ARGS(id, ADLB_DSYM_NULL), rank);
+    char c = '0';
+    RSEND(&c, 1, MPI_CHAR, rank, ADLB_TAG_RESPONSE);
+  }
   return ADLB_SUCCESS;
 }
 
@@ -57,6 +57,11 @@ void xlb_print_handler_counters(void);
 
 adlb_code xlb_recheck_queues(bool single, bool parallel);
 
+/**
+   Reply to lock waits that have timed out
+ */
+adlb_code xlb_check_lock_timeouts(void);
+
 /*
   Inlined functions (performance-critical to server loop)
  */
@@ -0,0 +1,295 @@
+/*
+ * Copyright 2014 University of Chicago and Argonne National Laboratory
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License
+ */
+
+/*
+ * incr_table.c
+ *
+ * Implementation notes:
+ * We grow at 3/4 load, but create the underlying tables with load
+ * factor XLB_INCR_TABLE_HARD_LOAD so that they never resize themselves
+ * while we are still migrating: migrating XLB_INCR_TABLE_MIGRATE_BUCKETS
+ * buckets per add means the old table is empty after capacity/8 adds,
+ * by which point the new table is well under 3/4 full.
+ *
+ * A bucket is migrated by repeatedly moving the entry at its head:
+ * the entry is added to the new table first, which copies the key,
+ * then removed from the old one.
+ */
+
+#include <assert.h>
+
+#include "incr_table.h"
+
+/** Load factor at which underlying tables would rehash themselves */
+#define XLB_INCR_TABLE_HARD_LOAD 2.0
+
+static inline bool
+needs_growth(int size, int capacity)
+{
+  return size >= capacity - capacity / 4;
+}
+
+static void lp_migrate(xlb_incr_lp *t, int buckets);
+static void bp_migrate(xlb_incr_bp *t, int buckets);
+
+bool
+xlb_incr_lp_init(xlb_incr_lp *t, int capacity)
+{
+  t->migrating = false;
+  t->migrate_pos = 0;
+  t->resizes = 0;
+  t->migrated = 0;
+  return table_lp_init_custom(&t->cur, capacity, XLB_INCR_TABLE_HARD_LOAD);
+}
+
+/**
+   Start migrating to a larger table if needed
+ */
+static void
+lp_grow(xlb_incr_lp *t)
+{
+  if (!needs_growth(t->cur.size, t->cur.capacity))
+    return;
+
+  if (t->migrating)
+  {
+    // Should not happen: finish up before starting again
+    lp_migrate(t, t->old.capacity);
+  }
+
+  struct table_lp bigger;
+  if (!table_lp_init_custom(&bigger, t->cur.capacity * 2,
+                            XLB_INCR_TABLE_HARD_LOAD))
+  {
+    // Keep going with current table: it can still rehash itself
+    return;
+  }
+
+  t->old = t->cur;
+  t->cur = bigger;
+  t->migrating = true;
+  t->migrate_pos = 0;
+  t->resizes++;
+}
+
+static void
+lp_migrate(xlb_incr_lp *t, int buckets)
+{
+  if (!t->migrating)
+    return;
+
+  struct table_lp *old = &t->old;
+  int end = t->migrate_pos + buckets;
+  if (end > old->capacity)
+    end = old->capacity;
+
+  for (; t->migrate_pos < end; t->migrate_pos++)
+  {
+    table_lp_entry *head = &old->array[t->migrate_pos];
+    while (table_lp_entry_valid(head))
+    {
+      int64_t key = head->key;
+      void *data;
+      table_lp_add(&t->cur, key, head->data);
+      bool removed = table_lp_remove(old, key, &data);
+      assert(removed);
+      if (!removed)
+        break;
+      t->migrated++;
+    }
+  }
+
+  if (t->migrate_pos >= old->capacity)
+  {
+    assert(old->size == 0);
+    table_lp_free_callback(old, false, NULL);
+    t->migrating = false;
+  }
+}
+
+bool
+xlb_incr_lp_add(xlb_incr_lp *t, int64_t key, void *data)
+{
+  lp_migrate(t, XLB_INCR_TABLE_MIGRATE_BUCKETS);
+  lp_grow(t);
+  return table_lp_add(&t->cur, key, data);
+}
+
+bool
+xlb_incr_lp_search(const xlb_incr_lp *t, int64_t key, void **data)
+{
+  if (table_lp_search(&t->cur, key, data))
+    return true;
+  return t->migrating && table_lp_search(&t->old, key, data);
+}
+
+bool
+xlb_incr_lp_contains(const xlb_incr_lp *t, int64_t key)
+{
+  void *tmp;
+  return xlb_incr_lp_search(t, key, &tmp);
+}
+
+bool
+xlb_incr_lp_remove(xlb_incr_lp *t, int64_t key, void **data)
+{
+  bool found = table_lp_remove(&t->cur, key, data) ||
+      (t->migrating && table_lp_remove(&t->old, key, data));
+  lp_migrate(t, XLB_INCR_TABLE_MIGRATE_BUCKETS);
+  return found;
+}
+
+int
+xlb_incr_lp_size(const xlb_incr_lp *t)
+{
+  return t->cur.size + (t->migrating ? t->old.size : 0);
+}
+
+void
+xlb_incr_lp_finish(xlb_incr_lp *t)
+{
+  if (t->migrating)
+    lp_migrate(t, t->old.capacity);
+}
+
+void
+xlb_incr_lp_free_callback(xlb_incr_lp *t,
+                          void (*callback)(int64_t, void*))
+{
+  xlb_incr_lp_finish(t);
+  table_lp_free_callback(&t->cur, false, callback);
+}
+
+bool
+xlb_incr_bp_init(xlb_incr_bp *t, int capacity)
+{
+  t->migrating = false;
+  t->migrate_pos = 0;
+  t->resizes = 0;
+  t->migrated = 0;
+  return table_bp_init_custom(&t->cur, capacity, XLB_INCR_TABLE_HARD_LOAD);
+}
+
+static void
+bp_grow(xlb_incr_bp *t)
+{
+  if (!needs_growth(t->cur.size, t->cur.capacity))
+    return;
+
+  if (t->migrating)
+  {
+    bp_migrate(t, t->old.capacity);
+  }
+
+  struct table_bp bigger;
+  if (!table_bp_init_custom(&bigger, t->cur.capacity * 2,
+                            XLB_INCR_TABLE_HARD_LOAD))
+  {
+    return;
+  }
+
+  t->old = t->cur;
+  t->cur = bigger;
+  t->migrating = true;
+  t->migrate_pos = 0;
+  t->resizes++;
+}
+
+static void
+bp_migrate(xlb_incr_bp *t, int buckets)
+{
+  if (!t->migrating)
+    return;
+
+  struct table_bp *old = &t->old;
+  int end = t->migrate_pos + buckets;
+  if (end > old->capacity)
+    end = old->capacity;
+
+  for (; t->migrate_pos < end; t->migrate_pos++)
+  {
+    table_bp_entry *head = &old->array[t->migrate_pos];
+    while (table_bp_entry_valid(head))
+    {
+      const void *key = table_bp_get_key(head);
+      size_t key_len = head->key_len;
+      void *data;
+      // Key is copied by add, so still valid for remove
+      table_bp_add(&t->cur, key, key_len, head->data);
+      bool removed = table_bp_remove(old, key, key_len, &data);
+      assert(removed);
+      if (!removed)
+        break;
+      t->migrated++;
+    }
+  }
+
+  if (t->migrate_pos >= old->capacity)
+  {
+    assert(old->size == 0);
+    table_bp_free_callback(old, false, NULL);
+    t->migrating = false;
+  }
+}
+
+bool
+xlb_incr_bp_add(xlb_incr_bp *t, const void *key, size_t key_len,
+                void *data)
+{
+  bp_migrate(t, XLB_INCR_TABLE_MIGRATE_BUCKETS);
+  bp_grow(t);
+  return table_bp_add(&t->cur, key, key_len, data);
+}
+
+bool
+xlb_incr_bp_search(const xlb_incr_bp *t, const void *key,
+                   size_t key_len, void **data)
+{
+  if (table_bp_search(&t->cur, key, key_len, data))
+    return true;
+  return t->migrating && table_bp_search(&t->old, key, key_len, data);
+}
+
+bool
+xlb_incr_bp_remove(xlb_incr_bp *t, const void *key, size_t key_len,
+                   void **data)
+{
+  bool found = table_bp_remove(&t->cur, key, key_len, data) ||
+      (t->migrating && table_bp_remove(&t->old, key, key_len, data));
+  bp_migrate(t, XLB_INCR_TABLE_MIGRATE_BUCKETS);
+  return found;
+}
+
+int
+xlb_incr_bp_size(const xlb_incr_bp *t)
+{
+  return t->cur.size + (t->migrating ? t->old.size : 0);
+}
+
+void
+xlb_incr_bp_finish(xlb_incr_bp *t)
+{
+  if (t->migrating)
+    bp_migrate(t, t->old.capacity);
+}
+
+void
+xlb_incr_bp_free_callback(xlb_incr_bp *t,
+                          void (*callback)(const void*, size_t, void*))
+{
+  xlb_incr_bp_finish(t);
+  table_bp_free_callback(&t->cur, false, callback);
+}
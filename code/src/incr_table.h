@@ -0,0 +1,106 @@
+/*
+ * Copyright 2014 University of Chicago and Argonne National Laboratory
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License
+ */
+
+/*
+ * incr_table.h
+ *
+ * Hash tables that grow incrementally.
+ *
+ * These wrap the c-utils table_lp and table_bp, which rehash every
+ * entry at once when they grow.  Once a table reaches its load
+ * factor, a table of twice the capacity is allocated, and later adds
+ * and removes each migrate a few buckets from the old table to the
+ * new one.  Until migration finishes, lookups check both tables.
+ * Migration finishes well before the new table fills up, so at most
+ * two tables exist at a time.
+ */
+
+#ifndef INCR_TABLE_H
+#define INCR_TABLE_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include <table_bp.h>
+#include <table_lp.h>
+
+/** Buckets of old table migrated per add or remove */
+#define XLB_INCR_TABLE_MIGRATE_BUCKETS 8
+
+typedef struct
+{
+  /** Table that new entries are added to */
+  struct table_lp cur;
+  /** Table being migrated, valid if migrating */
+  struct table_lp old;
+  bool migrating;
+  /** Next bucket of old table to migrate */
+  int migrate_pos;
+
+  // Perf counters
+  int64_t resizes;
+  int64_t migrated;
+} xlb_incr_lp;
+
+typedef struct
+{
+  struct table_bp cur;
+  struct table_bp old;
+  bool migrating;
+  int migrate_pos;
+
+  int64_t resizes;
+  int64_t migrated;
+} xlb_incr_bp;
+
+bool xlb_incr_lp_init(xlb_incr_lp *t, int capacity);
+bool xlb_incr_lp_add(xlb_incr_lp *t, int64_t key, void *data);
+bool xlb_incr_lp_search(const xlb_incr_lp *t, int64_t key, void **data);
+bool xlb_incr_lp_contains(const xlb_incr_lp *t, int64_t key);
+bool xlb_incr_lp_remove(xlb_incr_lp *t, int64_t key, void **data);
+int xlb_incr_lp_size(const xlb_incr_lp *t);
+
+/**
+   Complete any migration in progress.  Afterwards all entries are
+   in t->cur, which can be iterated with TABLE_LP_FOREACH.
+ */
+void xlb_incr_lp_finish(xlb_incr_lp *t);
+
+/**
+   Free all entries, calling callback on each if not NULL
+ */
+void xlb_incr_lp_free_callback(xlb_incr_lp *t,
+                               void (*callback)(int64_t, void*));
+
+bool xlb_incr_bp_init(xlb_incr_bp *t, int capacity);
+bool xlb_incr_bp_add(xlb_incr_bp *t, const void *key, size_t key_len,
+                     void *data);
+bool xlb_incr_bp_search(const xlb_incr_bp *t, const void *key,
+                        size_t key_len, void **data);
+bool xlb_incr_bp_remove(xlb_incr_bp *t, const void *key, size_t key_len,
+                        void **data);
+int xlb_incr_bp_size(const xlb_incr_bp *t);
+
+/**
+   Complete any migration in progress.  Afterwards all entries are
+   in t->cur, which can be iterated with TABLE_BP_FOREACH.
+ */
+void xlb_incr_bp_finish(xlb_incr_bp *t);
+
+void xlb_incr_bp_free_callback(xlb_incr_bp *t,
+                       void (*callback)(const void*, size_t, void*));
+
+#endif // INCR_TABLE_H
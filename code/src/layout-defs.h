@@ -70,6 +70,15 @@ typedef struct {
      Workers are in ascending order.
    */
   struct dyn_array_i *my_host2workers;
+
+  /** Number of other servers on the same host as this server */
+  int my_host_servers;
+
+  /**
+     Ranks of other servers on the same host as this server, in
+     ascending order.  Used to prefer on-node steal victims.
+   */
+  int *my_host_server_ranks;
 } xlb_layout;
 
 #endif // __LAYOUT_DEFS_H
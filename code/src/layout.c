@@ -16,6 +16,8 @@
 
 #include "layout.h"
 
+#include <string.h>
+
 #include <table.h>
 
 #include "checks.h"
@@ -32,6 +34,10 @@ static adlb_code
 build_host2workers(const xlb_layout *layout, int worker_count,
       int host_count, const int *worker2host,
       struct dyn_array_i **host2workers);
+static adlb_code
+build_host_servers(const struct xlb_hostnames *hostnames,
+      const xlb_layout *layout, int **host_server_ranks,
+      int *host_servers);
 
 
 adlb_code
@@ -75,6 +81,10 @@ xlb_layout_init(int comm_size, int comm_rank, int nservers,
                   layout->my_worker_hosts, layout->my_worker2host,
                   &layout->my_host2workers);
     ADLB_CHECK(ac);
+
+    ac = build_host_servers(hostnames, layout,
+                  &layout->my_host_server_ranks, &layout->my_host_servers);
+    ADLB_CHECK(ac);
   }
   else
   {
@@ -82,6 +92,8 @@ xlb_layout_init(int comm_size, int comm_rank, int nservers,
     layout->my_worker_hosts = 0;
     layout->my_worker2host = NULL;
     layout->my_host2workers = NULL;
+    layout->my_host_servers = 0;
+    layout->my_host_server_ranks = NULL;
   }
 
   return ADLB_SUCCESS;
@@ -104,6 +116,13 @@ xlb_layout_finalize(xlb_layout *layout)
     free(layout->my_host2workers);
     layout->my_host2workers = NULL;
   }
+
+  if (layout->my_host_server_ranks != NULL)
+  {
+    free(layout->my_host_server_ranks);
+    layout->my_host_server_ranks = NULL;
+  }
+  layout->my_host_servers = 0;
 }
 
 static int
@@ -185,3 +204,41 @@ build_host2workers(const xlb_layout *layout, int worker_count,
 
   return ADLB_SUCCESS;
 }
+
+static adlb_code
+build_host_servers(const struct xlb_hostnames *hostnames,
+      const xlb_layout *layout, int **host_server_ranks,
+      int *host_servers)
+{
+  const char *my_host = xlb_hostnames_lookup(hostnames, layout->rank);
+  CHECK_MSG(my_host != NULL, "Unexpected error looking up host for "
+            "rank %i", layout->rank);
+
+  *host_servers = 0;
+  *host_server_ranks = NULL;
+  if (layout->servers <= 1)
+  {
+    return ADLB_SUCCESS;
+  }
+
+  *host_server_ranks = malloc(sizeof((*host_server_ranks)[0]) *
+                              (size_t)(layout->servers - 1));
+  ADLB_MALLOC_CHECK(*host_server_ranks);
+
+  for (int rank = layout->master_server_rank; rank < layout->size; rank++)
+  {
+    if (rank == layout->rank)
+      continue;
+
+    const char *host_name = xlb_hostnames_lookup(hostnames, rank);
+    CHECK_MSG(host_name != NULL, "Unexpected error looking up host for "
+              "rank %i", rank);
+    if (strcmp(host_name, my_host) == 0)
+    {
+      (*host_server_ranks)[(*host_servers)++] = rank;
+      DEBUG("host_servers: server %i shares host %s", rank, my_host);
+    }
+  }
+
+  return ADLB_SUCCESS;
+}
@@ -86,10 +86,14 @@ add_tags()
   add_tag(ADLB_TAG_ENUMERATE);
   add_tag(ADLB_TAG_SUBSCRIBE);
   add_tag(ADLB_TAG_NOTIFY);
+  add_tag(ADLB_TAG_NOTIFY_FORWARD);
   add_tag(ADLB_TAG_PERMANENT);
   add_tag(ADLB_TAG_GET_REFCOUNTS);
   add_tag(ADLB_TAG_REFCOUNT_INCR);
+  add_tag(ADLB_TAG_REFCOUNT_INCR_BATCH);
   add_tag(ADLB_TAG_INSERT_ATOMIC);
+  add_tag(ADLB_TAG_ATOMIC);
+  add_tag(ADLB_TAG_REDUCE);
   add_tag(ADLB_TAG_UNIQUE);
   add_tag(ADLB_TAG_TYPEOF);
   add_tag(ADLB_TAG_CONTAINER_TYPEOF);
@@ -308,9 +308,18 @@ struct packed_enumerate
   adlb_datum_id id;
   char request_subscripts;
   char request_members;
+  char use_cursor; // If true, start at cursor instead of offset
   int count;
   int offset;
+  adlb_enum_cursor cursor;
   adlb_refc decr;
+  // Filter, with prefix bytes following struct
+  adlb_enum_filter_type filter_type;
+  bool sorted;
+  int64_t lo;
+  int64_t hi;
+  int prefix_len;
+  char prefix[];
 };
 
 struct packed_enumerate_result
@@ -320,6 +329,7 @@ struct packed_enumerate_result
   size_t length; // length of data in bytes
   adlb_data_type key_type;
   adlb_data_type val_type;
+  adlb_enum_cursor cursor; // Position after records, if use_cursor
 };
 
 struct packed_notif
@@ -327,6 +337,8 @@ struct packed_notif
   adlb_datum_id id;
   int subscript_data; // index of extra data item, -1 for no subscript
   int rank; // Rank to notify
+  int work_type;
+  int val_data; // index of extra data item, -1 for no value
 };
 
 struct packed_reference
@@ -352,6 +364,16 @@ struct packed_refcounts_resp {
   adlb_refc refcounts;
 };
 
+/**
+   Lock request
+ */
+struct packed_lock
+{
+  adlb_datum_id id;
+  bool wait; // If locked, wait in queue instead of failing
+  double timeout; // Seconds to wait if >= 0
+};
+
 /**
    Count increment or decrement
  */
@@ -370,6 +392,16 @@ struct packed_incr_resp
   struct packed_notif_counts notifs;
 };
 
+/**
+   Header for batch of count changes, all for data on the receiving
+   server.  Followed by count struct packed_incr records sent with
+   ADLB_TAG_WORK.  Response is struct packed_incr_resp.
+ */
+struct packed_incr_batch
+{
+  int count;
+};
+
 /**
  * Header for store message
  */
@@ -415,6 +447,41 @@ struct packed_insert_atomic_resp
   adlb_data_type value_type;
 };
 
+struct packed_atomic
+{
+  adlb_datum_id id;
+  adlb_atomic_op op;
+  adlb_data_type type;
+  adlb_atomic_value operand;
+  adlb_atomic_value compare;
+  adlb_refc refcount_decr;
+};
+
+struct packed_atomic_resp
+{
+  struct packed_notif_counts notifs;
+  adlb_data_code dc;
+  adlb_atomic_value old_value;
+  bool old_set;
+  bool updated;
+};
+
+struct packed_reduce
+{
+  adlb_datum_id id;
+  adlb_reduce_spec spec;
+  adlb_refc decr; // Refcounts to release after reducing
+  bool on_close; // If true, store result when closed instead
+  adlb_datum_id result_id;
+  int write_decr; // Write refcount to release on result_id
+};
+
+struct packed_reduce_resp
+{
+  adlb_data_code dc;
+  adlb_reduce_result result;
+};
+
 struct pack_sub_resp
 {
   adlb_data_code dc; // Error code
@@ -511,6 +578,40 @@ struct packed_subscribe_sync
   size_t subscript_len;
 };
 
+/**
+ Header for batch of subscribes.  Entries packed with
+ xlb_pack_id_sub() are sent separately with ADLB_TAG_SYNC_SUB.
+ */
+struct packed_subscribe_batch
+{
+  int count; // Number of entries
+  int length; // Bytes of packed entries
+};
+
+/**
+ Header for notifications forwarded to the server of the target
+ workers.  Sent with ADLB_TAG_NOTIFY_FORWARD from workers, or as sync
+ from servers, followed by the packed records.
+ */
+struct packed_notif_forward
+{
+  int count; // Number of records
+  int length; // Bytes of packed records
+};
+
+/**
+ Forwarded notification record, followed by subscript_len bytes of
+ subscript and value_len bytes of value.  Records are not aligned.
+ */
+struct packed_notif_fwd
+{
+  adlb_datum_id id;
+  int rank; // Worker to notify
+  int work_type;
+  int subscript_len;
+  int value_len; // -1 if no value
+};
+
 /**
  Sync can contain various types of control messages.
  These should be registered in sync.c for human-readable perf counters
@@ -525,6 +626,10 @@ typedef enum
   ADLB_SYNC_SUBSCRIBE, // Subscribe to a datum
   ADLB_SYNC_NOTIFY, // Notify after subscription to a datum
   ADLB_SYNC_SHUTDOWN, // Shutdown server
+  ADLB_SYNC_PUSH, // Offload work to underloaded server
+  ADLB_SYNC_CREDIT, // Return buffered sync credits only
+  ADLB_SYNC_SUBSCRIBE_BATCH, // Subscribe to multiple data
+  ADLB_SYNC_NOTIFY_FORWARD, // Notify workers of target server
 
   ADLB_SYNC_ENUM_COUNT, // Dummy value: count of enum types
 } adlb_sync_mode;
@@ -532,11 +637,17 @@ typedef enum
 struct packed_sync
 {
   adlb_sync_mode mode;
+  /* Sender's time when sent, used to order piggybacked load info */
+  double load_time;
+  /* Buffered sync credits returned to receiver, cf. sync.h */
+  int credits;
   union
   {
     struct packed_incr incr;   // if refcount increment
-    struct packed_steal steal; // if steal
+    struct packed_steal steal; // if steal or push
     struct packed_subscribe_sync subscribe; // if subscribe or notify
+    struct packed_subscribe_batch subscribe_batch;
+    struct packed_notif_forward notif_forward;
   };
   /* Extra data depending on sync type.  Same size used by all servers to
      allow for fixed-size buffers to be used */
@@ -546,7 +657,17 @@ struct packed_sync
 #define SYNC_DATA_SIZE \
   (WORK_TYPES_SIZE > PACKED_SUBSCRIBE_INLINE_BYTES ? \
    WORK_TYPES_SIZE : PACKED_SUBSCRIBE_INLINE_BYTES)
-#define PACKED_SYNC_SIZE (sizeof(struct packed_sync) + SYNC_DATA_SIZE)
+/* Sender's work type counts, as int[], are piggybacked on every sync
+   message after the sync data */
+#define SYNC_LOAD_SIZE WORK_TYPES_SIZE
+#define PACKED_SYNC_SIZE \
+  (sizeof(struct packed_sync) + SYNC_DATA_SIZE + SYNC_LOAD_SIZE)
+
+static inline void *
+xlb_sync_load(const struct packed_sync *hdr)
+{
+  return (void*)(hdr->sync_data + SYNC_DATA_SIZE);
+}
 
 /**
    Simple data type transfer
@@ -594,10 +715,14 @@ typedef enum
   ADLB_TAG_ENUMERATE,
   ADLB_TAG_SUBSCRIBE,
   ADLB_TAG_NOTIFY,
+  ADLB_TAG_NOTIFY_FORWARD,
   ADLB_TAG_PERMANENT,
   ADLB_TAG_GET_REFCOUNTS,
   ADLB_TAG_REFCOUNT_INCR,
+  ADLB_TAG_REFCOUNT_INCR_BATCH,
   ADLB_TAG_INSERT_ATOMIC,
+  ADLB_TAG_ATOMIC,
+  ADLB_TAG_REDUCE,
   ADLB_TAG_UNIQUE,
   ADLB_TAG_TYPEOF,
   ADLB_TAG_CONTAINER_TYPEOF,
@@ -1,5 +1,10 @@
 #include "notifications.h"
 
+#include <limits.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
 #include "client_internal.h"
 #include "common.h"
 #include "handlers.h"
@@ -92,6 +97,318 @@ static adlb_code notify_nonlocal(int target, int server,
   return ADLB_SUCCESS;
 }
 
+static int notif_cmp(const void *a, const void *b)
+{
+  const adlb_notif_rank *na = a, *nb = b;
+  if (na->rank != nb->rank)
+    return na->rank < nb->rank ? -1 : 1;
+  if (na->work_type != nb->work_type)
+    return na->work_type < nb->work_type ? -1 : 1;
+  return 0;
+}
+
+/*
+  Group notifications by target rank and work type for batching
+ */
+static void sort_notifs(adlb_notif_ranks *ranks)
+{
+  if (xlb_s.binary_notifs && ranks->count > 1)
+  {
+    qsort(ranks->notifs, (size_t)ranks->count, sizeof(ranks->notifs[0]),
+          notif_cmp);
+  }
+}
+
+// Text notifications cannot carry values
+static inline bool notif_is_binary(const adlb_notif_rank *notif)
+{
+  return xlb_s.binary_notifs || notif->value_len >= 0;
+}
+
+/*
+  Length of run of notifications at start of array that can go in
+  the same task.  Always 1 for text notifications.
+ */
+static int notif_run(const adlb_notif_rank *notifs, int count)
+{
+  if (!notif_is_binary(&notifs[0]))
+    return 1;
+
+  int n = 1;
+  while (n < count && notifs[n].rank == notifs[0].rank &&
+         notifs[n].work_type == notifs[0].work_type &&
+         notif_is_binary(&notifs[n]))
+  {
+    n++;
+  }
+  return n;
+}
+
+// Returns size of binary batch payload
+static size_t notif_batch_size(const adlb_notif_rank *notifs, int count)
+{
+  size_t size = sizeof(adlb_notif_batch_hdr);
+  for (int i = 0; i < count; i++)
+  {
+    size += sizeof(adlb_notif_record);
+    if (adlb_has_sub(notifs[i].subscript))
+      size += notifs[i].subscript.length;
+    if (notifs[i].value_len > 0)
+      size += (size_t)notifs[i].value_len;
+  }
+  return size;
+}
+
+static void fill_notif_batch(char *payload, const adlb_notif_rank *notifs,
+                             int count)
+{
+  adlb_notif_batch_hdr hdr = { .magic = ADLB_NOTIF_BATCH_MAGIC,
+                               .count = count };
+  memcpy(payload, &hdr, sizeof(hdr));
+  char *pos = payload + sizeof(hdr);
+
+  for (int i = 0; i < count; i++)
+  {
+    adlb_subscript sub = notifs[i].subscript;
+    adlb_notif_record rec;
+    rec.id = notifs[i].id;
+    rec.subscript_len = adlb_has_sub(sub) ? (int32_t)sub.length : 0;
+    rec.value_len = notifs[i].value_len;
+    memcpy(pos, &rec, sizeof(rec));
+    pos += sizeof(rec);
+    if (rec.subscript_len > 0)
+    {
+      memcpy(pos, sub.key, sub.length);
+      pos += sub.length;
+    }
+    if (rec.value_len > 0)
+    {
+      memcpy(pos, notifs[i].value, (size_t)rec.value_len);
+      pos += rec.value_len;
+    }
+  }
+}
+
+/*
+  Send a run of notifications to a worker as one task.
+  All must have the same rank and work type.
+ */
+static adlb_code notify_worker(const adlb_notif_rank *notifs, int count)
+{
+  int target = notifs[0].rank;
+  int work_type = notifs[0].work_type;
+  int server = xlb_map_to_server(&xlb_s.layout, target);
+
+  char stack_payload[MAX_NOTIF_PAYLOAD];
+  char *payload = stack_payload;
+  int length;
+
+  if (notif_is_binary(&notifs[0]))
+  {
+    size_t batch_size = notif_batch_size(notifs, count);
+    CHECK_MSG(batch_size <= INT_MAX, "Notification batch too large: %zu",
+              batch_size);
+    if (batch_size > sizeof(stack_payload))
+    {
+      payload = malloc(batch_size);
+      ADLB_MALLOC_CHECK(payload);
+    }
+    fill_notif_batch(payload, notifs, count);
+    length = (int)batch_size;
+  }
+  else
+  {
+    assert(count == 1);
+    length = fill_notif_payload(payload, notifs[0].id,
+                                notifs[0].subscript);
+  }
+
+  adlb_code rc;
+  if (server == xlb_s.layout.rank)
+  {
+    rc = notify_local(target, payload, length, work_type);
+  }
+  else
+  {
+    rc = notify_nonlocal(target, server, payload, length, work_type);
+  }
+
+  if (payload != stack_payload)
+  {
+    free(payload);
+  }
+  ADLB_CHECK(rc);
+  return ADLB_SUCCESS;
+}
+
+// Returns size of forwarded record for notification
+static size_t fwd_record_size(const adlb_notif_rank *notif)
+{
+  size_t size = sizeof(struct packed_notif_fwd);
+  if (adlb_has_sub(notif->subscript))
+    size += notif->subscript.length;
+  if (notif->value_len > 0)
+    size += (size_t)notif->value_len;
+  return size;
+}
+
+static void fill_fwd_record(char *pos, const adlb_notif_rank *notif)
+{
+  struct packed_notif_fwd rec;
+  rec.id = notif->id;
+  rec.rank = notif->rank;
+  rec.work_type = notif->work_type;
+  rec.subscript_len = adlb_has_sub(notif->subscript) ?
+                      (int)notif->subscript.length : 0;
+  rec.value_len = notif->value_len;
+  memcpy(pos, &rec, sizeof(rec));
+  pos += sizeof(rec);
+  if (rec.subscript_len > 0)
+  {
+    memcpy(pos, notif->subscript.key, (size_t)rec.subscript_len);
+    pos += rec.subscript_len;
+  }
+  if (rec.value_len > 0)
+  {
+    memcpy(pos, notif->value, (size_t)rec.value_len);
+  }
+}
+
+static adlb_code forward_to_server(int server, const void *records,
+                                   int length, int count)
+{
+  if (xlb_s.layout.am_server)
+  {
+    // Must use sync for server->server
+    adlb_code ac = xlb_sync_notify_forward(server, records, length,
+                                           count);
+    ADLB_CHECK(ac);
+    return ADLB_SUCCESS;
+  }
+
+  MPI_Status status;
+  MPI_Request request;
+
+  struct packed_notif_forward hdr = { .count = count, .length = length };
+  int response;
+  IRECV(&response, 1, MPI_INT, server, ADLB_TAG_RESPONSE);
+  SEND(&hdr, sizeof(hdr), MPI_BYTE, server, ADLB_TAG_NOTIFY_FORWARD);
+  SEND(records, length, MPI_BYTE, server, ADLB_TAG_WORK);
+  WAIT(&request, &status);
+
+  return (adlb_code)response;
+}
+
+/*
+  Per-server accumulator for forwarded notifications
+ */
+typedef struct {
+  int count;
+  size_t bytes;
+  size_t pos; // Position in buffer if forwarding, else SIZE_MAX
+} fwd_server;
+
+/*
+  Send notifications for workers of other servers through those
+  servers, one message per server, if there are enough to be worth
+  it.  Forwarded notifications are removed from ranks.
+ */
+static adlb_code forward_notifs(adlb_notif_ranks *ranks)
+{
+  int threshold = xlb_s.notif_fanout;
+  if (threshold <= 0 || ranks->count < threshold)
+  {
+    return ADLB_SUCCESS;
+  }
+
+  int nservers = xlb_s.layout.servers;
+  int first_server = xlb_s.layout.workers;
+  fwd_server *servers = calloc((size_t)nservers, sizeof(servers[0]));
+  ADLB_MALLOC_CHECK(servers);
+
+  // Count notifications per server of target worker
+  bool any_forward = false;
+  for (int i = 0; i < ranks->count; i++)
+  {
+    const adlb_notif_rank *notif = &ranks->notifs[i];
+    int server = xlb_map_to_server(&xlb_s.layout, notif->rank);
+    if (server == notif->rank || server == xlb_s.layout.rank)
+      continue;
+
+    fwd_server *s = &servers[server - first_server];
+    s->count++;
+    s->bytes += fwd_record_size(notif);
+    if (s->count >= threshold)
+      any_forward = true;
+  }
+
+  if (!any_forward)
+  {
+    free(servers);
+    return ADLB_SUCCESS;
+  }
+
+  // Lay out records for each server in one buffer
+  size_t total = 0;
+  for (int s = 0; s < nservers; s++)
+  {
+    if (servers[s].count >= threshold)
+    {
+      CHECK_MSG(servers[s].bytes <= INT_MAX,
+                "Forwarded notifications too large: %zu",
+                servers[s].bytes);
+      servers[s].pos = total;
+      total += servers[s].bytes;
+    }
+    else
+    {
+      servers[s].pos = SIZE_MAX;
+    }
+  }
+
+  char *buffer = malloc(total);
+  ADLB_MALLOC_CHECK(buffer);
+
+  // Pack forwarded notifications, and move remainder to front
+  int remaining = 0;
+  for (int i = 0; i < ranks->count; i++)
+  {
+    const adlb_notif_rank *notif = &ranks->notifs[i];
+    int server = xlb_map_to_server(&xlb_s.layout, notif->rank);
+    if (server != notif->rank && server != xlb_s.layout.rank &&
+        servers[server - first_server].pos != SIZE_MAX)
+    {
+      fwd_server *s = &servers[server - first_server];
+      fill_fwd_record(buffer + s->pos, notif);
+      s->pos += fwd_record_size(notif);
+    }
+    else
+    {
+      ranks->notifs[remaining++] = *notif;
+    }
+  }
+  ranks->count = remaining;
+
+  adlb_code rc = ADLB_SUCCESS;
+  size_t start = 0;
+  for (int s = 0; s < nservers && rc == ADLB_SUCCESS; s++)
+  {
+    if (servers[s].count >= threshold)
+    {
+      DEBUG("Forward %i notifications to server %i", servers[s].count,
+            first_server + s);
+      rc = forward_to_server(first_server + s, buffer + start,
+                             (int)servers[s].bytes, servers[s].count);
+      start += servers[s].bytes;
+    }
+  }
+
+  free(buffer);
+  free(servers);
+  ADLB_CHECK(rc);
+  return ADLB_SUCCESS;
+}
+
 
 void xlb_free_notif(adlb_notif_t *notifs)
 {
@@ -218,52 +535,46 @@ xlb_set_ref(adlb_datum_id id, adlb_subscript subscript,
 
 /*
  * Send all notifications.
+ * With binary notifications, those for the same worker and work type
+ * are sent together as one task.  Many notifications for workers of
+ * the same server are forwarded through that server.
  */
 static adlb_code
 xlb_close_notify(adlb_notif_ranks *ranks)
 {
   adlb_code rc;
-  char payload[MAX_NOTIF_PAYLOAD];
-  int payload_len = 0;
-  adlb_subscript last_subscript = ADLB_NO_SUB;
 
-  for (int i = 0; i < ranks->count; i++)
+  rc = forward_notifs(ranks);
+  ADLB_CHECK(rc);
+
+  sort_notifs(ranks);
+
+  int i = 0;
+  while (i < ranks->count)
   {
     adlb_notif_rank *notif = &ranks->notifs[i];
-   
+
     int target = notif->rank;
     int server = xlb_map_to_server(&xlb_s.layout, target);
     if (xlb_s.layout.am_server && target == xlb_s.layout.rank)
     {
       rc = xlb_notify_server_self(notif);
       ADLB_CHECK(rc);
+      i++;
     }
     else if (server == target)
     {
       // Server subscribed by sync
       rc = xlb_notify_server(server, notif->id, notif->subscript);
       ADLB_CHECK(rc);
+      i++;
     }
     else
     {
-      if (i == 0 || notif->subscript.key != last_subscript.key ||
-                    notif->subscript.length != last_subscript.length)
-      {
-        // Skip refilling payload if possible 
-        payload_len = fill_notif_payload(payload, notif->id,
-                                          notif->subscript);
-      }
-      if (server == xlb_s.layout.rank)
-      {
-        rc = notify_local(target, payload, payload_len, notif->work_type);
-        ADLB_CHECK(rc);
-      }
-      else
-      {
-        rc = notify_nonlocal(target, server, payload, payload_len,
-                             notif->work_type);
-        ADLB_CHECK(rc);
-      }
+      int run = notif_run(notif, ranks->count - i);
+      rc = notify_worker(notif, run);
+      ADLB_CHECK(rc);
+      i += run;
     }
   }
 
@@ -390,55 +701,40 @@ xlb_process_local_notif_ranks(adlb_notif_ranks *ranks)
   assert(xlb_s.layout.am_server);
   if (ranks->count > 0)
   {
-    char payload[MAX_NOTIF_PAYLOAD];
-    int payload_len = 0;
-    adlb_subscript last_subscript = ADLB_NO_SUB;
+    sort_notifs(ranks);
 
+    // Move remaining notifications to front of array
+    int remaining = 0;
     int i = 0;
     while (i < ranks->count)
     {
       adlb_notif_rank *notif = &ranks->notifs[i];
       int target = notif->rank;
-      bool processed_locally = false;
 
-      if (xlb_s.layout.am_server && target == xlb_s.layout.rank)
+      if (target == xlb_s.layout.rank)
       {
         adlb_code rc = xlb_notify_server_self(notif);
         ADLB_CHECK(rc);
-        processed_locally = true;
-      } else {
-        int server = xlb_map_to_server(&xlb_s.layout, target);
-        if (server == xlb_s.layout.rank)
-        {
-          // Check to see if target is worker belonging to server
-          if (i == 0 || notif->subscript.key != last_subscript.key ||
-                        notif->subscript.length != last_subscript.length)
-          {
-            // Skip refilling payload if possible 
-            payload_len = fill_notif_payload(payload, notif->id,
-                                               notif->subscript);
-          }
-
-          // Swap with last and shorten array
-          adlb_code rc = notify_local(target, payload, payload_len,
-                                      notif->work_type);
-          ADLB_CHECK(rc);
-          processed_locally = true;
-        }
+        i++;
       }
-
-      if (processed_locally)
+      else if (xlb_map_to_server(&xlb_s.layout, target) ==
+               xlb_s.layout.rank)
       {
-        ranks->notifs[i] = ranks->notifs[ranks->count - 1];
-        ranks->count--;
+        // Target is worker belonging to server
+        int run = notif_run(notif, ranks->count - i);
+        adlb_code rc = notify_worker(notif, run);
+        ADLB_CHECK(rc);
+        i += run;
       }
       else
       {
+        ranks->notifs[remaining++] = *notif;
         i++;
       }
     }
+    ranks->count = remaining;
 
-    // Free memory if we managed to remove some
+    // Free memory if we managed to remove all
     if (ranks->count == 0 && ranks->notifs != NULL)
     {
       xlb_free_ranks(ranks);
@@ -447,6 +743,54 @@ xlb_process_local_notif_ranks(adlb_notif_ranks *ranks)
   return ADLB_SUCCESS;
 }
 
+adlb_code
+xlb_deliver_forwarded_notifs(const void *records, int length, int count)
+{
+  assert(xlb_s.layout.am_server);
+  assert(count > 0);
+
+  adlb_notif_ranks ranks = ADLB_NO_NOTIF_RANKS;
+  adlb_code ac = xlb_notifs_expand(&ranks, count);
+  ADLB_CHECK(ac);
+
+  // Notifications point into records
+  const char *pos = records;
+  const char *end = pos + length;
+  for (int i = 0; i < count; i++)
+  {
+    struct packed_notif_fwd rec;
+    CHECK_MSG(pos + sizeof(rec) <= end, "Truncated forwarded notification");
+    memcpy(&rec, pos, sizeof(rec));
+    pos += sizeof(rec);
+
+    adlb_subscript sub = ADLB_NO_SUB;
+    if (rec.subscript_len > 0)
+    {
+      sub.key = pos;
+      sub.length = (size_t)rec.subscript_len;
+      pos += rec.subscript_len;
+    }
+
+    adlb_notif_rank *notif = &ranks.notifs[ranks.count++];
+    xlb_notif_init(notif, rec.rank, rec.id, sub, rec.work_type);
+    if (rec.value_len >= 0)
+    {
+      notif->value = pos;
+      notif->value_len = rec.value_len;
+      pos += rec.value_len;
+    }
+    CHECK_MSG(pos <= end, "Truncated forwarded notification");
+  }
+
+  ac = xlb_process_local_notif_ranks(&ranks);
+  ADLB_CHECK(ac);
+  CHECK_MSG(ranks.count == 0, "%i forwarded notifications not for "
+            "workers of this server", ranks.count);
+
+  xlb_free_ranks(&ranks);
+  return ADLB_SUCCESS;
+}
+
 adlb_code
 xlb_notify_all(adlb_notif_t *notifs)
 {
@@ -881,6 +1225,7 @@ xlb_prepare_for_send(adlb_notif_t *notifs,
     adlb_notif_rank *rank = &notifs->notify.notifs[i];
     packed_notifs[i].rank = rank->rank;
     packed_notifs[i].id = rank->id;
+    packed_notifs[i].work_type = rank->work_type;
     if (adlb_has_sub(rank->subscript))
     {
       if (last_subscript != NULL &&
@@ -909,6 +1254,19 @@ xlb_prepare_for_send(adlb_notif_t *notifs,
     {
       packed_notifs[i].subscript_data = -1; // No subscript
     }
+
+    if (rank->value_len >= 0)
+    {
+      packed_notifs[i].val_data = extra_data_count++;
+      dc = ADLB_Append_buffer(ADLB_DATA_TYPE_NULL, rank->value,
+          (size_t)rank->value_len, true, &extra_data,
+          &using_caller_buf2, &extra_pos);
+      ADLB_DATA_CHECK(dc);
+    }
+    else
+    {
+      packed_notifs[i].val_data = -1; // No value
+    }
   }
 
   // Track last value so we don't send redundant values
@@ -1118,6 +1476,20 @@ xlb_recv_notif_work(const struct packed_notif_counts *counts,
       r = &notifs->notify.notifs[notifs->notify.count + i];
       r->rank = tmp[i].rank;
       r->id = tmp[i].id;
+      r->work_type = tmp[i].work_type;
+      if (tmp[i].val_data == -1)
+      {
+        r->value = NULL;
+        r->value_len = -1;
+      }
+      else
+      {
+        assert(tmp[i].val_data >= 0 &&
+               tmp[i].val_data < extra_data_count);
+        adlb_binary_data *data = &extra_data_ptrs[tmp[i].val_data];
+        r->value = data->data;
+        r->value_len = (int)data->length;
+      }
       if (tmp[i].subscript_data == -1)
       {
         // No subscript
@@ -1233,3 +1605,108 @@ xlb_recv_notif_work(const struct packed_notif_counts *counts,
   TRACE("Done receiving notifs");
   return ADLB_SUCCESS;
 }
+
+adlb_code
+ADLB_Notif_next(const void *payload, int length, int *pos,
+                adlb_datum_id *id, adlb_subscript *subscript,
+                const void **value, int *value_len)
+{
+  const char *data = payload;
+  adlb_notif_batch_hdr hdr;
+
+  if (length >= (int)sizeof(hdr))
+  {
+    memcpy(&hdr, data, sizeof(hdr));
+  }
+  else
+  {
+    hdr.magic = 0;
+  }
+
+  if (hdr.magic == ADLB_NOTIF_BATCH_MAGIC)
+  {
+    if (*pos == 0)
+      *pos = (int)sizeof(hdr);
+    if (*pos >= length)
+      return ADLB_NOTHING;
+
+    adlb_notif_record rec;
+    CHECK_MSG(*pos + (int)sizeof(rec) <= length,
+              "Truncated notification record at %i", *pos);
+    memcpy(&rec, data + *pos, sizeof(rec));
+    *pos += (int)sizeof(rec);
+
+    CHECK_MSG(rec.subscript_len >= 0 &&
+              rec.subscript_len <= length - *pos,
+              "Bad notification subscript length %"PRId32,
+              rec.subscript_len);
+    *id = rec.id;
+    if (rec.subscript_len > 0)
+    {
+      subscript->key = data + *pos;
+      subscript->length = (size_t)rec.subscript_len;
+    }
+    else
+    {
+      *subscript = ADLB_NO_SUB;
+    }
+    *pos += rec.subscript_len;
+
+    CHECK_MSG(rec.value_len >= -1 && rec.value_len <= length - *pos,
+              "Bad notification value length %"PRId32, rec.value_len);
+    *value = rec.value_len >= 0 ? data + *pos : NULL;
+    *value_len = rec.value_len;
+    if (rec.value_len > 0)
+      *pos += rec.value_len;
+    return ADLB_SUCCESS;
+  }
+
+  // Text format: one notification per payload
+  if (*pos > 0)
+    return ADLB_NOTHING;
+
+  const char *prefix = "close ";
+  size_t prefix_len = strlen(prefix);
+  CHECK_MSG(length > (int)prefix_len &&
+            memcmp(data, prefix, prefix_len) == 0 &&
+            data[length - 1] == '\0',
+            "Not a close notification: %.*s", length, data);
+
+  char *end;
+  *id = strtoll(data + prefix_len, &end, 10);
+  CHECK_MSG(end != data + prefix_len, "Bad notification id: %s", data);
+
+  if (*end == ' ')
+  {
+    subscript->key = end + 1;
+    subscript->length = (size_t)(data + length - (end + 1));
+  }
+  else
+  {
+    CHECK_MSG(*end == '\0', "Bad notification: %s", data);
+    *subscript = ADLB_NO_SUB;
+  }
+  *value = NULL;
+  *value_len = -1;
+  *pos = length;
+  return ADLB_SUCCESS;
+}
+
+adlb_code
+ADLB_Notif_count(const void *payload, int length, int *count)
+{
+  adlb_notif_batch_hdr hdr;
+  if (length >= (int)sizeof(hdr))
+  {
+    memcpy(&hdr, payload, sizeof(hdr));
+    if (hdr.magic == ADLB_NOTIF_BATCH_MAGIC)
+    {
+      *count = hdr.count;
+      return ADLB_SUCCESS;
+    }
+  }
+
+  // Text notification
+  *count = 1;
+  return ADLB_SUCCESS;
+}
@@ -68,6 +68,9 @@ typedef struct {
   adlb_subscript subscript; // Optional subscript
   int rank;
   int work_type;
+  // Optional packed value of closed data, sent with notification
+  const void *value;
+  int value_len; // -1 if no value
 } adlb_notif_rank;
 
 typedef struct {
@@ -176,6 +179,14 @@ xlb_process_local_notif(adlb_notif_t *notifs);
 adlb_code
 xlb_notify_all(adlb_notif_t *notifs);
 
+/*
+  Deliver notifications forwarded by another rank to workers of this
+  server.
+  records: count packed_notif_fwd records, length bytes in total
+ */
+adlb_code
+xlb_deliver_forwarded_notifs(const void *records, int length, int count);
+
 /*
  * Track state of prepared notifs.
  */
@@ -256,6 +267,8 @@ static inline void xlb_notif_init(adlb_notif_rank *r,
   r->id = id;
   r->subscript = subscript;
   r->work_type = work_type;
+  r->value = NULL;
+  r->value_len = -1;
 }
 
 static inline adlb_code xlb_notifs_add(adlb_notif_ranks *notifs,
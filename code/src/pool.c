@@ -0,0 +1,348 @@
+/*
+ * Copyright 2014 University of Chicago and Argonne National Laboratory
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License
+ */
+
+/*
+ * pool.c
+ *
+ * Implementation notes:
+ * Slabs are aligned to XLB_POOL_SLAB_SIZE, so the slab holding an
+ * object is found by masking its address.  Since xlb_pool_free() may
+ * be given malloc()ed memory too, the slab addresses are recorded in a
+ * table and checked before the slab header is trusted.
+ *
+ * Each slab has its own free list, and a class keeps a list of the
+ * slabs with free objects.  Objects that have never been allocated are
+ * handed out from the end of the slab, so new slabs need no setup.
+ */
+
+#include <assert.h>
+#include <inttypes.h>
+#include <stdint.h>
+#include <stdlib.h>
+
+#include <table_lp.h>
+#include <tools.h>
+
+#include "checks.h"
+#include "common.h"
+#include "debug.h"
+#include "pool.h"
+
+/** Alignment and granularity of size classes */
+#define XLB_POOL_ALIGN 16
+
+typedef struct pool_slab pool_slab;
+
+typedef struct
+{
+  size_t obj_size;
+  int slab_objs; // Objects per slab
+
+  /** Slabs with free objects */
+  pool_slab *partial;
+
+  int slabs;
+
+  // Stats
+  int64_t allocs;
+  int64_t in_use;
+  int64_t peak_in_use;
+  int peak_slabs;
+} pool_class;
+
+struct pool_slab
+{
+  pool_class *cls;
+  pool_slab *prev, *next; // In partial list of class
+  void *free_list;
+  int used;
+  int fresh; // Index of first never-allocated object
+};
+
+/** Offset of first object in slab */
+#define SLAB_HDR_SIZE                                         \
+  ((sizeof(pool_slab) + XLB_POOL_ALIGN - 1) &                 \
+   ~(size_t)(XLB_POOL_ALIGN - 1))
+
+static const size_t class_sizes[] = { 16, 32, 48, 64, 96, 128, 192, 256 };
+#define CLASSES ((int)(sizeof(class_sizes) / sizeof(class_sizes[0])))
+
+static pool_class classes[CLASSES];
+
+/** Class index by size in units of XLB_POOL_ALIGN, rounded up */
+static int class_by_units[XLB_POOL_MAX_SIZE / XLB_POOL_ALIGN + 1];
+
+static bool pools_enabled = false;
+
+/** Addresses of all slabs, valid if slab_table_init */
+static struct table_lp slab_table;
+static bool slab_table_init = false;
+
+static void *class_alloc(pool_class *cls);
+static void slab_release(pool_slab *slab);
+
+adlb_code
+xlb_pool_init(void)
+{
+  bool enabled;
+  getenv_boolean("ADLB_DATA_POOLS", true, &enabled);
+  if (!enabled)
+    return ADLB_SUCCESS;
+
+  int c = 0;
+  for (int units = 0; units <= XLB_POOL_MAX_SIZE / XLB_POOL_ALIGN; units++)
+  {
+    while (class_sizes[c] < (size_t)units * XLB_POOL_ALIGN)
+      c++;
+    class_by_units[units] = c;
+  }
+
+  for (int i = 0; i < CLASSES; i++)
+  {
+    pool_class *cls = &classes[i];
+    cls->obj_size = class_sizes[i];
+    cls->slab_objs = (int)((XLB_POOL_SLAB_SIZE - SLAB_HDR_SIZE) /
+                           cls->obj_size);
+    cls->partial = NULL;
+    cls->slabs = 0;
+    cls->allocs = 0;
+    cls->in_use = 0;
+    cls->peak_in_use = 0;
+    cls->peak_slabs = 0;
+  }
+
+  bool ok = table_lp_init(&slab_table, 64);
+  CHECK_MSG(ok, "Could not allocate slab table");
+  slab_table_init = true;
+
+  pools_enabled = true;
+  return ADLB_SUCCESS;
+}
+
+void *
+xlb_pool_alloc(size_t size)
+{
+  if (!pools_enabled || size > XLB_POOL_MAX_SIZE || size == 0)
+    return malloc(size);
+
+  size_t units = (size + XLB_POOL_ALIGN - 1) / XLB_POOL_ALIGN;
+  void *p = class_alloc(&classes[class_by_units[units]]);
+  if (p == NULL)
+    return malloc(size);
+  return p;
+}
+
+static inline void
+partial_push(pool_class *cls, pool_slab *slab)
+{
+  slab->prev = NULL;
+  slab->next = cls->partial;
+  if (cls->partial != NULL)
+    cls->partial->prev = slab;
+  cls->partial = slab;
+}
+
+static inline void
+partial_remove(pool_class *cls, pool_slab *slab)
+{
+  if (slab->prev != NULL)
+    slab->prev->next = slab->next;
+  else
+    cls->partial = slab->next;
+  if (slab->next != NULL)
+    slab->next->prev = slab->prev;
+  slab->prev = slab->next = NULL;
+}
+
+static pool_slab *
+slab_create(pool_class *cls)
+{
+  void *mem;
+  if (posix_memalign(&mem, XLB_POOL_SLAB_SIZE, XLB_POOL_SLAB_SIZE) != 0)
+    return NULL;
+
+  if (!table_lp_add(&slab_table, (int64_t)(uintptr_t)mem, mem))
+  {
+    free(mem);
+    return NULL;
+  }
+
+  pool_slab *slab = mem;
+  slab->cls = cls;
+  slab->free_list = NULL;
+  slab->used = 0;
+  slab->fresh = 0;
+  partial_push(cls, slab);
+
+  cls->slabs++;
+  if (cls->slabs > cls->peak_slabs)
+    cls->peak_slabs = cls->slabs;
+  return slab;
+}
+
+static void *
+class_alloc(pool_class *cls)
+{
+  pool_slab *slab = cls->partial;
+  if (slab == NULL)
+  {
+    slab = slab_create(cls);
+    if (slab == NULL)
+      return NULL;
+  }
+
+  void *p;
+  if (slab->free_list != NULL)
+  {
+    p = slab->free_list;
+    slab->free_list = *(void**)p;
+  }
+  else
+  {
+    assert(slab->fresh < cls->slab_objs);
+    p = (char*)slab + SLAB_HDR_SIZE + (size_t)slab->fresh * cls->obj_size;
+    slab->fresh++;
+  }
+
+  slab->used++;
+  if (slab->used == cls->slab_objs)
+    partial_remove(cls, slab);
+
+  cls->allocs++;
+  cls->in_use++;
+  if (cls->in_use > cls->peak_in_use)
+    cls->peak_in_use = cls->in_use;
+  return p;
+}
+
+/**
+   return: slab containing p, or NULL if not from a pool
+ */
+static inline pool_slab *
+find_slab(void *p)
+{
+  uintptr_t base = (uintptr_t)p & ~(uintptr_t)(XLB_POOL_SLAB_SIZE - 1);
+  if ((void*)base == p)
+  {
+    // Slab header: cannot be an object
+    return NULL;
+  }
+  if (!slab_table_init || slab_table.size == 0 ||
+      !table_lp_contains(&slab_table, (int64_t)base))
+  {
+    return NULL;
+  }
+  return (pool_slab*)base;
+}
+
+void
+xlb_pool_free(void *p)
+{
+  if (p == NULL)
+    return;
+
+  pool_slab *slab = find_slab(p);
+  if (slab == NULL)
+  {
+    free(p);
+    return;
+  }
+
+  pool_class *cls = slab->cls;
+  if (slab->used == cls->slab_objs)
+    partial_push(cls, slab);
+
+  *(void**)p = slab->free_list;
+  slab->free_list = p;
+  slab->used--;
+  cls->in_use--;
+
+  if (slab->used == 0 && cls->slabs > 1)
+  {
+    // Return memory, but keep a slab if it is the last one
+    partial_remove(cls, slab);
+    slab_release(slab);
+  }
+}
+
+static void
+slab_release(pool_slab *slab)
+{
+  void *tmp;
+  bool removed = table_lp_remove(&slab_table, (int64_t)(uintptr_t)slab,
+                                 &tmp);
+  assert(removed);
+  slab->cls->slabs--;
+  free(slab);
+}
+
+void
+xlb_print_pool_stats(void)
+{
+  if (!slab_table_init || !xlb_s.perfc_enabled)
+  {
+    return;
+  }
+
+  for (int i = 0; i < CLASSES; i++)
+  {
+    pool_class *cls = &classes[i];
+    PRINT_COUNTER("DATA_POOL_%zu_ALLOCS=%"PRId64, cls->obj_size,
+                  cls->allocs);
+    PRINT_COUNTER("DATA_POOL_%zu_IN_USE=%"PRId64, cls->obj_size,
+                  cls->in_use);
+    PRINT_COUNTER("DATA_POOL_%zu_PEAK_IN_USE=%"PRId64, cls->obj_size,
+                  cls->peak_in_use);
+    PRINT_COUNTER("DATA_POOL_%zu_SLABS=%i", cls->obj_size, cls->slabs);
+    PRINT_COUNTER("DATA_POOL_%zu_PEAK_SLABS=%i", cls->obj_size,
+                  cls->peak_slabs);
+  }
+}
+
+void
+xlb_pool_finalize(void)
+{
+  if (!pools_enabled)
+    return;
+  pools_enabled = false;
+
+  bool all_empty = true;
+  for (int i = 0; i < CLASSES; i++)
+  {
+    pool_class *cls = &classes[i];
+    if (cls->in_use > 0)
+    {
+      DEBUG("%"PRId64" objects of size %zu still allocated from pool",
+            cls->in_use, cls->obj_size);
+      all_empty = false;
+      continue;
+    }
+
+    while (cls->partial != NULL)
+    {
+      pool_slab *slab = cls->partial;
+      partial_remove(cls, slab);
+      slab_release(slab);
+    }
+  }
+
+  // Keep looking up slabs if objects could still be freed
+  if (all_empty)
+  {
+    table_lp_free_callback(&slab_table, false, NULL);
+    slab_table_init = false;
+  }
+}
@@ -0,0 +1,80 @@
+/*
+ * Copyright 2014 University of Chicago and Argonne National Laboratory
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License
+ */
+
+/*
+ * pool.h
+ *
+ * Slab pools for the small objects in the server's data store:
+ * adlb_datum, container member storage, and short string and blob
+ * values, and for the engine's waiting transforms.  Servers create and
+ * free huge numbers of these, and interleaving them with other
+ * allocations fragments the heap.
+ *
+ * Objects up to XLB_POOL_MAX_SIZE bytes are rounded up to a size
+ * class and carved out of XLB_POOL_SLAB_SIZE byte slabs.  Slabs that
+ * become empty are returned to the system, keeping one spare per
+ * class.
+ *
+ * Pools are only enabled on servers, between xlb_pool_init() and
+ * xlb_pool_finalize().  Otherwise xlb_pool_alloc() and xlb_pool_free()
+ * are malloc() and free().  xlb_pool_free() accepts any malloc()ed
+ * pointer, so values unpacked without copying can be freed the same
+ * way as pooled ones.
+ */
+
+#ifndef POOL_H
+#define POOL_H
+
+#include <stdbool.h>
+#include <stddef.h>
+
+#include "adlb-defs.h"
+#include "adlb_types.h"
+
+/** Largest object size that is pooled */
+#define XLB_POOL_MAX_SIZE 256
+
+/** Slab size: must be power of two */
+#define XLB_POOL_SLAB_SIZE (64 * 1024)
+
+/**
+   Enable pools, unless disabled with ADLB_DATA_POOLS=0
+ */
+adlb_code xlb_pool_init(void);
+
+/**
+   Allocate object from the pool for its size class, or with malloc()
+   if pools are disabled or size is over XLB_POOL_MAX_SIZE
+ */
+void *xlb_pool_alloc(size_t size);
+
+/**
+   Free object from xlb_pool_alloc() or malloc()
+ */
+void xlb_pool_free(void *p);
+
+/**
+   Print occupancy of each size class, if perf counters are enabled
+ */
+void xlb_print_pool_stats(void);
+
+/**
+   Disable pools and free empty slabs.  Slabs still holding objects
+   are left allocated, so that any leaked objects remain valid.
+ */
+void xlb_pool_finalize(void);
+
+#endif // POOL_H
@@ -0,0 +1,225 @@
+/*
+ * Copyright 2014 University of Chicago and Argonne National Laboratory
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License
+ */
+
+
+/*
+ * reduce.c
+ */
+
+#include <assert.h>
+#include <inttypes.h>
+#include <string.h>
+
+#include "checks.h"
+#include "container.h"
+#include "data_internal.h"
+#include "debug.h"
+#include "multiset.h"
+#include "reduce.h"
+
+adlb_data_code
+xlb_reduce_check(const adlb_reduce_spec *spec, adlb_data_type val_type)
+{
+  switch (spec->op)
+  {
+    case ADLB_REDUCE_COUNT:
+      return ADLB_DATA_SUCCESS;
+    case ADLB_REDUCE_HISTOGRAM:
+      check_verbose(spec->hist_bins > 0 &&
+                    spec->hist_bins <= ADLB_REDUCE_HIST_BINS_MAX &&
+                    spec->hist_lo < spec->hist_hi,
+                    ADLB_DATA_ERROR_INVALID,
+                    "Invalid histogram: %i bins over [%lf, %lf)",
+                    spec->hist_bins, spec->hist_lo, spec->hist_hi);
+      // Fall through to type check
+    case ADLB_REDUCE_SUM:
+    case ADLB_REDUCE_MIN:
+    case ADLB_REDUCE_MAX:
+      check_verbose(val_type == ADLB_DATA_TYPE_INTEGER ||
+                    val_type == ADLB_DATA_TYPE_FLOAT,
+                    ADLB_DATA_ERROR_TYPE,
+                    "Cannot reduce values of type %s",
+                    ADLB_Data_type_tostring(val_type));
+      return ADLB_DATA_SUCCESS;
+  }
+
+  verbose_error(ADLB_DATA_ERROR_INVALID, "Invalid reduce op: %i",
+                spec->op);
+}
+
+static inline void
+reduce_hist(const adlb_reduce_spec *spec, double x,
+            adlb_reduce_result *result)
+{
+  if (!(x >= spec->hist_lo))
+  {
+    result->hist_under++;
+  }
+  else if (x >= spec->hist_hi)
+  {
+    result->hist_over++;
+  }
+  else
+  {
+    int bin = (int)((x - spec->hist_lo) /
+                    (spec->hist_hi - spec->hist_lo) * spec->hist_bins);
+    // Rounding may put values just under hist_hi in last bin + 1
+    if (bin >= spec->hist_bins)
+      bin = spec->hist_bins - 1;
+    result->hist[bin]++;
+  }
+}
+
+/**
+   Add one value to result
+ */
+static inline void
+reduce_value(const adlb_reduce_spec *spec,
+             const adlb_datum_storage *val, adlb_reduce_result *result)
+{
+  bool first = (result->count == 0);
+  result->count++;
+
+  if (spec->op == ADLB_REDUCE_COUNT)
+    return;
+
+  if (result->type == ADLB_DATA_TYPE_INTEGER)
+  {
+    adlb_int_t x = val->INTEGER;
+    adlb_int_t *acc = &result->value.INTEGER;
+    switch (spec->op)
+    {
+      case ADLB_REDUCE_SUM:
+        *acc += x;
+        break;
+      case ADLB_REDUCE_MIN:
+        if (first || x < *acc)
+          *acc = x;
+        break;
+      case ADLB_REDUCE_MAX:
+        if (first || x > *acc)
+          *acc = x;
+        break;
+      default:
+        reduce_hist(spec, (double)x, result);
+        break;
+    }
+  }
+  else
+  {
+    adlb_float_t x = val->FLOAT;
+    adlb_float_t *acc = &result->value.FLOAT;
+    switch (spec->op)
+    {
+      case ADLB_REDUCE_SUM:
+        *acc += x;
+        break;
+      case ADLB_REDUCE_MIN:
+        if (first || x < *acc)
+          *acc = x;
+        break;
+      case ADLB_REDUCE_MAX:
+        if (first || x > *acc)
+          *acc = x;
+        break;
+      default:
+        reduce_hist(spec, x, result);
+        break;
+    }
+  }
+}
+
+adlb_data_code
+xlb_reduce(const adlb_datum_storage *data, adlb_data_type type,
+           const adlb_reduce_spec *spec, adlb_reduce_result *result)
+{
+  adlb_data_code dc;
+  adlb_data_type val_type;
+  if (type == ADLB_DATA_TYPE_CONTAINER)
+  {
+    val_type = (adlb_data_type)data->CONTAINER.val_type;
+  }
+  else if (type == ADLB_DATA_TYPE_MULTISET)
+  {
+    val_type = (adlb_data_type)data->MULTISET->elem_type;
+  }
+  else
+  {
+    verbose_error(ADLB_DATA_ERROR_TYPE, "Cannot reduce type %s",
+                  ADLB_Data_type_tostring(type));
+  }
+
+  dc = xlb_reduce_check(spec, val_type);
+  DATA_CHECK(dc);
+
+  memset(result, 0, sizeof(*result));
+  result->type = val_type;
+
+  if (type == ADLB_DATA_TYPE_CONTAINER)
+  {
+    const adlb_container *c = &data->CONTAINER;
+    xlb_members_iter it;
+    xlb_members_iter_init(&it);
+    while (xlb_members_iter_next(c, &it))
+    {
+      // Skip reserved members with no value yet
+      if (it.val != NULL)
+        reduce_value(spec, it.val, result);
+    }
+  }
+  else
+  {
+    const xlb_multiset *set = data->MULTISET;
+    for (uint i = 0; i < set->chunk_count; i++)
+    {
+      uint elems = (i == set->chunk_count - 1) ?
+                   set->last_chunk_elems : XLB_MULTISET_CHUNK_SIZE;
+      const adlb_datum_storage *arr = set->chunks[i]->arr;
+      for (uint j = 0; j < elems; j++)
+        reduce_value(spec, &arr[j], result);
+    }
+  }
+
+  DEBUG("reduce op %i: %"PRId64" values", spec->op, result->count);
+  return ADLB_DATA_SUCCESS;
+}
+
+void
+xlb_reduce_result_pack(const adlb_reduce_spec *spec,
+                       const adlb_reduce_result *result,
+                       adlb_data_type *type, void *buf, size_t *length)
+{
+  assert(spec->op != ADLB_REDUCE_HISTOGRAM);
+  if (spec->op == ADLB_REDUCE_COUNT)
+  {
+    *type = ADLB_DATA_TYPE_INTEGER;
+    adlb_int_t count = result->count;
+    memcpy(buf, &count, sizeof(count));
+    *length = sizeof(count);
+  }
+  else if (result->type == ADLB_DATA_TYPE_INTEGER)
+  {
+    *type = ADLB_DATA_TYPE_INTEGER;
+    memcpy(buf, &result->value.INTEGER, sizeof(adlb_int_t));
+    *length = sizeof(adlb_int_t);
+  }
+  else
+  {
+    *type = ADLB_DATA_TYPE_FLOAT;
+    memcpy(buf, &result->value.FLOAT, sizeof(adlb_float_t));
+    *length = sizeof(adlb_float_t);
+  }
+}
@@ -0,0 +1,55 @@
+/*
+ * Copyright 2014 University of Chicago and Argonne National Laboratory
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License
+ */
+
+/*
+ * reduce.h
+ *
+ * Reductions over the values of containers and multisets, computed in
+ * place on the server so that only the result is sent back.
+ */
+
+#ifndef REDUCE_H
+#define REDUCE_H
+
+#include "adlb-defs.h"
+#include "adlb_types.h"
+
+/**
+   Check that spec can be applied to values of type
+ */
+adlb_data_code xlb_reduce_check(const adlb_reduce_spec *spec,
+                                adlb_data_type val_type);
+
+/**
+   Reduce all values in a container or multiset
+   data, type: the container or multiset
+ */
+adlb_data_code xlb_reduce(const adlb_datum_storage *data,
+                          adlb_data_type type,
+                          const adlb_reduce_spec *spec,
+                          adlb_reduce_result *result);
+
+/**
+   Pack scalar result of COUNT, SUM, MIN or MAX for storing into a
+   datum.  Result is an integer for COUNT, otherwise of the value type.
+   buf: buffer of at least sizeof(adlb_atomic_value)
+ */
+void xlb_reduce_result_pack(const adlb_reduce_spec *spec,
+                            const adlb_reduce_result *result,
+                            adlb_data_type *type, void *buf,
+                            size_t *length);
+
+#endif // REDUCE_H
@@ -21,6 +21,7 @@
  **/
 
 #include <assert.h>
+#include <limits.h>
 #include <stddef.h>
 #include <unistd.h>
 
@@ -36,15 +37,18 @@
 #include "checks.h"
 #include "common.h"
 #include "data.h"
+#include "data_cleanup.h"
 #include "debug.h"
 #include "handlers.h"
 #include "messaging.h"
 #include "mpe-tools.h"
+#include "notifications.h"
 #include "refcount.h"
 #include "requestqueue.h"
 #include "server.h"
 #include "steal.h"
 #include "sync.h"
+#include "termination.h"
 #include "engine.h"
 #include "workqueue.h"
 
@@ -115,6 +119,12 @@ static bool fail_code = -1;
 /** Ready task queue for server */
 xlb_engine_work_array xlb_server_ready_work;
 
+/**
+   Max members of garbage collected containers to free per server
+   loop iteration.  Set by ADLB_GC_BUDGET
+ */
+static long xlb_gc_budget = 4096;
+
 static adlb_code setup_idle_time(void);
 
 static inline int xlb_server_number(int rank);
@@ -138,6 +148,9 @@ xlb_handle_ready_work(void);
 static adlb_code
 xlb_process_ready_work(void);
 
+static inline adlb_code
+xlb_gc_step(void);
+
 /**
    Serve a single request then return
    @param source MPI rank of allowable client: usually MPI_ANY_SOURCE unless syncing
@@ -160,6 +173,9 @@ xlb_server_init(const struct xlb_state *state)
   xlb_data_init(state->layout.servers, xlb_server_number(state->layout.rank));
   code = setup_idle_time();
   ADLB_CHECK(code);
+  code = xlb_env_long("ADLB_GC_BUDGET", &xlb_gc_budget);
+  CHECK_MSG(code != ADLB_ERROR && xlb_gc_budget > 0 &&
+            xlb_gc_budget <= INT_MAX, "Invalid ADLB_GC_BUDGET");
   // Set a default value for now:
   mm_set_max(mm_default, 10*MB);
   xlb_handlers_init();
@@ -172,6 +188,9 @@ xlb_server_init(const struct xlb_state *state)
   code = xlb_steal_init();
   ADLB_CHECK(code);
 
+  code = xlb_termination_init();
+  ADLB_CHECK(code);
+
   xlb_engine_code tc = xlb_engine_init(state->layout.rank);
   CHECK_MSG(tc == XLB_ENGINE_SUCCESS, "Error initializing engine");
 
@@ -193,9 +212,14 @@ xlb_server_number(int rank)
 __attribute__((always_inline))
 static inline adlb_code serve_several(void);
 static inline bool master_server(void);
+#if ADLB_MPI_VERSION >= 3
+static inline bool check_terminated(void);
+#else
 static inline bool check_idle(void);
+#endif
 static adlb_code server_shutdown(void);
 static inline adlb_code check_steal(void);
+static inline adlb_code check_push(void);
 static inline void print_final_stats();
 
 adlb_code
@@ -219,8 +243,13 @@ ADLB_Server(long max_memory)
   {
     if (xlb_server_shutting_down)
       break;
+#if ADLB_MPI_VERSION >= 3
+    if (check_terminated())
+      break;
+#else
     if (master_server() && check_idle())
       break;
+#endif
 
     update_cached_time(); // Periodically refresh timestamp
 
@@ -231,6 +260,13 @@ ADLB_Server(long max_memory)
     update_cached_time(); // Periodically refresh timestamp
 
     check_steal();
+    check_push();
+
+    code = xlb_check_lock_timeouts();
+    ADLB_CHECK(code);
+
+    code = xlb_gc_step();
+    ADLB_CHECK(code);
   }
 
   // Print stats, then cleanup all modules
@@ -321,6 +357,15 @@ serve_several()
       {
         return ADLB_SUCCESS;
       }
+
+      // Use quiet time to free garbage collected data
+      if (xlb_deferred_cleanup_backlog() > 0)
+      {
+        code = xlb_gc_step();
+        ADLB_CHECK(code);
+        exit_points += xlb_loop_poll_points;
+        continue;
+      }
       // Backoff
       bool slept;
       bool again = xlb_backoff_server(curr_server_backoff, &slept);
@@ -425,6 +470,31 @@ static adlb_code xlb_process_ready_work(void)
   return ADLB_SUCCESS;
 }
 
+/*
+ * Free some members of garbage collected containers, within budget,
+ * and apply resulting reference count changes.
+ */
+static inline adlb_code
+xlb_gc_step(void)
+{
+  if (xlb_deferred_cleanup_backlog() == 0)
+  {
+    return ADLB_SUCCESS;
+  }
+
+  adlb_notif_t notifs = ADLB_NO_NOTIFS;
+  adlb_data_code dc = xlb_deferred_cleanup_step((int)xlb_gc_budget,
+                                                &notifs.refcs);
+  CHECK_MSG(dc == ADLB_DATA_SUCCESS, "Error in deferred cleanup");
+
+  adlb_code rc = xlb_notify_all(&notifs);
+  ADLB_CHECK(rc);
+
+  xlb_free_notif(&notifs);
+
+  return ADLB_SUCCESS;
+}
+
 static inline adlb_code
 xlb_serve_one(int source)
 {
@@ -488,6 +558,26 @@ check_steal(void)
   return rc;
 }
 
+/*
+  Offload work to underloaded servers, if enabled
+ */
+static inline adlb_code
+check_push(void)
+{
+  if (!xlb_push_enabled)
+    return ADLB_SUCCESS;
+
+  TRACE_START;
+  adlb_code rc = xlb_try_push();
+  ADLB_CHECK(rc);
+
+  // Sync may have added pending syncs
+  rc = xlb_handle_pending_syncs();
+  ADLB_CHECK(rc);
+  TRACE_END;
+  return ADLB_SUCCESS;
+}
+
 /*
   Initiate a steal attempt
  */
@@ -562,6 +652,35 @@ workers_idle(void)
   return false;
 }
 
+#if ADLB_MPI_VERSION >= 3
+
+/**
+   All servers use this to check for shutdown condition,
+   cf. termination.h
+   @return true when all servers have terminated
+ */
+static inline bool
+check_terminated()
+{
+  bool terminated;
+  adlb_code rc = xlb_termination_check(&terminated);
+  ASSERT(rc == ADLB_SUCCESS);
+  if (!terminated)
+    return false;
+
+  // Ensure no notifications in system
+  assert(xlb_server_ready_work.count == 0);
+  assert(!xlb_have_pending_notifs());
+
+  MPE_LOG(xlb_mpe_dmn_shutdown_start);
+  DEBUG("All servers terminated");
+  xlb_server_shutting_down = true;
+  MPE_LOG(xlb_mpe_dmn_shutdown_end);
+  return true;
+}
+
+#else
+
 static bool servers_idle(void);
 static void shutdown_all_servers(void);
 
@@ -594,6 +713,8 @@ check_idle()
   return true;
 }
 
+#endif
+
 bool
 xlb_server_check_idle_local(bool master, int64_t check_attempt)
 {
@@ -616,6 +737,15 @@ xlb_server_check_idle_local(bool master, int64_t check_attempt)
     xlb_idle_check_attempt = check_attempt;
   }
 
+  if (xlb_work_pushed_since_idle_check)
+  {
+    TRACE("Idle check: not idle because pushed work");
+    // Receiver may already have been checked, or pushed work may be
+    // in flight
+    xlb_work_pushed_since_idle_check = false;
+    return false;
+  }
+
   if (! workers_idle())
   {
     TRACE("Idle check: a worker is not idle");
@@ -630,6 +760,19 @@ xlb_server_check_idle_local(bool master, int64_t check_attempt)
     return false;
   }
 
+  if (xlb_sync_backlog_count > 0)
+  {
+    TRACE("Idle check: buffered syncs waiting for credits");
+    return false;
+  }
+
+  if (xlb_deferred_cleanup_backlog() > 0)
+  {
+    TRACE("Idle check: garbage collection in progress");
+    // Released references can close data and release work
+    return false;
+  }
+
   /*
    * TODO:
    * We currently use a timer to (heuristically) avoid some corner cases
@@ -648,6 +791,8 @@ xlb_server_check_idle_local(bool master, int64_t check_attempt)
   return true;
 }
 
+#if ADLB_MPI_VERSION < 3
+
 static bool
 servers_idle()
 {
@@ -776,6 +921,8 @@ shutdown_all_servers()
   MPE_LOG(xlb_mpe_dmn_shutdown_end);
 }
 
+#endif
+
 adlb_code
 xlb_server_fail(int code)
 {
@@ -816,6 +963,7 @@ server_shutdown()
   xlb_requestqueue_shutdown();
   xlb_workq_finalize();
   xlb_steal_finalize();
+  xlb_termination_finalize();
   xlb_sync_finalize();
 
   xlb_engine_finalize();
@@ -844,5 +992,8 @@ static inline void print_final_stats()
   xlb_print_handler_counters();
   xlb_print_workq_perf_counters();
   xlb_print_sync_counters();
+  xlb_print_steal_counters();
+  xlb_print_termination_counters();
+  xlb_print_data_counters();
   xlb_engine_print_counters();
 }
@@ -22,6 +22,11 @@
  *      Authors: wozniak, armstrong
  */
 
+#include <assert.h>
+#include <inttypes.h>
+#include <limits.h>
+#include <string.h>
+
 #include <mpi.h>
 
 #include <table_ip.h>
@@ -37,29 +42,229 @@
 #include "server.h"
 #include "sync.h"
 #include "steal.h"
+#include "termination.h"
 
 double xlb_steal_last = 0.0;
 int xlb_failed_steals_since_backoff = 0;
 
 /*
   Table to track ranks that we have sent steal probes to but not
-  received a response from.
+  received a response from.  Value is the steal_level + 1 of the probe.
  */
 static struct table_ip sent_steal_probes;
 
-/**
-   Target: another server
+/*
+  Levels of hierarchical victim selection.  We try servers on the same
+  host first, since those steals don't cross the network, then servers
+  on nearby hosts, then fall back to choosing uniformly at random.
+ */
+typedef enum
+{
+  STEAL_LEVEL_HOST,
+  STEAL_LEVEL_NEARBY,
+  STEAL_LEVEL_RANDOM,
+  STEAL_LEVEL_COUNT
+} steal_level;
+
+static const char *steal_level_name[STEAL_LEVEL_COUNT] =
+  { "HOST", "NEARBY", "RANDOM" };
+
+/*
+  Number of servers on other hosts to treat as nearby.  Ranks are
+  normally placed on hosts in blocks, so servers with adjacent server
+  numbers are likely to be on adjacent hosts.
+ */
+#define XLB_STEAL_NEARBY_SERVERS 4
+
+typedef struct
+{
+  /** Candidate victims, unused for STEAL_LEVEL_RANDOM */
+  int *ranks;
+  int count;
+
+  /** Probes sent at this level without response */
+  int outstanding;
+  int limit;
+
+  /** Consecutive probes at this level that found nothing to steal */
+  int failed;
+
+  /** Perf counters */
+  int64_t probes;
+  int64_t steals;
+} steal_level_state;
+
+static steal_level_state steal_levels[STEAL_LEVEL_COUNT];
+
+/** Steals done without a probe, based on piggybacked load info */
+static int64_t direct_steals = 0;
+
+/*
+  Push mode: optionally offload work to underloaded servers rather
+  than waiting for them to steal.  Enabled with ADLB_PUSH_WORK.
+ */
+bool xlb_push_enabled = false;
+
+/*
+  Only push a work type once we have at least this many tasks of it,
+  set with ADLB_PUSH_THRESHOLD.
+ */
+#define XLB_PUSH_THRESHOLD_DEFAULT 64
+static int push_threshold = XLB_PUSH_THRESHOLD_DEFAULT;
+
+/*
+  Only push to a server if we have more than (1 + XLB_PUSH_IMBALANCE)
+  times as many tasks of a type as it does
+ */
+#define XLB_PUSH_IMBALANCE 1.0
+
+/** Last time we tried to push */
+static double push_last = 0.0;
+
+/** Perf counters: tasks pushed and received */
+static int64_t pushed_tasks = 0;
+static int64_t push_received_tasks = 0;
+
+bool xlb_work_pushed_since_idle_check = false;
+
+static adlb_code init_steal_levels(void);
+
+/*
+  Stale-tolerant table of other servers' load, indexed by server
+  number, filled in from work counts piggybacked on sync messages.
+  Entries older than xlb_load_info_max_age are ignored.
+ */
+typedef struct
+{
+  /** Local time when received, 0.0 if no valid information */
+  double recv_time;
+  /** Sender's time when sent, to discard out-of-order updates */
+  double sent_time;
+} peer_load;
+
+static peer_load *peer_loads = NULL;
+
+/** Work type counts per server: servers x xlb_s.types_size */
+static int *peer_work_counts = NULL;
+
+/*
+  Servers whose latest load info shows queued work: candidates for
+  direct steals, so that idle polls needn't scan all servers.
+  known_victim_ix is indexed by server number, -1 if not present.
+ */
+static int *known_victims = NULL;
+static int known_victim_count = 0;
+static int *known_victim_ix = NULL;
+
+/*
+  Max servers checked by find_peer() after this host and nearby hosts
+ */
+#define XLB_PEER_SCAN_MAX 16
+
+static bool xlb_can_steal(const int *work_type_counts);
+
+/*
+  Look up fresh load info for a server
+  return: NULL if none
  */
+static inline const int *
+peer_load_lookup(int rank)
+{
+  int server_num = rank - xlb_s.layout.workers;
+  const peer_load *load = &peer_loads[server_num];
+  if (load->recv_time <= 0.0 ||
+      xlb_approx_time() - load->recv_time > xlb_load_info_max_age)
+  {
+    return NULL;
+  }
+  return &peer_work_counts[server_num * xlb_s.types_size];
+}
+
+static void
+known_victim_update(int server_num, bool has_work)
+{
+  int ix = known_victim_ix[server_num];
+  if (has_work && ix < 0)
+  {
+    known_victim_ix[server_num] = known_victim_count;
+    known_victims[known_victim_count++] = xlb_s.layout.workers +
+                                          server_num;
+  }
+  else if (!has_work && ix >= 0)
+  {
+    // Move last entry into place
+    int last = known_victims[--known_victim_count];
+    known_victims[ix] = last;
+    known_victim_ix[last - xlb_s.layout.workers] = ix;
+    known_victim_ix[server_num] = -1;
+  }
+}
+
 static inline void
-get_target_server(int* result)
+peer_load_invalidate(int rank)
 {
-  do
+  int server_num = rank - xlb_s.layout.workers;
+  peer_loads[server_num].recv_time = 0.0;
+  known_victim_update(server_num, false);
+}
+
+/*
+  True if recent load info says there is nothing to steal on server
+ */
+static inline bool
+known_no_work(int rank)
+{
+  const int *counts = peer_load_lookup(rank);
+  return counts != NULL && !xlb_can_steal(counts);
+}
+
+static bool is_host_server(int rank)
+{
+  for (int i = 0; i < xlb_s.layout.my_host_servers; i++)
   {
-    *result = xlb_random_server();
-  } while (*result == xlb_s.layout.rank);
+    if (xlb_s.layout.my_host_server_ranks[i] == rank)
+      return true;
+  }
+  return false;
+}
+
+/**
+   Target: another server at the given level that does not already
+   have a probe outstanding
+   return: false if no suitable target
+ */
+static inline bool
+get_target_server(steal_level level, int* result)
+{
+  if (level == STEAL_LEVEL_RANDOM)
+  {
+    do
+    {
+      *result = xlb_random_server();
+    } while (*result == xlb_s.layout.rank);
+    return !table_ip_contains(&sent_steal_probes, *result) &&
+           !known_no_work(*result);
+  }
+
+  const steal_level_state *L = &steal_levels[level];
+  if (L->count == 0)
+    return false;
+
+  // Scan candidates from random starting point
+  int start = random_between(0, L->count);
+  for (int i = 0; i < L->count; i++)
+  {
+    int rank = L->ranks[(start + i) % L->count];
+    if (!table_ip_contains(&sent_steal_probes, rank) &&
+        !known_no_work(rank))
+    {
+      *result = rank;
+      return true;
+    }
+  }
+  return false;
 }
 
-static bool xlb_can_steal(const int *work_type_counts);
 static adlb_code xlb_steal(int target, bool* stole_single, bool *stole_par);
 static adlb_code steal_sync(int target, int max_memory, int *response);
 static adlb_code steal_payloads(int target, int count,
@@ -74,6 +279,101 @@ xlb_steal_init(void)
   bool ok = table_ip_init(&sent_steal_probes, 128);
   CHECK_MSG(ok, "Error initing table_ip");
 
+  adlb_code rc = init_steal_levels();
+  ADLB_CHECK(rc);
+
+  int servers = xlb_s.layout.servers;
+  peer_loads = malloc(sizeof(peer_loads[0]) * (size_t)servers);
+  ADLB_MALLOC_CHECK(peer_loads);
+  peer_work_counts = malloc(sizeof(peer_work_counts[0]) *
+                            (size_t)(servers * xlb_s.types_size));
+  ADLB_MALLOC_CHECK(peer_work_counts);
+  known_victims = malloc(sizeof(known_victims[0]) * (size_t)servers);
+  ADLB_MALLOC_CHECK(known_victims);
+  known_victim_ix = malloc(sizeof(known_victim_ix[0]) * (size_t)servers);
+  ADLB_MALLOC_CHECK(known_victim_ix);
+  known_victim_count = 0;
+  for (int i = 0; i < servers; i++)
+  {
+    peer_loads[i].recv_time = 0.0;
+    peer_loads[i].sent_time = 0.0;
+    known_victim_ix[i] = -1;
+  }
+  direct_steals = 0;
+
+  getenv_boolean("ADLB_PUSH_WORK", false, &xlb_push_enabled);
+
+  long tmp;
+  rc = xlb_env_long("ADLB_PUSH_THRESHOLD", &tmp);
+  ADLB_CHECK(rc);
+  if (rc == ADLB_SUCCESS)
+  {
+    CHECK_MSG(tmp > 0 && tmp <= INT_MAX,
+              "Invalid ADLB_PUSH_THRESHOLD %li", tmp);
+    push_threshold = (int)tmp;
+  }
+  push_last = 0.0;
+  pushed_tasks = 0;
+  push_received_tasks = 0;
+  xlb_work_pushed_since_idle_check = false;
+
+  return ADLB_SUCCESS;
+}
+
+/*
+  Build candidate lists for each level from the layout
+ */
+static adlb_code
+init_steal_levels(void)
+{
+  const xlb_layout *layout = &xlb_s.layout;
+
+  for (int i = 0; i < STEAL_LEVEL_COUNT; i++)
+  {
+    steal_level_state *L = &steal_levels[i];
+    L->ranks = NULL;
+    L->count = 0;
+    L->outstanding = 0;
+    L->failed = 0;
+    L->probes = 0;
+    L->steals = 0;
+  }
+  steal_levels[STEAL_LEVEL_HOST].limit =
+                        (int)xlb_steal_host_concurrency_limit;
+  steal_levels[STEAL_LEVEL_NEARBY].limit =
+                        (int)xlb_steal_nearby_concurrency_limit;
+  steal_levels[STEAL_LEVEL_RANDOM].limit =
+                        (int)xlb_steal_random_concurrency_limit;
+
+  // Servers on this host were worked out during layout init
+  steal_levels[STEAL_LEVEL_HOST].ranks = layout->my_host_server_ranks;
+  steal_levels[STEAL_LEVEL_HOST].count = layout->my_host_servers;
+
+  // Nearby servers: closest server numbers not on this host
+  steal_level_state *nearby = &steal_levels[STEAL_LEVEL_NEARBY];
+  nearby->ranks = malloc(sizeof(nearby->ranks[0]) *
+                         XLB_STEAL_NEARBY_SERVERS);
+  ADLB_MALLOC_CHECK(nearby->ranks);
+
+  int my_num = layout->rank - layout->workers;
+  for (int d = 1; d < layout->servers &&
+                  nearby->count < XLB_STEAL_NEARBY_SERVERS; d++)
+  {
+    int nums[2] = { my_num + d, my_num - d };
+    for (int i = 0; i < 2 && nearby->count < XLB_STEAL_NEARBY_SERVERS;
+         i++)
+    {
+      if (nums[i] < 0 || nums[i] >= layout->servers)
+        continue;
+      int rank = layout->workers + nums[i];
+      if (!is_host_server(rank))
+        nearby->ranks[nearby->count++] = rank;
+    }
+  }
+
+  DEBUG("[%i] steal levels: host servers: %i nearby servers: %i",
+        layout->rank, steal_levels[STEAL_LEVEL_HOST].count,
+        nearby->count);
   return ADLB_SUCCESS;
 }
 
@@ -81,8 +381,190 @@ void
 xlb_steal_finalize(void)
 {
   table_ip_free_callback(&sent_steal_probes, false, NULL);
+
+  // Host level array is owned by layout
+  free(steal_levels[STEAL_LEVEL_NEARBY].ranks);
+  steal_levels[STEAL_LEVEL_NEARBY].ranks = NULL;
+  steal_levels[STEAL_LEVEL_NEARBY].count = 0;
+
+  free(peer_loads);
+  peer_loads = NULL;
+  free(peer_work_counts);
+  peer_work_counts = NULL;
+  free(known_victims);
+  known_victims = NULL;
+  free(known_victim_ix);
+  known_victim_ix = NULL;
+  known_victim_count = 0;
+}
+
+void
+xlb_peer_load_update(int rank, double sent_time, const void *work_counts)
+{
+  assert(xlb_is_server(&xlb_s.layout, rank));
+  int server_num = rank - xlb_s.layout.workers;
+  peer_load *load = &peer_loads[server_num];
+  if (sent_time < load->sent_time)
+  {
+    // Already have newer information, e.g. from deferred sync
+    return;
+  }
+
+  load->sent_time = sent_time;
+  load->recv_time = xlb_approx_time();
+  // May be unaligned within sync message
+  int *counts = &peer_work_counts[server_num * xlb_s.types_size];
+  memcpy(counts, work_counts, WORK_TYPES_SIZE);
+
+  bool has_work = false;
+  for (int t = 0; t < xlb_s.types_size; t++)
+  {
+    if (counts[t] > 0)
+    {
+      has_work = true;
+      break;
+    }
+  }
+  known_victim_update(server_num, has_work);
+}
+
+void
+xlb_print_steal_counters(void)
+{
+  if (!xlb_s.perfc_enabled)
+  {
+    return;
+  }
+
+  for (int i = 0; i < STEAL_LEVEL_COUNT; i++)
+  {
+    PRINT_COUNTER("STEAL_PROBES_%s=%"PRId64, steal_level_name[i],
+                  steal_levels[i].probes);
+    PRINT_COUNTER("STEALS_%s=%"PRId64, steal_level_name[i],
+                  steal_levels[i].steals);
+  }
+  PRINT_COUNTER("STEALS_DIRECT=%"PRId64, direct_steals);
+  PRINT_COUNTER("PUSHED_TASKS=%"PRId64, pushed_tasks);
+  PRINT_COUNTER("PUSH_RECEIVED_TASKS=%"PRId64, push_received_tasks);
 }
 
+/*
+  Predicate on a server's fresh load info used by find_peer()
+ */
+typedef bool (*peer_match_fn)(int rank, const int *counts,
+                              const void *arg);
+
+/*
+  Find a server with fresh load info that matches, searching in the
+  same order as for steal probes: this host, nearby hosts, then other
+  candidates starting at a random point to spread load.  At most
+  XLB_PEER_SCAN_MAX other candidates are checked.
+  candidates: ranks of other candidates, or NULL for all servers
+  count: number of candidates
+  return: false if none found
+ */
+static bool
+find_peer(peer_match_fn match, const void *arg,
+          const int *candidates, int count, int *target,
+          steal_level *level)
+{
+  for (steal_level l = 0; l < STEAL_LEVEL_RANDOM; l++)
+  {
+    const steal_level_state *L = &steal_levels[l];
+    for (int i = 0; i < L->count; i++)
+    {
+      int rank = L->ranks[i];
+      const int *counts = peer_load_lookup(rank);
+      if (counts != NULL && match(rank, counts, arg))
+      {
+        *target = rank;
+        *level = l;
+        return true;
+      }
+    }
+  }
+
+  if (count == 0)
+    return false;
+
+  int start = random_between(0, count);
+  int scan = (count < XLB_PEER_SCAN_MAX) ? count : XLB_PEER_SCAN_MAX;
+  for (int i = 0; i < scan; i++)
+  {
+    int j = (start + i) % count;
+    int rank = (candidates != NULL) ? candidates[j] :
+                                      xlb_s.layout.workers + j;
+    if (rank == xlb_s.layout.rank)
+      continue;
+    const int *counts = peer_load_lookup(rank);
+    if (counts != NULL && match(rank, counts, arg))
+    {
+      *target = rank;
+      *level = STEAL_LEVEL_RANDOM;
+      return true;
+    }
+  }
+  return false;
+}
+
+/*
+  Server has work we can steal and no probe outstanding
+ */
+static bool
+victim_match(int rank, const int *counts, const void *arg)
+{
+  return xlb_can_steal(counts) &&
+         !table_ip_contains(&sent_steal_probes, rank);
+}
+
+/*
+  Steal from target and try to match stolen tasks, updating
+  per-level state.
+ */
+static adlb_code
+steal_from(int target, steal_level level)
+{
+  bool stole_single, stole_par;
+  adlb_code rc = xlb_steal(target, &stole_single, &stole_par);
+  ADLB_CHECK(rc);
+
+  DEBUG("[%i] Completed steal from %i stole_single: %i stole_par: %i",
+        xlb_s.layout.rank, target, (int)stole_single, (int)stole_par);
+  // Try to match stolen tasks
+  rc = xlb_recheck_queues(stole_single, stole_par);
+  ADLB_CHECK(rc);
+
+  // Target's load changed: don't trust old info
+  peer_load_invalidate(target);
+
+  steal_level_state *L = &steal_levels[level];
+  if (stole_single || stole_par)
+  {
+    // Keep stealing at this level while it has work
+    L->failed = 0;
+    if (xlb_s.perfc_enabled)
+    {
+      L->steals++;
+    }
+  }
+  else
+  {
+    L->failed++;
+  }
+  return ADLB_SUCCESS;
+}
+
+/*
+  Nothing is done once the number of outstanding steal probes
+  reaches its limit.  If piggybacked load info shows another server
+  has work we can steal, steal from it directly.  Otherwise send a
+  steal probe to a victim chosen hierarchically: servers on this host
+  first, then nearby hosts, then random.  A level is skipped once it
+  has reached its concurrency limit, or once every candidate at that
+  level has recently been probed without finding anything to steal.
+  Servers that recent load info shows have nothing to steal are not
+  probed.
+ */
 adlb_code
 xlb_random_steal_probe(void)
 {
@@ -93,21 +575,187 @@ xlb_random_steal_probe(void)
   }
 
   int target;
-  get_target_server(&target);
+  steal_level known_level;
+  if (find_peer(victim_match, NULL, known_victims, known_victim_count,
+                &target, &known_level))
+  {
+    DEBUG("[%i] direct steal from %i level %s", xlb_s.layout.rank,
+          target, steal_level_name[known_level]);
+    if (xlb_s.perfc_enabled)
+    {
+      direct_steals++;
+    }
+    adlb_code rc = steal_from(target, known_level);
+    ADLB_CHECK(rc);
+    return ADLB_SUCCESS;
+  }
+
+  for (steal_level level = 0; level < STEAL_LEVEL_COUNT; level++)
+  {
+    steal_level_state *L = &steal_levels[level];
+    if (L->outstanding >= L->limit)
+      continue;
+
+    if (level != STEAL_LEVEL_RANDOM && L->failed >= L->count)
+      // Tried all candidates at this level recently
+      continue;
+
+    if (!get_target_server(level, &target))
+      // No candidates or already sent probes to all of them
+      continue;
 
-  if (table_ip_contains(&sent_steal_probes, target))
+    adlb_code rc = xlb_sync_steal_probe(target);
+    ADLB_CHECK(rc);
+
+    // Mark as sent to avoid duplicates
+    bool ok = table_ip_add(&sent_steal_probes, target,
+                           (void*)(long)(level + 1));
+    CHECK_MSG(ok, "error adding to table");
+
+    L->outstanding++;
+    if (xlb_s.perfc_enabled)
+    {
+      L->probes++;
+    }
+
+    if (level == STEAL_LEVEL_RANDOM)
+    {
+      // Fell through all levels: start again with closer servers
+      steal_levels[STEAL_LEVEL_HOST].failed = 0;
+      steal_levels[STEAL_LEVEL_NEARBY].failed = 0;
+    }
+    DEBUG("[%i] steal probe to %i level %s", xlb_s.layout.rank, target,
+          steal_level_name[level]);
+    return ADLB_SUCCESS;
+  }
+
+  return ADLB_NOTHING;
+}
+
+/*
+  We have a backlog of a work type relative to server
+ */
+static bool
+push_match(int rank, const int *counts, const void *arg)
+{
+  const int *my_counts = arg;
+  for (int t = 0; t < xlb_s.types_size; t++)
   {
-    // do nothing - already sent probe
+    if (my_counts[t] >= push_threshold &&
+        my_counts[t] > (1.0 + XLB_PUSH_IMBALANCE) * counts[t])
+    {
+      return true;
+    }
+  }
+  return false;
+}
+
+static adlb_code send_work(int rank, int max_memory,
+                     const int *work_type_counts, int *sent_count);
+
+adlb_code
+xlb_try_push(void)
+{
+  if (!xlb_push_enabled || xlb_s.layout.servers == 1)
     return ADLB_NOTHING;
+
+  double t = xlb_approx_time();
+  if (t - push_last < xlb_steal_rate_limit)
+    // Too soon to try again
+    return ADLB_NOTHING;
+  push_last = t;
+
+  int my_counts[xlb_s.types_size];
+  xlb_workq_type_counts(my_counts, xlb_s.types_size);
+
+  int target;
+  steal_level level;
+  if (!find_peer(push_match, my_counts, NULL, xlb_s.layout.servers,
+                 &target, &level))
+    return ADLB_NOTHING;
+
+  // Copy target's counts now: may expire during sync
+  int target_counts[xlb_s.types_size];
+  memcpy(target_counts, peer_load_lookup(target), WORK_TYPES_SIZE);
+
+  TRACE_START;
+  MPE_LOG(xlb_mpe_svr_steal_start);
+  DEBUG("[%i] pushing work to %i level %s", xlb_s.layout.rank, target,
+        steal_level_name[level]);
+
+  int max_memory = 1;
+  int response;
+  adlb_code rc = xlb_sync_push(target, max_memory, &response);
+  if (rc == ADLB_SHUTDOWN)
+    goto end;
+  ADLB_CHECK(rc);
+  if (!response)
+    goto end;
+
+  int sent;
+  rc = send_work(target, max_memory, target_counts, &sent);
+  ADLB_CHECK(rc);
+
+  // Target's load changed: don't trust old info
+  peer_load_invalidate(target);
+
+  // Work moved: master must not rely on earlier idle checks
+  xlb_work_pushed_since_idle_check = true;
+
+  if (xlb_s.perfc_enabled)
+  {
+    pushed_tasks += sent;
   }
- 
-  adlb_code rc = xlb_sync_steal_probe(target);
+  DEBUG("[%i] push result: sent %i tasks to %i", xlb_s.layout.rank,
+        sent, target);
+
+  end:
+  MPE_LOG(xlb_mpe_svr_steal_end);
+  TRACE_END;
+  return ADLB_SUCCESS;
+}
+
+adlb_code
+xlb_handle_push(int caller, const struct packed_steal *req)
+{
+  TRACE_START;
+  MPE_LOG(xlb_mpe_dmn_steal_start);
+  MPI_Status status;
+  adlb_code rc;
+
+  // Pusher streams work in groups, each with header
+  struct packed_steal_resp hdr;
+  int total_single = 0, total_par = 0;
+  do
+  {
+    RECV(&hdr, sizeof(hdr), MPI_BYTE, caller,
+         ADLB_TAG_RESPONSE_STEAL_COUNT);
+    if (hdr.count > 0)
+    {
+      int single, par;
+      rc = steal_payloads(caller, hdr.count, &single, &par, false);
+      ADLB_CHECK(rc);
+      total_single += single;
+      total_par += par;
+    }
+  } while (!hdr.last);
+
+  DEBUG("[%i] push result: received %i tasks from %i", xlb_s.layout.rank,
+        total_single + total_par, caller);
+  if (xlb_s.perfc_enabled)
+  {
+    push_received_tasks += total_single + total_par;
+  }
+
+  // Pusher's load changed: don't trust old info
+  peer_load_invalidate(caller);
+
+  // Try to match pushed tasks
+  rc = xlb_recheck_queues(total_single > 0, total_par > 0);
   ADLB_CHECK(rc);
-  
-  // Mark as sent to avoid duplicates
-  bool ok = table_ip_add(&sent_steal_probes, target, (void*)0x1);
-  CHECK_MSG(ok, "error adding to table");
 
+  MPE_LOG(xlb_mpe_dmn_steal_end);
+  TRACE_END;
   return ADLB_SUCCESS;
 }
 
@@ -141,23 +789,22 @@ xlb_handle_steal_probe_resp(int caller,
   bool found = table_ip_remove(&sent_steal_probes, caller, &tmp);
   CHECK_MSG(found, "probe not found");
 
+  steal_level level = (steal_level)((long)tmp - 1);
+  assert(level >= 0 && level < STEAL_LEVEL_COUNT);
+  steal_level_state *L = &steal_levels[level];
+  L->outstanding--;
+
   const int *caller_type_counts = (int*)hdr->sync_data;
   if (xlb_can_steal(caller_type_counts))
   {
-    bool stole_single, stole_par;
-    rc = xlb_steal(caller, &stole_single, &stole_par);
-    ADLB_CHECK(rc);
-  
-    DEBUG("[%i] Completed steal from %i stole_single: %i stole_par: %i",
-          xlb_s.layout.rank, caller, (int)stole_single, (int)stole_par);
-    // Try to match stolen tasks
-    rc = xlb_recheck_queues(stole_single, stole_par);
+    rc = steal_from(caller, level);
     ADLB_CHECK(rc);
   }
   else
   {
     DEBUG("[%i] No matching work to steal from %i",
           xlb_s.layout.rank, caller);
+    L->failed++;
   }
 
   return ADLB_SUCCESS;
@@ -352,6 +999,7 @@ steal_payloads(int target, int count,
   }
   free(wus);
   DEBUG("[%i] received batch size %i", xlb_s.layout.rank, count);
+  xlb_term_recvd += count;
 
   *single_count = single;
   *par_count = par;
@@ -437,21 +1085,23 @@ handle_steal_callback(void *cb_data, xlb_work_unit *work)
   return ADLB_SUCCESS;
 }
 
-adlb_code
-xlb_handle_steal(int caller, const struct packed_steal *req,
-                 const int *work_type_counts)
+/*
+  Send work to another server in batches, choosing work to balance
+  against the other server's work type counts.
+  sent_count: number of tasks sent
+ */
+static adlb_code
+send_work(int rank, int max_memory, const int *work_type_counts,
+          int *sent_count)
 {
-  TRACE_START;
-  MPE_LOG(xlb_mpe_svr_steal_start);
-  DEBUG("\t caller: %i", caller);
-
   adlb_code code;
 
   /* setup callback */
   steal_cb_state state;
-  state.stealer_rank = caller;
+  state.stealer_rank = rank;
   state.max_size = XLB_STEAL_CHUNK_SIZE;
   state.work_units = malloc(sizeof(*state.work_units) * state.max_size);
+  ADLB_MALLOC_CHECK(state.work_units);
   state.size = 0;
   state.stole_count = 0;
   xlb_workq_steal_callback cb;
@@ -460,17 +1110,35 @@ xlb_handle_steal(int caller, const struct packed_steal *req,
 
   // Maximum amount of memory to return- currently unused
   // Call steal.  This function will call back to send messages
-  code = xlb_workq_steal(req->max_memory, work_type_counts, cb);
+  code = xlb_workq_steal(max_memory, work_type_counts, cb);
   ADLB_CHECK(code);
  
   // send any remaining.  If nothing left (or nothing was stolen)
-  //    this will notify stealer we're done
+  //    this will notify receiver we're done
   code = send_steal_batch(&state, true);
   ADLB_CHECK(code);
 
   free(state.work_units);
 
-  if (state.stole_count > 0)
+  xlb_term_sent += state.stole_count;
+  *sent_count = state.stole_count;
+  return ADLB_SUCCESS;
+}
+
+adlb_code
+xlb_handle_steal(int caller, const struct packed_steal *req,
+                 const int *work_type_counts)
+{
+  TRACE_START;
+  MPE_LOG(xlb_mpe_svr_steal_start);
+  DEBUG("\t caller: %i", caller);
+
+  int stole_count;
+  adlb_code code = send_work(caller, req->max_memory, work_type_counts,
+                             &stole_count);
+  ADLB_CHECK(code);
+
+  if (stole_count > 0)
   {
     // Update idle check attempt if needed to account for work being
     // moved around.
@@ -483,12 +1151,11 @@ xlb_handle_steal(int caller, const struct packed_steal *req,
     }
   }
   DEBUG("[%i] steal result: sent %i tasks to %i", xlb_s.layout.rank,
-        state.stole_count, caller);
-  STATS("LOST: %i", state.stole_count);
-  // MPE_INFO(xlb_mpe_svr_info, "LOST: %i TO: %i", state.stole_count, caller);
+        stole_count, caller);
+  STATS("LOST: %i", stole_count);
+  // MPE_INFO(xlb_mpe_svr_info, "LOST: %i TO: %i", stole_count, caller);
 
   MPE_LOG(xlb_mpe_svr_steal_end);
   TRACE_END;
   return ADLB_SUCCESS;
 }
-
@@ -45,6 +45,20 @@ extern double xlb_steal_last;
 
 extern int xlb_failed_steals_since_backoff;
 
+/**
+   True if push mode is enabled: servers with a backlog of work
+   offload it to underloaded servers.  Set by ADLB_PUSH_WORK.
+ */
+extern bool xlb_push_enabled;
+
+/**
+   Set when this server pushes work to another server.  Cleared
+   by xlb_server_check_idle_local(), which must not declare this
+   server idle based on an earlier check of the receiver, with either
+   idle check or termination rounds.
+ */
+extern bool xlb_work_pushed_since_idle_check;
+
 /**
   Initialize steal internal state before use
  */
@@ -64,7 +78,23 @@ void xlb_steal_finalize(void);
 static inline bool xlb_steal_allowed(void);
 
 /**
-  Send a steal probe to check for work on a random caller 
+  Record load information piggybacked on a sync message from another
+  server.
+  sent_time: sender's time when message was sent
+  work_counts: int array of size xlb_s.types_size, may be unaligned
+ */
+void xlb_peer_load_update(int rank, double sent_time,
+                          const void *work_counts);
+
+/**
+  Print steal performance counters, if enabled
+ */
+void xlb_print_steal_counters(void);
+
+/**
+  Send a steal probe to check for work on another server.  Victims
+  are chosen hierarchically: servers on the same host first, then
+  servers on nearby hosts, then a random server.
  */
 adlb_code xlb_random_steal_probe(void);
 
@@ -82,6 +112,19 @@ adlb_code xlb_handle_steal_probe(int caller);
 adlb_code xlb_handle_steal_probe_resp(int caller,
                const struct packed_sync *msg);
 
+/**
+  If push mode is enabled and this server has a backlog of work
+  relative to a server whose load we know, push some to that server.
+  Should not be called when within sync loop.
+  return: ADLB_NOTHING if no work pushed
+ */
+adlb_code xlb_try_push(void);
+
+/**
+  Handle an accepted push: receive work from caller
+ */
+adlb_code xlb_handle_push(int caller, const struct packed_steal *req);
+
 /**
    Handle an accepted steal request
    work_type_counts: array of size xlb_s.types_size
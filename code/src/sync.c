@@ -26,15 +26,20 @@
 
 #include <mpi.h>
 
+#include <list.h>
+#include <tools.h>
+
 #include "backoffs.h"
 #include "common.h"
 #include "debug.h"
 #include "messaging.h"
 #include "mpe-tools.h"
+#include "notifications.h"
 #include "refcount.h"
 #include "server.h"
 #include "steal.h"
 #include "sync.h"
+#include "termination.h"
 
 // Enable debugging of very long syncs
 #ifndef XLB_DEBUG_SYNC_DELAY
@@ -50,7 +55,7 @@ struct sync_delay {
   double last_check_time;
 };
 
-static adlb_code xlb_sync2(int target, const struct packed_sync *hdr,
+static adlb_code xlb_sync2(int target, struct packed_sync *hdr,
                            int *response);
 static xlb_sync_recv *xlb_next_sync_msg(void);
 static adlb_code xlb_sync_msg_done(void);
@@ -58,10 +63,17 @@ static adlb_code xlb_sync_msg_done(void);
 static inline adlb_code msg_from_target(int target, int response);
 static adlb_code msg_from_other_server(int other_server,
                                        bool *shutting_down);
-static inline adlb_code cancel_sync(adlb_sync_mode mode, int sync_target);
+static inline adlb_code cancel_sync(adlb_sync_mode mode, int sync_target,
+                                   bool accepted);
+static inline adlb_code sync_accepted(MPI_Request *accept_request,
+                              const int *accept_response, bool *accepted);
 
 static adlb_code xlb_handle_subscribe_sync(int rank,
         const struct packed_sync *hdr, bool defer_svr_ops);
+static adlb_code xlb_handle_subscribe_batch_sync(int rank,
+        const struct packed_sync *hdr, bool defer_svr_ops);
+static adlb_code xlb_handle_notify_forward_sync(int rank,
+        const struct packed_sync *hdr, bool defer_svr_ops);
 
 static adlb_code enqueue_deferred_notify(int rank,
       const struct packed_sync *hdr);
@@ -72,6 +84,7 @@ static adlb_code enqueue_pending(xlb_pending_kind kind, int rank,
 static void free_pending_sync(xlb_pending *pending);
 
 static inline bool sync_accept_required(adlb_sync_mode mode);
+static inline bool sync_counts_for_termination(adlb_sync_mode mode);
 
 static inline void delay_check_init(struct sync_delay *state);
 static inline void delay_check(struct sync_delay *state,
@@ -118,12 +131,82 @@ int xlb_pending_sync_head = 0;
 int xlb_pending_sync_size = 0; // Malloced size
 int xlb_pending_notif_count = 0; // Number that are notifs
 
+/*
+  Buffered send state, cf. sync.h.  Arrays are indexed by server number.
+ */
+bool xlb_sync_buffered = false;
+int xlb_sync_backlog_count = 0;
+
+/*
+  Default credits per target.  Receive buffers are sized so that
+  messages sent on credit by all other servers fit,
+  cf. xlb_sync_recv_init_size()
+ */
+#define XLB_SYNC_CREDITS_DEFAULT 4
+
+/*
+  Messages each server may have in flight to a target without
+  spending credits: one rendezvous sync, since xlb_sync2() waits for
+  the backlog first, and up to two credit returns, since each returns
+  at least half of the credits
+ */
+#define XLB_SYNC_UNCREDITED_MAX 3
+
+static int sync_credits_max;
+static int *sync_credits = NULL; // Credits we can spend on each target
+static int *sync_credits_owed = NULL; // Buffers each sender has used
+
+/* Messages waiting for credits, in FIFO order for each target */
+typedef struct {
+  struct packed_sync *hdr;
+  void *extra;
+  int extra_len;
+} backlog_msg;
+
+static struct list *sync_backlog = NULL;
+
+/*
+  Non-blocking sends that may not have completed yet: buffered headers
+  and extra data sent after headers with ADLB_TAG_SYNC_SUB
+ */
+typedef struct {
+  MPI_Request reqs[2]; // Header and extra data
+  struct packed_sync *buf;
+  void *extra; // Copy of extra data, or NULL
+} buffered_send;
+
+static buffered_send *buffered_sends = NULL;
+static int buffered_sends_count = 0; // Active, at start of array
+static int buffered_sends_size = 0;
+
+static int64_t buffered_sent = 0;
+static int64_t buffered_backlogged = 0;
+static int64_t credit_msgs_sent = 0;
+
+static adlb_code sync_buffered_init(void);
+static void sync_buffered_finalize(void);
+static inline bool sync_buffered_mode(adlb_sync_mode mode);
+static adlb_code sync_send(int target, struct packed_sync *hdr,
+                           const void *extra, int extra_len);
+static adlb_code buffered_isend(int target, struct packed_sync *hdr,
+                                const void *extra, int extra_len);
+static adlb_code extra_isend(int target, const void *extra,
+                             int extra_len);
+static adlb_code sync_buffered_recvd(int rank,
+                  const struct packed_sync *hdr, bool *credit_only);
+static inline int take_credits_owed(int target);
+static adlb_code wait_backlog(int target);
+
 adlb_code
 xlb_sync_init(void)
 {
   adlb_code rc;
   long tmp;
 
+  // Need credits to size recv buffers
+  rc = sync_buffered_init();
+  ADLB_CHECK(rc);
+
   /*
     Setup sync recv buffers
    */
@@ -195,6 +278,10 @@ xlb_sync_init(void)
     xlb_add_sync_type_name(ADLB_SYNC_SUBSCRIBE);
     xlb_add_sync_type_name(ADLB_SYNC_NOTIFY);
     xlb_add_sync_type_name(ADLB_SYNC_SHUTDOWN);
+    xlb_add_sync_type_name(ADLB_SYNC_PUSH);
+    xlb_add_sync_type_name(ADLB_SYNC_CREDIT);
+    xlb_add_sync_type_name(ADLB_SYNC_SUBSCRIBE_BATCH);
+    xlb_add_sync_type_name(ADLB_SYNC_NOTIFY_FORWARD);
   }
   return ADLB_SUCCESS;
 }
@@ -213,6 +300,8 @@ void xlb_sync_finalize(void)
   xlb_sync_recvs = NULL;
   xlb_sync_recv_size = 0;
 
+  sync_buffered_finalize();
+
   DEBUG("[%i] Pending syncs at finalize: %i", xlb_s.layout.rank,
        xlb_pending_sync_count);
 
@@ -244,6 +333,14 @@ void xlb_print_sync_counters(void)
     PRINT_COUNTER("SYNC_ACCEPTED_%s=%"PRId64"\n", xlb_sync_mode_name[i],
                   xlb_sync_perf_counters[i].accepted);
   }
+
+  if (xlb_sync_buffered)
+  {
+    PRINT_COUNTER("SYNC_BUFFERED_SENT=%"PRId64"\n", buffered_sent);
+    PRINT_COUNTER("SYNC_BUFFERED_BACKLOGGED=%"PRId64"\n",
+                  buffered_backlogged);
+    PRINT_COUNTER("SYNC_CREDIT_MSGS_SENT=%"PRId64"\n", credit_msgs_sent);
+  }
 }
 
 /*
@@ -259,15 +356,30 @@ static adlb_code xlb_sync_recv_init_size(int servers, int *size)
   {
     assert(tmp > 0 && tmp <= INT_MAX);
     *size = (int)tmp;
-    return ADLB_SUCCESS;
+  }
+  else
+  {
+    // Base size on number of other servers
+    // Can be zero.
+    *size = (servers - 1) * 4;
+    if (*size >= XLB_SYNC_RECV_DEFAULT_MAX)
+    {
+      *size = XLB_SYNC_RECV_DEFAULT_MAX;
+    }
   }
 
-  // Base size on number of other servers
-  // Can be zero.
-  *size = (servers - 1) * 4;
-  if (*size >= XLB_SYNC_RECV_DEFAULT_MAX)
+  if (xlb_sync_buffered)
   {
-    *size = XLB_SYNC_RECV_DEFAULT_MAX;
+    // Every message sent on credit or returning credits must find a
+    // posted buffer
+    long credit_bufs = (long)(servers - 1) *
+                       (sync_credits_max + XLB_SYNC_UNCREDITED_MAX);
+    CHECK_MSG(credit_bufs <= INT_MAX, "Too many sync credits: %i",
+              sync_credits_max);
+    if (*size < credit_bufs)
+    {
+      *size = (int)credit_bufs;
+    }
   }
 
   return ADLB_SUCCESS;
@@ -301,7 +413,7 @@ xlb_sync(int target)
    3) The master server tells this process to shut down
  */
 static adlb_code
-xlb_sync2(int target, const struct packed_sync *hdr, int *response)
+xlb_sync2(int target, struct packed_sync *hdr, int *response)
 {
   TRACE_START;
   DEBUG("[%i] xlb_sync() target: %i sync_mode: %s", xlb_s.layout.rank,
@@ -327,8 +439,15 @@ xlb_sync2(int target, const struct packed_sync *hdr, int *response)
   // If one of the requests is still pending
   bool requests_pending = false;
 
-  if (!xlb_server_shutting_down ||
-      hdr->mode == ADLB_SYNC_SHUTDOWN)
+  if (xlb_sync_buffered && hdr->mode != ADLB_SYNC_SHUTDOWN)
+  {
+    // Don't overtake buffered messages waiting for credits
+    rc = wait_backlog(target);
+    ADLB_CHECK(rc);
+  }
+
+  if (rc != ADLB_SHUTDOWN &&
+      (!xlb_server_shutting_down || hdr->mode == ADLB_SYNC_SHUTDOWN))
   {
 
     if (xlb_s.perfc_enabled)
@@ -343,6 +462,11 @@ xlb_sync2(int target, const struct packed_sync *hdr, int *response)
             &accept_request);
     }
 
+    // Piggyback our current load so target can skip steal probes
+    hdr->load_time = xlb_approx_time();
+    xlb_workq_type_counts(xlb_sync_load(hdr), xlb_s.types_size);
+    hdr->credits = take_credits_owed(target);
+
     /*
      * Send initial request.
      *
@@ -357,6 +481,9 @@ xlb_sync2(int target, const struct packed_sync *hdr, int *response)
     ISEND(hdr, (int)PACKED_SYNC_SIZE, MPI_BYTE, target,
           ADLB_TAG_SYNC_REQUEST, &isend_request);
     requests_pending = true;
+
+    if (sync_counts_for_termination(hdr->mode))
+      xlb_term_sent++;
     
     DEBUG("server_sync: [%d] waiting for sync response from %d",
                           xlb_s.layout.rank, target);
@@ -442,7 +569,15 @@ xlb_sync2(int target, const struct packed_sync *hdr, int *response)
         // has already shut down
         DEBUG("server_sync: [%d] cancelled by shutdown!", xlb_s.layout.rank);
 
-        rc = cancel_sync(hdr->mode, target);
+        bool accepted = false;
+        if (accept_required)
+        {
+          rc = sync_accepted(&accept_request, &accept_response,
+                             &accepted);
+          ADLB_CHECK(rc);
+        }
+
+        rc = cancel_sync(hdr->mode, target, accepted);
         ADLB_CHECK(rc);
 
         done = true;
@@ -452,6 +587,34 @@ xlb_sync2(int target, const struct packed_sync *hdr, int *response)
       flag2 = true;
     }
 
+    if (!done)
+    {
+      // Target may have already exited if all servers terminated
+      bool terminated;
+      rc = xlb_termination_poll(&terminated);
+      ADLB_CHECK(rc);
+      if (terminated)
+      {
+        DEBUG("server_sync: [%d] cancelled by termination!",
+              xlb_s.layout.rank);
+        xlb_server_shutting_down = true;
+
+        bool accepted = false;
+        if (accept_required)
+        {
+          rc = sync_accepted(&accept_request, &accept_response,
+                             &accepted);
+          ADLB_CHECK(rc);
+        }
+
+        rc = cancel_sync(hdr->mode, target, accepted);
+        ADLB_CHECK(rc);
+
+        done = true;
+        rc = ADLB_SHUTDOWN;
+      }
+    }
+
     if (!flag1 && !flag2)
     {
       // TODO: generally we don't want to wait longer than needed for
@@ -464,7 +627,8 @@ xlb_sync2(int target, const struct packed_sync *hdr, int *response)
   if (requests_pending)
   {
     CANCEL(&isend_request);
-    if (accept_required)
+    // Request is null if sync_accepted() got response
+    if (accept_required && accept_request != MPI_REQUEST_NULL)
     {
       CANCEL(&accept_request);
     }
@@ -522,17 +686,11 @@ send_subscribe_sync(adlb_sync_mode mode,
   }
 
   // Send sync message without waiting for response
-  adlb_code rc = xlb_sync2(target, req, NULL);
+  // If not inlined, subscript is sent separately with special tag
+  adlb_code rc = sync_send(target, req, inlined_subscript ? NULL : sub.key,
+                           inlined_subscript ? 0 : (int)sub.length);
   ADLB_CHECK(rc);
 
-  if (!inlined_subscript)
-  {
-    // send subscript separately with special tag
-    // note: could block here, although large subscripts
-    // are generally quite rare.
-    SEND(sub.key, (int)sub.length, MPI_BYTE, target, ADLB_TAG_SYNC_SUB);
-  }
-  
   return ADLB_SUCCESS;
 }
 
@@ -548,6 +706,48 @@ xlb_sync_subscribe(int target, adlb_datum_id id, adlb_subscript sub,
   return ADLB_SUCCESS;
 }
 
+adlb_code
+xlb_sync_subscribe_batch(int target, const void *entries, int length,
+                         int count)
+{
+  char req_storage[PACKED_SYNC_SIZE]; // Temporary stack storage for struct
+  struct packed_sync *req = (struct packed_sync *)req_storage;
+#ifndef NDEBUG
+  // Avoid send uninitialized bytes for memory checking tools
+  memset(req, 0, PACKED_SYNC_SIZE);
+#endif
+  req->mode = ADLB_SYNC_SUBSCRIBE_BATCH;
+  req->subscribe_batch.count = count;
+  req->subscribe_batch.length = length;
+
+  // Entries always follow header.  We will get notifications later
+  adlb_code rc = sync_send(target, req, entries, length);
+  ADLB_CHECK(rc);
+
+  return ADLB_SUCCESS;
+}
+
+adlb_code
+xlb_sync_notify_forward(int target, const void *records, int length,
+                        int count)
+{
+  char req_storage[PACKED_SYNC_SIZE]; // Temporary stack storage for struct
+  struct packed_sync *req = (struct packed_sync *)req_storage;
+#ifndef NDEBUG
+  // Avoid send uninitialized bytes for memory checking tools
+  memset(req, 0, PACKED_SYNC_SIZE);
+#endif
+  req->mode = ADLB_SYNC_NOTIFY_FORWARD;
+  req->notif_forward.count = count;
+  req->notif_forward.length = length;
+
+  // Records always follow header
+  adlb_code rc = sync_send(target, req, records, length);
+  ADLB_CHECK(rc);
+
+  return ADLB_SUCCESS;
+}
+
 adlb_code
 xlb_sync_notify(int target, adlb_datum_id id, adlb_subscript sub)
 {
@@ -568,7 +768,7 @@ adlb_code xlb_sync_steal_probe(int target)
 #endif
   hdr->mode = ADLB_SYNC_STEAL_PROBE;
 
-  return xlb_sync2(target, hdr, NULL);
+  return sync_send(target, hdr, NULL, 0);
 }
 
 adlb_code
@@ -587,7 +787,7 @@ xlb_sync_steal_probe_resp(int target, const int *work_counts,
   memcpy(hdr->sync_data, work_counts,
          sizeof(work_counts[0]) * (size_t)size);
   
-  return xlb_sync2(target, hdr, NULL);
+  return sync_send(target, hdr, NULL, 0);
 }
 
 adlb_code
@@ -602,7 +802,23 @@ xlb_sync_steal(int target, const int *work_counts, int size,
 
   // Include work types in sync data field
   memcpy(req->sync_data, work_counts,
-         sizeof(work_counts[0] * (size_t)xlb_s.types_size));
+         sizeof(work_counts[0]) * (size_t)size);
+
+  return xlb_sync2(target, req, response);
+}
+
+adlb_code
+xlb_sync_push(int target, int max_memory, int *response)
+{
+  char req_storage[PACKED_SYNC_SIZE]; // Temporary stack storage for struct
+  struct packed_sync *req = (struct packed_sync *)req_storage;
+#ifndef NDEBUG
+  // Avoid send uninitialized bytes for memory checking tools
+  memset(req, 0, PACKED_SYNC_SIZE);
+#endif
+  req->mode = ADLB_SYNC_PUSH;
+  req->steal.max_memory = max_memory;
+  req->steal.idle_check_attempt = xlb_idle_check_attempt;
 
   return xlb_sync2(target, req, response);
 }
@@ -619,7 +835,7 @@ adlb_code xlb_sync_refcount(int target, adlb_datum_id id,
   hdr->mode = ADLB_SYNC_REFCOUNT;
   hdr->incr.id = id;
   hdr->incr.change = change;
-  return xlb_sync2(target, hdr, NULL);
+  return sync_send(target, hdr, NULL, 0);
 }
 
 /**
@@ -636,6 +852,27 @@ msg_from_target(int target, int response)
   return ADLB_SUCCESS;
 }
 
+/*
+  Return true if the sync may create work on the target, so must be
+  counted by termination detection.  Work moved by steals and pushes
+  is counted per task instead.
+ */
+static inline bool sync_counts_for_termination(adlb_sync_mode mode)
+{
+  switch (mode)
+  {
+    case ADLB_SYNC_REQUEST:
+    case ADLB_SYNC_REFCOUNT:
+    case ADLB_SYNC_SUBSCRIBE:
+    case ADLB_SYNC_SUBSCRIBE_BATCH:
+    case ADLB_SYNC_NOTIFY:
+    case ADLB_SYNC_NOTIFY_FORWARD:
+      return true;
+    default:
+      return false;
+  }
+}
+
 /*
   Return true if we need to wait for the sync to be accepted
   before returning to the caller.
@@ -643,7 +880,8 @@ msg_from_target(int target, int response)
 static inline bool sync_accept_required(adlb_sync_mode mode)
 {
   if (mode == ADLB_SYNC_REQUEST ||
-      mode == ADLB_SYNC_STEAL)
+      mode == ADLB_SYNC_STEAL ||
+      mode == ADLB_SYNC_PUSH)
   {
     return true;
   }
@@ -663,13 +901,24 @@ static adlb_code msg_from_other_server(int other_server, bool *shutting_down)
   xlb_sync_recv *sync_msg = xlb_next_sync_msg();
   struct packed_sync *other_hdr = sync_msg->buf;
 
+  xlb_peer_load_update(other_server, other_hdr->load_time,
+                       xlb_sync_load(other_hdr));
+
+  bool credit_only;
+  code = sync_buffered_recvd(other_server, other_hdr, &credit_only);
+  ADLB_CHECK(code);
+
   /* Serve another server
    * We need to avoid the case of circular deadlock, e.g. where A is waiting
    * to serve B, which is waiting to serve C, which is waiting to serve A, 
    * so don't serve higher ranked servers until we've finished our
    * sync request. We choose this ordering because the master server is
    * somewhat more likely to be busy and should be unblocked. */
-  if (other_server < xlb_s.layout.rank)
+  if (credit_only)
+  {
+    // Only returned credits: nothing to serve
+  }
+  else if (other_server < xlb_s.layout.rank)
   {
     // accept incoming sync
     DEBUG("server_sync: [%d] interrupted by incoming sync request from %d",
@@ -733,6 +982,17 @@ adlb_code xlb_handle_next_sync_msg(int caller)
 
   adlb_code rc = xlb_sync_msg_done();
   ADLB_CHECK(rc);
+
+  xlb_peer_load_update(caller, hdr->load_time, xlb_sync_load(hdr));
+
+  bool credit_only;
+  rc = sync_buffered_recvd(caller, hdr, &credit_only);
+  ADLB_CHECK(rc);
+  if (credit_only)
+  {
+    MPE_LOG(xlb_mpe_svr_sync_end);
+    return ADLB_SUCCESS;
+  }
   
   rc = xlb_accept_sync(caller, hdr, false);
   MPE_LOG(xlb_mpe_svr_sync_end);
@@ -759,6 +1019,11 @@ adlb_code xlb_accept_sync(int rank, const struct packed_sync *hdr,
     xlb_sync_perf_counters[mode].accepted++;
   }
 
+  if (sync_counts_for_termination(mode))
+  {
+    xlb_term_recvd++;
+  }
+
   if (sync_accept_required(mode))
   {
     // Notify the waiting caller
@@ -774,7 +1039,8 @@ adlb_code xlb_accept_sync(int rank, const struct packed_sync *hdr,
       break;
 
     case ADLB_SYNC_STEAL_PROBE:
-      if (defer_svr_ops)
+      // Buffered response can be sent from within sync loop
+      if (defer_svr_ops && !xlb_sync_buffered)
       {
         code = enqueue_pending(DEFERRED_STEAL_PROBE, rank, NULL, NULL);
       }
@@ -801,6 +1067,11 @@ adlb_code xlb_accept_sync(int rank, const struct packed_sync *hdr,
       code = xlb_handle_steal(rank, &hdr->steal, (int*)hdr->sync_data);
       break;
 
+    case ADLB_SYNC_PUSH:
+      // Receive work pushed to us
+      code = xlb_handle_push(rank, &hdr->steal);
+      break;
+
     case ADLB_SYNC_REFCOUNT:
       /*
         We defer handling of server->server refcounts to avoid potential
@@ -843,6 +1114,14 @@ adlb_code xlb_accept_sync(int rank, const struct packed_sync *hdr,
       code = xlb_handle_subscribe_sync(rank, hdr, defer_svr_ops);
       break;
 
+    case ADLB_SYNC_SUBSCRIBE_BATCH:
+      code = xlb_handle_subscribe_batch_sync(rank, hdr, defer_svr_ops);
+      break;
+
+    case ADLB_SYNC_NOTIFY_FORWARD:
+      code = xlb_handle_notify_forward_sync(rank, hdr, defer_svr_ops);
+      break;
+
     case ADLB_SYNC_NOTIFY:
       if (defer_svr_ops)
       {
@@ -891,8 +1170,17 @@ adlb_code xlb_handle_pending_sync(xlb_pending_kind kind,
       CHECK_MSG(dc == ADLB_DATA_SUCCESS, "unexpected error in refcount");
       break;
     case DEFERRED_NOTIFY:
-      rc = xlb_handle_notify_sync(rank, &hdr->subscribe, hdr->sync_data,
-                                  extra_data);
+      if (hdr->mode == ADLB_SYNC_NOTIFY_FORWARD)
+      {
+        rc = xlb_deliver_forwarded_notifs(extra_data,
+              hdr->notif_forward.length, hdr->notif_forward.count);
+        free(extra_data);
+      }
+      else
+      {
+        rc = xlb_handle_notify_sync(rank, &hdr->subscribe, hdr->sync_data,
+                                    extra_data);
+      }
       ADLB_CHECK(rc);
       break;
     case UNSENT_NOTIFY:
@@ -957,13 +1245,15 @@ static adlb_code xlb_handle_subscribe_sync(int rank,
 
   // call data module to subscribe
   bool subscribed;
-  dc = xlb_data_subscribe(sub_hdr->id, sub, rank, 0, &subscribed);
+  dc = xlb_data_subscribe(sub_hdr->id, sub, rank, 0, false,
+                          &subscribed);
   ADLB_DATA_CHECK(dc);
 
   if (!subscribed)
   {
     // Is ready, need to get notification back to caller
-    if (defer_svr_ops)
+    // Buffered notification can be sent from within sync loop
+    if (defer_svr_ops && !xlb_sync_buffered)
     {
       // Enqueue it for later sending
       ac = enqueue_pending(UNSENT_NOTIFY, rank, hdr,
@@ -985,6 +1275,106 @@ static adlb_code xlb_handle_subscribe_sync(int rank,
   return ADLB_SUCCESS;
 }
 
+static adlb_code xlb_handle_subscribe_batch_sync(int rank,
+        const struct packed_sync *hdr, bool defer_svr_ops)
+{
+  adlb_data_code dc;
+  adlb_code ac;
+
+  MPI_Status status;
+
+  const struct packed_subscribe_batch *batch = &hdr->subscribe_batch;
+  assert(batch->length > 0);
+  char *entries = malloc((size_t)batch->length);
+  ADLB_MALLOC_CHECK(entries);
+
+  // Entries always sent as separate message with special tag
+  RECV(entries, batch->length, MPI_BYTE, rank, ADLB_TAG_SYNC_SUB);
+
+  const char *pos = entries;
+  for (int i = 0; i < batch->count; i++)
+  {
+    adlb_datum_id id;
+    adlb_subscript sub;
+    pos += xlb_unpack_id_sub(pos, &id, &sub);
+    assert(pos <= entries + batch->length);
+
+    bool subscribed;
+    dc = xlb_data_subscribe(id, sub, rank, 0, false, &subscribed);
+    ADLB_DATA_CHECK(dc);
+
+    if (subscribed)
+    {
+      continue;
+    }
+
+    // Is ready, need to get notification back to caller
+    if (defer_svr_ops && !xlb_sync_buffered)
+    {
+      // Enqueue as if from single subscribe
+      char req_storage[PACKED_SYNC_SIZE];
+      struct packed_sync *req = (struct packed_sync *)req_storage;
+      req->mode = ADLB_SYNC_SUBSCRIBE;
+      req->subscribe.id = id;
+      req->subscribe.subscript_len = sub.length;
+
+      void *malloced_subscript = NULL;
+      if (sub.length <= SYNC_DATA_SIZE)
+      {
+        if (sub.length > 0)
+        {
+          memcpy(req->sync_data, sub.key, sub.length);
+        }
+      }
+      else
+      {
+        malloced_subscript = malloc(sub.length);
+        ADLB_MALLOC_CHECK(malloced_subscript);
+        memcpy(malloced_subscript, sub.key, sub.length);
+      }
+
+      ac = enqueue_pending(UNSENT_NOTIFY, rank, req, malloced_subscript);
+      ADLB_CHECK(ac);
+    }
+    else
+    {
+      ac = xlb_sync_notify(rank, id, sub);
+      ADLB_CHECK(ac);
+    }
+  }
+
+  free(entries);
+  return ADLB_SUCCESS;
+}
+
+static adlb_code xlb_handle_notify_forward_sync(int rank,
+        const struct packed_sync *hdr, bool defer_svr_ops)
+{
+  MPI_Status status;
+
+  const struct packed_notif_forward *fwd = &hdr->notif_forward;
+  assert(fwd->length > 0);
+  void *records = malloc((size_t)fwd->length);
+  ADLB_MALLOC_CHECK(records);
+
+  // Records always sent as separate message with special tag
+  RECV(records, fwd->length, MPI_BYTE, rank, ADLB_TAG_SYNC_SUB);
+
+  if (defer_svr_ops)
+  {
+    DEBUG("Defer %i forwarded notifications", fwd->count);
+    adlb_code ac = enqueue_pending(DEFERRED_NOTIFY, rank, hdr, records);
+    ADLB_CHECK(ac);
+    return ADLB_SUCCESS;
+  }
+
+  adlb_code ac = xlb_deliver_forwarded_notifs(records, fwd->length,
+                                              fwd->count);
+  free(records);
+  ADLB_CHECK(ac);
+  return ADLB_SUCCESS;
+}
+
 /*
  * req_hdr: header from the subscribe request
  * malloc_subscript: memory for longer subscripts
@@ -1234,8 +1624,24 @@ adlb_code xlb_pending_shrink(void)
   return ADLB_SUCCESS;
 }
 
+/*
+  Check, without waiting, whether target accepted a sync that we are
+  about to cancel
+ */
+static inline adlb_code sync_accepted(MPI_Request *accept_request,
+                              const int *accept_response, bool *accepted)
+{
+  int flag;
+  MPI_TEST(accept_request, &flag);
+  *accepted = flag && *accept_response;
+  return ADLB_SUCCESS;
+}
+
+/*
+  accepted: true if target accepted the sync
+ */
 static inline adlb_code
-cancel_sync(adlb_sync_mode mode, int sync_target)
+cancel_sync(adlb_sync_mode mode, int sync_target, bool accepted)
 {
   TRACE_START;
   DEBUG("server_sync: [%d] cancelled by shutdown!", xlb_s.layout.rank);
@@ -1247,13 +1653,28 @@ cancel_sync(adlb_sync_mode mode, int sync_target)
      * something, we send them a dummy piece of work. */
     SEND_TAG(sync_target, ADLB_TAG_DO_NOTHING);
   }
+  else if (mode == ADLB_SYNC_PUSH)
+  {
+    /* If target accepted, it is waiting for work.  Send an empty
+     * final batch so that it doesn't get stuck.  Otherwise, it must
+     * not get a message it didn't ask for. */
+    if (accepted)
+    {
+      struct packed_steal_resp hdr = { .count = 0, .last = true };
+      SEND(&hdr, sizeof(hdr), MPI_BYTE, sync_target,
+           ADLB_TAG_RESPONSE_STEAL_COUNT);
+    }
+  }
   else if (mode == ADLB_SYNC_STEAL_PROBE ||
            mode == ADLB_SYNC_STEAL_PROBE_RESP ||
            mode == ADLB_SYNC_STEAL ||
            mode == ADLB_SYNC_REFCOUNT ||
            mode == ADLB_SYNC_SUBSCRIBE ||
+           mode == ADLB_SYNC_SUBSCRIBE_BATCH ||
            mode == ADLB_SYNC_NOTIFY ||
-           mode == ADLB_SYNC_SHUTDOWN)
+           mode == ADLB_SYNC_NOTIFY_FORWARD ||
+           mode == ADLB_SYNC_SHUTDOWN ||
+           mode == ADLB_SYNC_CREDIT)
   {
     // Don't do anything, the sync initiator doesn't block on any
     // follow-up response from this server after it's accepted
@@ -1268,6 +1689,453 @@ cancel_sync(adlb_sync_mode mode, int sync_target)
   return ADLB_SUCCESS;
 }
 
+/*
+  Setup buffered sends if enabled by ADLB_SYNC_BUFFERED
+ */
+static adlb_code sync_buffered_init(void)
+{
+  getenv_boolean("ADLB_SYNC_BUFFERED", false, &xlb_sync_buffered);
+  xlb_sync_backlog_count = 0;
+  if (!xlb_sync_buffered)
+  {
+    return ADLB_SUCCESS;
+  }
+
+  long tmp;
+  adlb_code rc = xlb_env_long("ADLB_SYNC_CREDITS", &tmp);
+  ADLB_CHECK(rc);
+  if (rc != ADLB_NOTHING)
+  {
+    CHECK_MSG(tmp > 0 && tmp <= INT_MAX,
+              "ADLB_SYNC_CREDITS must be positive: %li", tmp);
+    sync_credits_max = (int)tmp;
+  }
+  else
+  {
+    sync_credits_max = XLB_SYNC_CREDITS_DEFAULT;
+  }
+
+  int servers = xlb_s.layout.servers;
+  sync_credits = malloc(sizeof(sync_credits[0]) * (size_t)servers);
+  ADLB_MALLOC_CHECK(sync_credits);
+  sync_credits_owed = malloc(sizeof(sync_credits_owed[0]) *
+                             (size_t)servers);
+  ADLB_MALLOC_CHECK(sync_credits_owed);
+  sync_backlog = malloc(sizeof(sync_backlog[0]) * (size_t)servers);
+  ADLB_MALLOC_CHECK(sync_backlog);
+
+  for (int i = 0; i < servers; i++)
+  {
+    sync_credits[i] = sync_credits_max;
+    sync_credits_owed[i] = 0;
+    list_init(&sync_backlog[i]);
+  }
+
+  DEBUG("Buffered syncs enabled with %i credits", sync_credits_max);
+  return ADLB_SUCCESS;
+}
+
+static void sync_buffered_finalize(void)
+{
+  // Extra data is sent with these even if syncs aren't buffered
+  for (int i = 0; i < buffered_sends_count; i++)
+  {
+    for (int j = 0; j < 2; j++)
+    {
+      // Target may have shut down: don't wait
+      int flag;
+      MPI_Test(&buffered_sends[i].reqs[j], &flag, MPI_STATUS_IGNORE);
+      if (!flag)
+      {
+        MPI_Cancel(&buffered_sends[i].reqs[j]);
+        MPI_Request_free(&buffered_sends[i].reqs[j]);
+      }
+    }
+  }
+  for (int i = 0; i < buffered_sends_size; i++)
+  {
+    free(buffered_sends[i].buf);
+    free(buffered_sends[i].extra);
+  }
+  free(buffered_sends);
+  buffered_sends = NULL;
+  buffered_sends_count = buffered_sends_size = 0;
+
+  if (!xlb_sync_buffered)
+  {
+    return;
+  }
+
+  DEBUG("[%i] Buffered syncs in backlog at finalize: %i",
+        xlb_s.layout.rank, xlb_sync_backlog_count);
+  for (int i = 0; i < xlb_s.layout.servers; i++)
+  {
+    backlog_msg *msg;
+    while ((msg = list_poll(&sync_backlog[i])) != NULL)
+    {
+      free(msg->hdr);
+      free(msg->extra);
+      free(msg);
+    }
+  }
+  free(sync_backlog);
+  sync_backlog = NULL;
+  xlb_sync_backlog_count = 0;
+
+  free(sync_credits);
+  free(sync_credits_owed);
+  sync_credits = sync_credits_owed = NULL;
+}
+
+/*
+  Return true if messages of this mode can be buffered: the sender
+  doesn't need a response from the target.
+ */
+static inline bool sync_buffered_mode(adlb_sync_mode mode)
+{
+  switch (mode)
+  {
+    case ADLB_SYNC_STEAL_PROBE:
+    case ADLB_SYNC_STEAL_PROBE_RESP:
+    case ADLB_SYNC_REFCOUNT:
+    case ADLB_SYNC_SUBSCRIBE:
+    case ADLB_SYNC_SUBSCRIBE_BATCH:
+    case ADLB_SYNC_NOTIFY:
+    case ADLB_SYNC_NOTIFY_FORWARD:
+      return true;
+    default:
+      return false;
+  }
+}
+
+/*
+  Send a sync message that doesn't need a response, buffered if
+  enabled.  If extra_len > 0, extra data is sent after the header
+  with ADLB_TAG_SYNC_SUB.
+ */
+static adlb_code sync_send(int target, struct packed_sync *hdr,
+                           const void *extra, int extra_len)
+{
+  if (!xlb_sync_buffered || !sync_buffered_mode(hdr->mode))
+  {
+    adlb_code rc = xlb_sync2(target, hdr, NULL);
+    ADLB_CHECK(rc);
+
+    if (rc == ADLB_SUCCESS && extra_len > 0)
+    {
+      rc = extra_isend(target, extra, extra_len);
+      ADLB_CHECK(rc);
+    }
+    return rc;
+  }
+
+  if (xlb_server_shutting_down)
+  {
+    return ADLB_SHUTDOWN;
+  }
+
+  if (xlb_s.perfc_enabled)
+  {
+    xlb_sync_perf_counters[hdr->mode].sent++;
+  }
+
+  // Counted as sent now: backlog keeps system from terminating
+  if (sync_counts_for_termination(hdr->mode))
+    xlb_term_sent++;
+
+  int server = target - xlb_s.layout.workers;
+  if (sync_credits[server] > 0 &&
+      list_size(&sync_backlog[server]) == 0)
+  {
+    return buffered_isend(target, hdr, extra, extra_len);
+  }
+
+  // Out of credits: keep in order until target returns some
+  DEBUG("server_sync: [%d] backlog sync to %d: %s", xlb_s.layout.rank,
+        target, xlb_sync_mode_name[hdr->mode]);
+  backlog_msg *msg = malloc(sizeof(*msg));
+  ADLB_MALLOC_CHECK(msg);
+  msg->hdr = malloc(PACKED_SYNC_SIZE);
+  ADLB_MALLOC_CHECK(msg->hdr);
+  memcpy(msg->hdr, hdr, PACKED_SYNC_SIZE);
+  msg->extra_len = extra_len;
+  msg->extra = NULL;
+  if (extra_len > 0)
+  {
+    msg->extra = malloc((size_t)extra_len);
+    ADLB_MALLOC_CHECK(msg->extra);
+    memcpy(msg->extra, extra, (size_t)extra_len);
+  }
+  list_add(&sync_backlog[server], msg);
+  xlb_sync_backlog_count++;
+  buffered_backlogged++;
+  return ADLB_SUCCESS;
+}
+
+/*
+  Get a buffer for a new buffered send, reusing buffers of
+  completed sends.
+ */
+static adlb_code buffered_send_slot(buffered_send **slot)
+{
+  if (buffered_sends_count == buffered_sends_size)
+  {
+    // Compact completed sends to end of array
+    int i = 0;
+    while (i < buffered_sends_count)
+    {
+      int flag;
+      int mpi_rc = MPI_Testall(2, buffered_sends[i].reqs, &flag,
+                               MPI_STATUSES_IGNORE);
+      MPI_CHECK(mpi_rc);
+      if (flag)
+      {
+        free(buffered_sends[i].extra);
+        buffered_sends[i].extra = NULL;
+        buffered_sends_count--;
+        buffered_send tmp = buffered_sends[i];
+        buffered_sends[i] = buffered_sends[buffered_sends_count];
+        buffered_sends[buffered_sends_count] = tmp;
+      }
+      else
+      {
+        i++;
+      }
+    }
+  }
+
+  if (buffered_sends_count == buffered_sends_size)
+  {
+    int new_size = buffered_sends_size == 0 ?
+                   XLB_SYNC_CREDITS_DEFAULT : buffered_sends_size * 2;
+    buffered_send *tmp = realloc(buffered_sends,
+                          sizeof(buffered_sends[0]) * (size_t)new_size);
+    ADLB_MALLOC_CHECK(tmp);
+    buffered_sends = tmp;
+    for (int i = buffered_sends_size; i < new_size; i++)
+    {
+      buffered_sends[i].buf = malloc(PACKED_SYNC_SIZE);
+      ADLB_MALLOC_CHECK(buffered_sends[i].buf);
+      buffered_sends[i].extra = NULL;
+    }
+    buffered_sends_size = new_size;
+  }
+
+  *slot = &buffered_sends[buffered_sends_count++];
+  (*slot)->reqs[0] = (*slot)->reqs[1] = MPI_REQUEST_NULL;
+  return ADLB_SUCCESS;
+}
+
+/*
+  Send copy of extra data in slot without waiting for completion.
+  The receiver gets it after the header.  A blocking send could
+  deadlock if two servers send each other large extra data.
+ */
+static adlb_code slot_extra_isend(buffered_send *slot, int target,
+                                  const void *extra, int extra_len)
+{
+  assert(slot->extra == NULL);
+  slot->extra = malloc((size_t)extra_len);
+  ADLB_MALLOC_CHECK(slot->extra);
+  memcpy(slot->extra, extra, (size_t)extra_len);
+
+  ISEND(slot->extra, extra_len, MPI_BYTE, target, ADLB_TAG_SYNC_SUB,
+        &slot->reqs[1]);
+  return ADLB_SUCCESS;
+}
+
+/*
+  Send extra data after a sync header sent with xlb_sync2()
+ */
+static adlb_code extra_isend(int target, const void *extra,
+                             int extra_len)
+{
+  buffered_send *slot;
+  adlb_code rc = buffered_send_slot(&slot);
+  ADLB_CHECK(rc);
+
+  return slot_extra_isend(slot, target, extra, extra_len);
+}
+
+/*
+  Send header without waiting for completion.  Spends a credit unless
+  this is a credit return.  Caller checks for credits, except when
+  draining the backlog.
+ */
+static adlb_code buffered_isend(int target, struct packed_sync *hdr,
+                                const void *extra, int extra_len)
+{
+  buffered_send *slot;
+  adlb_code rc = buffered_send_slot(&slot);
+  ADLB_CHECK(rc);
+
+  if (hdr->mode != ADLB_SYNC_CREDIT)
+  {
+    int server = target - xlb_s.layout.workers;
+    sync_credits[server]--;
+    buffered_sent++;
+  }
+
+  hdr->load_time = xlb_approx_time();
+  xlb_workq_type_counts(xlb_sync_load(hdr), xlb_s.types_size);
+  hdr->credits = take_credits_owed(target);
+
+  memcpy(slot->buf, hdr, PACKED_SYNC_SIZE);
+  ISEND(slot->buf, (int)PACKED_SYNC_SIZE, MPI_BYTE, target,
+        ADLB_TAG_SYNC_REQUEST, &slot->reqs[0]);
+
+  if (extra_len > 0)
+  {
+    rc = slot_extra_isend(slot, target, extra, extra_len);
+    ADLB_CHECK(rc);
+  }
+  return ADLB_SUCCESS;
+}
+
+/*
+  Send backlogged messages to target while we have credits
+ */
+static adlb_code flush_backlog(int target)
+{
+  int server = target - xlb_s.layout.workers;
+  while (sync_credits[server] > 0 &&
+         list_size(&sync_backlog[server]) > 0)
+  {
+    backlog_msg *msg = list_poll(&sync_backlog[server]);
+    xlb_sync_backlog_count--;
+
+    adlb_code rc = buffered_isend(target, msg->hdr, msg->extra,
+                                  msg->extra_len);
+    ADLB_CHECK(rc);
+
+    free(msg->hdr);
+    free(msg->extra);
+    free(msg);
+  }
+  return ADLB_SUCCESS;
+}
+
+/*
+  Wait until all backlogged messages to target are sent, so that a
+  rendezvous sync sent next can't overtake them: MPI keeps messages
+  with the same tag in order.  Serves other servers while waiting, as
+  in the xlb_sync2() loop: backlogged messages are sent by
+  flush_backlog() as the target returns credits.
+  Called with xlb_server_sync_in_progress set.
+  return: ADLB_SHUTDOWN if shutting down while waiting
+ */
+static adlb_code wait_backlog(int target)
+{
+  int server = target - xlb_s.layout.workers;
+  if (list_size(&sync_backlog[server]) == 0)
+  {
+    return ADLB_SUCCESS;
+  }
+
+  DEBUG("server_sync: [%d] wait for %i backlogged syncs to %d",
+        xlb_s.layout.rank, list_size(&sync_backlog[server]), target);
+
+  adlb_code rc;
+  while (list_size(&sync_backlog[server]) > 0)
+  {
+    int other_rank = -1;
+    rc = xlb_check_sync_msgs(&other_rank);
+    ADLB_CHECK(rc);
+    if (rc == ADLB_SUCCESS)
+    {
+      bool shutting_down;
+      rc = msg_from_other_server(other_rank, &shutting_down);
+      ADLB_CHECK(rc);
+      if (shutting_down)
+      {
+        DEBUG("server_sync: [%d] backlog wait cancelled by shutdown!",
+              xlb_s.layout.rank);
+        return ADLB_SHUTDOWN;
+      }
+      continue;
+    }
+
+    bool terminated;
+    rc = xlb_termination_poll(&terminated);
+    ADLB_CHECK(rc);
+    if (terminated)
+    {
+      DEBUG("server_sync: [%d] backlog wait cancelled by termination!",
+            xlb_s.layout.rank);
+      xlb_server_shutting_down = true;
+      return ADLB_SHUTDOWN;
+    }
+  }
+  return ADLB_SUCCESS;
+}
+
+/*
+  Return credits owed to target, for piggybacking on a message
+ */
+static inline int take_credits_owed(int target)
+{
+  if (!xlb_sync_buffered)
+  {
+    return 0;
+  }
+  int server = target - xlb_s.layout.workers;
+  int owed = sync_credits_owed[server];
+  sync_credits_owed[server] = 0;
+  return owed;
+}
+
+/*
+  Update credits for sync message received from rank.  Must be called
+  once for each message taken from the sync receive buffers.
+  credit_only: set to true if message carries nothing else
+ */
+static adlb_code sync_buffered_recvd(int rank,
+                  const struct packed_sync *hdr, bool *credit_only)
+{
+  *credit_only = false;
+  if (!xlb_sync_buffered)
+  {
+    return ADLB_SUCCESS;
+  }
+
+  adlb_code rc;
+  int server = rank - xlb_s.layout.workers;
+  if (hdr->credits > 0)
+  {
+    sync_credits[server] += hdr->credits;
+    assert(sync_credits[server] <= sync_credits_max);
+    rc = flush_backlog(rank);
+    ADLB_CHECK(rc);
+  }
+
+  if (hdr->mode == ADLB_SYNC_CREDIT)
+  {
+    *credit_only = true;
+    return ADLB_SUCCESS;
+  }
+
+  if (sync_buffered_mode(hdr->mode))
+  {
+    // Sender spent a credit
+    sync_credits_owed[server]++;
+    if (sync_credits_owed[server] * 2 >= sync_credits_max)
+    {
+      // Sender may be waiting: return explicitly
+      char hdr_storage[PACKED_SYNC_SIZE];
+      struct packed_sync *credit_hdr = (struct packed_sync *)hdr_storage;
+#ifndef NDEBUG
+      // Avoid send uninitialized bytes for memory checking tools
+      memset(credit_hdr, 0, PACKED_SYNC_SIZE);
+#endif
+      credit_hdr->mode = ADLB_SYNC_CREDIT;
+      rc = buffered_isend(rank, credit_hdr, NULL, 0);
+      ADLB_CHECK(rc);
+      credit_msgs_sent++;
+    }
+  }
+  return ADLB_SUCCESS;
+}
+
 static inline void delay_check_init(struct sync_delay *state) {
   state->attempts = 0;
   state->start_time = xlb_approx_time();
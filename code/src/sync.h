@@ -41,6 +41,18 @@
  *   requests from other servers, to avoid starvation propagating.
  * - Request buffering, where we accumulate pending requests to be
  *   processed later.
+ * - Optionally, buffered sends (ADLB_SYNC_BUFFERED), where refcount,
+ *   subscribe, notify and steal probe messages skip the sync loop.
+ *   They are sent with MPI_Isend into the target's pre-posted sync
+ *   receive buffers.  Each server holds a fixed number of credits
+ *   (ADLB_SYNC_CREDITS) per target, spends one per message and queues
+ *   messages in order while it has none.  Receivers return credits
+ *   piggybacked on their own sync messages, or in an explicit credit
+ *   message once half of them are owed.  A rendezvous sync waits,
+ *   serving other servers, until the backlog to its target is sent.
+ * - Extra data that follows a sync header, e.g. long subscripts, is
+ *   sent with MPI_Isend, so servers sending each other large extra
+ *   data can't block each other.
  */
 
 #ifndef SYNC_H
@@ -52,6 +64,12 @@
 adlb_code xlb_sync_init(void);
 void xlb_sync_finalize(void);
 
+/** True if buffered sends are enabled */
+extern bool xlb_sync_buffered;
+
+/** Buffered sync messages waiting for credits, to all targets */
+extern int xlb_sync_backlog_count;
+
 void xlb_print_sync_counters(void);
 
 /**
@@ -84,6 +102,24 @@ adlb_code
 xlb_sync_subscribe(int target, adlb_datum_id id, adlb_subscript sub,
                    bool *subscribed);
 
+/*
+  Subscribe to multiple data on another server in one message
+  entries: count entries packed with xlb_pack_id_sub()
+  length: bytes of packed entries
+ */
+adlb_code
+xlb_sync_subscribe_batch(int target, const void *entries, int length,
+                         int count);
+
+/*
+  Forward notifications to workers of another server in one message
+  records: count packed_notif_fwd records
+  length: bytes of packed records
+ */
+adlb_code
+xlb_sync_notify_forward(int target, const void *records, int length,
+                        int count);
+
 adlb_code
 xlb_sync_notify(int target, adlb_datum_id id, adlb_subscript sub);
 
@@ -118,6 +154,15 @@ adlb_code
 xlb_sync_steal(int target, const int *work_counts, int size,
                int max_memory, int *response);
 
+/*
+  Send a request to push work to target, to be followed up by sending
+  the work once accepted.
+  max_memory: max additional memory to send
+  response: logical, true if target will receive work
+ */
+adlb_code
+xlb_sync_push(int target, int max_memory, int *response);
+
 /*
   Send a refcount operation to another server, and return as soon
   as it is sent.
@@ -286,6 +331,8 @@ static inline bool xlb_is_pending_notif_mode(adlb_sync_mode mode)
   switch (mode) {
     case ADLB_SYNC_NOTIFY:
     case ADLB_SYNC_SUBSCRIBE:
+    case ADLB_SYNC_SUBSCRIBE_BATCH:
+    case ADLB_SYNC_NOTIFY_FORWARD:
     case ADLB_SYNC_REFCOUNT:
       // Notification or may result in notification
       return true;
@@ -0,0 +1,279 @@
+/*
+ * Copyright 2013 University of Chicago and Argonne National Laboratory
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License
+ */
+
+
+/*
+ * termination.c
+ *
+ * Implementation notes:
+ * A server only contributes to a round while it is locally idle, so
+ * a round in which all servers contributed observed every server
+ * idle at some point.  A server can only become busy again by
+ * receiving a counted message or task, so if nothing was received
+ * between the two rounds beyond what was already sent before the
+ * first, no server became busy and no message is in flight.
+ */
+
+#include <assert.h>
+#include <inttypes.h>
+
+#include <mpi.h>
+
+#include "backoffs.h"
+#include "checks.h"
+#include "common.h"
+#include "debug.h"
+#include "messaging.h"
+#include "requestqueue.h"
+#include "server.h"
+#include "termination.h"
+#include "workqueue.h"
+
+int64_t xlb_term_sent = 0;
+int64_t xlb_term_recvd = 0;
+
+#if ADLB_MPI_VERSION >= 3
+
+/*
+  Layout of the reduced vector: counters, then for each work type
+  the number of servers with requests, then the number of servers
+  with work.
+ */
+#define TERM_SENT  0
+#define TERM_RECVD 1
+#define TERM_COUNTERS 2
+
+#define term_requests_ix(type) (TERM_COUNTERS + (type))
+#define term_work_ix(type) (TERM_COUNTERS + xlb_s.types_size + (type))
+
+/** Private duplicate of server communicator */
+static MPI_Comm term_comm = MPI_COMM_NULL;
+
+static int term_vector_size;
+
+/** Our contribution to the current round, and the reduced totals */
+static int64_t *term_local = NULL;
+static int64_t *term_total = NULL;
+
+static bool round_active = false;
+static MPI_Request round_request;
+
+/** Time we last started a round */
+static double last_round_time;
+
+/**
+   True if the previous round found all servers idle: then
+   prev_recvd is the total received in that round
+ */
+static bool prev_round_idle = false;
+static int64_t prev_recvd;
+
+// Perf counters
+static int64_t term_rounds = 0;
+
+static adlb_code start_round(void);
+static bool round_complete(void);
+
+adlb_code
+xlb_termination_init(void)
+{
+  int rc = MPI_Comm_dup(xlb_s.server_comm, &term_comm);
+  MPI_CHECK(rc);
+
+  term_vector_size = TERM_COUNTERS + 2 * xlb_s.types_size;
+  term_local = malloc(sizeof(term_local[0]) * (size_t)term_vector_size);
+  ADLB_MALLOC_CHECK(term_local);
+  term_total = malloc(sizeof(term_total[0]) * (size_t)term_vector_size);
+  ADLB_MALLOC_CHECK(term_total);
+
+  round_active = false;
+  prev_round_idle = false;
+  last_round_time = MPI_Wtime();
+  return ADLB_SUCCESS;
+}
+
+void
+xlb_termination_finalize(void)
+{
+  if (round_active)
+  {
+    /*
+      All servers contributed to a round before any of them could
+      detect termination, so this only happens if we are shutting
+      down for another reason, e.g. failure.  Don't wait for servers
+      that may never contribute.
+     */
+    DEBUG("Termination round still active at shutdown");
+  }
+  else
+  {
+    MPI_Comm_free(&term_comm);
+  }
+  free(term_local);
+  free(term_total);
+  term_local = term_total = NULL;
+}
+
+adlb_code
+xlb_termination_poll(bool *terminated)
+{
+  *terminated = false;
+  if (!round_active)
+    return ADLB_SUCCESS;
+
+  int flag;
+  MPI_TEST(&round_request, &flag);
+  if (!flag)
+    return ADLB_SUCCESS;
+
+  round_active = false;
+  *terminated = round_complete();
+  return ADLB_SUCCESS;
+}
+
+adlb_code
+xlb_termination_check(bool *terminated)
+{
+  adlb_code rc = xlb_termination_poll(terminated);
+  ADLB_CHECK(rc);
+
+  if (*terminated || round_active)
+    return ADLB_SUCCESS;
+
+  double now = xlb_approx_time();
+  if (now - last_round_time < xlb_max_idle * xlb_servers_idle_frac)
+    return ADLB_SUCCESS;
+
+  if (xlb_server_ready_work.count > 0 ||
+      !xlb_server_check_idle_local(true, 0))
+    return ADLB_SUCCESS;
+
+  last_round_time = now;
+  return start_round();
+}
+
+/**
+   Take snapshot of local state and start a round
+ */
+static adlb_code
+start_round(void)
+{
+  int types = xlb_s.types_size;
+  int request_counts[types];
+  int work_counts[types];
+  xlb_requestqueue_type_counts(request_counts, types);
+  xlb_workq_type_counts(work_counts, types);
+
+  term_local[TERM_SENT] = xlb_term_sent;
+  term_local[TERM_RECVD] = xlb_term_recvd;
+  for (int t = 0; t < types; t++)
+  {
+    term_local[term_requests_ix(t)] = (request_counts[t] > 0);
+    term_local[term_work_ix(t)] = (work_counts[t] > 0);
+  }
+
+  DEBUG("Termination round: sent %"PRId64" received %"PRId64,
+        xlb_term_sent, xlb_term_recvd);
+
+  int rc = MPI_Iallreduce(term_local, term_total, term_vector_size,
+                          MPI_INT64_T, MPI_SUM, term_comm, &round_request);
+  MPI_CHECK(rc);
+  round_active = true;
+  term_rounds++;
+  return ADLB_SUCCESS;
+}
+
+/**
+   Evaluate totals of a completed round
+   return: true if terminated
+ */
+static bool
+round_complete(void)
+{
+  int64_t sent = term_total[TERM_SENT];
+  int64_t recvd = term_total[TERM_RECVD];
+  bool idle = (sent == recvd);
+
+  // Check to see if work stealing could match work to requests
+  for (int t = 0; idle && t < xlb_s.types_size; t++)
+  {
+    if (term_total[term_requests_ix(t)] > 0 &&
+        term_total[term_work_ix(t)] > 0)
+    {
+      DEBUG("Unmatched work of type %i: requests on %"PRId64" servers, "
+            "work on %"PRId64" servers", t, term_total[term_requests_ix(t)],
+            term_total[term_work_ix(t)]);
+      idle = false;
+    }
+  }
+
+  bool terminated = idle && prev_round_idle && prev_recvd == sent;
+  DEBUG("Termination round complete: sent %"PRId64" received %"PRId64
+        " idle: %i terminated: %i", sent, recvd, (int)idle,
+        (int)terminated);
+
+  prev_round_idle = idle;
+  prev_recvd = recvd;
+  return terminated;
+}
+
+void
+xlb_print_termination_counters(void)
+{
+  if (!xlb_s.perfc_enabled)
+  {
+    return;
+  }
+
+  PRINT_COUNTER("TERMINATION_ROUNDS=%"PRId64, term_rounds);
+  PRINT_COUNTER("TERMINATION_MSGS_SENT=%"PRId64, xlb_term_sent);
+  PRINT_COUNTER("TERMINATION_MSGS_RECEIVED=%"PRId64, xlb_term_recvd);
+}
+
+#else // ADLB_MPI_VERSION < 3
+
+adlb_code
+xlb_termination_init(void)
+{
+  return ADLB_SUCCESS;
+}
+
+void
+xlb_termination_finalize(void)
+{
+}
+
+adlb_code
+xlb_termination_poll(bool *terminated)
+{
+  // Master server detects termination, cf. server.c
+  *terminated = false;
+  return ADLB_SUCCESS;
+}
+
+adlb_code
+xlb_termination_check(bool *terminated)
+{
+  *terminated = false;
+  return ADLB_SUCCESS;
+}
+
+void
+xlb_print_termination_counters(void)
+{
+}
+
+#endif
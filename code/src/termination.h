@@ -0,0 +1,74 @@
+/*
+ * Copyright 2013 University of Chicago and Argonne National Laboratory
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License
+ */
+
+
+/*
+ * termination.h
+ *
+ * Distributed termination detection for servers.
+ *
+ * Each server counts the server-to-server messages that can create
+ * work (RPC requests, refcounts, subscribes, notifications) and the
+ * tasks moved by steals and pushes, on both the sending and the
+ * receiving side.  Servers that are locally idle join rounds of a
+ * non-blocking allreduce over the server communicator that sums these
+ * counters.  Using the four-counter method, the system has terminated
+ * if two consecutive rounds find every server idle and the total
+ * received in the first round equals the total sent in the second:
+ * then no message was in flight and nothing woke a server in between.
+ * Every server gets the same result, so no shutdown broadcast is
+ * needed, and each round takes time logarithmic in the server count.
+ *
+ * Requires MPI 3 for MPI_Iallreduce.  With MPI 2 the master server
+ * polls each server in turn instead, cf. server.c.
+ */
+
+#ifndef TERMINATION_H
+#define TERMINATION_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "adlb-defs.h"
+
+/** Messages and tasks sent to other servers */
+extern int64_t xlb_term_sent;
+
+/** Messages and tasks received from other servers */
+extern int64_t xlb_term_recvd;
+
+adlb_code xlb_termination_init(void);
+void xlb_termination_finalize(void);
+
+void xlb_print_termination_counters(void);
+
+/**
+   Poll the current detection round, and join a new round if this
+   server is locally idle and the rate limit allows.  Called from
+   the server loop.
+   terminated: set to true if all servers have terminated
+ */
+adlb_code xlb_termination_check(bool *terminated);
+
+/**
+   Poll the current detection round without starting another.
+   Safe to call inside a sync loop, so that a server blocked on a
+   server that has already exited can also exit.
+   terminated: set to true if all servers have terminated
+ */
+adlb_code xlb_termination_poll(bool *terminated);
+
+#endif
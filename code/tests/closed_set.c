@@ -0,0 +1,201 @@
+/*
+ * Copyright 2015 University of Chicago and Argonne National Laboratory
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License
+ */
+
+
+/*
+ * closed_set.c
+ *
+ * Regression test for the engine's sets of closed remote data.  Sets
+ * must never report entries that were not added, must stay within
+ * capacity, and must give recently looked up entries a second chance
+ * on eviction.
+ */
+#include <inttypes.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "common.h"
+#include "checks.h"
+#include "closed_set.h"
+
+static adlb_code run(void);
+static adlb_code test_clock(void);
+static adlb_code test_ids_exact(void);
+static adlb_code test_keys_exact(void);
+static adlb_code test_disabled(void);
+
+int main(int argc, char **argv)
+{
+  adlb_code ac = run();
+
+  if (ac != ADLB_SUCCESS) {
+    fprintf(stderr, "FAILED!: %i\n", ac);
+    return 1;
+  }
+
+  return 0;
+}
+
+static adlb_code run(void)
+{
+  adlb_code ac;
+
+  fprintf(stderr, "Testing eviction...\n");
+  ac = test_clock();
+  ADLB_CHECK(ac);
+
+  fprintf(stderr, "Testing id sets...\n");
+  ac = test_ids_exact();
+  ADLB_CHECK(ac);
+
+  fprintf(stderr, "Testing key sets...\n");
+  ac = test_keys_exact();
+  ADLB_CHECK(ac);
+
+  fprintf(stderr, "Testing disabled sets...\n");
+  ac = test_disabled();
+  ADLB_CHECK(ac);
+
+  fprintf(stderr, "Done.\n");
+  return ADLB_SUCCESS;
+}
+
+/*
+  With a single bucket, slots fill in order and the clock hand
+  evicts them in order, skipping entries hit since it last passed
+ */
+static adlb_code test_clock(void)
+{
+  xlb_id_set s;
+  bool ok = xlb_id_set_init(&s, XLB_CLOSED_SET_WAYS);
+  CHECK_MSG(ok && s.c.nbuckets == 1, "init failed");
+
+  for (adlb_datum_id id = 1; id <= XLB_CLOSED_SET_WAYS; id++)
+  {
+    xlb_id_set_add(&s, id);
+  }
+  CHECK_MSG(s.c.size == XLB_CLOSED_SET_WAYS && s.c.evictions == 0,
+            "set should be full without evictions");
+
+  // Hit on 3 gives it a second chance
+  CHECK_MSG(xlb_id_set_contains(&s, 3), "3 missing");
+
+  xlb_id_set_add(&s, 101);
+  CHECK_MSG(!xlb_id_set_contains(&s, 1), "1 should be evicted");
+  xlb_id_set_add(&s, 102);
+  CHECK_MSG(!xlb_id_set_contains(&s, 2), "2 should be evicted");
+  xlb_id_set_add(&s, 103);
+  CHECK_MSG(!xlb_id_set_contains(&s, 4), "4 should be evicted");
+
+  CHECK_MSG(xlb_id_set_contains(&s, 3), "3 should survive");
+  for (adlb_datum_id id = 101; id <= 103; id++)
+  {
+    CHECK_MSG(xlb_id_set_contains(&s, id), "%"PRId64" missing", id);
+  }
+  CHECK_MSG(s.c.size == XLB_CLOSED_SET_WAYS && s.c.evictions == 3,
+            "size %i evictions %"PRId64, s.c.size, s.c.evictions);
+
+  // Adding again is a no-op
+  xlb_id_set_add(&s, 3);
+  CHECK_MSG(s.c.evictions == 3, "re-adding should not evict");
+
+  xlb_id_set_free(&s);
+  return ADLB_SUCCESS;
+}
+
+static adlb_code test_ids_exact(void)
+{
+  const int capacity = 1024;
+  xlb_id_set s;
+  bool ok = xlb_id_set_init(&s, capacity);
+  CHECK_MSG(ok, "init failed");
+
+  // Add even ids only, many more than fit
+  for (adlb_datum_id id = 2; id <= 200000; id += 2)
+  {
+    xlb_id_set_add(&s, id);
+    CHECK_MSG(xlb_id_set_contains(&s, id), "%"PRId64" missing after add",
+              id);
+    CHECK_MSG(s.c.size <= capacity, "size %i over capacity", s.c.size);
+  }
+  CHECK_MSG(s.c.evictions > 0, "expected evictions");
+
+  for (adlb_datum_id id = -1000; id <= 200001; id += 2)
+  {
+    CHECK_MSG(!xlb_id_set_contains(&s, id), "false positive for %"PRId64,
+              id);
+  }
+
+  xlb_id_set_free(&s);
+  return ADLB_SUCCESS;
+}
+
+static adlb_code test_keys_exact(void)
+{
+  const int capacity = 64;
+  xlb_key_set s;
+  bool ok = xlb_key_set_init(&s, capacity);
+  CHECK_MSG(ok, "init failed");
+
+  char key[32];
+  for (int i = 0; i < 1000; i++)
+  {
+    int len = sprintf(key, "k%i", i);
+    ok = xlb_key_set_add(&s, key, (size_t)len);
+    CHECK_MSG(ok, "add failed");
+    CHECK_MSG(xlb_key_set_contains(&s, key, (size_t)len),
+              "%s missing after add", key);
+    CHECK_MSG(s.c.size <= capacity, "size %i over capacity", s.c.size);
+  }
+
+  for (int i = 0; i < 1000; i++)
+  {
+    int len = sprintf(key, "x%i", i);
+    CHECK_MSG(!xlb_key_set_contains(&s, key, (size_t)len),
+              "false positive for %s", key);
+  }
+
+  // Keys must match in length too, e.g. with and without terminator
+  ok = xlb_key_set_add(&s, "abc", 3);
+  CHECK_MSG(ok, "add failed");
+  CHECK_MSG(xlb_key_set_contains(&s, "abc", 3), "abc missing");
+  CHECK_MSG(!xlb_key_set_contains(&s, "abc", 4), "abc\\0 found");
+  CHECK_MSG(!xlb_key_set_contains(&s, "abc", 2), "ab found");
+
+  xlb_key_set_free(&s);
+  return ADLB_SUCCESS;
+}
+
+static adlb_code test_disabled(void)
+{
+  xlb_id_set ids;
+  bool ok = xlb_id_set_init(&ids, 0);
+  CHECK_MSG(ok, "init failed");
+  xlb_id_set_add(&ids, 1);
+  CHECK_MSG(!xlb_id_set_contains(&ids, 1), "disabled set has entry");
+  xlb_id_set_free(&ids);
+
+  xlb_key_set keys;
+  ok = xlb_key_set_init(&keys, 0);
+  CHECK_MSG(ok, "init failed");
+  xlb_key_set_add(&keys, "a", 1);
+  CHECK_MSG(!xlb_key_set_contains(&keys, "a", 1), "disabled set has entry");
+  xlb_key_set_free(&keys);
+
+  return ADLB_SUCCESS;
+}
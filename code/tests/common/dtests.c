@@ -0,0 +1,150 @@
+/*
+ * Copyright 2015 University of Chicago and Argonne National Laboratory
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License
+ */
+
+
+/*
+ * dtests.c
+ *
+ * Common functions for tests of the server's data module
+ */
+
+#include "dtests.h"
+
+#include <assert.h>
+#include <inttypes.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "checks.h"
+#include "common.h"
+#include "data.h"
+#include "qtests.h"
+
+#define DT_COMM_SIZE 4
+
+static adlb_datum_id next_id = 1;
+
+adlb_code dt_init(void)
+{
+  adlb_code ac;
+
+  int my_rank = DT_COMM_SIZE - 1;
+  int nservers = 1;
+  const char *fake_hosts[DT_COMM_SIZE];
+  make_fake_hosts(fake_hosts, DT_COMM_SIZE);
+
+  ac = qs_init(DT_COMM_SIZE, my_rank, nservers, fake_hosts, 1);
+  ADLB_CHECK(ac);
+
+  assert(xlb_s.layout.am_server);
+  adlb_data_code dc = xlb_data_init(nservers, 0);
+  ADLB_DATA_CHECK(dc);
+
+  return ADLB_SUCCESS;
+}
+
+adlb_code dt_finalize(void)
+{
+  adlb_data_code dc = xlb_data_finalize();
+  ADLB_DATA_CHECK(dc);
+
+  adlb_code ac = qs_finalize();
+  ADLB_CHECK(ac);
+
+  return ADLB_SUCCESS;
+}
+
+adlb_datum_id dt_new_id(void)
+{
+  return next_id++;
+}
+
+adlb_subscript dt_int_key(int64_t key, char *buf)
+{
+  int len = sprintf(buf, "%"PRId64, key);
+  adlb_subscript sub = { .key = buf, .length = (size_t)len + 1 };
+  return sub;
+}
+
+adlb_code dt_create_integer(adlb_datum_id id)
+{
+  adlb_create_props props = DEFAULT_CREATE_PROPS;
+  adlb_data_code dc = xlb_data_create(id, ADLB_DATA_TYPE_INTEGER, NULL,
+                                      &props);
+  ADLB_DATA_CHECK(dc);
+  return ADLB_SUCCESS;
+}
+
+adlb_code dt_create_container(adlb_datum_id id, adlb_data_type key_type,
+                      adlb_data_type val_type, bool sorted_index)
+{
+  adlb_create_props props = DEFAULT_CREATE_PROPS;
+  props.sorted_index = sorted_index;
+
+  adlb_type_extra extra;
+  extra.valid = true;
+  extra.CONTAINER.key_type = key_type;
+  extra.CONTAINER.val_type = val_type;
+
+  adlb_data_code dc = xlb_data_create(id, ADLB_DATA_TYPE_CONTAINER,
+                                      &extra, &props);
+  ADLB_DATA_CHECK(dc);
+  return ADLB_SUCCESS;
+}
+
+adlb_code dt_store_integer(adlb_datum_id id, adlb_subscript subscript,
+                           int64_t value)
+{
+  adlb_notif_t notifs = ADLB_NO_NOTIFS;
+  adlb_data_code dc = xlb_data_store(id, subscript, &value, sizeof(value),
+                true, NULL, ADLB_DATA_TYPE_INTEGER, ADLB_NO_REFC,
+                ADLB_NO_REFC, &notifs);
+  xlb_free_notif(&notifs);
+  ADLB_DATA_CHECK(dc);
+  return ADLB_SUCCESS;
+}
+
+adlb_code dt_next_integer(const adlb_buffer *buf, size_t *pos,
+                          int64_t *value)
+{
+  const void *entry;
+  size_t entry_length;
+  adlb_data_code dc = ADLB_Unpack_buffer(ADLB_DATA_TYPE_INTEGER,
+              buf->data, buf->length, pos, &entry, &entry_length);
+  ADLB_DATA_CHECK(dc);
+
+  adlb_int_t tmp;
+  dc = ADLB_Unpack_integer(&tmp, entry, entry_length);
+  ADLB_DATA_CHECK(dc);
+  *value = tmp;
+  return ADLB_SUCCESS;
+}
+
+adlb_code dt_check_next_key(const adlb_buffer *buf, size_t *pos,
+                            const char *expected)
+{
+  const void *entry;
+  size_t entry_length;
+  adlb_data_code dc = ADLB_Unpack_buffer(ADLB_DATA_TYPE_NULL,
+              buf->data, buf->length, pos, &entry, &entry_length);
+  ADLB_DATA_CHECK(dc);
+
+  CHECK_MSG(entry_length == strlen(expected) + 1 &&
+            memcmp(entry, expected, entry_length) == 0,
+            "Expected key \"%s\" Actual \"%.*s\"", expected,
+            (int)entry_length, (const char*)entry);
+  return ADLB_SUCCESS;
+}
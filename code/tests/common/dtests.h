@@ -0,0 +1,80 @@
+/*
+ * Copyright 2015 University of Chicago and Argonne National Laboratory
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License
+ */
+
+
+/*
+ * dtests.h
+ *
+ * Common functions for tests of the server's data module.  The test
+ * process acts as the only server, so all data is local and no
+ * messages are sent.
+ */
+
+#ifndef __DTESTS_H
+#define __DTESTS_H
+
+#include <stdint.h>
+
+#include "adlb-defs.h"
+#include "adlb_types.h"
+
+/** Max bytes in decimal integer key, including null terminator */
+#define DT_INT_KEY_MAX 24
+
+/*
+  Setup layout with this rank as the only server and initialize data
+ */
+adlb_code dt_init(void);
+
+adlb_code dt_finalize(void);
+
+/*
+  Allocate a new id on this server
+ */
+adlb_datum_id dt_new_id(void);
+
+/*
+  Make subscript for integer key, using buf for storage
+  buf: at least DT_INT_KEY_MAX bytes
+ */
+adlb_subscript dt_int_key(int64_t key, char *buf);
+
+adlb_code dt_create_integer(adlb_datum_id id);
+
+adlb_code dt_create_container(adlb_datum_id id, adlb_data_type key_type,
+                      adlb_data_type val_type, bool sorted_index);
+
+/*
+  Store integer value, to subscript if not ADLB_NO_SUB.  Does not
+  release any refcounts.
+ */
+adlb_code dt_store_integer(adlb_datum_id id, adlb_subscript subscript,
+                           int64_t value);
+
+/*
+  Unpack integer value from buffer with packed values
+  pos: input/output read position, cf. ADLB_Unpack_buffer
+ */
+adlb_code dt_next_integer(const adlb_buffer *buf, size_t *pos,
+                          int64_t *value);
+
+/*
+  Unpack key from buffer with packed keys, and check key
+ */
+adlb_code dt_check_next_key(const adlb_buffer *buf, size_t *pos,
+                            const char *expected);
+
+#endif // __DTESTS_H
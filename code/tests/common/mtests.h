@@ -0,0 +1,48 @@
+/*
+ * Copyright 2015 University of Chicago and Argonne National Laboratory
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License
+ */
+
+
+/*
+ * mtests.h
+ *
+ * Common definitions for tests that run servers and workers through
+ * the public ADLB API.  These must be launched with mpiexec.
+ */
+
+#ifndef __MTESTS_H
+#define __MTESTS_H
+
+#include <stdio.h>
+
+#include <adlb.h>
+
+/*
+  Print message and return ADLB_ERROR if condition is false
+ */
+#define TEST_CHECK(cond, fmt, args...) {                    \
+    if (!(cond)) {                                          \
+      fprintf(stderr, "CHECK FAILED: %s:%i: " fmt "\n",     \
+              __FILE__, __LINE__, ## args);                 \
+      return ADLB_ERROR;                                    \
+    }}
+
+/*
+  Check return code of ADLB call
+ */
+#define TEST_RC(rc) TEST_CHECK((rc) == ADLB_SUCCESS,        \
+                               "ADLB call failed: %i", (rc))
+
+#endif // __MTESTS_H
@@ -0,0 +1,238 @@
+/*
+ * Copyright 2015 University of Chicago and Argonne National Laboratory
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License
+ */
+
+
+/*
+ * data_atomic.c
+ *
+ * Regression test for atomic operations on integer and float data.
+ */
+#include <assert.h>
+#include <inttypes.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "common/dtests.h"
+
+#include "checks.h"
+#include "data.h"
+
+static adlb_code run(void);
+static adlb_code test_integer(void);
+static adlb_code test_float(void);
+static adlb_code test_errors(void);
+
+int main(int argc, char **argv)
+{
+  adlb_code ac = run();
+
+  if (ac != ADLB_SUCCESS) {
+    fprintf(stderr, "FAILED!: %i\n", ac);
+    return 1;
+  }
+
+  return 0;
+}
+
+static adlb_code run(void)
+{
+  adlb_code ac;
+
+  fprintf(stderr, "Initializing...\n");
+  ac = dt_init();
+  ADLB_CHECK(ac);
+
+  fprintf(stderr, "Testing integer...\n");
+  ac = test_integer();
+  ADLB_CHECK(ac);
+
+  fprintf(stderr, "Testing float...\n");
+  ac = test_float();
+  ADLB_CHECK(ac);
+
+  fprintf(stderr, "Testing errors...\n");
+  ac = test_errors();
+  ADLB_CHECK(ac);
+
+  fprintf(stderr, "Finalizing...\n");
+  ac = dt_finalize();
+  ADLB_CHECK(ac);
+
+  fprintf(stderr, "Done.\n");
+  return ADLB_SUCCESS;
+}
+
+/*
+  Apply integer op and check the outcome
+ */
+static adlb_code check_int_op(adlb_datum_id id, adlb_atomic_op op,
+        int64_t operand, int64_t compare, bool expect_old_set,
+        int64_t expect_old, bool expect_updated)
+{
+  adlb_atomic_value operand_v = { .INTEGER = operand };
+  adlb_atomic_value compare_v = { .INTEGER = compare };
+  adlb_atomic_value old_value;
+  bool old_set, updated;
+  adlb_notif_t notifs = ADLB_NO_NOTIFS;
+
+  adlb_data_code dc = xlb_data_atomic(id, op, ADLB_DATA_TYPE_INTEGER,
+            &operand_v, &compare_v, ADLB_NO_REFC, &old_value, &old_set,
+            &updated, &notifs);
+  xlb_free_notif(&notifs);
+  ADLB_DATA_CHECK(dc);
+
+  CHECK_MSG(old_set == expect_old_set, "op %i: expected old_set %i",
+            op, (int)expect_old_set);
+  CHECK_MSG(!old_set || old_value.INTEGER == expect_old,
+            "op %i: expected old value %"PRId64" actual %"PRId64,
+            op, expect_old, old_value.INTEGER);
+  CHECK_MSG(updated == expect_updated, "op %i: expected updated %i",
+            op, (int)expect_updated);
+  return ADLB_SUCCESS;
+}
+
+static adlb_code test_integer(void)
+{
+  adlb_code ac;
+
+  adlb_datum_id id = dt_new_id();
+  ac = dt_create_integer(id);
+  ADLB_CHECK(ac);
+
+  // CAS does nothing while unset
+  ac = check_int_op(id, ADLB_ATOMIC_CAS, 1, 0, false, 0, false);
+  ADLB_CHECK(ac);
+
+  // ADD stores operand into unset datum
+  ac = check_int_op(id, ADLB_ATOMIC_ADD, 5, 0, false, 0, true);
+  ADLB_CHECK(ac);
+  ac = check_int_op(id, ADLB_ATOMIC_ADD, 3, 0, true, 5, true);
+  ADLB_CHECK(ac);
+
+  ac = check_int_op(id, ADLB_ATOMIC_CAS, 42, 7, true, 8, false);
+  ADLB_CHECK(ac);
+  ac = check_int_op(id, ADLB_ATOMIC_CAS, 42, 8, true, 8, true);
+  ADLB_CHECK(ac);
+
+  ac = check_int_op(id, ADLB_ATOMIC_MIN, 50, 0, true, 42, false);
+  ADLB_CHECK(ac);
+  ac = check_int_op(id, ADLB_ATOMIC_MIN, -10, 0, true, 42, true);
+  ADLB_CHECK(ac);
+
+  ac = check_int_op(id, ADLB_ATOMIC_MAX, -11, 0, true, -10, false);
+  ADLB_CHECK(ac);
+  ac = check_int_op(id, ADLB_ATOMIC_MAX, 11, 0, true, -10, true);
+  ADLB_CHECK(ac);
+
+  // Read final value
+  ac = check_int_op(id, ADLB_ATOMIC_ADD, 0, 0, true, 11, true);
+  ADLB_CHECK(ac);
+
+  return ADLB_SUCCESS;
+}
+
+static adlb_code test_float(void)
+{
+  adlb_data_code dc;
+
+  adlb_datum_id id = dt_new_id();
+  adlb_create_props props = DEFAULT_CREATE_PROPS;
+  dc = xlb_data_create(id, ADLB_DATA_TYPE_FLOAT, NULL, &props);
+  ADLB_DATA_CHECK(dc);
+
+  adlb_atomic_value operand = { .FLOAT = 1.5 };
+  adlb_atomic_value compare = { .FLOAT = 0.0 };
+  adlb_atomic_value old_value;
+  bool old_set, updated;
+  adlb_notif_t notifs = ADLB_NO_NOTIFS;
+
+  for (int i = 0; i < 2; i++)
+  {
+    dc = xlb_data_atomic(id, ADLB_ATOMIC_ADD, ADLB_DATA_TYPE_FLOAT,
+              &operand, &compare, ADLB_NO_REFC, &old_value, &old_set,
+              &updated, &notifs);
+    ADLB_DATA_CHECK(dc);
+    CHECK_MSG(updated, "float add should update");
+  }
+  CHECK_MSG(old_set && old_value.FLOAT == 1.5,
+            "Expected old value 1.5 actual %f", old_value.FLOAT);
+
+  operand.FLOAT = 0.5;
+  compare.FLOAT = 3.0;
+  dc = xlb_data_atomic(id, ADLB_ATOMIC_CAS, ADLB_DATA_TYPE_FLOAT,
+            &operand, &compare, ADLB_NO_REFC, &old_value, &old_set,
+            &updated, &notifs);
+  ADLB_DATA_CHECK(dc);
+  CHECK_MSG(updated && old_value.FLOAT == 3.0,
+            "Expected CAS from 3.0, old value %f", old_value.FLOAT);
+
+  xlb_free_notif(&notifs);
+  return ADLB_SUCCESS;
+}
+
+static adlb_code test_errors(void)
+{
+  adlb_code ac;
+  adlb_data_code dc;
+
+  adlb_datum_id id = dt_new_id();
+  ac = dt_create_integer(id);
+  ADLB_CHECK(ac);
+
+  adlb_atomic_value operand = { .INTEGER = 1 };
+  adlb_atomic_value compare = { .INTEGER = 0 };
+  adlb_atomic_value old_value;
+  bool old_set, updated;
+  adlb_notif_t notifs = ADLB_NO_NOTIFS;
+
+  dc = xlb_data_atomic(id, ADLB_ATOMIC_ADD, ADLB_DATA_TYPE_FLOAT,
+            &operand, &compare, ADLB_NO_REFC, &old_value, &old_set,
+            &updated, &notifs);
+  CHECK_MSG(dc == ADLB_DATA_ERROR_TYPE,
+            "Expected type error, got %i", dc);
+
+  // Update and close datum in one operation
+  dc = xlb_data_atomic(id, ADLB_ATOMIC_ADD, ADLB_DATA_TYPE_INTEGER,
+            &operand, &compare, ADLB_WRITE_REFC, &old_value, &old_set,
+            &updated, &notifs);
+  ADLB_DATA_CHECK(dc);
+  CHECK_MSG(updated, "add should update");
+
+  dc = xlb_data_atomic(id, ADLB_ATOMIC_ADD, ADLB_DATA_TYPE_INTEGER,
+            &operand, &compare, ADLB_NO_REFC, &old_value, &old_set,
+            &updated, &notifs);
+  CHECK_MSG(dc == ADLB_DATA_ERROR_DOUBLE_WRITE,
+            "Expected double write error for closed datum, got %i", dc);
+
+  // Overflow must not change the value
+  adlb_datum_id big = dt_new_id();
+  ac = dt_create_integer(big);
+  ADLB_CHECK(ac);
+  ac = check_int_op(big, ADLB_ATOMIC_ADD, INT64_MAX - 1, 0, false, 0, true);
+  ADLB_CHECK(ac);
+  operand.INTEGER = 2;
+  dc = xlb_data_atomic(big, ADLB_ATOMIC_ADD, ADLB_DATA_TYPE_INTEGER,
+            &operand, &compare, ADLB_NO_REFC, &old_value, &old_set,
+            &updated, &notifs);
+  CHECK_MSG(dc == ADLB_DATA_ERROR_INVALID,
+            "Expected invalid error for overflow, got %i", dc);
+  ac = check_int_op(big, ADLB_ATOMIC_ADD, 1, 0, true, INT64_MAX - 1, true);
+  ADLB_CHECK(ac);
+
+  xlb_free_notif(&notifs);
+  return ADLB_SUCCESS;
+}
@@ -0,0 +1,220 @@
+/*
+ * Copyright 2015 University of Chicago and Argonne National Laboratory
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License
+ */
+
+
+/*
+ * data_lock.c
+ *
+ * Regression test for datum locks: FIFO wait queue, timeouts, and
+ * rejecting waits by the rank that holds the lock.
+ */
+#include <assert.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "common/dtests.h"
+
+#include "checks.h"
+#include "data.h"
+
+static adlb_code run(void);
+static adlb_code test_wait_queue(void);
+static adlb_code test_timeout(void);
+static adlb_code test_owner_wait(void);
+
+int main(int argc, char **argv)
+{
+  adlb_code ac = run();
+
+  if (ac != ADLB_SUCCESS) {
+    fprintf(stderr, "FAILED!: %i\n", ac);
+    return 1;
+  }
+
+  return 0;
+}
+
+static adlb_code run(void)
+{
+  adlb_code ac;
+
+  fprintf(stderr, "Initializing...\n");
+  ac = dt_init();
+  ADLB_CHECK(ac);
+
+  fprintf(stderr, "Testing wait queue...\n");
+  ac = test_wait_queue();
+  ADLB_CHECK(ac);
+
+  fprintf(stderr, "Testing timeout...\n");
+  ac = test_timeout();
+  ADLB_CHECK(ac);
+
+  fprintf(stderr, "Testing owner wait...\n");
+  ac = test_owner_wait();
+  ADLB_CHECK(ac);
+
+  fprintf(stderr, "Finalizing...\n");
+  ac = dt_finalize();
+  ADLB_CHECK(ac);
+
+  fprintf(stderr, "Done.\n");
+  return ADLB_SUCCESS;
+}
+
+/*
+  Waiters are granted the lock in the order they asked for it
+ */
+static adlb_code test_wait_queue(void)
+{
+  adlb_code ac;
+  adlb_data_code dc;
+  bool result;
+  int granted;
+
+  adlb_datum_id id = dt_new_id();
+  ac = dt_create_integer(id);
+  ADLB_CHECK(ac);
+
+  dc = xlb_data_lock(id, 0, false, -1.0, &result);
+  ADLB_DATA_CHECK(dc);
+  CHECK_MSG(result, "rank 0 should get free lock");
+
+  dc = xlb_data_lock(id, 1, false, -1.0, &result);
+  ADLB_DATA_CHECK(dc);
+  CHECK_MSG(!result, "rank 1 should not get held lock");
+
+  dc = xlb_data_lock(id, 2, true, -1.0, &result);
+  ADLB_DATA_CHECK(dc);
+  CHECK_MSG(!result, "rank 2 should be queued");
+
+  dc = xlb_data_lock(id, 1, true, -1.0, &result);
+  ADLB_DATA_CHECK(dc);
+  CHECK_MSG(!result, "rank 1 should be queued");
+
+  dc = xlb_data_unlock(id, &granted);
+  ADLB_DATA_CHECK(dc);
+  CHECK_MSG(granted == 2, "Expected grant to rank 2, got %i", granted);
+
+  dc = xlb_data_unlock(id, &granted);
+  ADLB_DATA_CHECK(dc);
+  CHECK_MSG(granted == 1, "Expected grant to rank 1, got %i", granted);
+
+  dc = xlb_data_unlock(id, &granted);
+  ADLB_DATA_CHECK(dc);
+  CHECK_MSG(granted == -1, "Expected no grant, got %i", granted);
+
+  // Lock is free again
+  dc = xlb_data_lock(id, 1, false, -1.0, &result);
+  ADLB_DATA_CHECK(dc);
+  CHECK_MSG(result, "rank 1 should get free lock");
+
+  dc = xlb_data_unlock(id, &granted);
+  ADLB_DATA_CHECK(dc);
+  CHECK_MSG(granted == -1, "Expected no grant, got %i", granted);
+
+  return ADLB_SUCCESS;
+}
+
+/*
+  Expired waiters are removed from the queue and skipped on unlock
+ */
+static adlb_code test_timeout(void)
+{
+  adlb_code ac;
+  adlb_data_code dc;
+  bool result;
+  int granted;
+  adlb_datum_id expired_id;
+  int expired_rank;
+
+  adlb_datum_id id = dt_new_id();
+  ac = dt_create_integer(id);
+  ADLB_CHECK(ac);
+
+  dc = xlb_data_lock(id, 0, true, -1.0, &result);
+  ADLB_DATA_CHECK(dc);
+  CHECK_MSG(result, "rank 0 should get free lock");
+
+  dc = xlb_data_lock(id, 1, true, 10.0, &result);
+  ADLB_DATA_CHECK(dc);
+  CHECK_MSG(!result, "rank 1 should be queued");
+
+  dc = xlb_data_lock(id, 2, true, 20.0, &result);
+  ADLB_DATA_CHECK(dc);
+  CHECK_MSG(!result, "rank 2 should be queued");
+
+  CHECK_MSG(!xlb_data_lock_expire(5.0, &expired_id, &expired_rank),
+            "No wait should have expired yet");
+
+  CHECK_MSG(xlb_data_lock_expire(15.0, &expired_id, &expired_rank),
+            "Wait by rank 1 should have expired");
+  CHECK_MSG(expired_id == id && expired_rank == 1,
+            "Wrong expired wait: "ADLB_PRID" rank %i",
+            ADLB_PRID_ARGS(expired_id, ADLB_DSYM_NULL), expired_rank);
+  CHECK_MSG(!xlb_data_lock_expire(15.0, &expired_id, &expired_rank),
+            "Only one wait should have expired");
+
+  dc = xlb_data_unlock(id, &granted);
+  ADLB_DATA_CHECK(dc);
+  CHECK_MSG(granted == 2, "Expected grant to rank 2, got %i", granted);
+
+  // Granted waiter no longer times out
+  CHECK_MSG(!xlb_data_lock_expire(25.0, &expired_id, &expired_rank),
+            "Granted wait should not expire");
+
+  dc = xlb_data_unlock(id, &granted);
+  ADLB_DATA_CHECK(dc);
+  CHECK_MSG(granted == -1, "Expected no grant, got %i", granted);
+
+  return ADLB_SUCCESS;
+}
+
+/*
+  The owner waiting for its own lock would never be granted it
+ */
+static adlb_code test_owner_wait(void)
+{
+  adlb_code ac;
+  adlb_data_code dc;
+  bool result;
+  int granted;
+
+  adlb_datum_id id = dt_new_id();
+  ac = dt_create_integer(id);
+  ADLB_CHECK(ac);
+
+  dc = xlb_data_lock(id, 0, false, -1.0, &result);
+  ADLB_DATA_CHECK(dc);
+  CHECK_MSG(result, "rank 0 should get free lock");
+
+  // Try lock by owner fails without error, as before
+  dc = xlb_data_lock(id, 0, false, -1.0, &result);
+  ADLB_DATA_CHECK(dc);
+  CHECK_MSG(!result, "rank 0 should not get held lock");
+
+  dc = xlb_data_lock(id, 0, true, -1.0, &result);
+  CHECK_MSG(dc == ADLB_DATA_ERROR_INVALID,
+            "Expected error for owner wait, got %i", dc);
+
+  // Owner was not queued
+  dc = xlb_data_unlock(id, &granted);
+  ADLB_DATA_CHECK(dc);
+  CHECK_MSG(granted == -1, "Expected no grant, got %i", granted);
+
+  return ADLB_SUCCESS;
+}
@@ -0,0 +1,160 @@
+/*
+ * Copyright 2015 University of Chicago and Argonne National Laboratory
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License
+ */
+
+
+/*
+ * data_pool.c
+ *
+ * Regression test for the slab pools for small data store objects.
+ * Live objects of every size must not overlap, freed objects must be
+ * reused safely, and xlb_pool_free() must accept malloc()ed memory.
+ */
+#include <inttypes.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "common.h"
+#include "checks.h"
+#include "pool.h"
+
+/** Sizes tested go past the largest pooled size */
+#define MAX_TEST_SIZE (XLB_POOL_MAX_SIZE + 64)
+/** Objects allocated of each size, more than fit in one slab */
+#define PER_SIZE 200
+#define OBJECTS (MAX_TEST_SIZE * PER_SIZE)
+
+static adlb_code run(void);
+static adlb_code test_alloc(void);
+
+int main(int argc, char **argv)
+{
+  adlb_code ac = run();
+
+  if (ac != ADLB_SUCCESS) {
+    fprintf(stderr, "FAILED!: %i\n", ac);
+    return 1;
+  }
+
+  return 0;
+}
+
+static adlb_code run(void)
+{
+  adlb_code ac;
+
+  fprintf(stderr, "Initializing...\n");
+  ac = xlb_pool_init();
+  ADLB_CHECK(ac);
+
+  fprintf(stderr, "Testing allocation...\n");
+  ac = test_alloc();
+  ADLB_CHECK(ac);
+
+  fprintf(stderr, "Finalizing...\n");
+  xlb_pool_finalize();
+
+  fprintf(stderr, "Done.\n");
+  return ADLB_SUCCESS;
+}
+
+typedef struct
+{
+  unsigned char *p;
+  size_t size;
+} object;
+
+static object objects[OBJECTS];
+
+/** Fill object i with a byte pattern unique to it */
+static void fill(int i)
+{
+  for (size_t j = 0; j < objects[i].size; j++)
+    objects[i].p[j] = (unsigned char)(i + j);
+}
+
+static adlb_code check_fill(int i)
+{
+  for (size_t j = 0; j < objects[i].size; j++)
+  {
+    CHECK_MSG(objects[i].p[j] == (unsigned char)(i + j),
+              "object %i of size %zu overwritten at %zu", i,
+              objects[i].size, j);
+  }
+  return ADLB_SUCCESS;
+}
+
+static adlb_code alloc(int i, size_t size)
+{
+  objects[i].size = size;
+  objects[i].p = xlb_pool_alloc(size);
+  CHECK_MSG(objects[i].p != NULL, "alloc of %zu failed", size);
+  CHECK_MSG(((uintptr_t)objects[i].p) % sizeof(void*) == 0,
+            "object of size %zu misaligned", size);
+  fill(i);
+  return ADLB_SUCCESS;
+}
+
+static adlb_code test_alloc(void)
+{
+  adlb_code ac;
+
+  // Interleave sizes so that slabs of all classes fill up together
+  for (int i = 0; i < OBJECTS; i++)
+  {
+    ac = alloc(i, (size_t)(i % MAX_TEST_SIZE) + 1);
+    ADLB_CHECK(ac);
+  }
+  for (int i = 0; i < OBJECTS; i++)
+  {
+    ac = check_fill(i);
+    ADLB_CHECK(ac);
+  }
+
+  // Free every other object, then reallocate into the holes
+  for (int i = 0; i < OBJECTS; i += 2)
+  {
+    xlb_pool_free(objects[i].p);
+  }
+  for (int i = 0; i < OBJECTS; i += 2)
+  {
+    ac = alloc(i, objects[i].size);
+    ADLB_CHECK(ac);
+  }
+  for (int i = 0; i < OBJECTS; i++)
+  {
+    ac = check_fill(i);
+    ADLB_CHECK(ac);
+  }
+
+  // Values unpacked without copying are malloc()ed
+  for (size_t size = 1; size <= MAX_TEST_SIZE; size++)
+  {
+    void *p = malloc(size);
+    CHECK_MSG(p != NULL, "malloc failed");
+    xlb_pool_free(p);
+  }
+
+  // Freeing everything empties the slabs, which are released
+  for (int i = 0; i < OBJECTS; i++)
+  {
+    xlb_pool_free(objects[i].p);
+  }
+
+  return ADLB_SUCCESS;
+}
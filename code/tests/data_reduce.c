@@ -0,0 +1,283 @@
+/*
+ * Copyright 2015 University of Chicago and Argonne National Laboratory
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License
+ */
+
+
+/*
+ * data_reduce.c
+ *
+ * Regression test for server-side reductions over containers and
+ * multisets.
+ */
+#include <assert.h>
+#include <inttypes.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "common/dtests.h"
+
+#include "checks.h"
+#include "data.h"
+
+static adlb_code run(void);
+static adlb_code test_container(void);
+static adlb_code test_float(void);
+static adlb_code test_on_close(void);
+static adlb_code test_errors(void);
+
+int main(int argc, char **argv)
+{
+  adlb_code ac = run();
+
+  if (ac != ADLB_SUCCESS) {
+    fprintf(stderr, "FAILED!: %i\n", ac);
+    return 1;
+  }
+
+  return 0;
+}
+
+static adlb_code run(void)
+{
+  adlb_code ac;
+
+  fprintf(stderr, "Initializing...\n");
+  ac = dt_init();
+  ADLB_CHECK(ac);
+
+  fprintf(stderr, "Testing container...\n");
+  ac = test_container();
+  ADLB_CHECK(ac);
+
+  fprintf(stderr, "Testing float...\n");
+  ac = test_float();
+  ADLB_CHECK(ac);
+
+  fprintf(stderr, "Testing reduce on close...\n");
+  ac = test_on_close();
+  ADLB_CHECK(ac);
+
+  fprintf(stderr, "Testing errors...\n");
+  ac = test_errors();
+  ADLB_CHECK(ac);
+
+  fprintf(stderr, "Finalizing...\n");
+  ac = dt_finalize();
+  ADLB_CHECK(ac);
+
+  fprintf(stderr, "Done.\n");
+  return ADLB_SUCCESS;
+}
+
+/*
+  Create container with integer values 0..n-1 at keys 0..n-1
+ */
+static adlb_code make_int_container(int n, adlb_datum_id *id)
+{
+  adlb_code ac;
+  char key[DT_INT_KEY_MAX];
+
+  *id = dt_new_id();
+  ac = dt_create_container(*id, ADLB_DATA_TYPE_INTEGER,
+                           ADLB_DATA_TYPE_INTEGER, false);
+  ADLB_CHECK(ac);
+
+  for (int i = 0; i < n; i++)
+  {
+    ac = dt_store_integer(*id, dt_int_key(i, key), i);
+    ADLB_CHECK(ac);
+  }
+  return ADLB_SUCCESS;
+}
+
+static adlb_code test_container(void)
+{
+  adlb_code ac;
+  adlb_data_code dc;
+  adlb_datum_id id;
+  adlb_reduce_result result;
+  adlb_reduce_spec spec = { .op = ADLB_REDUCE_COUNT };
+  char key[DT_INT_KEY_MAX];
+
+  ac = make_int_container(10, &id);
+  ADLB_CHECK(ac);
+
+  // Reserved member without value is skipped
+  bool created, value_present;
+  dc = xlb_data_insert_atomic(id, dt_int_key(100, key), &created,
+                              &value_present);
+  ADLB_DATA_CHECK(dc);
+  CHECK_MSG(created && !value_present, "Expected reserved member");
+
+  dc = xlb_data_reduce(id, &spec, &result);
+  ADLB_DATA_CHECK(dc);
+  CHECK_MSG(result.count == 10, "Expected count 10 actual %"PRId64,
+            result.count);
+
+  spec.op = ADLB_REDUCE_SUM;
+  dc = xlb_data_reduce(id, &spec, &result);
+  ADLB_DATA_CHECK(dc);
+  CHECK_MSG(result.type == ADLB_DATA_TYPE_INTEGER &&
+            result.value.INTEGER == 45,
+            "Expected sum 45 actual %"PRId64, result.value.INTEGER);
+
+  spec.op = ADLB_REDUCE_MIN;
+  dc = xlb_data_reduce(id, &spec, &result);
+  ADLB_DATA_CHECK(dc);
+  CHECK_MSG(result.value.INTEGER == 0,
+            "Expected min 0 actual %"PRId64, result.value.INTEGER);
+
+  spec.op = ADLB_REDUCE_MAX;
+  dc = xlb_data_reduce(id, &spec, &result);
+  ADLB_DATA_CHECK(dc);
+  CHECK_MSG(result.value.INTEGER == 9,
+            "Expected max 9 actual %"PRId64, result.value.INTEGER);
+
+  // Values outside [2, 8) are counted separately
+  spec.op = ADLB_REDUCE_HISTOGRAM;
+  spec.hist_lo = 2.0;
+  spec.hist_hi = 8.0;
+  spec.hist_bins = 3;
+  dc = xlb_data_reduce(id, &spec, &result);
+  ADLB_DATA_CHECK(dc);
+  CHECK_MSG(result.hist_under == 2 && result.hist_over == 2,
+            "Expected 2 under and 2 over, actual %"PRId64" and %"PRId64,
+            result.hist_under, result.hist_over);
+  for (int b = 0; b < spec.hist_bins; b++)
+  {
+    CHECK_MSG(result.hist[b] == 2, "Expected 2 in bin %i actual %"PRId64,
+              b, result.hist[b]);
+  }
+
+  return ADLB_SUCCESS;
+}
+
+static adlb_code test_float(void)
+{
+  adlb_code ac;
+  adlb_data_code dc;
+  char key[DT_INT_KEY_MAX];
+
+  adlb_datum_id id = dt_new_id();
+  ac = dt_create_container(id, ADLB_DATA_TYPE_INTEGER,
+                           ADLB_DATA_TYPE_FLOAT, false);
+  ADLB_CHECK(ac);
+
+  adlb_notif_t notifs = ADLB_NO_NOTIFS;
+  for (int i = 0; i < 4; i++)
+  {
+    double x = 0.25 * i;
+    dc = xlb_data_store(id, dt_int_key(i, key), &x, sizeof(x), true,
+              NULL, ADLB_DATA_TYPE_FLOAT, ADLB_NO_REFC, ADLB_NO_REFC,
+              &notifs);
+    ADLB_DATA_CHECK(dc);
+  }
+  xlb_free_notif(&notifs);
+
+  adlb_reduce_spec spec = { .op = ADLB_REDUCE_SUM };
+  adlb_reduce_result result;
+  dc = xlb_data_reduce(id, &spec, &result);
+  ADLB_DATA_CHECK(dc);
+  CHECK_MSG(result.type == ADLB_DATA_TYPE_FLOAT &&
+            result.value.FLOAT == 1.5,
+            "Expected sum 1.5 actual %f", result.value.FLOAT);
+
+  spec.op = ADLB_REDUCE_MAX;
+  dc = xlb_data_reduce(id, &spec, &result);
+  ADLB_DATA_CHECK(dc);
+  CHECK_MSG(result.value.FLOAT == 0.75,
+            "Expected max 0.75 actual %f", result.value.FLOAT);
+
+  return ADLB_SUCCESS;
+}
+
+/*
+  Reduction registered on open container is returned as a store to
+  the result datum when the container closes
+ */
+static adlb_code test_on_close(void)
+{
+  adlb_code ac;
+  adlb_data_code dc;
+  adlb_datum_id id;
+
+  ac = make_int_container(5, &id);
+  ADLB_CHECK(ac);
+
+  adlb_datum_id result_id = dt_new_id();
+  ac = dt_create_integer(result_id);
+  ADLB_CHECK(ac);
+
+  adlb_notif_t notifs = ADLB_NO_NOTIFS;
+  adlb_reduce_spec spec = { .op = ADLB_REDUCE_SUM };
+  dc = xlb_data_reduce_on_close(id, &spec, result_id, 1, &notifs);
+  ADLB_DATA_CHECK(dc);
+  CHECK_MSG(xlb_notif_empty(&notifs),
+            "Open container should not be reduced yet");
+
+  adlb_refc decr = { .read_refcount = 0, .write_refcount = -1 };
+  dc = xlb_data_reference_count(id, decr, XLB_NO_ACQUIRE, NULL, &notifs);
+  ADLB_DATA_CHECK(dc);
+
+  CHECK_MSG(notifs.references.count == 1,
+            "Expected 1 store of result, got %i", notifs.references.count);
+  adlb_ref_datum *ref = &notifs.references.data[0];
+  CHECK_MSG(ref->id == result_id && ref->type == ADLB_DATA_TYPE_INTEGER &&
+            ref->write_decr == 1, "Wrong store of result");
+
+  adlb_int_t sum;
+  dc = ADLB_Unpack_integer(&sum, ref->value, ref->value_len);
+  ADLB_DATA_CHECK(dc);
+  CHECK_MSG(sum == 10, "Expected sum 10 actual %"PRId64, sum);
+
+  xlb_free_notif(&notifs);
+  return ADLB_SUCCESS;
+}
+
+static adlb_code test_errors(void)
+{
+  adlb_code ac;
+  adlb_data_code dc;
+  adlb_reduce_result result;
+
+  adlb_datum_id id = dt_new_id();
+  ac = dt_create_container(id, ADLB_DATA_TYPE_STRING,
+                           ADLB_DATA_TYPE_STRING, false);
+  ADLB_CHECK(ac);
+
+  // Only COUNT works on non-numeric values
+  adlb_reduce_spec spec = { .op = ADLB_REDUCE_COUNT };
+  dc = xlb_data_reduce(id, &spec, &result);
+  ADLB_DATA_CHECK(dc);
+  CHECK_MSG(result.count == 0, "Expected empty container");
+
+  spec.op = ADLB_REDUCE_SUM;
+  dc = xlb_data_reduce(id, &spec, &result);
+  CHECK_MSG(dc == ADLB_DATA_ERROR_TYPE, "Expected type error, got %i", dc);
+
+  ac = make_int_container(1, &id);
+  ADLB_CHECK(ac);
+
+  spec.op = ADLB_REDUCE_HISTOGRAM;
+  spec.hist_lo = 1.0;
+  spec.hist_hi = 0.0;
+  spec.hist_bins = 4;
+  dc = xlb_data_reduce(id, &spec, &result);
+  CHECK_MSG(dc == ADLB_DATA_ERROR_INVALID,
+            "Expected invalid histogram error, got %i", dc);
+
+  return ADLB_SUCCESS;
+}
@@ -0,0 +1,230 @@
+/*
+ * Copyright 2015 University of Chicago and Argonne National Laboratory
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License
+ */
+
+
+/*
+ * datum_table.c
+ *
+ * Regression test for the paged datum table.  Ids handed out to this
+ * server must be stored in pages, other ids in the hash table, and
+ * every datum must be found, iterated and removed wherever it is.
+ */
+#include <inttypes.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "common.h"
+#include "checks.h"
+#include "datum_table.h"
+
+#define SERVERS 4
+#define SERVER_NUM 1
+/** Ids of each kind added, spanning several pages */
+#define COUNT 5000
+
+static adlb_code run(void);
+static adlb_code test_unique(void);
+static adlb_code test_reserved(void);
+
+int main(int argc, char **argv)
+{
+  adlb_code ac = run();
+
+  if (ac != ADLB_SUCCESS) {
+    fprintf(stderr, "FAILED!: %i\n", ac);
+    return 1;
+  }
+
+  return 0;
+}
+
+static adlb_code run(void)
+{
+  adlb_code ac;
+
+  fprintf(stderr, "Testing unique ids...\n");
+  ac = test_unique();
+  ADLB_CHECK(ac);
+
+  fprintf(stderr, "Testing reserved ids...\n");
+  ac = test_reserved();
+  ADLB_CHECK(ac);
+
+  fprintf(stderr, "Done.\n");
+  return ADLB_SUCCESS;
+}
+
+/** Distinct non-null datum for each id */
+static void *id_datum(adlb_datum_id id)
+{
+  return (void*)(intptr_t)(id * 2 + 1);
+}
+
+static adlb_code add(xlb_datum_table *t, adlb_datum_id id)
+{
+  bool ok = xlb_datum_table_add(t, id, id_datum(id));
+  CHECK_MSG(ok, "add <%"PRId64"> failed", id);
+  return ADLB_SUCCESS;
+}
+
+static adlb_code check(const xlb_datum_table *t, adlb_datum_id id,
+                       bool present)
+{
+  void *datum;
+  bool found = xlb_datum_table_search(t, id, &datum);
+  CHECK_MSG(found == present, "<%"PRId64">: expected present %i",
+            id, (int)present);
+  CHECK_MSG(!found || datum == id_datum(id), "<%"PRId64">: wrong datum",
+            id);
+  return ADLB_SUCCESS;
+}
+
+static adlb_code remove_id(xlb_datum_table *t, adlb_datum_id id)
+{
+  void *datum;
+  bool found = xlb_datum_table_remove(t, id, &datum);
+  CHECK_MSG(found && datum == id_datum(id), "remove <%"PRId64"> failed",
+            id);
+  return ADLB_SUCCESS;
+}
+
+/*
+  Count data seen by iterator
+ */
+static int64_t iter_count(xlb_datum_table *t)
+{
+  xlb_datum_iter it;
+  xlb_datum_iter_init(t, &it);
+  int64_t count = 0;
+  while (xlb_datum_iter_next(t, &it))
+  {
+    if (it.datum == id_datum(it.id))
+      count++;
+  }
+  return count;
+}
+
+/*
+  Positive ids as from xlb_data_unique(), plus ids from other servers
+  and far-off ids, which must go in the hash table
+ */
+static adlb_code test_unique(void)
+{
+  adlb_code ac;
+  xlb_datum_table t;
+  bool ok = xlb_datum_table_init(&t, SERVERS, SERVER_NUM, 16);
+  CHECK_MSG(ok, "init failed");
+
+  for (int64_t i = 0; i < COUNT; i++)
+  {
+    ac = add(&t, i * SERVERS + SERVER_NUM);
+    ADLB_CHECK(ac);
+  }
+  CHECK_MSG(t.paged_adds == COUNT && t.sparse_adds == 0,
+            "expected %i paged adds, got %"PRId64" paged %"PRId64
+            " sparse", COUNT, t.paged_adds, t.sparse_adds);
+
+  adlb_datum_id other = 2 * SERVERS + SERVER_NUM + 1;
+  adlb_datum_id far = ((int64_t)1 << 40) * SERVERS + SERVER_NUM;
+  ac = add(&t, other);
+  ADLB_CHECK(ac);
+  ac = add(&t, far);
+  ADLB_CHECK(ac);
+  CHECK_MSG(t.sparse_adds == 2, "expected 2 sparse adds, got %"PRId64,
+            t.sparse_adds);
+
+  for (int64_t i = 0; i < COUNT; i++)
+  {
+    ac = check(&t, i * SERVERS + SERVER_NUM, true);
+    ADLB_CHECK(ac);
+  }
+  ac = check(&t, other, true);
+  ADLB_CHECK(ac);
+  ac = check(&t, far, true);
+  ADLB_CHECK(ac);
+  ac = check(&t, COUNT * SERVERS + SERVER_NUM, false);
+  ADLB_CHECK(ac);
+  ac = check(&t, 0, false);
+  ADLB_CHECK(ac);
+
+  CHECK_MSG(iter_count(&t) == COUNT + 2, "iterated %"PRId64" data",
+            iter_count(&t));
+
+  // Remove the first half, which empties the first pages
+  for (int64_t i = 0; i < COUNT / 2; i++)
+  {
+    ac = remove_id(&t, i * SERVERS + SERVER_NUM);
+    ADLB_CHECK(ac);
+  }
+  ac = remove_id(&t, other);
+  ADLB_CHECK(ac);
+
+  for (int64_t i = 0; i < COUNT; i++)
+  {
+    ac = check(&t, i * SERVERS + SERVER_NUM, i >= COUNT / 2);
+    ADLB_CHECK(ac);
+  }
+  ac = check(&t, other, false);
+  ADLB_CHECK(ac);
+  CHECK_MSG(iter_count(&t) == COUNT - COUNT / 2 + 1,
+            "iterated %"PRId64" data", iter_count(&t));
+
+  xlb_datum_table_free_callback(&t, NULL);
+  return ADLB_SUCCESS;
+}
+
+/*
+  Negative ids as from xlb_data_system_reserve()
+ */
+static adlb_code test_reserved(void)
+{
+  adlb_code ac;
+  xlb_datum_table t;
+  bool ok = xlb_datum_table_init(&t, SERVERS, SERVER_NUM, 16);
+  CHECK_MSG(ok, "init failed");
+
+  for (int64_t i = 1; i <= COUNT; i++)
+  {
+    ac = add(&t, -i);
+    ADLB_CHECK(ac);
+  }
+  // Reserved ranges are contiguous, so all ids fit in pages
+  CHECK_MSG(t.paged_adds == COUNT, "expected %i paged adds, got %"PRId64,
+            COUNT, t.paged_adds);
+
+  for (int64_t i = 1; i <= COUNT; i++)
+  {
+    ac = check(&t, -i, true);
+    ADLB_CHECK(ac);
+  }
+  CHECK_MSG(iter_count(&t) == COUNT, "iterated %"PRId64" data",
+            iter_count(&t));
+
+  for (int64_t i = 1; i <= COUNT; i += 2)
+  {
+    ac = remove_id(&t, -i);
+    ADLB_CHECK(ac);
+  }
+  for (int64_t i = 1; i <= COUNT; i++)
+  {
+    ac = check(&t, -i, i % 2 == 0);
+    ADLB_CHECK(ac);
+  }
+
+  xlb_datum_table_free_callback(&t, NULL);
+  return ADLB_SUCCESS;
+}
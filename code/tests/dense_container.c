@@ -0,0 +1,240 @@
+/*
+ * Copyright 2015 University of Chicago and Argonne National Laboratory
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License
+ */
+
+
+/*
+ * dense_container.c
+ *
+ * Regression test for dense storage of integer-keyed container
+ * members, cf. container.h.  Dense members are iterated in key order,
+ * which is used to check that keys were stored densely.
+ */
+#include <inttypes.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "checks.h"
+#include "container.h"
+
+/** Number of keys added by each test */
+#define KEY_COUNT 1000
+
+static adlb_code run(void);
+static adlb_code test_ascending(void);
+static adlb_code test_offset(void);
+static adlb_code test_descending(void);
+static adlb_code test_sparse(void);
+
+int main(int argc, char **argv)
+{
+  adlb_code ac = run();
+
+  if (ac != ADLB_SUCCESS) {
+    fprintf(stderr, "FAILED!: %i\n", ac);
+    return 1;
+  }
+
+  return 0;
+}
+
+static adlb_code run(void)
+{
+  adlb_code ac;
+
+  fprintf(stderr, "Testing ascending keys...\n");
+  ac = test_ascending();
+  ADLB_CHECK(ac);
+
+  fprintf(stderr, "Testing keys not starting at zero...\n");
+  ac = test_offset();
+  ADLB_CHECK(ac);
+
+  fprintf(stderr, "Testing descending keys...\n");
+  ac = test_descending();
+  ADLB_CHECK(ac);
+
+  fprintf(stderr, "Testing sparse keys...\n");
+  ac = test_sparse();
+  ADLB_CHECK(ac);
+
+  fprintf(stderr, "Done.\n");
+  return ADLB_SUCCESS;
+}
+
+static adlb_code init_container(adlb_container *c)
+{
+  c->key_type = ADLB_DATA_TYPE_INTEGER;
+  c->val_type = ADLB_DATA_TYPE_INTEGER;
+  adlb_data_code dc = xlb_members_init(c, true);
+  CHECK_MSG(dc == ADLB_DATA_SUCCESS, "Error initializing members");
+  return ADLB_SUCCESS;
+}
+
+/*
+  Reserve key in container: no value, so no value ownership
+ */
+static adlb_code add_key(adlb_container *c, int64_t key)
+{
+  char buf[XLB_DENSE_KEY_MAX];
+  int len = sprintf(buf, "%"PRId64, key);
+  adlb_data_code dc = xlb_members_add(c, buf, (size_t)len + 1, NULL,
+                                     NULL);
+  CHECK_MSG(dc == ADLB_DATA_SUCCESS, "Error adding key %"PRId64, key);
+  return ADLB_SUCCESS;
+}
+
+static adlb_code check_key(const adlb_container *c, int64_t key)
+{
+  char buf[XLB_DENSE_KEY_MAX];
+  int len = sprintf(buf, "%"PRId64, key);
+  adlb_container_val val;
+  bool found = xlb_members_lookup(c, buf, (size_t)len + 1, &val);
+  CHECK_MSG(found, "Key %"PRId64" not found", key);
+  CHECK_MSG(val == NULL, "Key %"PRId64" should have no value", key);
+  return ADLB_SUCCESS;
+}
+
+/*
+  Check container has keys first, first+1, ... in that order, as
+  when all are stored densely
+ */
+static adlb_code check_dense_range(const adlb_container *c,
+                                   int64_t first, int count)
+{
+  CHECK_MSG(xlb_members_size(c) == count, "Expected %i members, got %i",
+            count, xlb_members_size(c));
+
+  xlb_members_iter it;
+  xlb_members_iter_init(&it);
+  int64_t expected = first;
+  while (xlb_members_iter_next(c, &it))
+  {
+    int64_t key = strtoll(it.key, NULL, 10);
+    CHECK_MSG(key == expected, "Expected key %"PRId64", got %"PRId64
+              ": not stored densely", expected, key);
+    CHECK_MSG(it.inline_val, "Key %"PRId64" not stored densely", key);
+    expected++;
+  }
+  CHECK_MSG(expected == first + count, "Iterated over %"PRId64" keys",
+            expected - first);
+
+  for (int i = 0; i < count; i++)
+  {
+    adlb_code ac = check_key(c, first + i);
+    ADLB_CHECK(ac);
+  }
+  return ADLB_SUCCESS;
+}
+
+static adlb_code test_ascending(void)
+{
+  adlb_code ac;
+  adlb_container c;
+  ac = init_container(&c);
+  ADLB_CHECK(ac);
+
+  for (int i = 0; i < KEY_COUNT; i++)
+  {
+    ac = add_key(&c, i);
+    ADLB_CHECK(ac);
+  }
+
+  ac = check_dense_range(&c, 0, KEY_COUNT);
+  ADLB_CHECK(ac);
+
+  xlb_members_free(&c);
+  return ADLB_SUCCESS;
+}
+
+/*
+  Keys far from zero, e.g. from an offset range
+ */
+static adlb_code test_offset(void)
+{
+  adlb_code ac;
+  adlb_container c;
+  ac = init_container(&c);
+  ADLB_CHECK(ac);
+
+  int64_t first = 1000000;
+  for (int i = 0; i < KEY_COUNT; i++)
+  {
+    ac = add_key(&c, first + i);
+    ADLB_CHECK(ac);
+  }
+
+  ac = check_dense_range(&c, first, KEY_COUNT);
+  ADLB_CHECK(ac);
+
+  xlb_members_free(&c);
+  return ADLB_SUCCESS;
+}
+
+/*
+  Keys added in descending order, e.g. by a reverse loop
+ */
+static adlb_code test_descending(void)
+{
+  adlb_code ac;
+  adlb_container c;
+  ac = init_container(&c);
+  ADLB_CHECK(ac);
+
+  int64_t first = 5000;
+  for (int i = KEY_COUNT - 1; i >= 0; i--)
+  {
+    ac = add_key(&c, first + i);
+    ADLB_CHECK(ac);
+  }
+
+  ac = check_dense_range(&c, first, KEY_COUNT);
+  ADLB_CHECK(ac);
+
+  xlb_members_free(&c);
+  return ADLB_SUCCESS;
+}
+
+/*
+  Keys far apart are still found when stored in hash table
+ */
+static adlb_code test_sparse(void)
+{
+  adlb_code ac;
+  adlb_container c;
+  ac = init_container(&c);
+  ADLB_CHECK(ac);
+
+  int64_t stride = 1000000;
+  for (int i = 0; i < KEY_COUNT; i++)
+  {
+    ac = add_key(&c, i * stride);
+    ADLB_CHECK(ac);
+  }
+
+  CHECK_MSG(xlb_members_size(&c) == KEY_COUNT,
+            "Expected %i members, got %i", KEY_COUNT,
+            xlb_members_size(&c));
+  for (int i = 0; i < KEY_COUNT; i++)
+  {
+    ac = check_key(&c, i * stride);
+    ADLB_CHECK(ac);
+  }
+
+  xlb_members_free(&c);
+  return ADLB_SUCCESS;
+}
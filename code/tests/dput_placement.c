@@ -0,0 +1,302 @@
+/*
+ * Copyright 2015 University of Chicago and Argonne National Laboratory
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License
+ */
+
+
+/*
+ * dput_placement.c
+ *
+ * Regression test for placing data-dependent tasks on their inputs'
+ * server, cf. ADLB_DPUT_PLACEMENT.  Workers put tasks whose inputs are
+ * all on one server, split between servers, or container members.
+ * Every task must run once, after its inputs are closed, and targeted
+ * tasks must still run on their target.  Run with at least two
+ * servers.
+ */
+#include <inttypes.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include <mpi.h>
+#include <adlb.h>
+
+#include "common/mtests.h"
+
+/** Number of data created by each worker */
+#define DATA_COUNT 24
+/** Number of data-dependent tasks put by each worker */
+#define TASK_COUNT 24
+/** Max inputs of each task */
+#define MAX_INPUTS 3
+
+/** Task payload: describes the inputs to check */
+typedef struct
+{
+  int target;
+  int id_count;
+  adlb_datum_id ids[MAX_INPUTS];
+  // Container member input, if container is not ADLB_DATA_ID_NULL
+  adlb_datum_id container;
+  int64_t key;
+} task;
+
+static adlb_code run(MPI_Comm worker_comm);
+
+int
+main()
+{
+  int mpi_argc = 0;
+  char** mpi_argv = NULL;
+  MPI_Init(&mpi_argc, &mpi_argv);
+
+  setenv("ADLB_DPUT_PLACEMENT", "1", 1);
+
+  int types[1] = {0};
+  int nservers = 2;
+  int am_server;
+  MPI_Comm worker_comm;
+  adlb_code ac = ADLB_Init(nservers, 1, types, &am_server,
+                           MPI_COMM_WORLD, &worker_comm);
+  if (ac != ADLB_SUCCESS)
+  {
+    fprintf(stderr, "ADLB_Init failed\n");
+    return 1;
+  }
+
+  if (am_server)
+  {
+    ac = ADLB_Server(1);
+  }
+  else
+  {
+    ac = run(worker_comm);
+    if (ac != ADLB_SUCCESS)
+    {
+      fprintf(stderr, "FAILED!: %i\n", ac);
+    }
+  }
+
+  ADLB_Finalize();
+  MPI_Finalize();
+  return (ac == ADLB_SUCCESS) ? 0 : 1;
+}
+
+/*
+  Pick up to count ids from ids located on server, starting from a
+  different position for each task
+  return: number of ids picked
+ */
+static int
+pick_on_server(const adlb_datum_id *ids, int server, int start,
+               int count, adlb_datum_id *out)
+{
+  int picked = 0;
+  for (int i = 0; i < DATA_COUNT && picked < count; i++)
+  {
+    adlb_datum_id id = ids[(start + i) % DATA_COUNT];
+    if (ADLB_Locate(id) == server)
+      out[picked++] = id;
+  }
+  return picked;
+}
+
+/*
+  Put task i.  Tasks cycle through inputs all on one server, inputs
+  split between two servers, and a single container member.  Odd
+  tasks are targeted at the next worker.
+ */
+static adlb_code
+put_task(int i, int rank, int workers, const adlb_datum_id *ids,
+         adlb_datum_id container)
+{
+  int servers[2] = { ADLB_Locate(ids[0]), ADLB_Locate(ids[1]) };
+
+  task t;
+  t.target = (i % 2 == 1) ? (rank + 1) % workers : ADLB_RANK_ANY;
+  t.id_count = 0;
+  t.container = ADLB_DATA_ID_NULL;
+  t.key = -1;
+
+  switch (i % 3)
+  {
+    case 0:
+      t.id_count = pick_on_server(ids, servers[(i / 3) % 2], i,
+                                  MAX_INPUTS, t.ids);
+      break;
+    case 1:
+      t.id_count = pick_on_server(ids, servers[0], i, 1, t.ids);
+      t.id_count += pick_on_server(ids, servers[1], i, 1,
+                                   &t.ids[t.id_count]);
+      break;
+    case 2:
+      t.container = container;
+      t.key = i;
+      break;
+  }
+
+  char key_buf[32];
+  adlb_datum_id_sub id_sub;
+  int id_sub_count = 0;
+  if (t.container != ADLB_DATA_ID_NULL)
+  {
+    int len = sprintf(key_buf, "%"PRId64, t.key);
+    id_sub.id = t.container;
+    id_sub.subscript.key = key_buf;
+    id_sub.subscript.length = (size_t)len + 1;
+    id_sub_count = 1;
+  }
+
+  adlb_code ac = ADLB_Dput(&t, (int)sizeof(t), t.target, -1, 0,
+                ADLB_DEFAULT_PUT_OPTS, "dput_placement", t.ids,
+                t.id_count, &id_sub, id_sub_count);
+  TEST_RC(ac);
+  return ADLB_SUCCESS;
+}
+
+static adlb_code
+store_integer(adlb_datum_id id, adlb_subscript sub, int64_t val,
+              adlb_refc decr)
+{
+  adlb_code ac = ADLB_Store(id, sub, ADLB_DATA_TYPE_INTEGER, &val,
+                            sizeof(val), decr, ADLB_NO_REFC);
+  TEST_RC(ac);
+  return ADLB_SUCCESS;
+}
+
+static adlb_code
+check_integer(adlb_datum_id id, adlb_subscript sub, int64_t expected)
+{
+  int64_t result[8];
+  size_t length;
+  adlb_data_type type;
+  adlb_code ac = ADLB_Retrieve(id, sub, ADLB_RETRIEVE_NO_REFC, &type,
+                               result, &length);
+  TEST_RC(ac);
+  TEST_CHECK(type == ADLB_DATA_TYPE_INTEGER &&
+             length == sizeof(int64_t) && result[0] == expected,
+             "Wrong value retrieved for <%"PRId64">", id);
+  return ADLB_SUCCESS;
+}
+
+/*
+  Run task: check target and that all inputs are closed
+ */
+static adlb_code
+run_task(const task *t, int rank)
+{
+  adlb_code ac;
+  TEST_CHECK(t->target == ADLB_RANK_ANY || t->target == rank,
+             "task for rank %i ran on %i", t->target, rank);
+
+  for (int i = 0; i < t->id_count; i++)
+  {
+    ac = check_integer(t->ids[i], ADLB_NO_SUB, t->ids[i]);
+    TEST_RC(ac);
+  }
+
+  if (t->container != ADLB_DATA_ID_NULL)
+  {
+    char key_buf[32];
+    int len = sprintf(key_buf, "%"PRId64, t->key);
+    adlb_subscript sub = { .key = key_buf, .length = (size_t)len + 1 };
+    ac = check_integer(t->container, sub, t->key);
+    TEST_RC(ac);
+  }
+  return ADLB_SUCCESS;
+}
+
+static adlb_code
+run(MPI_Comm worker_comm)
+{
+  adlb_code ac;
+  int rank, workers;
+  MPI_Comm_rank(worker_comm, &rank);
+  MPI_Comm_size(worker_comm, &workers);
+
+  // ADLB_Unique() assigns ids round-robin, so consecutive data live
+  // on different servers
+  adlb_datum_id ids[DATA_COUNT];
+  for (int i = 0; i < DATA_COUNT; i++)
+  {
+    ac = ADLB_Unique(&ids[i]);
+    TEST_RC(ac);
+    ac = ADLB_Create_integer(ids[i], DEFAULT_CREATE_PROPS, NULL);
+    TEST_RC(ac);
+  }
+  TEST_CHECK(ADLB_Locate(ids[0]) != ADLB_Locate(ids[1]),
+             "consecutive data on the same server");
+
+  adlb_datum_id container;
+  ac = ADLB_Unique(&container);
+  TEST_RC(ac);
+  ac = ADLB_Create_container(container, ADLB_DATA_TYPE_INTEGER,
+                  ADLB_DATA_TYPE_INTEGER, DEFAULT_CREATE_PROPS, NULL);
+  TEST_RC(ac);
+
+  // Close the first data before putting tasks, the rest after
+  int stored_early = DATA_COUNT / 4;
+  for (int i = 0; i < stored_early; i++)
+  {
+    ac = store_integer(ids[i], ADLB_NO_SUB, ids[i], ADLB_WRITE_REFC);
+    TEST_RC(ac);
+  }
+
+  for (int i = 0; i < TASK_COUNT; i++)
+  {
+    ac = put_task(i, rank, workers, ids, container);
+    TEST_RC(ac);
+  }
+
+  for (int i = stored_early; i < DATA_COUNT; i++)
+  {
+    ac = store_integer(ids[i], ADLB_NO_SUB, ids[i], ADLB_WRITE_REFC);
+    TEST_RC(ac);
+  }
+  for (int i = 2; i < TASK_COUNT; i += 3)
+  {
+    char key_buf[32];
+    int len = sprintf(key_buf, "%i", i);
+    adlb_subscript sub = { .key = key_buf, .length = (size_t)len + 1 };
+    adlb_refc decr = (i + 3 >= TASK_COUNT) ? ADLB_WRITE_REFC
+                                           : ADLB_NO_REFC;
+    ac = store_integer(container, sub, i, decr);
+    TEST_RC(ac);
+  }
+
+  long count = 0;
+  while (true)
+  {
+    task t;
+    int length, answer, type;
+    MPI_Comm task_comm;
+    ac = ADLB_Get(0, &t, &length, &answer, &type, &task_comm);
+    if (ac == ADLB_SHUTDOWN)
+      break;
+    TEST_RC(ac);
+    TEST_CHECK(length == (int)sizeof(t), "bad task length: %i", length);
+
+    ac = run_task(&t, rank);
+    TEST_RC(ac);
+    count++;
+  }
+
+  long total;
+  MPI_Allreduce(&count, &total, 1, MPI_LONG, MPI_SUM, worker_comm);
+  TEST_CHECK(total == (long)workers * TASK_COUNT,
+             "ran %li tasks, expected %li", total,
+             (long)workers * TASK_COUNT);
+  return ADLB_SUCCESS;
+}
@@ -0,0 +1,375 @@
+/*
+ * Copyright 2015 University of Chicago and Argonne National Laboratory
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License
+ */
+
+/*
+ * engine_bench.c
+ *
+ * Benchmarking utility for data-dependent task engine: tasks with
+ * many inputs that are closed one by one.
+ */
+#include <assert.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "common/qtests.h"
+#include "common/timers.h"
+
+#include "common.h"
+#include "checks.h"
+#include "data.h"
+#include "engine.h"
+#include "layout.h"
+
+/** Random seed to use for each experiment */
+unsigned int random_seed = 123456;
+
+/** Payload size for work units */
+size_t payload_size = 64;
+
+/** Total number of task inputs in each benchmark run */
+int benchmark_ninputs = 256 * 1024;
+
+/** Maximum number of inputs per task to run experiments with */
+int max_width = 16 * 1024;
+
+/** Number of warmup iterations to run */
+int warmup_iters = 2;
+
+/** Next datum ID to create */
+static adlb_datum_id next_id = 1;
+
+typedef enum
+{
+  FORWARD, // Close inputs in order of task inputs
+  REVERSE,
+  RANDOM,
+} close_order;
+
+static adlb_code run(bool run_benchmarks);
+static adlb_code init(void);
+static adlb_code finalize(void);
+static adlb_code warmup(void);
+static adlb_code expt_fan_in(close_order order, int width, int ntasks,
+                             bool report);
+
+static const char *close_order_str(close_order order);
+static void report_hdr(void);
+static void report_expt(const char *expt, close_order order, int width,
+                   int ntasks, expt_timers timers);
+
+int main(int argc, char **argv)
+{
+  bool run_benchmarks = false;
+
+  int c;
+
+  while ((c = getopt(argc, argv, "bn:W:")) != -1)
+  {
+    switch (c) {
+      case 'b':
+        run_benchmarks = true;
+        break;
+      case 'n':
+        benchmark_ninputs = atoi(optarg);
+        if (benchmark_ninputs <= 0)
+        {
+          fprintf(stderr, "Invalid number of inputs: %s\n", optarg);
+          return 1;
+        }
+
+        fprintf(stderr, "Number of inputs: %i\n", benchmark_ninputs);
+        break;
+      case 'W':
+        max_width = atoi(optarg);
+        if (max_width <= 0)
+        {
+          fprintf(stderr, "Invalid max width: %s\n", optarg);
+          return 1;
+        }
+
+        fprintf(stderr, "Max task width: %i\n", max_width);
+        break;
+      case '?':
+        fprintf(stderr, "Unknown option %c\n", (char)(c));
+        return 1;
+    }
+  }
+
+  adlb_code ac = run(run_benchmarks);
+
+  if (ac != ADLB_SUCCESS) {
+    fprintf(stderr, "FAILED!: %i\n", ac);
+    return 1;
+  }
+
+  return 0;
+}
+
+static adlb_code run(bool run_benchmarks)
+{
+  adlb_code ac;
+
+  fprintf(stderr, "Initializing...\n");
+  ac = init();
+  ADLB_CHECK(ac);
+
+  fprintf(stderr, "Running warmup tests...\n");
+  ac = warmup();
+  ADLB_CHECK(ac);
+
+  if (run_benchmarks)
+  {
+    fprintf(stderr, "Running benchmarks...\n");
+    report_hdr();
+
+    close_order orders[] = {FORWARD, REVERSE, RANDOM};
+    int norders = sizeof(orders)/sizeof(orders[0]);
+
+    for (int exp_iter = 0; exp_iter < 3; exp_iter++)
+    {
+      bool report = exp_iter > 0;
+
+      for (int order_idx = 0; order_idx < norders; order_idx++)
+      {
+        for (int width = 1; width <= max_width; width *= 4)
+        {
+          int ntasks = benchmark_ninputs / width;
+          if (ntasks < 1)
+            ntasks = 1;
+          ac = expt_fan_in(orders[order_idx], width, ntasks, report);
+          ADLB_CHECK(ac);
+        }
+      }
+    }
+  }
+
+  fprintf(stderr, "Finalizing...\n");
+
+  ac = finalize();
+  ADLB_CHECK(ac);
+
+  fprintf(stderr, "Done.\n");
+
+  return ADLB_SUCCESS;
+}
+
+static adlb_code init(void)
+{
+  int comm_size = 64;
+  int my_rank = comm_size - 1;
+  int nservers = 1;
+
+  const char *fake_hosts[comm_size];
+  make_fake_hosts(fake_hosts, comm_size);
+
+  adlb_code ac;
+
+  ac = qs_init(comm_size, my_rank, nservers, fake_hosts, 1);
+  ADLB_CHECK(ac);
+
+  // This rank is the only server, so all data is local
+  assert(xlb_s.layout.am_server);
+  adlb_data_code dc = xlb_data_init(nservers, 0);
+  ADLB_DATA_CHECK(dc);
+
+  xlb_engine_code tc = xlb_engine_init(my_rank);
+  CHECK_MSG(tc == XLB_ENGINE_SUCCESS, "Error initializing engine");
+
+  return ADLB_SUCCESS;
+}
+
+/*
+  Cleanup modules to free memory, etc
+ */
+static adlb_code finalize(void)
+{
+  adlb_code ac;
+
+  xlb_engine_finalize();
+
+  adlb_data_code dc = xlb_data_finalize();
+  ADLB_DATA_CHECK(dc);
+
+  ac = qs_finalize();
+  ADLB_CHECK(ac);
+
+  return ADLB_SUCCESS;
+}
+
+/*
+  Do some warming up and testing.
+ */
+static adlb_code warmup(void) {
+  adlb_code ac;
+
+  for (int iter = 0; iter < warmup_iters; iter++)
+  {
+    for (close_order order = FORWARD; order <= RANDOM; order++)
+    {
+      ac = expt_fan_in(order, 1, 64, false);
+      ADLB_CHECK(ac);
+
+      ac = expt_fan_in(order, 100, 4, false);
+      ADLB_CHECK(ac);
+    }
+  }
+
+  return ADLB_SUCCESS;
+}
+
+/*
+  Run experiment with ntasks tasks that each wait on the same width
+  inputs.  Checks that tasks are released only after all inputs close.
+ */
+static adlb_code expt_fan_in(close_order order, int width, int ntasks,
+                             bool report)
+{
+  // Reseed before experiment
+  srand(random_seed);
+
+  adlb_code ac;
+  adlb_data_code dc;
+  xlb_engine_code tc;
+
+  adlb_datum_id *ids = malloc(sizeof(ids[0]) * (size_t)width);
+  ADLB_MALLOC_CHECK(ids);
+
+  adlb_create_props props = DEFAULT_CREATE_PROPS;
+  for (int i = 0; i < width; i++)
+  {
+    ids[i] = next_id++;
+    dc = xlb_data_create(ids[i], ADLB_DATA_TYPE_INTEGER, NULL, &props);
+    ADLB_DATA_CHECK(dc);
+  }
+
+  // Order to close inputs in
+  adlb_datum_id *close_ids = malloc(sizeof(close_ids[0]) * (size_t)width);
+  ADLB_MALLOC_CHECK(close_ids);
+  for (int i = 0; i < width; i++)
+  {
+    switch (order)
+    {
+      case FORWARD:
+        close_ids[i] = ids[i];
+        break;
+      case REVERSE:
+        close_ids[i] = ids[width - 1 - i];
+        break;
+      case RANDOM:
+        close_ids[i] = ids[i];
+        break;
+    }
+  }
+
+  if (order == RANDOM)
+  {
+    // Knuth shuffle
+    for (int i = width - 1; i > 0; i--)
+    {
+      int j = rand() % (i + 1);
+      adlb_datum_id tmp = close_ids[i];
+      close_ids[i] = close_ids[j];
+      close_ids[j] = tmp;
+    }
+  }
+
+  xlb_engine_work_array ready = { .work = NULL, .size = 0, .count = 0 };
+
+  expt_timers timers;
+  time_begin(&timers);
+
+  for (int t = 0; t < ntasks; t++)
+  {
+    xlb_work_unit *wu;
+    ac = make_wu(EQUAL, UNTARGETED, payload_size, &wu);
+    ADLB_CHECK(ac);
+
+    bool task_ready;
+    tc = xlb_engine_put(NULL, 0, width, ids, 0, NULL, wu, &task_ready);
+    CHECK_MSG(tc == XLB_ENGINE_SUCCESS, "Error adding task: %s",
+              xlb_engine_code_tostring(tc));
+    CHECK_MSG(!task_ready, "Task ready before inputs closed");
+  }
+
+  for (int i = 0; i < width; i++)
+  {
+    tc = xlb_engine_close(close_ids[i], false, &ready);
+    CHECK_MSG(tc == XLB_ENGINE_SUCCESS, "Error closing input: %s",
+              xlb_engine_code_tostring(tc));
+
+    if (i < width - 1)
+    {
+      CHECK_MSG(ready.count == 0, "%i tasks ready after %i/%i inputs "
+                "closed", ready.count, i + 1, width);
+    }
+  }
+
+  time_end(&timers);
+
+  CHECK_MSG(ready.count == ntasks, "Expected %i ready tasks, got %i",
+            ntasks, ready.count);
+
+  for (int i = 0; i < ready.count; i++)
+  {
+    xlb_work_unit_free(ready.work[i]);
+  }
+  free(ready.work);
+  free(close_ids);
+  free(ids);
+
+  if (report)
+  {
+    report_expt("fan_in", order, width, ntasks, timers);
+  }
+
+  return ADLB_SUCCESS;
+}
+
+static const char *close_order_str(close_order order)
+{
+  switch (order)
+  {
+    case FORWARD: return "FORWARD";
+    case REVERSE: return "REVERSE";
+    case RANDOM: return "RANDOM";
+    default: assert(false);
+  }
+  return NULL;
+}
+
+static void report_hdr(void)
+{
+  printf("experiment,order,width,ntasks,ninputs,nsec,sec,nsec_input,"
+         "input_sec\n");
+}
+
+static void report_expt(const char *expt, close_order order, int width,
+                   int ntasks, expt_timers timers)
+{
+  long long nsec = duration_nsec(timers);
+  long long ninputs = (long long)width * ntasks;
+
+  printf("%s,%s,%i,%i,%lli,%lli,%lf,%lf,%.0lf\n",
+    expt, close_order_str(order), width, ntasks, ninputs,
+    nsec, (double)nsec / (double)1e9,
+    (double)nsec / (double)ninputs,
+    (double)ninputs / ((double)nsec / (double)1e9));
+  // Make progress visible
+  fflush(stdout);
+}
@@ -0,0 +1,317 @@
+/*
+ * Copyright 2015 University of Chicago and Argonne National Laboratory
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License
+ */
+
+
+/*
+ * engine_ready.c
+ *
+ * Regression test for release of data-dependent tasks by the engine.
+ * A task must be released exactly once, when the last of its inputs
+ * closes, including with repeated inputs, subscript inputs and inputs
+ * closed before the task is put.  Tasks waiting on the same input are
+ * released in the order they were put, including tasks too large
+ * for the pooled allocation size classes.
+ */
+#include <assert.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "common/dtests.h"
+
+#include "common.h"
+#include "checks.h"
+#include "data.h"
+#include "engine.h"
+
+static adlb_code run(void);
+static adlb_code test_shared(void);
+static adlb_code test_subscripts(void);
+static adlb_code test_closed(void);
+static adlb_code test_large(void);
+
+int main(int argc, char **argv)
+{
+  adlb_code ac = run();
+
+  if (ac != ADLB_SUCCESS) {
+    fprintf(stderr, "FAILED!: %i\n", ac);
+    return 1;
+  }
+
+  return 0;
+}
+
+static adlb_code run(void)
+{
+  adlb_code ac;
+
+  fprintf(stderr, "Initializing...\n");
+  ac = dt_init();
+  ADLB_CHECK(ac);
+
+  xlb_engine_code tc = xlb_engine_init(xlb_s.layout.rank);
+  CHECK_MSG(tc == XLB_ENGINE_SUCCESS, "Error initializing engine");
+
+  fprintf(stderr, "Testing shared inputs...\n");
+  ac = test_shared();
+  ADLB_CHECK(ac);
+
+  fprintf(stderr, "Testing subscripts...\n");
+  ac = test_subscripts();
+  ADLB_CHECK(ac);
+
+  fprintf(stderr, "Testing closed inputs...\n");
+  ac = test_closed();
+  ADLB_CHECK(ac);
+
+  fprintf(stderr, "Testing large tasks...\n");
+  ac = test_large();
+  ADLB_CHECK(ac);
+
+  fprintf(stderr, "Finalizing...\n");
+  xlb_engine_finalize();
+  ac = dt_finalize();
+  ADLB_CHECK(ac);
+
+  fprintf(stderr, "Done.\n");
+  return ADLB_SUCCESS;
+}
+
+/*
+  Put task with number task_num as payload
+ */
+static adlb_code put_task(int task_num, int id_count,
+        const adlb_datum_id *ids, int id_sub_count,
+        const adlb_datum_id_sub *id_subs, bool expect_ready)
+{
+  xlb_work_unit *wu = work_unit_alloc(sizeof(task_num));
+  ADLB_MALLOC_CHECK(wu);
+  xlb_work_unit_init(wu, 0, 0, 0, ADLB_RANK_ANY, (int)sizeof(task_num),
+                     ADLB_DEFAULT_PUT_OPTS);
+  memcpy(wu->payload, &task_num, sizeof(task_num));
+
+  const char *name = "engine_ready";
+  bool ready;
+  xlb_engine_code tc = xlb_engine_put(name, (int)strlen(name),
+          id_count, ids, id_sub_count, id_subs, wu, &ready);
+  CHECK_MSG(tc == XLB_ENGINE_SUCCESS, "Error adding task: %s",
+            xlb_engine_code_tostring(tc));
+  CHECK_MSG(ready == expect_ready, "Task %i: expected ready %i",
+            task_num, (int)expect_ready);
+  if (ready)
+  {
+    xlb_work_unit_free(wu);
+  }
+  return ADLB_SUCCESS;
+}
+
+/*
+  Check that exactly the expected tasks were released, in order, and
+  free them
+ */
+static adlb_code check_ready(xlb_engine_work_array *ready,
+                             const int *expected, int count)
+{
+  CHECK_MSG(ready->count == count, "Expected %i ready tasks, got %i",
+            count, ready->count);
+  for (int i = 0; i < count; i++)
+  {
+    int task_num;
+    memcpy(&task_num, ready->work[i]->payload, sizeof(task_num));
+    CHECK_MSG(task_num == expected[i], "Expected task %i at %i, got %i",
+              expected[i], i, task_num);
+    xlb_work_unit_free(ready->work[i]);
+  }
+  ready->count = 0;
+  return ADLB_SUCCESS;
+}
+
+static adlb_code close_id(adlb_datum_id id, const int *expected,
+                          int count)
+{
+  xlb_engine_work_array ready = { .work = NULL, .size = 0, .count = 0 };
+  xlb_engine_code tc = xlb_engine_close(id, false, &ready);
+  CHECK_MSG(tc == XLB_ENGINE_SUCCESS, "Error closing input: %s",
+            xlb_engine_code_tostring(tc));
+  adlb_code ac = check_ready(&ready, expected, count);
+  free(ready.work);
+  return ac;
+}
+
+static adlb_code close_sub(adlb_datum_id id, const char *key,
+                           const int *expected, int count)
+{
+  xlb_engine_work_array ready = { .work = NULL, .size = 0, .count = 0 };
+  adlb_subscript sub = { .key = key, .length = strlen(key) + 1 };
+  xlb_engine_code tc = xlb_engine_sub_close(id, sub, false, &ready);
+  CHECK_MSG(tc == XLB_ENGINE_SUCCESS, "Error closing input: %s",
+            xlb_engine_code_tostring(tc));
+  adlb_code ac = check_ready(&ready, expected, count);
+  free(ready.work);
+  return ac;
+}
+
+static adlb_code test_shared(void)
+{
+  adlb_code ac;
+  adlb_datum_id x = dt_new_id(), y = dt_new_id();
+  ac = dt_create_integer(x);
+  ADLB_CHECK(ac);
+  ac = dt_create_integer(y);
+  ADLB_CHECK(ac);
+
+  adlb_datum_id t0[] = { x, y };
+  adlb_datum_id t1[] = { y };
+  adlb_datum_id t2[] = { x, x, y, x };
+  adlb_datum_id t3[] = { y, x };
+  ac = put_task(0, 2, t0, 0, NULL, false);
+  ADLB_CHECK(ac);
+  ac = put_task(1, 1, t1, 0, NULL, false);
+  ADLB_CHECK(ac);
+  ac = put_task(2, 4, t2, 0, NULL, false);
+  ADLB_CHECK(ac);
+  ac = put_task(3, 2, t3, 0, NULL, false);
+  ADLB_CHECK(ac);
+
+  ac = close_id(y, (int[]){ 1 }, 1);
+  ADLB_CHECK(ac);
+  ac = close_id(x, (int[]){ 0, 2, 3 }, 3);
+  ADLB_CHECK(ac);
+
+  return ADLB_SUCCESS;
+}
+
+static adlb_code test_subscripts(void)
+{
+  adlb_code ac;
+  adlb_datum_id c = dt_new_id(), z = dt_new_id();
+  ac = dt_create_container(c, ADLB_DATA_TYPE_STRING,
+                           ADLB_DATA_TYPE_INTEGER, false);
+  ADLB_CHECK(ac);
+  ac = dt_create_integer(z);
+  ADLB_CHECK(ac);
+
+  adlb_datum_id_sub a = { .id = c,
+        .subscript = { .key = "a", .length = 2 } };
+  adlb_datum_id_sub b = { .id = c,
+        .subscript = { .key = "b", .length = 2 } };
+
+  adlb_datum_id_sub t4_subs[] = { a };
+  adlb_datum_id t4_ids[] = { z };
+  adlb_datum_id_sub t5_subs[] = { b };
+  adlb_datum_id_sub t6_subs[] = { b, a, b };
+  ac = put_task(4, 1, t4_ids, 1, t4_subs, false);
+  ADLB_CHECK(ac);
+  ac = put_task(5, 0, NULL, 1, t5_subs, false);
+  ADLB_CHECK(ac);
+  ac = put_task(6, 0, NULL, 3, t6_subs, false);
+  ADLB_CHECK(ac);
+
+  ac = close_sub(c, "a", NULL, 0);
+  ADLB_CHECK(ac);
+  ac = close_sub(c, "b", (int[]){ 5, 6 }, 2);
+  ADLB_CHECK(ac);
+  ac = close_id(z, (int[]){ 4 }, 1);
+  ADLB_CHECK(ac);
+
+  return ADLB_SUCCESS;
+}
+
+static adlb_code test_closed(void)
+{
+  adlb_code ac;
+  adlb_datum_id closed = dt_new_id(), open = dt_new_id();
+  ac = dt_create_integer(closed);
+  ADLB_CHECK(ac);
+  ac = dt_create_integer(open);
+  ADLB_CHECK(ac);
+
+  // Store and close
+  adlb_int_t val = 42;
+  adlb_notif_t notifs = ADLB_NO_NOTIFS;
+  adlb_data_code dc = xlb_data_store(closed, ADLB_NO_SUB, &val,
+            sizeof(val), true, NULL, ADLB_DATA_TYPE_INTEGER,
+            ADLB_WRITE_REFC, ADLB_NO_REFC, &notifs);
+  xlb_free_notif(&notifs);
+  ADLB_DATA_CHECK(dc);
+
+  // Closed inputs count as closed from the start
+  adlb_datum_id t7[] = { closed, closed };
+  adlb_datum_id t8[] = { closed, open, closed };
+  ac = put_task(7, 2, t7, 0, NULL, true);
+  ADLB_CHECK(ac);
+  ac = put_task(8, 3, t8, 0, NULL, false);
+  ADLB_CHECK(ac);
+
+  ac = close_id(open, (int[]){ 8 }, 1);
+  ADLB_CHECK(ac);
+
+  return ADLB_SUCCESS;
+}
+
+/*
+  Tasks with many inputs and long subscripts, too large for the
+  pooled size classes
+ */
+static adlb_code test_large(void)
+{
+  adlb_code ac;
+  const int nids = 100, nsubs = 20;
+  adlb_datum_id ids[nids];
+  for (int i = 0; i < nids; i++)
+  {
+    ids[i] = dt_new_id();
+    ac = dt_create_integer(ids[i]);
+    ADLB_CHECK(ac);
+  }
+
+  adlb_datum_id c = dt_new_id();
+  ac = dt_create_container(c, ADLB_DATA_TYPE_STRING,
+                           ADLB_DATA_TYPE_INTEGER, false);
+  ADLB_CHECK(ac);
+
+  char keys[nsubs][64];
+  adlb_datum_id_sub subs[nsubs];
+  for (int i = 0; i < nsubs; i++)
+  {
+    int len = sprintf(keys[i], "a_long_subscript_to_make_task_large_%i", i);
+    subs[i].id = c;
+    subs[i].subscript.key = keys[i];
+    subs[i].subscript.length = (size_t)len + 1;
+  }
+
+  ac = put_task(9, nids, ids, nsubs, subs, false);
+  ADLB_CHECK(ac);
+  ac = put_task(10, 1, ids, 1, subs, false);
+  ADLB_CHECK(ac);
+
+  for (int i = 0; i < nsubs; i++)
+  {
+    ac = close_sub(c, keys[i], NULL, 0);
+    ADLB_CHECK(ac);
+  }
+  for (int i = nids - 1; i > 0; i--)
+  {
+    ac = close_id(ids[i], NULL, 0);
+    ADLB_CHECK(ac);
+  }
+  ac = close_id(ids[0], (int[]){ 9, 10 }, 2);
+  ADLB_CHECK(ac);
+
+  return ADLB_SUCCESS;
+}
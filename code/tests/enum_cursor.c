@@ -0,0 +1,325 @@
+/*
+ * Copyright 2015 University of Chicago and Argonne National Laboratory
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License
+ */
+
+
+/*
+ * enum_cursor.c
+ *
+ * Regression test for cursor-based container enumeration: listing a
+ * container in chunks must return each member once, in the same order
+ * as listing it in one go, for dense and hashed member storage.
+ */
+#include <assert.h>
+#include <inttypes.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "common/dtests.h"
+
+#include "checks.h"
+#include "data.h"
+
+/** Max members in test containers */
+#define MAX_MEMBERS 1024
+
+/** Max key length in test containers */
+#define KEY_MAX 32
+
+static adlb_code run(void);
+static adlb_code test_int_keys(void);
+static adlb_code test_string_keys(void);
+static adlb_code test_insert(void);
+static adlb_code test_multiset(void);
+
+int main(int argc, char **argv)
+{
+  adlb_code ac = run();
+
+  if (ac != ADLB_SUCCESS) {
+    fprintf(stderr, "FAILED!: %i\n", ac);
+    return 1;
+  }
+
+  return 0;
+}
+
+static adlb_code run(void)
+{
+  adlb_code ac;
+
+  fprintf(stderr, "Initializing...\n");
+  ac = dt_init();
+  ADLB_CHECK(ac);
+
+  fprintf(stderr, "Testing integer keys...\n");
+  ac = test_int_keys();
+  ADLB_CHECK(ac);
+
+  fprintf(stderr, "Testing string keys...\n");
+  ac = test_string_keys();
+  ADLB_CHECK(ac);
+
+  fprintf(stderr, "Testing insert between chunks...\n");
+  ac = test_insert();
+  ADLB_CHECK(ac);
+
+  fprintf(stderr, "Testing multiset...\n");
+  ac = test_multiset();
+  ADLB_CHECK(ac);
+
+  fprintf(stderr, "Finalizing...\n");
+  ac = dt_finalize();
+  ADLB_CHECK(ac);
+
+  fprintf(stderr, "Done.\n");
+  return ADLB_SUCCESS;
+}
+
+/*
+  Enumerate keys of container, appending to keys
+  cursor: if NULL, enumerate from offset 0
+  n: input/output number of keys in array
+ */
+static adlb_code enumerate_keys(adlb_datum_id id, int count,
+        adlb_enum_cursor *cursor, char keys[][KEY_MAX], int *n,
+        int *actual)
+{
+  adlb_buffer data = { .data = NULL, .length = 0 };
+  adlb_data_type key_type, val_type;
+
+  adlb_data_code dc = xlb_data_enumerate(id, count, 0, true, false,
+              cursor, NULL, NULL, &data, actual, &key_type, &val_type);
+  ADLB_DATA_CHECK(dc);
+
+  size_t pos = 0;
+  for (int i = 0; i < *actual; i++)
+  {
+    const void *entry;
+    size_t entry_length;
+    dc = ADLB_Unpack_buffer(ADLB_DATA_TYPE_NULL, data.data, data.length,
+                            &pos, &entry, &entry_length);
+    ADLB_DATA_CHECK(dc);
+    CHECK_MSG(*n < MAX_MEMBERS && entry_length <= KEY_MAX,
+              "Too many or too long keys");
+    memcpy(keys[*n], entry, entry_length);
+    (*n)++;
+  }
+
+  free(data.data);
+  return ADLB_SUCCESS;
+}
+
+/*
+  Check that enumerating in chunks of count gives same keys in same
+  order as enumerating all at once
+ */
+static adlb_code check_chunks(adlb_datum_id id, int size, int count)
+{
+  adlb_code ac;
+  static char all[MAX_MEMBERS][KEY_MAX];
+  static char chunked[MAX_MEMBERS][KEY_MAX];
+  int nall = 0, nchunked = 0, actual;
+
+  ac = enumerate_keys(id, -1, NULL, all, &nall, &actual);
+  ADLB_CHECK(ac);
+  CHECK_MSG(nall == size, "Expected %i members, got %i", size, nall);
+
+  adlb_enum_cursor cursor = ADLB_ENUM_CURSOR_START;
+  do
+  {
+    ac = enumerate_keys(id, count, &cursor, chunked, &nchunked, &actual);
+    ADLB_CHECK(ac);
+    CHECK_MSG(actual <= count, "Chunk too large: %i", actual);
+    CHECK_MSG(cursor.position == nchunked, "Cursor position %i after %i "
+              "members", cursor.position, nchunked);
+  } while (actual > 0);
+
+  CHECK_MSG(nchunked == size, "Expected %i members in chunks, got %i",
+            size, nchunked);
+  for (int i = 0; i < size; i++)
+  {
+    CHECK_MSG(strcmp(all[i], chunked[i]) == 0, "Member %i: expected "
+              "key %s, got %s", i, all[i], chunked[i]);
+  }
+  return ADLB_SUCCESS;
+}
+
+/*
+  Dense keys, plus keys that go in the hash table
+ */
+static adlb_code test_int_keys(void)
+{
+  adlb_code ac;
+  char key[DT_INT_KEY_MAX];
+
+  adlb_datum_id id = dt_new_id();
+  ac = dt_create_container(id, ADLB_DATA_TYPE_INTEGER,
+                           ADLB_DATA_TYPE_INTEGER, false);
+  ADLB_CHECK(ac);
+
+  int size = 0;
+  for (int i = 0; i < 300; i++)
+  {
+    ac = dt_store_integer(id, dt_int_key(i, key), i);
+    ADLB_CHECK(ac);
+    size++;
+  }
+  for (int i = 0; i < 50; i++)
+  {
+    ac = dt_store_integer(id, dt_int_key(-1 - i * 1000003, key), i);
+    ADLB_CHECK(ac);
+    size++;
+  }
+
+  int counts[] = { 1, 7, 64, 299, 1000 };
+  for (int i = 0; i < (int)(sizeof(counts) / sizeof(counts[0])); i++)
+  {
+    ac = check_chunks(id, size, counts[i]);
+    ADLB_CHECK(ac);
+  }
+  return ADLB_SUCCESS;
+}
+
+static adlb_code test_string_keys(void)
+{
+  adlb_code ac;
+
+  adlb_datum_id id = dt_new_id();
+  ac = dt_create_container(id, ADLB_DATA_TYPE_STRING,
+                           ADLB_DATA_TYPE_INTEGER, false);
+  ADLB_CHECK(ac);
+
+  int size = 200;
+  for (int i = 0; i < size; i++)
+  {
+    char key[KEY_MAX];
+    int len = sprintf(key, "key%i", i);
+    adlb_subscript sub = { .key = key, .length = (size_t)len + 1 };
+    ac = dt_store_integer(id, sub, i);
+    ADLB_CHECK(ac);
+  }
+
+  ac = check_chunks(id, size, 1);
+  ADLB_CHECK(ac);
+  ac = check_chunks(id, size, 13);
+  ADLB_CHECK(ac);
+  return ADLB_SUCCESS;
+}
+
+/*
+  Inserts between chunks invalidate the cursor, so the server counts
+  from the start.  Appending a key after the existing ones must not
+  repeat or skip members.
+ */
+static adlb_code test_insert(void)
+{
+  adlb_code ac;
+  char key[DT_INT_KEY_MAX];
+
+  adlb_datum_id id = dt_new_id();
+  ac = dt_create_container(id, ADLB_DATA_TYPE_INTEGER,
+                           ADLB_DATA_TYPE_INTEGER, false);
+  ADLB_CHECK(ac);
+
+  int size = 100;
+  for (int i = 0; i < size; i++)
+  {
+    ac = dt_store_integer(id, dt_int_key(i, key), i);
+    ADLB_CHECK(ac);
+  }
+
+  static char keys[MAX_MEMBERS][KEY_MAX];
+  int n = 0, actual;
+  adlb_enum_cursor cursor = ADLB_ENUM_CURSOR_START;
+  ac = enumerate_keys(id, 40, &cursor, keys, &n, &actual);
+  ADLB_CHECK(ac);
+
+  // Append after all existing keys
+  ac = dt_store_integer(id, dt_int_key(size, key), size);
+  ADLB_CHECK(ac);
+  size++;
+
+  do
+  {
+    ac = enumerate_keys(id, 40, &cursor, keys, &n, &actual);
+    ADLB_CHECK(ac);
+  } while (actual > 0);
+
+  CHECK_MSG(n == size, "Expected %i members, got %i", size, n);
+  bool seen[size];
+  memset(seen, 0, sizeof(seen));
+  for (int i = 0; i < n; i++)
+  {
+    int k = atoi(keys[i]);
+    CHECK_MSG(k >= 0 && k < size && !seen[k], "Unexpected key %s",
+              keys[i]);
+    seen[k] = true;
+  }
+  return ADLB_SUCCESS;
+}
+
+static adlb_code test_multiset(void)
+{
+  adlb_code ac;
+  adlb_data_code dc;
+  char key[DT_INT_KEY_MAX];
+
+  adlb_datum_id id = dt_new_id();
+  adlb_create_props props = DEFAULT_CREATE_PROPS;
+  adlb_type_extra extra;
+  extra.valid = true;
+  extra.MULTISET.val_type = ADLB_DATA_TYPE_INTEGER;
+  dc = xlb_data_create(id, ADLB_DATA_TYPE_MULTISET, &extra, &props);
+  ADLB_DATA_CHECK(dc);
+
+  int size = 100;
+  for (int i = 0; i < size; i++)
+  {
+    // Any subscript appends to multiset
+    ac = dt_store_integer(id, dt_int_key(i, key), i);
+    ADLB_CHECK(ac);
+  }
+
+  int total = 0, actual;
+  adlb_enum_cursor cursor = ADLB_ENUM_CURSOR_START;
+  do
+  {
+    adlb_buffer data = { .data = NULL, .length = 0 };
+    adlb_data_type key_type, val_type;
+    dc = xlb_data_enumerate(id, 30, 0, false, true, &cursor, NULL, NULL,
+                            &data, &actual, &key_type, &val_type);
+    ADLB_DATA_CHECK(dc);
+
+    size_t pos = 0;
+    for (int i = 0; i < actual; i++)
+    {
+      int64_t val;
+      ac = dt_next_integer(&data, &pos, &val);
+      ADLB_CHECK(ac);
+      CHECK_MSG(val == total + i, "Expected %i actual %"PRId64,
+                total + i, val);
+    }
+    free(data.data);
+    total += actual;
+    CHECK_MSG(cursor.position == total, "Cursor position %i after %i",
+              cursor.position, total);
+  } while (actual > 0);
+
+  CHECK_MSG(total == size, "Expected %i members, got %i", size, total);
+  return ADLB_SUCCESS;
+}
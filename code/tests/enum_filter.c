@@ -0,0 +1,267 @@
+/*
+ * Copyright 2015 University of Chicago and Argonne National Laboratory
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License
+ */
+
+
+/*
+ * enum_filter.c
+ *
+ * Regression test for filtered and sorted container enumeration, with
+ * and without a sorted index on the container.
+ */
+#include <assert.h>
+#include <inttypes.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "common/dtests.h"
+
+#include "checks.h"
+#include "data.h"
+
+static adlb_code run(void);
+static adlb_code test_range(bool sorted_index);
+static adlb_code test_prefix(bool sorted_index);
+static adlb_code test_errors(void);
+
+int main(int argc, char **argv)
+{
+  adlb_code ac = run();
+
+  if (ac != ADLB_SUCCESS) {
+    fprintf(stderr, "FAILED!: %i\n", ac);
+    return 1;
+  }
+
+  return 0;
+}
+
+static adlb_code run(void)
+{
+  adlb_code ac;
+
+  fprintf(stderr, "Initializing...\n");
+  ac = dt_init();
+  ADLB_CHECK(ac);
+
+  for (int i = 0; i < 2; i++)
+  {
+    bool sorted_index = (i == 1);
+    fprintf(stderr, "Testing range, sorted_index=%i...\n", i);
+    ac = test_range(sorted_index);
+    ADLB_CHECK(ac);
+
+    fprintf(stderr, "Testing prefix, sorted_index=%i...\n", i);
+    ac = test_prefix(sorted_index);
+    ADLB_CHECK(ac);
+  }
+
+  fprintf(stderr, "Testing errors...\n");
+  ac = test_errors();
+  ADLB_CHECK(ac);
+
+  fprintf(stderr, "Finalizing...\n");
+  ac = dt_finalize();
+  ADLB_CHECK(ac);
+
+  fprintf(stderr, "Done.\n");
+  return ADLB_SUCCESS;
+}
+
+/*
+  Enumerate with filter and check keys and values
+  expected_keys: keys in expected order
+  expected_vals: integer values of members
+ */
+static adlb_code check_filter(adlb_datum_id id,
+        const adlb_enum_filter *filter, int count, int offset,
+        int nexpected, const char **expected_keys,
+        const int64_t *expected_vals)
+{
+  adlb_buffer data = { .data = NULL, .length = 0 };
+  int actual;
+  adlb_data_type key_type, val_type;
+
+  adlb_data_code dc = xlb_data_enumerate(id, count, offset, true, true,
+              NULL, filter, NULL, &data, &actual, &key_type, &val_type);
+  ADLB_DATA_CHECK(dc);
+  CHECK_MSG(actual == nexpected, "Expected %i members, got %i",
+            nexpected, actual);
+
+  size_t pos = 0;
+  for (int i = 0; i < nexpected; i++)
+  {
+    adlb_code ac = dt_check_next_key(&data, &pos, expected_keys[i]);
+    ADLB_CHECK(ac);
+
+    int64_t val;
+    ac = dt_next_integer(&data, &pos, &val);
+    ADLB_CHECK(ac);
+    CHECK_MSG(val == expected_vals[i], "Key %s: expected %"PRId64
+              " actual %"PRId64, expected_keys[i], expected_vals[i], val);
+  }
+  CHECK_MSG(pos == data.length, "Extra data after members");
+
+  free(data.data);
+  return ADLB_SUCCESS;
+}
+
+static adlb_code test_range(bool sorted_index)
+{
+  adlb_code ac;
+  char key[DT_INT_KEY_MAX];
+
+  adlb_datum_id id = dt_new_id();
+  ac = dt_create_container(id, ADLB_DATA_TYPE_INTEGER,
+                           ADLB_DATA_TYPE_INTEGER, sorted_index);
+  ADLB_CHECK(ac);
+
+  // Insert out of order, including negative and sparse keys
+  const int64_t keys[] = { 7, 2, -5, 0, 9, 4, 3, 1000, 6, 5, 8, 1 };
+  int nkeys = (int)(sizeof(keys) / sizeof(keys[0]));
+  for (int i = 0; i < nkeys; i++)
+  {
+    ac = dt_store_integer(id, dt_int_key(keys[i], key), keys[i] * 10);
+    ADLB_CHECK(ac);
+  }
+
+  adlb_enum_filter filter = { .type = ADLB_ENUM_RANGE, .lo = 3, .hi = 7,
+                              .prefix = NULL, .prefix_len = 0,
+                              .sorted = true };
+  {
+    const char *k[] = { "3", "4", "5", "6", "7" };
+    const int64_t v[] = { 30, 40, 50, 60, 70 };
+    ac = check_filter(id, &filter, -1, 0, 5, k, v);
+    ADLB_CHECK(ac);
+  }
+
+  // Offset and count apply to matching members
+  {
+    const char *k[] = { "4", "5" };
+    const int64_t v[] = { 40, 50 };
+    ac = check_filter(id, &filter, 2, 1, 2, k, v);
+    ADLB_CHECK(ac);
+  }
+
+  // Numeric rather than bytewise order
+  filter.lo = -10;
+  filter.hi = 1000;
+  {
+    const char *k[] = { "-5", "0", "1", "2", "3", "4", "5", "6", "7",
+                        "8", "9", "1000" };
+    const int64_t v[] = { -50, 0, 10, 20, 30, 40, 50, 60, 70, 80, 90,
+                          10000 };
+    ac = check_filter(id, &filter, -1, 0, nkeys, k, v);
+    ADLB_CHECK(ac);
+  }
+
+  // Empty range
+  filter.lo = 10;
+  filter.hi = 999;
+  ac = check_filter(id, &filter, -1, 0, 0, NULL, NULL);
+  ADLB_CHECK(ac);
+
+  // All members in key order
+  adlb_enum_filter all = { .type = ADLB_ENUM_ALL, .sorted = true };
+  {
+    const char *k[] = { "-5", "0", "1" };
+    const int64_t v[] = { -50, 0, 10 };
+    ac = check_filter(id, &all, 3, 0, 3, k, v);
+    ADLB_CHECK(ac);
+  }
+
+  return ADLB_SUCCESS;
+}
+
+static adlb_code test_prefix(bool sorted_index)
+{
+  adlb_code ac;
+
+  adlb_datum_id id = dt_new_id();
+  ac = dt_create_container(id, ADLB_DATA_TYPE_STRING,
+                           ADLB_DATA_TYPE_INTEGER, sorted_index);
+  ADLB_CHECK(ac);
+
+  const char *keys[] = { "apricot", "banana", "ap", "avocado", "apple",
+                         "a" };
+  int nkeys = (int)(sizeof(keys) / sizeof(keys[0]));
+  for (int i = 0; i < nkeys; i++)
+  {
+    adlb_subscript sub = { .key = keys[i],
+                           .length = strlen(keys[i]) + 1 };
+    ac = dt_store_integer(id, sub, i);
+    ADLB_CHECK(ac);
+  }
+
+  adlb_enum_filter filter = { .type = ADLB_ENUM_PREFIX, .lo = 0, .hi = 0,
+                              .prefix = "ap", .prefix_len = 2,
+                              .sorted = true };
+  {
+    const char *k[] = { "ap", "apple", "apricot" };
+    const int64_t v[] = { 2, 4, 0 };
+    ac = check_filter(id, &filter, -1, 0, 3, k, v);
+    ADLB_CHECK(ac);
+  }
+
+  filter.prefix = "b";
+  filter.prefix_len = 1;
+  {
+    const char *k[] = { "banana" };
+    const int64_t v[] = { 1 };
+    ac = check_filter(id, &filter, -1, 0, 1, k, v);
+    ADLB_CHECK(ac);
+  }
+
+  filter.prefix = "c";
+  ac = check_filter(id, &filter, -1, 0, 0, NULL, NULL);
+  ADLB_CHECK(ac);
+
+  return ADLB_SUCCESS;
+}
+
+static adlb_code test_errors(void)
+{
+  adlb_code ac;
+  adlb_data_code dc;
+  adlb_buffer data = { .data = NULL, .length = 0 };
+  int actual;
+  adlb_data_type key_type, val_type;
+
+  adlb_datum_id id = dt_new_id();
+  ac = dt_create_container(id, ADLB_DATA_TYPE_STRING,
+                           ADLB_DATA_TYPE_INTEGER, false);
+  ADLB_CHECK(ac);
+
+  adlb_enum_filter filter = { .type = ADLB_ENUM_RANGE, .lo = 0, .hi = 1,
+                              .prefix = NULL, .prefix_len = 0,
+                              .sorted = false };
+  dc = xlb_data_enumerate(id, -1, 0, true, true, NULL, &filter, NULL,
+                          &data, &actual, &key_type, &val_type);
+  CHECK_MSG(dc == ADLB_DATA_ERROR_TYPE,
+            "Expected type error for range over string keys, got %i", dc);
+
+  adlb_enum_cursor cursor = ADLB_ENUM_CURSOR_START;
+  filter.type = ADLB_ENUM_PREFIX;
+  filter.prefix = "a";
+  filter.prefix_len = 1;
+  dc = xlb_data_enumerate(id, -1, 0, true, true, &cursor, &filter, NULL,
+                          &data, &actual, &key_type, &val_type);
+  CHECK_MSG(dc == ADLB_DATA_ERROR_INVALID,
+            "Expected error for cursor with filter, got %i", dc);
+
+  return ADLB_SUCCESS;
+}
@@ -0,0 +1,207 @@
+/*
+ * Copyright 2015 University of Chicago and Argonne National Laboratory
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License
+ */
+
+
+/*
+ * gc_incremental.c
+ *
+ * Regression test for incremental garbage collection of large
+ * containers, cf. ADLB_GC_DEFER_MIN.  A collected container's members
+ * must be queued rather than freed at once, and each cleanup step must
+ * free at most its budget of members and release only their
+ * references.  Every referenced datum must be freed in the end.
+ */
+#include <assert.h>
+#include <inttypes.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "common/dtests.h"
+
+#include "checks.h"
+#include "common.h"
+#include "data.h"
+#include "data_cleanup.h"
+#include "data_internal.h"
+
+/** Members in each container, more than ADLB_GC_DEFER_MIN */
+#define MEMBERS 1000
+/** Members freed per cleanup step */
+#define BUDGET 64
+
+static adlb_code run(void);
+static adlb_code test_container(int64_t key_stride);
+
+int main(int argc, char **argv)
+{
+  adlb_code ac = run();
+
+  if (ac != ADLB_SUCCESS) {
+    fprintf(stderr, "FAILED!: %i\n", ac);
+    return 1;
+  }
+
+  return 0;
+}
+
+static adlb_code run(void)
+{
+  adlb_code ac;
+
+  setenv("ADLB_GC_DEFER_MIN", "100", 1);
+
+  fprintf(stderr, "Initializing...\n");
+  ac = dt_init();
+  ADLB_CHECK(ac);
+
+  // Members hold read references to the data they refer to
+  xlb_s.read_refc_enabled = true;
+
+  fprintf(stderr, "Testing dense container...\n");
+  ac = test_container(1);
+  ADLB_CHECK(ac);
+
+  fprintf(stderr, "Testing sparse container...\n");
+  ac = test_container(1000003);
+  ADLB_CHECK(ac);
+
+  fprintf(stderr, "Finalizing...\n");
+  ac = dt_finalize();
+  ADLB_CHECK(ac);
+
+  fprintf(stderr, "Done.\n");
+  return ADLB_SUCCESS;
+}
+
+/*
+  Apply refcount changes from cleanup, like the server loop
+  freed: incremented for each datum garbage collected
+ */
+static adlb_code apply_refcs(xlb_refc_changes *refcs, int *freed)
+{
+  for (int i = 0; i < refcs->count; i++)
+  {
+    xlb_refc_change *change = &refcs->arr[i];
+    bool garbage_collected;
+    adlb_notif_t notifs = ADLB_NO_NOTIFS;
+    adlb_data_code dc = xlb_data_reference_count(change->id, change->rc,
+                            XLB_NO_ACQUIRE, &garbage_collected, &notifs);
+    xlb_free_notif(&notifs);
+    ADLB_DATA_CHECK(dc);
+
+    if (garbage_collected)
+    {
+      (*freed)++;
+    }
+  }
+  xlb_refc_changes_free(refcs);
+  return ADLB_SUCCESS;
+}
+
+static adlb_code test_container(int64_t key_stride)
+{
+  adlb_code ac;
+  adlb_data_code dc;
+  char key_buf[DT_INT_KEY_MAX];
+  adlb_datum_id referands[MEMBERS];
+  adlb_notif_t notifs = ADLB_NO_NOTIFS;
+
+  adlb_datum_id id = dt_new_id();
+  ac = dt_create_container(id, ADLB_DATA_TYPE_INTEGER,
+                           ADLB_DATA_TYPE_REF, false);
+  ADLB_CHECK(ac);
+
+  for (int i = 0; i < MEMBERS; i++)
+  {
+    // One read reference for us, one to hand to the container
+    referands[i] = dt_new_id();
+    adlb_create_props props = DEFAULT_CREATE_PROPS;
+    props.read_refcount = 2;
+    dc = xlb_data_create(referands[i], ADLB_DATA_TYPE_INTEGER, NULL,
+                         &props);
+    ADLB_DATA_CHECK(dc);
+
+    adlb_int_t val = i;
+    dc = xlb_data_store(referands[i], ADLB_NO_SUB, &val, sizeof(val),
+                  true, NULL, ADLB_DATA_TYPE_INTEGER, ADLB_WRITE_REFC,
+                  ADLB_NO_REFC, &notifs);
+    ADLB_DATA_CHECK(dc);
+
+    adlb_ref ref = { .id = referands[i] };
+    adlb_subscript sub = dt_int_key(i * key_stride, key_buf);
+    dc = xlb_data_store(id, sub, &ref, sizeof(ref), true, NULL,
+                  ADLB_DATA_TYPE_REF, ADLB_NO_REFC, ADLB_READ_REFC,
+                  &notifs);
+    ADLB_DATA_CHECK(dc);
+
+    adlb_refc release = { .read_refcount = -1, .write_refcount = 0 };
+    dc = xlb_data_reference_count(referands[i], release, XLB_NO_ACQUIRE,
+                                  NULL, &notifs);
+    ADLB_DATA_CHECK(dc);
+  }
+  xlb_free_notif(&notifs);
+
+  // Close and release container, which is now garbage collected
+  adlb_refc release_all = { .read_refcount = -1, .write_refcount = -1 };
+  bool garbage_collected;
+  dc = xlb_data_reference_count(id, release_all, XLB_NO_ACQUIRE,
+                                &garbage_collected, &notifs);
+  ADLB_DATA_CHECK(dc);
+  CHECK_MSG(garbage_collected, "Container should be collected");
+  CHECK_MSG(xlb_refc_changes_empty(&notifs.refcs),
+            "Member references should not be released yet");
+  xlb_free_notif(&notifs);
+
+  adlb_datum *d;
+  dc = xlb_datum_lookup(id, &d);
+  CHECK_MSG(dc == ADLB_DATA_ERROR_NOT_FOUND,
+            "Container should be removed at once");
+  CHECK_MSG(xlb_deferred_cleanup_backlog() == MEMBERS,
+            "Expected backlog %i, actual %"PRId64, MEMBERS,
+            xlb_deferred_cleanup_backlog());
+
+  int freed = 0;
+  int steps = 0;
+  while (xlb_deferred_cleanup_backlog() > 0)
+  {
+    xlb_refc_changes refcs = ADLB_NO_REFC_CHANGES;
+    dc = xlb_deferred_cleanup_step(BUDGET, &refcs);
+    ADLB_DATA_CHECK(dc);
+    steps++;
+
+    int64_t expected = MEMBERS - (int64_t)steps * BUDGET;
+    expected = (expected < 0) ? 0 : expected;
+    CHECK_MSG(xlb_deferred_cleanup_backlog() == expected,
+              "Step %i: expected backlog %"PRId64", actual %"PRId64,
+              steps, expected, xlb_deferred_cleanup_backlog());
+
+    ac = apply_refcs(&refcs, &freed);
+    ADLB_CHECK(ac);
+    CHECK_MSG(freed == MEMBERS - expected,
+              "Step %i: expected %"PRId64" referands freed, actual %i",
+              steps, MEMBERS - expected, freed);
+  }
+
+  for (int i = 0; i < MEMBERS; i++)
+  {
+    dc = xlb_datum_lookup(referands[i], &d);
+    CHECK_MSG(dc == ADLB_DATA_ERROR_NOT_FOUND,
+              "Referand <%"PRId64"> should be freed", referands[i]);
+  }
+
+  return ADLB_SUCCESS;
+}
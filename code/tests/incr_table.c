@@ -0,0 +1,190 @@
+/*
+ * Copyright 2015 University of Chicago and Argonne National Laboratory
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License
+ */
+
+
+/*
+ * incr_table.c
+ *
+ * Regression test for incrementally grown hash tables.  Entries must
+ * stay visible while the tables grow and migrate, and removes must
+ * find entries in either table.
+ */
+#include <inttypes.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "common.h"
+#include "checks.h"
+#include "incr_table.h"
+
+/** Entries added, enough for several resizes */
+#define ENTRIES 10000
+
+static adlb_code run(void);
+static adlb_code test_lp(void);
+static adlb_code test_bp(void);
+
+int main(int argc, char **argv)
+{
+  adlb_code ac = run();
+
+  if (ac != ADLB_SUCCESS) {
+    fprintf(stderr, "FAILED!: %i\n", ac);
+    return 1;
+  }
+
+  return 0;
+}
+
+static adlb_code run(void)
+{
+  adlb_code ac;
+
+  fprintf(stderr, "Testing integer keys...\n");
+  ac = test_lp();
+  ADLB_CHECK(ac);
+
+  fprintf(stderr, "Testing binary keys...\n");
+  ac = test_bp();
+  ADLB_CHECK(ac);
+
+  fprintf(stderr, "Done.\n");
+  return ADLB_SUCCESS;
+}
+
+/** Distinct non-null data for each key */
+static void *key_data(int64_t key)
+{
+  return (void*)(intptr_t)(key + 1);
+}
+
+static adlb_code check_lp(const xlb_incr_lp *t, int64_t key, bool present)
+{
+  void *data;
+  bool found = xlb_incr_lp_search(t, key, &data);
+  CHECK_MSG(found == present, "key %"PRId64": expected present %i",
+            key, (int)present);
+  CHECK_MSG(!found || data == key_data(key),
+            "key %"PRId64": wrong data", key);
+  CHECK_MSG(xlb_incr_lp_contains(t, key) == present,
+            "key %"PRId64": contains disagrees with search", key);
+  return ADLB_SUCCESS;
+}
+
+static adlb_code test_lp(void)
+{
+  adlb_code ac;
+  xlb_incr_lp t;
+  bool ok = xlb_incr_lp_init(&t, 4);
+  CHECK_MSG(ok, "init failed");
+
+  for (int64_t key = 0; key < ENTRIES; key++)
+  {
+    // Spread keys so that they don't land in consecutive buckets
+    ok = xlb_incr_lp_add(&t, key * 7919, key_data(key * 7919));
+    CHECK_MSG(ok, "add failed");
+
+    // Earlier keys must remain visible, whichever table they are in
+    ac = check_lp(&t, (key / 2) * 7919, true);
+    ADLB_CHECK(ac);
+  }
+  CHECK_MSG(t.resizes > 0, "table never grew");
+  CHECK_MSG(xlb_incr_lp_size(&t) == ENTRIES, "wrong size %i",
+            xlb_incr_lp_size(&t));
+
+  // Remove every other key, which also continues migration
+  for (int64_t key = 0; key < ENTRIES; key += 2)
+  {
+    void *data;
+    ok = xlb_incr_lp_remove(&t, key * 7919, &data);
+    CHECK_MSG(ok && data == key_data(key * 7919),
+              "remove %"PRId64" failed", key * 7919);
+  }
+
+  for (int64_t key = 0; key < ENTRIES; key++)
+  {
+    ac = check_lp(&t, key * 7919, key % 2 == 1);
+    ADLB_CHECK(ac);
+  }
+
+  xlb_incr_lp_finish(&t);
+  CHECK_MSG(!t.migrating, "still migrating after finish");
+  CHECK_MSG(xlb_incr_lp_size(&t) == ENTRIES / 2, "wrong size %i",
+            xlb_incr_lp_size(&t));
+  for (int64_t key = 1; key < ENTRIES; key += 2)
+  {
+    ac = check_lp(&t, key * 7919, true);
+    ADLB_CHECK(ac);
+  }
+
+  xlb_incr_lp_free_callback(&t, NULL);
+  return ADLB_SUCCESS;
+}
+
+static adlb_code check_bp(const xlb_incr_bp *t, int key, bool present)
+{
+  char buf[16];
+  int len = sprintf(buf, "k%i", key);
+  void *data;
+  bool found = xlb_incr_bp_search(t, buf, (size_t)len, &data);
+  CHECK_MSG(found == present, "key %s: expected present %i",
+            buf, (int)present);
+  CHECK_MSG(!found || data == key_data(key), "key %s: wrong data", buf);
+  return ADLB_SUCCESS;
+}
+
+static adlb_code test_bp(void)
+{
+  adlb_code ac;
+  xlb_incr_bp t;
+  bool ok = xlb_incr_bp_init(&t, 4);
+  CHECK_MSG(ok, "init failed");
+
+  char buf[16];
+  for (int key = 0; key < ENTRIES; key++)
+  {
+    int len = sprintf(buf, "k%i", key);
+    ok = xlb_incr_bp_add(&t, buf, (size_t)len, key_data(key));
+    CHECK_MSG(ok, "add failed");
+
+    ac = check_bp(&t, key / 2, true);
+    ADLB_CHECK(ac);
+  }
+  CHECK_MSG(t.resizes > 0, "table never grew");
+  CHECK_MSG(xlb_incr_bp_size(&t) == ENTRIES, "wrong size %i",
+            xlb_incr_bp_size(&t));
+
+  for (int key = 0; key < ENTRIES; key += 2)
+  {
+    int len = sprintf(buf, "k%i", key);
+    void *data;
+    ok = xlb_incr_bp_remove(&t, buf, (size_t)len, &data);
+    CHECK_MSG(ok && data == key_data(key), "remove %s failed", buf);
+  }
+
+  xlb_incr_bp_finish(&t);
+  CHECK_MSG(!t.migrating, "still migrating after finish");
+  for (int key = 0; key < ENTRIES; key++)
+  {
+    ac = check_bp(&t, key, key % 2 == 1);
+    ADLB_CHECK(ac);
+  }
+
+  xlb_incr_bp_free_callback(&t, NULL);
+  return ADLB_SUCCESS;
+}
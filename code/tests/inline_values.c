@@ -0,0 +1,202 @@
+/*
+ * Copyright 2015 University of Chicago and Argonne National Laboratory
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License
+ */
+
+
+/*
+ * inline_values.c
+ *
+ * Regression test for short strings and blobs stored inline in the
+ * server's data store, cf. ADLB_INLINE_VALUES.  Values of every length
+ * around the inline limit must be stored inline exactly when they fit,
+ * and must read back unchanged, as datums and as container members.
+ */
+#include <assert.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "common/dtests.h"
+
+#include "checks.h"
+#include "data.h"
+#include "data_internal.h"
+
+/** Longest value tested, well past the inline limit */
+#define MAX_LENGTH 40
+
+static adlb_code run(void);
+static adlb_code test_datums(adlb_data_type type);
+static adlb_code test_members(void);
+
+int main(int argc, char **argv)
+{
+  adlb_code ac = run();
+
+  if (ac != ADLB_SUCCESS) {
+    fprintf(stderr, "FAILED!: %i\n", ac);
+    return 1;
+  }
+
+  return 0;
+}
+
+static adlb_code run(void)
+{
+  adlb_code ac;
+
+  fprintf(stderr, "Initializing...\n");
+  ac = dt_init();
+  ADLB_CHECK(ac);
+
+  fprintf(stderr, "Testing strings...\n");
+  ac = test_datums(ADLB_DATA_TYPE_STRING);
+  ADLB_CHECK(ac);
+
+  fprintf(stderr, "Testing blobs...\n");
+  ac = test_datums(ADLB_DATA_TYPE_BLOB);
+  ADLB_CHECK(ac);
+
+  fprintf(stderr, "Testing members...\n");
+  ac = test_members();
+  ADLB_CHECK(ac);
+
+  fprintf(stderr, "Finalizing...\n");
+  ac = dt_finalize();
+  ADLB_CHECK(ac);
+
+  fprintf(stderr, "Done.\n");
+  return ADLB_SUCCESS;
+}
+
+/*
+  Fill buf with length bytes of test data.  Strings are null
+  terminated, and length includes the terminator.
+ */
+static void make_value(adlb_data_type type, size_t length, char *buf)
+{
+  for (size_t i = 0; i < length; i++)
+  {
+    buf[i] = (char)('a' + (length + i) % 26);
+  }
+  if (type == ADLB_DATA_TYPE_STRING)
+  {
+    buf[length - 1] = '\0';
+  }
+}
+
+/*
+  Retrieve value at id[subscript] and compare with expected
+ */
+static adlb_code check_value(adlb_datum_id id, adlb_subscript subscript,
+        adlb_data_type type, const char *expected, size_t length)
+{
+  adlb_data_type actual_type;
+  adlb_binary_data result;
+  adlb_notif_t notifs = ADLB_NO_NOTIFS;
+  adlb_data_code dc = xlb_data_retrieve(id, subscript, ADLB_NO_REFC,
+              ADLB_NO_REFC, &actual_type, NULL, &result, &notifs);
+  xlb_free_notif(&notifs);
+  ADLB_DATA_CHECK(dc);
+
+  CHECK_MSG(actual_type == type, "Wrong type: %i", actual_type);
+  CHECK_MSG(result.length == length &&
+            memcmp(result.data, expected, length) == 0,
+            "Wrong value for length %zu: \"%.*s\"", length,
+            (int)result.length, (const char*)result.data);
+  ADLB_Free_binary_data(&result);
+  return ADLB_SUCCESS;
+}
+
+static adlb_code test_datums(adlb_data_type type)
+{
+  adlb_code ac;
+  adlb_data_code dc;
+  char buf[MAX_LENGTH];
+
+  for (size_t length = 1; length <= MAX_LENGTH; length++)
+  {
+    adlb_datum_id id = dt_new_id();
+    adlb_create_props props = DEFAULT_CREATE_PROPS;
+    dc = xlb_data_create(id, type, NULL, &props);
+    ADLB_DATA_CHECK(dc);
+
+    make_value(type, length, buf);
+    adlb_notif_t notifs = ADLB_NO_NOTIFS;
+    dc = xlb_data_store(id, ADLB_NO_SUB, buf, length, true, NULL, type,
+                        ADLB_NO_REFC, ADLB_NO_REFC, &notifs);
+    xlb_free_notif(&notifs);
+    ADLB_DATA_CHECK(dc);
+
+    // Overwrite caller's copy: the store must not refer to it
+    memset(buf, 'X', sizeof(buf));
+
+    adlb_datum *d;
+    dc = xlb_datum_lookup(id, &d);
+    ADLB_DATA_CHECK(dc);
+    bool expect_inline = xlb_inline_values &&
+                         length <= XLB_INLINE_VALUE_MAX;
+    CHECK_MSG(xlb_value_is_inline(&d->data.STRING) == expect_inline,
+              "Length %zu: expected inline %i", length,
+              (int)expect_inline);
+    CHECK_MSG(xlb_value_length(&d->data.STRING) == length,
+              "Length %zu: wrong stored length %zu", length,
+              xlb_value_length(&d->data.STRING));
+
+    make_value(type, length, buf);
+    ac = check_value(id, ADLB_NO_SUB, type, buf, length);
+    ADLB_CHECK(ac);
+  }
+
+  return ADLB_SUCCESS;
+}
+
+static adlb_code test_members(void)
+{
+  adlb_code ac;
+  adlb_data_code dc;
+  char buf[MAX_LENGTH];
+  char key_buf[DT_INT_KEY_MAX];
+
+  adlb_datum_id id = dt_new_id();
+  ac = dt_create_container(id, ADLB_DATA_TYPE_INTEGER,
+                           ADLB_DATA_TYPE_STRING, false);
+  ADLB_CHECK(ac);
+
+  for (size_t length = 1; length <= MAX_LENGTH; length++)
+  {
+    adlb_subscript sub = dt_int_key((int64_t)length, key_buf);
+    make_value(ADLB_DATA_TYPE_STRING, length, buf);
+    adlb_notif_t notifs = ADLB_NO_NOTIFS;
+    dc = xlb_data_store(id, sub, buf, length, true, NULL,
+                        ADLB_DATA_TYPE_STRING, ADLB_NO_REFC,
+                        ADLB_NO_REFC, &notifs);
+    xlb_free_notif(&notifs);
+    ADLB_DATA_CHECK(dc);
+  }
+
+  // Read back after all stores, so that earlier members have moved
+  // if the container grew
+  for (size_t length = 1; length <= MAX_LENGTH; length++)
+  {
+    adlb_subscript sub = dt_int_key((int64_t)length, key_buf);
+    make_value(ADLB_DATA_TYPE_STRING, length, buf);
+    ac = check_value(id, sub, ADLB_DATA_TYPE_STRING, buf, length);
+    ADLB_CHECK(ac);
+  }
+
+  return ADLB_SUCCESS;
+}
@@ -0,0 +1,108 @@
+/*
+ * Copyright 2015 University of Chicago and Argonne National Laboratory
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License
+ */
+
+
+/*
+ * layout_hosts.c
+ *
+ * Regression test for the servers on each server's host, which steal
+ * victim selection tries first.  Each server must list exactly the
+ * other servers on its host, in ascending rank order.
+ */
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "common.h"
+#include "checks.h"
+#include "layout.h"
+#include "location.h"
+
+#define COMM_SIZE 12
+#define SERVERS 4
+
+/** Server ranks 8, 10 and 11 share host A, 9 is alone on host B */
+static const char *hosts[COMM_SIZE] = {
+  "A", "B", "A", "B", "A", "B", "A", "B",
+  "A", "B", "A", "A" };
+
+/** Expected servers on same host, for each server, terminated by -1 */
+static const int expected[SERVERS][SERVERS] = {
+  { 10, 11, -1 },
+  { -1 },
+  { 8, 11, -1 },
+  { 8, 10, -1 } };
+
+static adlb_code run(void);
+static adlb_code check_server(int rank);
+
+int main(int argc, char **argv)
+{
+  adlb_code ac = run();
+
+  if (ac != ADLB_SUCCESS) {
+    fprintf(stderr, "FAILED!: %i\n", ac);
+    return 1;
+  }
+
+  return 0;
+}
+
+static adlb_code run(void)
+{
+  adlb_code ac;
+
+  for (int rank = COMM_SIZE - SERVERS; rank < COMM_SIZE; rank++)
+  {
+    fprintf(stderr, "Testing server %i...\n", rank);
+    ac = check_server(rank);
+    ADLB_CHECK(ac);
+  }
+
+  fprintf(stderr, "Done.\n");
+  return ADLB_SUCCESS;
+}
+
+static adlb_code check_server(int rank)
+{
+  adlb_code ac;
+  struct xlb_hostnames hostnames;
+  ac = xlb_hostnames_fill(&hostnames, hosts, COMM_SIZE, rank);
+  ADLB_CHECK(ac);
+
+  xlb_layout layout;
+  ac = xlb_layout_init(COMM_SIZE, rank, SERVERS, &hostnames, &layout);
+  ADLB_CHECK(ac);
+  xlb_hostnames_free(&hostnames);
+
+  const int *expect = expected[rank - (COMM_SIZE - SERVERS)];
+  int count = 0;
+  while (expect[count] >= 0)
+    count++;
+
+  CHECK_MSG(layout.my_host_servers == count,
+            "server %i: expected %i servers on host, got %i",
+            rank, count, layout.my_host_servers);
+  for (int i = 0; i < count; i++)
+  {
+    CHECK_MSG(layout.my_host_server_ranks[i] == expect[i],
+              "server %i: expected %i at %i, got %i", rank, expect[i],
+              i, layout.my_host_server_ranks[i]);
+  }
+
+  xlb_layout_finalize(&layout);
+  return ADLB_SUCCESS;
+}
@@ -0,0 +1,328 @@
+/*
+ * Copyright 2015 University of Chicago and Argonne National Laboratory
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License
+ */
+
+
+/*
+ * notifications.c
+ *
+ * Regression test for close notifications in the binary format,
+ * cf. ADLB_BINARY_NOTIFS, with values, cf. ADLB_Subscribe_value(), and
+ * forwarded through the subscribers' servers, cf. ADLB_NOTIF_FANOUT.
+ * Every worker subscribes to data and container members created by
+ * all workers, and must receive each notification exactly once, with
+ * the value if requested.  Run with at least two servers.
+ */
+#include <inttypes.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <mpi.h>
+#include <adlb.h>
+#include <adlb_types.h>
+
+#include "common/mtests.h"
+
+/** Number of data created by each worker */
+#define DATA_PER_WORKER 8
+/** Number of members in the container created by the first worker */
+#define MEMBERS 4
+/** Max workers supported */
+#define MAX_WORKERS 16
+/** Max subscriptions per worker */
+#define MAX_SUBS (MAX_WORKERS * DATA_PER_WORKER + MEMBERS)
+
+static adlb_code run(MPI_Comm worker_comm);
+
+int
+main()
+{
+  int mpi_argc = 0;
+  char** mpi_argv = NULL;
+  MPI_Init(&mpi_argc, &mpi_argv);
+
+  // Forward as soon as two workers of a server are notified
+  setenv("ADLB_BINARY_NOTIFS", "1", 1);
+  setenv("ADLB_NOTIF_FANOUT", "2", 1);
+
+  int types[1] = {0};
+  int nservers = 2;
+  int am_server;
+  MPI_Comm worker_comm;
+  adlb_code ac = ADLB_Init(nservers, 1, types, &am_server,
+                           MPI_COMM_WORLD, &worker_comm);
+  if (ac != ADLB_SUCCESS)
+  {
+    fprintf(stderr, "ADLB_Init failed\n");
+    return 1;
+  }
+
+  if (am_server)
+  {
+    ac = ADLB_Server(1);
+  }
+  else
+  {
+    ac = run(worker_comm);
+    if (ac != ADLB_SUCCESS)
+    {
+      fprintf(stderr, "FAILED!: %i\n", ac);
+    }
+  }
+
+  ADLB_Finalize();
+  MPI_Finalize();
+  return (ac == ADLB_SUCCESS) ? 0 : 1;
+}
+
+/** A subscription and whether its notification arrived */
+typedef struct
+{
+  adlb_datum_id id;
+  int64_t key; // -1 if no subscript
+  bool with_value;
+  bool notified;
+} subscription;
+
+static subscription subs[MAX_SUBS];
+static int sub_count = 0;
+
+/** Value stored into each datum or member */
+static int64_t
+expected_value(adlb_datum_id id, int64_t key)
+{
+  return id * 1000 + key;
+}
+
+static adlb_code
+subscribe(adlb_datum_id id, int64_t key)
+{
+  adlb_code ac;
+  char key_buf[32];
+  adlb_subscript sub = ADLB_NO_SUB;
+  if (key >= 0)
+  {
+    int len = sprintf(key_buf, "%"PRId64, key);
+    sub.key = key_buf;
+    sub.length = (size_t)len + 1;
+  }
+
+  // Ask for values for every other subscription
+  bool with_value = (sub_count % 2 == 1);
+  int subscribed;
+  if (with_value)
+  {
+    ac = ADLB_Subscribe_value(id, sub, 0, &subscribed);
+  }
+  else
+  {
+    ac = ADLB_Subscribe(id, sub, 0, &subscribed);
+  }
+  TEST_RC(ac);
+  TEST_CHECK(subscribed, "<%"PRId64">[%"PRId64"] already closed",
+             id, key);
+
+  TEST_CHECK(sub_count < MAX_SUBS, "too many subscriptions");
+  subscription *s = &subs[sub_count++];
+  s->id = id;
+  s->key = key;
+  s->with_value = with_value;
+  s->notified = false;
+  return ADLB_SUCCESS;
+}
+
+static adlb_code
+store(adlb_datum_id id, int64_t key, adlb_refc decr)
+{
+  char key_buf[32];
+  adlb_subscript sub = ADLB_NO_SUB;
+  if (key >= 0)
+  {
+    int len = sprintf(key_buf, "%"PRId64, key);
+    sub.key = key_buf;
+    sub.length = (size_t)len + 1;
+  }
+
+  int64_t val = expected_value(id, key);
+  adlb_code ac = ADLB_Store(id, sub, ADLB_DATA_TYPE_INTEGER, &val,
+                            sizeof(val), decr, ADLB_NO_REFC);
+  TEST_RC(ac);
+  return ADLB_SUCCESS;
+}
+
+/*
+  Match a notification against our subscriptions
+ */
+static adlb_code
+check_notif(adlb_datum_id id, adlb_subscript sub, const void *value,
+            int value_len)
+{
+  int64_t key = -1;
+  if (adlb_has_sub(sub))
+  {
+    // Copy to terminate the key, which may or may not include the
+    // null terminator
+    char key_buf[32];
+    TEST_CHECK(sub.length < sizeof(key_buf), "subscript too long");
+    memcpy(key_buf, sub.key, sub.length);
+    key_buf[sub.length] = '\0';
+    key = strtoll(key_buf, NULL, 10);
+  }
+
+  subscription *s = NULL;
+  for (int i = 0; i < sub_count; i++)
+  {
+    if (subs[i].id == id && subs[i].key == key)
+    {
+      s = &subs[i];
+      break;
+    }
+  }
+  TEST_CHECK(s != NULL, "unexpected notification <%"PRId64">[%"PRId64"]",
+             id, key);
+  TEST_CHECK(!s->notified, "duplicate notification <%"PRId64">[%"PRId64"]",
+             id, key);
+  s->notified = true;
+
+  if (s->with_value)
+  {
+    TEST_CHECK(value_len >= 0, "no value for <%"PRId64">[%"PRId64"]",
+               id, key);
+    adlb_int_t val;
+    adlb_data_code dc = ADLB_Unpack_integer(&val, value,
+                                            (size_t)value_len);
+    TEST_CHECK(dc == ADLB_DATA_SUCCESS, "bad value");
+    TEST_CHECK(val == expected_value(id, key),
+               "wrong value for <%"PRId64">[%"PRId64"]: %"PRId64,
+               id, key, val);
+  }
+  else
+  {
+    TEST_CHECK(value_len == -1, "unrequested value for <%"PRId64">",
+               id);
+  }
+  return ADLB_SUCCESS;
+}
+
+static adlb_code
+run(MPI_Comm worker_comm)
+{
+  adlb_code ac;
+  int rank, workers;
+  MPI_Comm_rank(worker_comm, &rank);
+  MPI_Comm_size(worker_comm, &workers);
+  TEST_CHECK(workers <= MAX_WORKERS, "too many workers: %i", workers);
+
+  // ADLB_Unique() assigns ids round-robin, so data are spread over
+  // all servers
+  adlb_datum_id my_ids[DATA_PER_WORKER];
+  for (int i = 0; i < DATA_PER_WORKER; i++)
+  {
+    ac = ADLB_Unique(&my_ids[i]);
+    TEST_RC(ac);
+    ac = ADLB_Create_integer(my_ids[i], DEFAULT_CREATE_PROPS, NULL);
+    TEST_RC(ac);
+  }
+
+  adlb_datum_id container = ADLB_DATA_ID_NULL;
+  if (rank == 0)
+  {
+    ac = ADLB_Unique(&container);
+    TEST_RC(ac);
+    ac = ADLB_Create_container(container, ADLB_DATA_TYPE_INTEGER,
+                    ADLB_DATA_TYPE_INTEGER, DEFAULT_CREATE_PROPS, NULL);
+    TEST_RC(ac);
+  }
+  MPI_Bcast(&container, 1, MPI_INT64_T, 0, worker_comm);
+
+  adlb_datum_id all_ids[MAX_WORKERS * DATA_PER_WORKER];
+  MPI_Allgather(my_ids, DATA_PER_WORKER, MPI_INT64_T,
+                all_ids, DATA_PER_WORKER, MPI_INT64_T, worker_comm);
+
+  for (int i = 0; i < workers * DATA_PER_WORKER; i++)
+  {
+    ac = subscribe(all_ids[i], -1);
+    TEST_RC(ac);
+  }
+  for (int key = 0; key < MEMBERS; key++)
+  {
+    ac = subscribe(container, key);
+    TEST_RC(ac);
+  }
+
+  // Close data only once everyone has subscribed
+  MPI_Barrier(worker_comm);
+
+  for (int i = 0; i < DATA_PER_WORKER; i++)
+  {
+    ac = store(my_ids[i], -1, ADLB_WRITE_REFC);
+    TEST_RC(ac);
+  }
+  if (rank == 0)
+  {
+    for (int key = 0; key < MEMBERS; key++)
+    {
+      adlb_refc decr = (key == MEMBERS - 1) ? ADLB_WRITE_REFC
+                                            : ADLB_NO_REFC;
+      ac = store(container, key, decr);
+      TEST_RC(ac);
+    }
+  }
+
+  static char payload[65536];
+  int notified = 0;
+  while (true)
+  {
+    int length, answer, type;
+    MPI_Comm task_comm;
+    ac = ADLB_Get(0, payload, &length, &answer, &type, &task_comm);
+    if (ac == ADLB_SHUTDOWN)
+      break;
+    TEST_RC(ac);
+
+    int count;
+    ac = ADLB_Notif_count(payload, length, &count);
+    TEST_RC(ac);
+
+    int pos = 0;
+    for (int i = 0; i < count; i++)
+    {
+      adlb_datum_id id;
+      adlb_subscript sub;
+      const void *value;
+      int value_len;
+      ac = ADLB_Notif_next(payload, length, &pos, &id, &sub,
+                           &value, &value_len);
+      TEST_RC(ac);
+      ac = check_notif(id, sub, value, value_len);
+      TEST_RC(ac);
+      notified++;
+    }
+
+    adlb_datum_id id;
+    adlb_subscript sub;
+    const void *value;
+    int value_len;
+    ac = ADLB_Notif_next(payload, length, &pos, &id, &sub,
+                         &value, &value_len);
+    TEST_CHECK(ac == ADLB_NOTHING, "more notifications than counted");
+  }
+
+  TEST_CHECK(notified == sub_count, "got %i notifications, expected %i",
+             notified, sub_count);
+  return ADLB_SUCCESS;
+}
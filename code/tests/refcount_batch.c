@@ -0,0 +1,271 @@
+/*
+ * Copyright 2015 University of Chicago and Argonne National Laboratory
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License
+ */
+
+
+/*
+ * refcount_batch.c
+ *
+ * Regression test for batched reference count changes on workers,
+ * cf. ADLB_REFC_BATCH: changes to the same id are merged or cancel
+ * out, and held changes reach the server before later operations on
+ * the same data.  Run with at least two servers and two workers.
+ */
+#include <inttypes.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include <mpi.h>
+#include <adlb.h>
+
+#include "common/mtests.h"
+
+/** Number of data created to check flushes to all servers */
+#define MANY_DATA 100
+
+static adlb_code run(void);
+
+int
+main()
+{
+  int mpi_argc = 0;
+  char** mpi_argv = NULL;
+  MPI_Init(&mpi_argc, &mpi_argv);
+
+  // Hold all changes until flushed by an operation
+  setenv("ADLB_REFC_BATCH", "1000", 1);
+
+  int types[1] = {0};
+  int nservers = 2;
+  int am_server;
+  MPI_Comm worker_comm;
+  adlb_code ac = ADLB_Init(nservers, 1, types, &am_server,
+                           MPI_COMM_WORLD, &worker_comm);
+  if (ac != ADLB_SUCCESS)
+  {
+    fprintf(stderr, "ADLB_Init failed\n");
+    return 1;
+  }
+
+  // Must be enabled on servers and workers
+  ADLB_Read_refcount_enable();
+
+  if (am_server)
+  {
+    ac = ADLB_Server(1);
+  }
+  else
+  {
+    ac = run();
+    if (ac != ADLB_SUCCESS)
+    {
+      fprintf(stderr, "FAILED!: %i\n", ac);
+    }
+  }
+
+  ADLB_Finalize();
+  MPI_Finalize();
+  return (ac == ADLB_SUCCESS) ? 0 : 1;
+}
+
+static adlb_code
+create_int(adlb_datum_id *id)
+{
+  adlb_create_props props = DEFAULT_CREATE_PROPS;
+  adlb_code ac = ADLB_Create_integer(ADLB_DATA_ID_NULL, props, id);
+  TEST_RC(ac);
+  return ADLB_SUCCESS;
+}
+
+static adlb_code
+incr(adlb_datum_id id, int read, int write)
+{
+  adlb_refc change = { .read_refcount = read, .write_refcount = write };
+  adlb_code ac = ADLB_Refcount_incr(id, change);
+  TEST_RC(ac);
+  return ADLB_SUCCESS;
+}
+
+/*
+  Check refcounts on server, which also flushes held changes
+ */
+static adlb_code
+check_refc(adlb_datum_id id, int read, int write)
+{
+  adlb_refc refc;
+  adlb_code ac = ADLB_Refcount_get(id, &refc, ADLB_NO_REFC);
+  TEST_RC(ac);
+  TEST_CHECK(refc.read_refcount == read && refc.write_refcount == write,
+             "<%"PRId64">: expected r: %i w: %i, actual r: %i w: %i",
+             id, read, write, refc.read_refcount, refc.write_refcount);
+  return ADLB_SUCCESS;
+}
+
+/*
+  Release all references so datum is freed
+ */
+static adlb_code
+release(adlb_datum_id id, int read, int write)
+{
+  return incr(id, -read, -write);
+}
+
+static adlb_code
+test_merge(void)
+{
+  adlb_code ac;
+  adlb_datum_id id;
+  ac = create_int(&id);
+  TEST_RC(ac);
+
+  // Opposite changes cancel out
+  ac = incr(id, 2, 0);
+  TEST_RC(ac);
+  ac = incr(id, -2, 0);
+  TEST_RC(ac);
+  ac = check_refc(id, 1, 1);
+  TEST_RC(ac);
+
+  // Changes are summed
+  for (int i = 0; i < 3; i++)
+  {
+    ac = incr(id, 1, 0);
+    TEST_RC(ac);
+  }
+  ac = incr(id, -1, 1);
+  TEST_RC(ac);
+  ac = check_refc(id, 3, 2);
+  TEST_RC(ac);
+
+  return release(id, 3, 2);
+}
+
+/*
+  If the store were applied before the held increment, it would close
+  the datum and the increment would fail
+ */
+static adlb_code
+test_flush_before_store(void)
+{
+  adlb_code ac;
+  adlb_datum_id id;
+  ac = create_int(&id);
+  TEST_RC(ac);
+
+  ac = incr(id, 0, 1);
+  TEST_RC(ac);
+
+  int64_t val = 42;
+  ac = ADLB_Store(id, ADLB_NO_SUB, ADLB_DATA_TYPE_INTEGER, &val,
+                  sizeof(val), ADLB_WRITE_REFC, ADLB_NO_REFC);
+  TEST_RC(ac);
+
+  ac = check_refc(id, 1, 1);
+  TEST_RC(ac);
+
+  return release(id, 1, 1);
+}
+
+/*
+  If the retrieve were applied before the held increment, it would
+  free the datum and the increment would fail
+ */
+static adlb_code
+test_flush_before_retrieve(void)
+{
+  adlb_code ac;
+  adlb_datum_id id;
+  ac = create_int(&id);
+  TEST_RC(ac);
+
+  int64_t val = 42;
+  ac = ADLB_Store(id, ADLB_NO_SUB, ADLB_DATA_TYPE_INTEGER, &val,
+                  sizeof(val), ADLB_WRITE_REFC, ADLB_NO_REFC);
+  TEST_RC(ac);
+
+  ac = incr(id, 1, 0);
+  TEST_RC(ac);
+
+  int64_t result[8];
+  size_t length;
+  adlb_data_type type;
+  ac = ADLB_Retrieve(id, ADLB_NO_SUB, ADLB_RETRIEVE_READ_REFC, &type,
+                     result, &length);
+  TEST_RC(ac);
+  TEST_CHECK(type == ADLB_DATA_TYPE_INTEGER && length == sizeof(val) &&
+             result[0] == val, "Wrong value retrieved");
+
+  ac = check_refc(id, 1, 0);
+  TEST_RC(ac);
+
+  return release(id, 1, 0);
+}
+
+/*
+  Explicit flush sends changes for many data in one batch per server
+ */
+static adlb_code
+test_flush(void)
+{
+  adlb_code ac;
+  adlb_datum_id ids[MANY_DATA];
+  for (int i = 0; i < MANY_DATA; i++)
+  {
+    ac = create_int(&ids[i]);
+    TEST_RC(ac);
+  }
+
+  for (int i = 0; i < MANY_DATA; i++)
+  {
+    ac = incr(ids[i], 1, 0);
+    TEST_RC(ac);
+  }
+  ac = ADLB_Refcount_flush();
+  TEST_RC(ac);
+
+  for (int i = 0; i < MANY_DATA; i++)
+  {
+    ac = check_refc(ids[i], 2, 1);
+    TEST_RC(ac);
+  }
+
+  for (int i = 0; i < MANY_DATA; i++)
+  {
+    ac = release(ids[i], 2, 1);
+    TEST_RC(ac);
+  }
+  return ADLB_Refcount_flush();
+}
+
+static adlb_code
+run(void)
+{
+  adlb_code ac;
+
+  ac = test_merge();
+  TEST_RC(ac);
+
+  ac = test_flush_before_store();
+  TEST_RC(ac);
+
+  ac = test_flush_before_retrieve();
+  TEST_RC(ac);
+
+  ac = test_flush();
+  TEST_RC(ac);
+
+  return ADLB_SUCCESS;
+}
@@ -0,0 +1,9 @@
+#!/bin/bash
+set -e
+
+THIS=$0
+EXEC=${THIS%.sh}.x
+OUTPUT=${THIS%.sh}.out
+
+# 2 servers, 4 workers
+mpiexec -n 6 ${EXEC} > ${OUTPUT} 2>&1
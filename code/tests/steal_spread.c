@@ -0,0 +1,124 @@
+/*
+ * Copyright 2015 University of Chicago and Argonne National Laboratory
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License
+ */
+
+
+/*
+ * steal_spread.c
+ *
+ * Regression test for work stealing, including direct steals based on
+ * work counts piggybacked on sync messages.  Only the first worker
+ * puts tasks, all on its own server, so other servers' workers only
+ * get work by stealing.  Every task must run once, and workers of
+ * other servers must run some of them.  Run with at least two servers
+ * and one worker per server.
+ */
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+#include <mpi.h>
+#include <adlb.h>
+
+#include "common/mtests.h"
+
+/** Number of tasks put by the first worker */
+#define TASK_COUNT 300
+/** Time each task takes, so that idle servers have time to steal */
+#define TASK_USEC 1000
+
+static adlb_code run(MPI_Comm worker_comm);
+
+int
+main()
+{
+  int mpi_argc = 0;
+  char** mpi_argv = NULL;
+  MPI_Init(&mpi_argc, &mpi_argv);
+
+  int types[1] = {0};
+  int nservers = 3;
+  int am_server;
+  MPI_Comm worker_comm;
+  adlb_code ac = ADLB_Init(nservers, 1, types, &am_server,
+                           MPI_COMM_WORLD, &worker_comm);
+  if (ac != ADLB_SUCCESS)
+  {
+    fprintf(stderr, "ADLB_Init failed\n");
+    return 1;
+  }
+
+  if (am_server)
+  {
+    ac = ADLB_Server(1);
+  }
+  else
+  {
+    ac = run(worker_comm);
+    if (ac != ADLB_SUCCESS)
+    {
+      fprintf(stderr, "FAILED!: %i\n", ac);
+    }
+  }
+
+  ADLB_Finalize();
+  MPI_Finalize();
+  return (ac == ADLB_SUCCESS) ? 0 : 1;
+}
+
+static adlb_code
+run(MPI_Comm worker_comm)
+{
+  adlb_code ac;
+  int rank, workers;
+  MPI_Comm_rank(worker_comm, &rank);
+  MPI_Comm_size(worker_comm, &workers);
+
+  if (rank == 0)
+  {
+    for (int i = 0; i < TASK_COUNT; i++)
+    {
+      ac = ADLB_Put(&i, (int)sizeof(i), ADLB_RANK_ANY, -1, 0,
+                    ADLB_DEFAULT_PUT_OPTS);
+      TEST_RC(ac);
+    }
+  }
+
+  long count = 0;
+  while (true)
+  {
+    int i, length, answer, type;
+    MPI_Comm task_comm;
+    ac = ADLB_Get(0, &i, &length, &answer, &type, &task_comm);
+    if (ac == ADLB_SHUTDOWN)
+      break;
+    TEST_RC(ac);
+    TEST_CHECK(length == (int)sizeof(i), "bad task length: %i", length);
+    usleep(TASK_USEC);
+    count++;
+  }
+
+  // Workers are assigned to servers round-robin, so worker 0 is the
+  // only one on the first server if there is one worker per server
+  long counts[2] = { rank == 0 ? count : 0, rank == 0 ? 0 : count };
+  long totals[2];
+  MPI_Allreduce(counts, totals, 2, MPI_LONG, MPI_SUM, worker_comm);
+  TEST_CHECK(totals[0] + totals[1] == TASK_COUNT,
+             "ran %li tasks, expected %i", totals[0] + totals[1],
+             TASK_COUNT);
+  TEST_CHECK(totals[1] > 0, "no tasks were stolen");
+  return ADLB_SUCCESS;
+}
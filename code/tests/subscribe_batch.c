@@ -0,0 +1,269 @@
+/*
+ * Copyright 2015 University of Chicago and Argonne National Laboratory
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License
+ */
+
+
+/*
+ * subscribe_batch.c
+ *
+ * Regression test for batched remote subscribes, cf.
+ * ADLB_SUBSCRIBE_BATCH.  Each data-dependent task waits on many data
+ * and container members spread over all servers, some repeated and
+ * some already closed, so its server subscribes to several of them on
+ * each other server at once.  Every task must run once, after all of
+ * its inputs are closed.  Run with at least two servers.
+ */
+#include <inttypes.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include <mpi.h>
+#include <adlb.h>
+
+#include "common/mtests.h"
+
+/** Number of data created by each worker */
+#define DATA_COUNT 12
+/** Number of container members each task waits on */
+#define TASK_MEMBERS 2
+/** Number of data-dependent tasks put by each worker */
+#define TASK_COUNT 10
+
+/** Task payload: the inputs to check */
+typedef struct
+{
+  adlb_datum_id ids[DATA_COUNT];
+  adlb_datum_id container;
+  int index;
+} task;
+
+static adlb_code run(MPI_Comm worker_comm);
+
+int
+main()
+{
+  int mpi_argc = 0;
+  char** mpi_argv = NULL;
+  MPI_Init(&mpi_argc, &mpi_argv);
+
+  setenv("ADLB_SUBSCRIBE_BATCH", "1", 1);
+
+  int types[1] = {0};
+  int nservers = 3;
+  int am_server;
+  MPI_Comm worker_comm;
+  adlb_code ac = ADLB_Init(nservers, 1, types, &am_server,
+                           MPI_COMM_WORLD, &worker_comm);
+  if (ac != ADLB_SUCCESS)
+  {
+    fprintf(stderr, "ADLB_Init failed\n");
+    return 1;
+  }
+
+  if (am_server)
+  {
+    ac = ADLB_Server(1);
+  }
+  else
+  {
+    ac = run(worker_comm);
+    if (ac != ADLB_SUCCESS)
+    {
+      fprintf(stderr, "FAILED!: %i\n", ac);
+    }
+  }
+
+  ADLB_Finalize();
+  MPI_Finalize();
+  return (ac == ADLB_SUCCESS) ? 0 : 1;
+}
+
+/** Data and container shared by all tasks of this worker */
+static adlb_datum_id ids[DATA_COUNT];
+static adlb_datum_id container;
+
+/** Key of member j of task i */
+static int64_t
+member_key(int i, int j)
+{
+  return i * TASK_MEMBERS + j;
+}
+
+static adlb_subscript
+int_sub(int64_t key, char *buf)
+{
+  int len = sprintf(buf, "%"PRId64, key);
+  adlb_subscript sub = { .key = buf, .length = (size_t)len + 1 };
+  return sub;
+}
+
+/*
+  Put task i, waiting on all data, one of them twice, and its own
+  container members
+ */
+static adlb_code
+put_task(int i)
+{
+  adlb_datum_id wait_ids[DATA_COUNT + 1];
+  for (int k = 0; k < DATA_COUNT; k++)
+    wait_ids[k] = ids[k];
+  wait_ids[DATA_COUNT] = ids[i % DATA_COUNT];
+
+  char key_bufs[TASK_MEMBERS][32];
+  adlb_datum_id_sub wait_subs[TASK_MEMBERS];
+  for (int j = 0; j < TASK_MEMBERS; j++)
+  {
+    wait_subs[j].id = container;
+    wait_subs[j].subscript = int_sub(member_key(i, j), key_bufs[j]);
+  }
+
+  task t;
+  for (int k = 0; k < DATA_COUNT; k++)
+    t.ids[k] = ids[k];
+  t.container = container;
+  t.index = i;
+  adlb_code ac = ADLB_Dput(&t, (int)sizeof(t), ADLB_RANK_ANY, -1, 0,
+                ADLB_DEFAULT_PUT_OPTS, "subscribe_batch", wait_ids,
+                DATA_COUNT + 1, wait_subs, TASK_MEMBERS);
+  TEST_RC(ac);
+  return ADLB_SUCCESS;
+}
+
+static adlb_code
+store_integer(adlb_datum_id id, adlb_subscript sub, int64_t val,
+              adlb_refc decr)
+{
+  adlb_code ac = ADLB_Store(id, sub, ADLB_DATA_TYPE_INTEGER, &val,
+                            sizeof(val), decr, ADLB_NO_REFC);
+  TEST_RC(ac);
+  return ADLB_SUCCESS;
+}
+
+static adlb_code
+check_integer(adlb_datum_id id, adlb_subscript sub, int64_t expected)
+{
+  int64_t result[8];
+  size_t length;
+  adlb_data_type type;
+  adlb_code ac = ADLB_Retrieve(id, sub, ADLB_RETRIEVE_NO_REFC, &type,
+                               result, &length);
+  TEST_RC(ac);
+  TEST_CHECK(type == ADLB_DATA_TYPE_INTEGER &&
+             length == sizeof(int64_t) && result[0] == expected,
+             "Wrong value retrieved for <%"PRId64">", id);
+  return ADLB_SUCCESS;
+}
+
+/*
+  Run task: all inputs must be closed
+ */
+static adlb_code
+run_task(const task *t)
+{
+  adlb_code ac;
+  for (int k = 0; k < DATA_COUNT; k++)
+  {
+    ac = check_integer(t->ids[k], ADLB_NO_SUB, t->ids[k]);
+    TEST_RC(ac);
+  }
+  for (int j = 0; j < TASK_MEMBERS; j++)
+  {
+    char key_buf[32];
+    int64_t key = member_key(t->index, j);
+    ac = check_integer(t->container, int_sub(key, key_buf), key);
+    TEST_RC(ac);
+  }
+  return ADLB_SUCCESS;
+}
+
+static adlb_code
+run(MPI_Comm worker_comm)
+{
+  adlb_code ac;
+  int rank, workers;
+  MPI_Comm_rank(worker_comm, &rank);
+  MPI_Comm_size(worker_comm, &workers);
+
+  // ADLB_Unique() assigns ids round-robin, so data are spread over
+  // all servers
+  for (int i = 0; i < DATA_COUNT; i++)
+  {
+    ac = ADLB_Unique(&ids[i]);
+    TEST_RC(ac);
+    ac = ADLB_Create_integer(ids[i], DEFAULT_CREATE_PROPS, NULL);
+    TEST_RC(ac);
+  }
+  ac = ADLB_Unique(&container);
+  TEST_RC(ac);
+  ac = ADLB_Create_container(container, ADLB_DATA_TYPE_INTEGER,
+                  ADLB_DATA_TYPE_INTEGER, DEFAULT_CREATE_PROPS, NULL);
+  TEST_RC(ac);
+
+  // Close some inputs before the tasks subscribe to them
+  for (int i = 0; i < DATA_COUNT; i += 2)
+  {
+    ac = store_integer(ids[i], ADLB_NO_SUB, ids[i], ADLB_WRITE_REFC);
+    TEST_RC(ac);
+  }
+
+  for (int i = 0; i < TASK_COUNT; i++)
+  {
+    ac = put_task(i);
+    TEST_RC(ac);
+  }
+
+  for (int i = 1; i < DATA_COUNT; i += 2)
+  {
+    ac = store_integer(ids[i], ADLB_NO_SUB, ids[i], ADLB_WRITE_REFC);
+    TEST_RC(ac);
+  }
+  for (int i = 0; i < TASK_COUNT; i++)
+  {
+    for (int j = 0; j < TASK_MEMBERS; j++)
+    {
+      char key_buf[32];
+      int64_t key = member_key(i, j);
+      bool last = (i == TASK_COUNT - 1 && j == TASK_MEMBERS - 1);
+      ac = store_integer(container, int_sub(key, key_buf), key,
+                         last ? ADLB_WRITE_REFC : ADLB_NO_REFC);
+      TEST_RC(ac);
+    }
+  }
+
+  long count = 0;
+  while (true)
+  {
+    task t;
+    int length, answer, type;
+    MPI_Comm task_comm;
+    ac = ADLB_Get(0, &t, &length, &answer, &type, &task_comm);
+    if (ac == ADLB_SHUTDOWN)
+      break;
+    TEST_RC(ac);
+    TEST_CHECK(length == (int)sizeof(t), "bad task length: %i", length);
+
+    ac = run_task(&t);
+    TEST_RC(ac);
+    count++;
+  }
+
+  long total;
+  MPI_Allreduce(&count, &total, 1, MPI_LONG, MPI_SUM, worker_comm);
+  TEST_CHECK(total == (long)workers * TASK_COUNT,
+             "ran %li tasks, expected %li", total,
+             (long)workers * TASK_COUNT);
+  return ADLB_SUCCESS;
+}
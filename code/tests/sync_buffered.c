@@ -0,0 +1,227 @@
+/*
+ * Copyright 2015 University of Chicago and Argonne National Laboratory
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License
+ */
+
+
+/*
+ * sync_buffered.c
+ *
+ * Regression test for buffered server-to-server syncs,
+ * cf. ADLB_SYNC_BUFFERED.  With a single credit per target, bursts
+ * of subscribe and notify messages for data on other servers must be
+ * backlogged and delivered in order, and steal probes must still get
+ * through.  Run with at least two servers.
+ */
+#include <inttypes.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include <mpi.h>
+#include <adlb.h>
+
+#include "common/mtests.h"
+
+/** Number of data created by each worker */
+#define DATA_COUNT 60
+/** Number of data each data-dependent task waits on */
+#define TASK_INPUTS 3
+/** Number of data-dependent tasks put by each worker */
+#define DPUT_COUNT (DATA_COUNT / TASK_INPUTS)
+/** Number of plain tasks put by the first worker, for others to steal */
+#define PUT_COUNT 200
+
+static adlb_code run(MPI_Comm worker_comm);
+
+int
+main()
+{
+  int mpi_argc = 0;
+  char** mpi_argv = NULL;
+  MPI_Init(&mpi_argc, &mpi_argv);
+
+  // Use one credit per target so that messages are backlogged
+  setenv("ADLB_SYNC_BUFFERED", "1", 1);
+  setenv("ADLB_SYNC_CREDITS", "1", 1);
+
+  int types[1] = {0};
+  int nservers = 3;
+  int am_server;
+  MPI_Comm worker_comm;
+  adlb_code ac = ADLB_Init(nservers, 1, types, &am_server,
+                           MPI_COMM_WORLD, &worker_comm);
+  if (ac != ADLB_SUCCESS)
+  {
+    fprintf(stderr, "ADLB_Init failed\n");
+    return 1;
+  }
+
+  if (am_server)
+  {
+    ac = ADLB_Server(1);
+  }
+  else
+  {
+    ac = run(worker_comm);
+    if (ac != ADLB_SUCCESS)
+    {
+      fprintf(stderr, "FAILED!: %i\n", ac);
+    }
+  }
+
+  ADLB_Finalize();
+  MPI_Finalize();
+  return (ac == ADLB_SUCCESS) ? 0 : 1;
+}
+
+/*
+  Create data with ids from ADLB_Unique(), which assigns ids
+  round-robin, so consecutive data live on different servers
+ */
+static adlb_code
+create_data(adlb_datum_id *ids, int count)
+{
+  adlb_code ac;
+  for (int i = 0; i < count; i++)
+  {
+    ac = ADLB_Unique(&ids[i]);
+    TEST_RC(ac);
+    ac = ADLB_Create_integer(ids[i], DEFAULT_CREATE_PROPS, NULL);
+    TEST_RC(ac);
+  }
+  return ADLB_SUCCESS;
+}
+
+/*
+  Put tasks that wait on data held by other servers, so the task's
+  server subscribes to them remotely
+ */
+static adlb_code
+put_tasks(const adlb_datum_id *ids)
+{
+  adlb_code ac;
+  for (int i = 0; i < DPUT_COUNT; i++)
+  {
+    const adlb_datum_id *inputs = &ids[i * TASK_INPUTS];
+    ac = ADLB_Dput(inputs, (int)(TASK_INPUTS * sizeof(inputs[0])),
+                   ADLB_RANK_ANY, -1, 0, ADLB_DEFAULT_PUT_OPTS,
+                   "sync_buffered", inputs, TASK_INPUTS, NULL, 0);
+    TEST_RC(ac);
+  }
+  return ADLB_SUCCESS;
+}
+
+/*
+  Close data, so their servers notify the subscribed servers
+ */
+static adlb_code
+store_data(const adlb_datum_id *ids, int count)
+{
+  adlb_code ac;
+  for (int i = 0; i < count; i++)
+  {
+    int64_t val = ids[i];
+    ac = ADLB_Store(ids[i], ADLB_NO_SUB, ADLB_DATA_TYPE_INTEGER, &val,
+                    sizeof(val), ADLB_WRITE_REFC, ADLB_NO_REFC);
+    TEST_RC(ac);
+  }
+  return ADLB_SUCCESS;
+}
+
+/*
+  Run a data-dependent task: all inputs must be closed
+ */
+static adlb_code
+check_inputs(const adlb_datum_id *inputs)
+{
+  adlb_code ac;
+  for (int i = 0; i < TASK_INPUTS; i++)
+  {
+    int64_t result[8];
+    size_t length;
+    adlb_data_type type;
+    ac = ADLB_Retrieve(inputs[i], ADLB_NO_SUB, ADLB_RETRIEVE_NO_REFC,
+                       &type, result, &length);
+    TEST_RC(ac);
+    TEST_CHECK(type == ADLB_DATA_TYPE_INTEGER &&
+               length == sizeof(int64_t) && result[0] == inputs[i],
+               "Wrong value retrieved for <%"PRId64">", inputs[i]);
+  }
+  return ADLB_SUCCESS;
+}
+
+static adlb_code
+run(MPI_Comm worker_comm)
+{
+  adlb_code ac;
+  int rank, workers;
+  MPI_Comm_rank(worker_comm, &rank);
+  MPI_Comm_size(worker_comm, &workers);
+
+  adlb_datum_id ids[DATA_COUNT];
+  ac = create_data(ids, DATA_COUNT);
+  TEST_RC(ac);
+
+  ac = put_tasks(ids);
+  TEST_RC(ac);
+
+  if (rank == 0)
+  {
+    for (int i = 0; i < PUT_COUNT; i++)
+    {
+      ac = ADLB_Put(&i, (int)sizeof(i), ADLB_RANK_ANY, -1, 0,
+                    ADLB_DEFAULT_PUT_OPTS);
+      TEST_RC(ac);
+    }
+  }
+
+  ac = store_data(ids, DATA_COUNT);
+  TEST_RC(ac);
+
+  long dput_count = 0, put_count = 0;
+  while (true)
+  {
+    adlb_datum_id payload[TASK_INPUTS];
+    int length, answer, type;
+    MPI_Comm task_comm;
+    ac = ADLB_Get(0, payload, &length, &answer, &type, &task_comm);
+    if (ac == ADLB_SHUTDOWN)
+      break;
+    TEST_RC(ac);
+
+    if (length == (int)sizeof(payload))
+    {
+      ac = check_inputs(payload);
+      TEST_RC(ac);
+      dput_count++;
+    }
+    else
+    {
+      TEST_CHECK(length == (int)sizeof(int), "bad task length: %i",
+                 length);
+      put_count++;
+    }
+  }
+
+  long counts[2] = { dput_count, put_count };
+  long totals[2];
+  MPI_Allreduce(counts, totals, 2, MPI_LONG, MPI_SUM, worker_comm);
+  TEST_CHECK(totals[0] == (long)workers * DPUT_COUNT,
+             "ran %li data-dependent tasks, expected %li",
+             totals[0], (long)workers * DPUT_COUNT);
+  TEST_CHECK(totals[1] == PUT_COUNT, "ran %li tasks, expected %i",
+             totals[1], PUT_COUNT);
+  return ADLB_SUCCESS;
+}
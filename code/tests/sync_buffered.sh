@@ -0,0 +1,9 @@
+#!/bin/bash
+set -e
+
+THIS=$0
+EXEC=${THIS%.sh}.x
+OUTPUT=${THIS%.sh}.out
+
+# 3 servers, 5 workers
+mpiexec -n 8 ${EXEC} > ${OUTPUT} 2>&1
@@ -0,0 +1,135 @@
+/*
+ * Copyright 2015 University of Chicago and Argonne National Laboratory
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License
+ */
+
+
+/*
+ * termination.c
+ *
+ * Regression test for distributed termination detection: workers
+ * spawn trees of tasks targeted at random workers, so tasks are
+ * forwarded and stolen between servers while others go idle.  Every
+ * task must run before ADLB_Get() returns ADLB_SHUTDOWN.  Run with at
+ * least two servers.
+ */
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include <mpi.h>
+#include <adlb.h>
+
+#include "common/mtests.h"
+
+/** Number of root tasks put by each worker */
+#define ROOTS 4
+/** Each task of depth d > 0 puts two tasks of depth d-1 */
+#define DEPTH 5
+/** Number of tasks in the tree under each root */
+#define TREE_SIZE ((2 << DEPTH) - 1)
+
+static adlb_code run(MPI_Comm worker_comm);
+
+int
+main()
+{
+  int mpi_argc = 0;
+  char** mpi_argv = NULL;
+  MPI_Init(&mpi_argc, &mpi_argv);
+
+  int types[1] = {0};
+  int nservers = 3;
+  int am_server;
+  MPI_Comm worker_comm;
+  adlb_code ac = ADLB_Init(nservers, 1, types, &am_server,
+                           MPI_COMM_WORLD, &worker_comm);
+  if (ac != ADLB_SUCCESS)
+  {
+    fprintf(stderr, "ADLB_Init failed\n");
+    return 1;
+  }
+
+  if (am_server)
+  {
+    ac = ADLB_Server(1);
+  }
+  else
+  {
+    ac = run(worker_comm);
+    if (ac != ADLB_SUCCESS)
+    {
+      fprintf(stderr, "FAILED!: %i\n", ac);
+    }
+  }
+
+  ADLB_Finalize();
+  MPI_Finalize();
+  return (ac == ADLB_SUCCESS) ? 0 : 1;
+}
+
+static adlb_code
+put_task(int depth, int target)
+{
+  adlb_code ac = ADLB_Put(&depth, (int)sizeof(depth), target, -1, 0,
+                          ADLB_DEFAULT_PUT_OPTS);
+  TEST_RC(ac);
+  return ADLB_SUCCESS;
+}
+
+static adlb_code
+run(MPI_Comm worker_comm)
+{
+  adlb_code ac;
+  int rank, workers;
+  MPI_Comm_rank(worker_comm, &rank);
+  MPI_Comm_size(worker_comm, &workers);
+  srand((unsigned)rank + 1);
+
+  for (int i = 0; i < ROOTS; i++)
+  {
+    ac = put_task(DEPTH, ADLB_RANK_ANY);
+    TEST_RC(ac);
+  }
+
+  long count = 0;
+  while (true)
+  {
+    int depth, length, answer, type;
+    MPI_Comm task_comm;
+    ac = ADLB_Get(0, &depth, &length, &answer, &type, &task_comm);
+    if (ac == ADLB_SHUTDOWN)
+      break;
+    TEST_RC(ac);
+    TEST_CHECK(length == (int)sizeof(depth), "bad task length: %i",
+               length);
+    count++;
+
+    if (depth > 0)
+    {
+      // Worker ranks are numbered from 0 in MPI_COMM_WORLD
+      ac = put_task(depth - 1, rand() % workers);
+      TEST_RC(ac);
+      ac = put_task(depth - 1, ADLB_RANK_ANY);
+      TEST_RC(ac);
+    }
+  }
+
+  long total;
+  MPI_Allreduce(&count, &total, 1, MPI_LONG, MPI_SUM, worker_comm);
+  long expected = (long)workers * ROOTS * TREE_SIZE;
+  TEST_CHECK(total == expected, "ran %li tasks, expected %li",
+             total, expected);
+  return ADLB_SUCCESS;
+}